@@ -21,6 +21,14 @@ echo "Build complete"
 echo "Testing"
 
 src/cmnalib/./testlib
+src/cmnalib/./testtraffic
+src/cmnalib/./testutil
+src/cmnalib/./testdevices
+src/cmnalib/./testqmi
+src/cmnalib/./testmeas
+src/cmnalib/./testat
+src/cmnalib/./testalloc
+src/cmnalib/./cmnalib_bench -n 10 > /dev/null
 
 echo "Test complete"
 
@@ -1,8 +1,8 @@
  
 ### Traffic Test Config
 
-APPLICATION="traffic_test"
-APP_PARAMS="-n 10 -p 30 -s 3000000 -o $LOGDIR"
+APPLICATION="campaign"
+APP_PARAMS="-f $SCRIPTDIR/campaign.schedule -o $LOGDIR"
 
 LOCAL_HOSTNAME=$(hostname)
 
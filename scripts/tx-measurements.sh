@@ -5,8 +5,8 @@ SCRIPTDIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
 BUILDDIR="$SCRIPTDIR/../build/src/examples"
 LOGDIR="$SCRIPTDIR/../log"
 
-APPLICATION="traffic_test"
-APP_PARAMS="-n 10 -p 30 -s 1000000 -o $LOGDIR"
+APPLICATION="campaign"
+APP_PARAMS="-f $SCRIPTDIR/campaign.schedule -o $LOGDIR"
 APP_STDOUT="$LOGDIR/eventlog.log"
 
 LOCAL_HOSTNAME=$(hostname)
@@ -30,9 +30,12 @@ echo "Starting reversetunnel:"
 echo "screen -d -m $SCRIPTDIR/./ssh-reversetunnel-ng40.sh"
 screen -d -m $SCRIPTDIR/./ssh-reversetunnel-ng40.sh
 
+# The campaign keeps the modem open and recovers from faults by itself,
+# only restart it if the process terminates.
+(while true; do $BUILDDIR/./$APPLICATION $APP_PARAMS >> $APP_STDOUT; sleep 30; done) &
+
 while true;
 do
-	$BUILDDIR/./$APPLICATION $APP_PARAMS >> $APP_STDOUT
 	echo "running rsync"
 	rsync -e ssh $LOGDIR/* $STORAGE_SERVER_USER@$STORAGE_SERVER_ADDR:$STORAGE_SERVER_BASEDIR/$LOCAL_HOSTNAME
 	echo "pause for 30s"
@@ -0,0 +1,491 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <argp.h>
+
+#include "cmnalib/logger.h"
+#include "cmnalib/tokenfind.h"
+#include "cmnalib/trace_logger.h"
+#include "cmnalib/at_interface.h"
+#include "cmnalib/at_sierra_wireless_em7565.h"
+
+/**
+  Microbenchmarks of the per-sample hot paths. Each case runs one warm-up
+  operation (regex caches are compiled on first use) and then the timed
+  iterations. Allocations are counted by replacing the malloc family of
+  glibc, so allocations inside libc (regcomp, strdup, stdio) are included.
+  Results are printed as JSON to stdout.
+  */
+
+#define FIXTURE_PATH TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/"
+#define MAX_FIXTURE_LENGTH 8192
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+
+/*
+ * allocation counting
+ */
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+static unsigned long nof_allocs = 0;
+static unsigned long nof_alloc_bytes = 0;
+
+void* malloc(size_t size) {
+    nof_allocs++;
+    nof_alloc_bytes += size;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size) {
+    nof_allocs++;
+    nof_alloc_bytes += nmemb * size;
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    nof_allocs++;
+    nof_alloc_bytes += size;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+
+/*
+ * benchmark cases
+ */
+
+typedef struct bench_state {
+    const char* fixture;
+    const char* command;
+    char path[64];              // fixture repeated for every iteration
+    sw_em7565_t* modem;
+    at_interface_t* at;
+    trace_handle_t* trace;
+    sw_em7565_gstatus_response_t* status;
+    sw_em7565_lteinfo_response_t* lteinfo;
+    sw_em7565_information_response_t* information;
+    sw_em7565_gpsloc_response_t* gpsloc;
+    sw_em7565_current_operator_t* operator;
+    sw_em7565_band_profile_list_t* band_list;
+    sw_em7565_network_list_t* networks;
+} bench_state_t;
+
+typedef struct bench_case {
+    const char* name;
+    const char* fixture;        // em7565 fixture, NULL if unused
+    const char* command;        // answer of the fixture to use, NULL for its first command
+    int (*setup)(bench_state_t* s, int nof_ops);
+    int (*run)(bench_state_t* s);
+    void (*teardown)(bench_state_t* s);
+} bench_case_t;
+
+static const char gstatus_text[] =
+    "!GSTATUS: \n"
+    "Current Time:  7480             Temperature: 34\n"
+    "Reset Counter: 1                Mode:        ONLINE         \n"
+    "System mode:   LTE              PS state:    Not attached \n"
+    "LTE band:      B3               LTE bw:      20 MHz  \n"
+    "LTE Rx chan:   1300             LTE Tx chan: 19300\n"
+    "EMM state:     Deregistered     Attach Needed  \n"
+    "RRC state:     RRC Idle       \n"
+    "PCC RxM RSSI:  -49              PCC RxM RSRP:  -80\n"
+    "PCC RxD RSSI:  -92              PCC RxD RSRP:  -131\n"
+    "Tx Power:      --               TAC:         34bb (13499)\n"
+    "RSRQ (dB):     -10.7            Cell ID:     01c07902 (29391106)\n"
+    "SINR (dB):      5.2\n"
+    "\n"
+    "OK\n";
+
+static const char intrafreq_table[] =
+    "PCI  RSRQ   RSRP   RSSI RXLV\n"
+    "166 -13.0  -80.9  -58.9 --\n"
+    "167  -9.4  -78.5  -46.1 --\n"
+    "418 -19.0  -92.8  -60.1 --\n"
+    "417 -20.0  -94.5  -60.1 --\n";
+
+typedef struct bench_gstatus {
+    int current_time;
+    int temperature;
+    int lte_band;
+    int lte_rx_chan;
+    int pcc_rxm_rsrp;
+    float rsrq;
+    float sinr;
+    char mode[32];
+    char system_mode[32];
+} bench_gstatus_t;
+
+static tokenfind_batch_t int_jobs[] = {
+    {offsetof(bench_gstatus_t, current_time), "Current Time:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
+    {offsetof(bench_gstatus_t, temperature), "Temperature:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
+    {offsetof(bench_gstatus_t, lte_band), "LTE band:[[:space:]]\\{1,\\}[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
+    {offsetof(bench_gstatus_t, lte_rx_chan), "LTE Rx chan:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
+    {offsetof(bench_gstatus_t, pcc_rxm_rsrp), "PCC RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
+};
+
+static tokenfind_batch_t float_jobs[] = {
+    {offsetof(bench_gstatus_t, rsrq), "RSRQ (dB):[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL},
+    {offsetof(bench_gstatus_t, sinr), "SINR (dB):[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL},
+};
+
+static tokenfind_batch_t string_jobs[] = {
+    {offsetof(bench_gstatus_t, mode), "Mode:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
+    {offsetof(bench_gstatus_t, system_mode), "System mode:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
+};
+
+static bench_gstatus_t gstatus_result;
+
+static int run_integer_batch(bench_state_t* s) {
+    return tokenfind_integer_batch(gstatus_text, &gstatus_result, int_jobs, NELEMS(int_jobs)) == (int)NELEMS(int_jobs) ? 0 : -1;
+}
+
+static int run_float_batch(bench_state_t* s) {
+    return tokenfind_float_batch(gstatus_text, &gstatus_result, float_jobs, NELEMS(float_jobs)) == (int)NELEMS(float_jobs) ? 0 : -1;
+}
+
+static int run_string_batch(bench_state_t* s) {
+    return tokenfind_string_batch(gstatus_text, &gstatus_result, string_jobs, NELEMS(string_jobs), sizeof(gstatus_result.mode)) == (int)NELEMS(string_jobs) ? 0 : -1;
+}
+
+static int run_parse_table(bench_state_t* s) {
+    tokenfind_string_table_t* t = tokenfind_parse_table(intrafreq_table);
+    int ret = t != NULL && t->n_rows == 5 ? 0 : -1;
+    tokenfind_free_table(t);
+    return ret;
+}
+
+/**
+  Copies one command and its answer from the fixture nof_ops times into a
+  temporary file. Without s->command the first one is used, otherwise the
+  last answer to s->command, as the fixtures list failing answers first.
+  */
+static int setup_fixture(bench_state_t* s, int nof_ops) {
+    char block[MAX_FIXTURE_LENGTH];
+    char current[MAX_FIXTURE_LENGTH];
+    char line[1024];
+    size_t len = 0;
+    size_t current_len = 0;
+
+    FILE* in = fopen(s->fixture, "r");
+    if(in == NULL) {
+        ERROR("Could not open fixture %s\n", s->fixture);
+        return -1;
+    }
+    while(fgets(line, sizeof(line), in) != NULL && current_len + strlen(line) < sizeof(current)) {
+        strcpy(current + current_len, line);
+        current_len += strlen(line);
+        if(strcmp(line, "OK\n") != 0 && strstr(line, "ERROR") == NULL) continue;
+
+        // end of a command and its answer
+        size_t cmd_len = strcspn(current, "\n");
+        if(s->command == NULL || (strlen(s->command) == cmd_len && strncmp(current, s->command, cmd_len) == 0)) {
+            memcpy(block, current, current_len);
+            len = current_len;
+            if(s->command == NULL) break;
+        }
+        current_len = 0;
+    }
+    fclose(in);
+    if(len == 0) {
+        ERROR("No answer to %s in fixture %s\n", s->command != NULL ? s->command : "any command", s->fixture);
+        return -1;
+    }
+
+    strcpy(s->path, "/tmp/cmnalib_bench_XXXXXX");
+    int fd = mkstemp(s->path);
+    if(fd < 0) return -1;
+    FILE* out = fdopen(fd, "w");
+    if(out == NULL) {
+        close(fd);
+        return -1;
+    }
+    for(int i = 0; i < nof_ops; i++) {
+        fwrite(block, 1, len, out);
+    }
+    fclose(out);
+    return 0;
+}
+
+static void teardown_fixture(bench_state_t* s) {
+    if(s->path[0] != 0) unlink(s->path);
+}
+
+static int setup_em7565(bench_state_t* s, int nof_ops) {
+    char device[128];
+    if(setup_fixture(s, nof_ops) != 0) return -1;
+    snprintf(device, sizeof(device), "mock:%s", s->path);
+    s->modem = sw_em7565_init(device);
+    s->status = sw_em7565_allocate_status();
+    s->lteinfo = sw_em7565_allocate_lteinfo();
+    s->information = sw_em7565_allocate_information();
+    s->gpsloc = sw_em7565_allocate_gpsloc();
+    s->operator = sw_em7565_allocate_current_operator();
+    s->band_list = sw_em7565_allocate_band_config_profile_list();
+    s->networks = sw_em7565_allocate_network_list();
+    return s->modem != NULL && s->status != NULL && s->lteinfo != NULL && s->information != NULL &&
+           s->gpsloc != NULL && s->operator != NULL && s->band_list != NULL && s->networks != NULL ? 0 : -1;
+}
+
+static void teardown_em7565(bench_state_t* s) {
+    sw_em7565_destroy(s->modem);
+    sw_em7565_free_status(s->status);
+    sw_em7565_free_lteinfo(s->lteinfo);
+    sw_em7565_free_information(s->information);
+    sw_em7565_free_get_gpsloc(s->gpsloc);
+    sw_em7565_free_current_operator(s->operator);
+    sw_em7565_free_band_config_profile_list(s->band_list);
+    sw_em7565_free_network_list(s->networks);
+    teardown_fixture(s);
+}
+
+static int run_get_status(bench_state_t* s) {
+    return sw_em7565_get_status(s->modem, s->status) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_status_trace_fields(bench_state_t* s) {
+    return sw_em7565_get_status_fields(s->modem, SW_EM7565_GSTATUS_TRACE, s->status) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_lteinfo(bench_state_t* s) {
+    return sw_em7565_get_lteinfo(s->modem, s->lteinfo) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_gps_autostart_mode(bench_state_t* s) {
+    sw_em7565_gps_autostart_mode_t mode;
+    return sw_em7565_get_gps_autostart_mode(s->modem, &mode) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_gps_status(bench_state_t* s) {
+    sw_em7565_gps_status_t status;
+    return sw_em7565_gps_status(s->modem, &status) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_radio_access_type(bench_state_t* s) {
+    sw_em7565_radio_access_type_t rat;
+    return sw_em7565_get_radio_access_type(s->modem, &rat) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_information(bench_state_t* s) {
+    return sw_em7565_get_information(s->modem, s->information) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_gpsloc(bench_state_t* s) {
+    return sw_em7565_get_gpsloc(s->modem, s->gpsloc) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_current_operator(bench_state_t* s) {
+    return sw_em7565_get_current_operator(s->modem, s->operator) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_network_search(bench_state_t* s) {
+    return sw_em7565_network_search(s->modem, s->networks) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_band_config_profile(bench_state_t* s) {
+    sw_em7565_band_profile_t profile;
+    return sw_em7565_get_band_config_profile(s->modem, &profile) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_band_config_profile_list(bench_state_t* s) {
+    return sw_em7565_get_band_config_profile_list(s->modem, s->band_list) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int run_get_protected_commands(bench_state_t* s) {
+    int enable;
+    return sw_em7565_get_protected_commands(s->modem, &enable) == SW_RESPONSE_SUCCESS ? 0 : -1;
+}
+
+static int setup_mock_transport(bench_state_t* s, int nof_ops) {
+    char device[128];
+    if(setup_fixture(s, nof_ops) != 0) return -1;
+    snprintf(device, sizeof(device), "mock:%s", s->path);
+    s->at = at_interface_open(device);
+    return s->at != NULL ? 0 : -1;
+}
+
+static void teardown_mock_transport(bench_state_t* s) {
+    at_interface_close(s->at);
+    teardown_fixture(s);
+}
+
+static int run_mock_transport(bench_state_t* s) {
+    static const at_interface_command_t cmd = {0, "at", 1, 0};
+    at_interface_response_t* response = NULL;
+    int ret = at_interface_command(s->at, &cmd, NULL, &response) == AT_RESPONSE_SUCCESS ? 0 : -1;
+    at_interface_free_response(response);
+    return ret;
+}
+
+static int setup_trace(bench_state_t* s, int nof_ops) {
+    s->trace = trace_init("/dev/null");
+    return s->trace != NULL ? 0 : -1;
+}
+
+static void teardown_trace(bench_state_t* s) {
+    trace_destroy(s->trace);
+}
+
+static int run_write_trace(bench_state_t* s) {
+    trace_data_t d = {
+        .time_sec = 1549871829, .time_usec = 123456,
+        .trace_transmission_counter = 42, .datarate = 12.5e6,
+        .sinr = 5.2, .rsrq = -10.7, .pcc_rsrp = -80, .scc_rsrp = -131,
+        .pcc_rssi = -49, .scc_rssi = -92, .tx_power = 3, .rxlv = 0,
+        .lte_band = 3, .lte_bw_MHz = 20, .lte_rx_chan = 1300, .lte_tx_chan = 19300,
+        .mcc = 262, .mnc = 1, .tac = 13499, .cell_id = 29391106, .pci = 167,
+        .nof_intrafreq_neighbours = 4, .nof_interfreq_neighbours = 5,
+        .total_distance = 1234.5, .latitude = 51.4925, .longitude = 7.4137,
+        .altitude = 112, .velocity_h = 13.9, .velocity_v = 0.1,
+    };
+    write_trace(s->trace, &d);
+    return 0;
+}
+
+static const bench_case_t cases[] = {
+    {"tokenfind_integer_batch", NULL, NULL, NULL, run_integer_batch, NULL},
+    {"tokenfind_float_batch", NULL, NULL, NULL, run_float_batch, NULL},
+    {"tokenfind_string_batch", NULL, NULL, NULL, run_string_batch, NULL},
+    {"tokenfind_parse_table", NULL, NULL, NULL, run_parse_table, NULL},
+    {"sw_em7565_get_status/at_gstatus_1", "at_gstatus_1.txt", NULL, setup_em7565, run_get_status, teardown_em7565},
+    {"sw_em7565_get_status/at_gstatus_2", "at_gstatus_2.txt", NULL, setup_em7565, run_get_status, teardown_em7565},
+    {"sw_em7565_get_status/at_gstatus_3", "at_gstatus_3.txt", NULL, setup_em7565, run_get_status, teardown_em7565},
+    {"sw_em7565_get_status/at_gstatus_4", "at_gstatus_4.txt", NULL, setup_em7565, run_get_status, teardown_em7565},
+    {"sw_em7565_get_status_fields/trace/at_gstatus_1", "at_gstatus_1.txt", NULL, setup_em7565, run_get_status_trace_fields, teardown_em7565},
+    {"sw_em7565_get_lteinfo/at_lteinfo_1", "at_lteinfo_1.txt", NULL, setup_em7565, run_get_lteinfo, teardown_em7565},
+    {"sw_em7565_get_information/at_info_1", "at_info_1.txt", NULL, setup_em7565, run_get_information, teardown_em7565},
+    {"sw_em7565_get_gps_autostart_mode/at_gpsautostart_1", "at_gpsautostart_1.txt", NULL, setup_em7565, run_get_gps_autostart_mode, teardown_em7565},
+    {"sw_em7565_gps_status/at_gpsstatus_1", "at_gpsstatus_1.txt", NULL, setup_em7565, run_gps_status, teardown_em7565},
+    {"sw_em7565_get_gpsloc/at_gps_1", "at_gps_1.txt", "at!gpsloc?", setup_em7565, run_get_gpsloc, teardown_em7565},
+    {"sw_em7565_get_radio_access_type/at_selrat_1", "at_selrat_1.txt", NULL, setup_em7565, run_get_radio_access_type, teardown_em7565},
+    {"sw_em7565_get_current_operator/at_cops_1", "at_cops_1.txt", "at+cops?", setup_em7565, run_get_current_operator, teardown_em7565},
+    {"sw_em7565_network_search/at_cops_1", "at_cops_1.txt", "at+cops=?", setup_em7565, run_network_search, teardown_em7565},
+    {"sw_em7565_get_band_config_profile/at_band_1", "at_band_1.txt", "at!band?", setup_em7565, run_get_band_config_profile, teardown_em7565},
+    {"sw_em7565_get_band_config_profile_list/at_band_1", "at_band_1.txt", "at!band=?", setup_em7565, run_get_band_config_profile_list, teardown_em7565},
+    {"sw_em7565_get_protected_commands/at_entercnd_1", "at_entercnd_1.txt", "at!entercnd?", setup_em7565, run_get_protected_commands, teardown_em7565},
+    {"at_transport_file_mock/at_ready_1", "at_ready_1.txt", NULL, setup_mock_transport, run_mock_transport, teardown_mock_transport},
+    {"write_trace", NULL, NULL, setup_trace, run_write_trace, teardown_trace},
+};
+
+static double now_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/* prints one JSON object, returns 0 if every operation succeeded */
+static int run_case(const bench_case_t* c, int nof_ops, int first) {
+    bench_state_t s;
+    char fixture[512];
+    int failures = 0;
+
+    memset(&s, 0, sizeof(s));
+    if(c->fixture != NULL) {
+        snprintf(fixture, sizeof(fixture), "%s%s", FIXTURE_PATH, c->fixture);
+        s.fixture = fixture;
+        s.command = c->command;
+    }
+    // one more operation for the warm-up
+    if(c->setup != NULL && c->setup(&s, nof_ops + 1) != 0) {
+        ERROR("Setup of %s failed\n", c->name);
+        if(c->teardown != NULL) c->teardown(&s);
+        return -1;
+    }
+    if(c->run(&s) != 0) failures++;
+
+    unsigned long allocs_start = nof_allocs;
+    unsigned long bytes_start = nof_alloc_bytes;
+    double start = now_ns();
+    for(int i = 0; i < nof_ops; i++) {
+        if(c->run(&s) != 0) failures++;
+    }
+    double elapsed = now_ns() - start;
+    unsigned long allocs = nof_allocs - allocs_start;
+    unsigned long bytes = nof_alloc_bytes - bytes_start;
+
+    if(c->teardown != NULL) c->teardown(&s);
+
+    printf("%s\n    {\"name\": \"%s\", \"iterations\": %d, \"ns_per_op\": %.1f, "
+           "\"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f, \"failures\": %d}",
+           first ? "" : ",", c->name, nof_ops, elapsed / nof_ops,
+           (double)allocs / nof_ops, (double)bytes / nof_ops, failures);
+    return failures == 0 ? 0 : -1;
+}
+
+const char *argp_program_version =
+        "cmnalib_bench";
+const char *argp_program_bug_address =
+        "<robert.falkenberg@tu-dortmund.de>";
+
+static char doc[] =
+        "cmnalib_bench -- Microbenchmarks of parsers, AT transport and trace writing\n"
+        "Prints ns/op, allocations/op and bytes/op of each case as JSON.";
+
+static char args_doc[] = "";
+
+static struct argp_option options[] = {
+    {"iterations", 'n', "N",      0, "Timed operations per case (default: 1000)" },
+    {"filter",     'f', "STRING", 0, "Only run cases whose name contains STRING" },
+    { 0 }
+};
+
+struct arguments {
+    int nof_ops;
+    const char* filter;
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state) {
+    struct arguments *arguments = state->input;
+
+    switch (key)
+    {
+    case 'n':
+        arguments->nof_ops = atoi(arg);
+        break;
+    case 'f':
+        arguments->filter = arg;
+        break;
+    case ARGP_KEY_ARG:
+        argp_usage(state);
+        break;
+    case ARGP_KEY_END:
+        if(arguments->nof_ops < 1) {
+            argp_usage (state);
+        }
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+int main(int argc, char** argv) {
+    struct arguments arguments;
+    arguments.nof_ops = 1000;
+    arguments.filter = NULL;
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+
+    logger_set_all_levels(LOGGER_VERBOSE_NONE);
+
+    int ret = EXIT_SUCCESS;
+    int first = 1;
+    printf("{\"benchmarks\": [");
+    for(size_t i = 0; i < NELEMS(cases); i++) {
+        if(arguments.filter != NULL && strstr(cases[i].name, arguments.filter) == NULL) continue;
+        if(run_case(&cases[i], arguments.nof_ops, first) != 0) ret = EXIT_FAILURE;
+        first = 0;
+    }
+    printf("\n]}\n");
+    return ret;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Heap allocator used by the library for everything it allocates and
+  releases itself (responses, parser tables, device lists, handles).
+  Allocations inside libc (regcomp, stdio), glib containers and libudev
+  are not routed through it.
+
+  Set the allocator once at startup, before the first library call:
+  memory must be released by the allocator that provided it.
+  */
+typedef struct allocator {
+    void* (*malloc)(void* context, size_t size);
+    void* (*calloc)(void* context, size_t nmemb, size_t size);
+    void* (*realloc)(void* context, void* ptr, size_t size);
+    void (*free)(void* context, void* ptr);
+    void* context;
+} allocator_t;
+
+/* copies the function table, NULL restores the libc allocator */
+void allocator_set(const allocator_t* allocator);
+void allocator_get(allocator_t* allocator);
+
+void* allocator_malloc(size_t size);
+void* allocator_calloc(size_t nmemb, size_t size);
+void* allocator_realloc(void* ptr, size_t size);
+void allocator_free(void* ptr);
+char* allocator_strdup(const char* str);
+char* allocator_strndup(const char* str, size_t n);
+
+/**
+  Counting allocator. Wraps the allocator that is active when it is
+  installed and counts calls and bytes across all threads.
+  */
+typedef struct allocator_stats {
+    unsigned long nof_allocs;           // malloc, calloc, realloc and strdup
+    unsigned long nof_frees;
+    unsigned long bytes_allocated;      // total requested
+    unsigned long bytes_in_use;
+    unsigned long peak_bytes_in_use;
+} allocator_stats_t;
+
+void allocator_counting_install();
+void allocator_counting_get_stats(allocator_stats_t* stats);
+/* clears the totals, bytes in use remain */
+void allocator_counting_reset_stats();
+
+#ifdef __cplusplus
+}
+#endif
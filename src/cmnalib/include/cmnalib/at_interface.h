@@ -1,5 +1,6 @@
 #pragma once 
 
+#include <stddef.h>
 #include <termios.h>
 
 #ifdef __cplusplus
@@ -13,6 +14,8 @@ extern "C" {
 
 #define AT_INTERFACE_MAX_CONSECUTIVE_TIMEOUTS 3
 
+#define AT_INTERFACE_MAX_CACHED_COMMANDS 16
+
 /**
   Errorcodes sorted by severity
   */
@@ -47,25 +50,106 @@ typedef struct {
 } at_interface_response_t;
 
 
-at_interface_t* at_interface_open(const char* tty_device_path);
+/**
+  Byte transport below the AT command layer, selected at runtime.
+  read waits up to timeout_ms for data and returns the number of bytes,
+  0 on timeout or -1 on error. write returns 0, -1 on error or
+  AT_TRANSPORT_MISMATCH if a replayed conversation does not contain the
+  command.
+  */
+#define AT_TRANSPORT_MISMATCH -2
+
+typedef struct at_transport {
+    int (*write)(void* transport_context, const char* buf, size_t len);
+    int (*read)(void* transport_context, char* buf, size_t buf_size, int timeout_ms);
+    int (*flush)(void* transport_context);
+    void (*close)(void* transport_context);
+    void* context;
+    const char* line_separator;     // terminates commands and response lines
+} at_transport_t;
+
+at_transport_t* at_transport_tty(const char* tty_device_path);
+
+/* response files of the unit tests: command line followed by the response lines */
+at_transport_t* at_transport_file_mock(const char* response_file);
+
+/**
+  Passes everything through to inner and logs each command and each
+  received chunk with its time in microseconds to filename.
+  */
+at_transport_t* at_transport_recorder(at_transport_t* inner, const char* filename);
+
+/**
+  Plays back a recording. Commands must match the recorded ones. With
+  realtime set, each chunk is delivered at its recorded offset to the
+  command, otherwise as fast as possible.
+  */
+at_transport_t* at_transport_replay(const char* filename, int realtime);
+
+/**
+  Transport from a device string, so that every entry point taking a tty
+  path also accepts a recording or fixture:
+  "mock:FILE", "replay:FILE", "replay-realtime:FILE", "record:FILE=TTY"
+  or a plain tty path.
+  */
+at_transport_t* at_transport_open(const char* device);
+
+void at_transport_destroy(at_transport_t* transport);
+
+/* opens at_transport_open(device) */
+at_interface_t* at_interface_open(const char* device);
+/* takes ownership of the transport, also on failure */
+at_interface_t* at_interface_open_transport(at_transport_t* transport);
 void at_interface_close(at_interface_t* h);
+/* at_interface_command_scheduled() with AT_PRIORITY_INTERACTIVE and no deadline */
 at_interface_response_status_t at_interface_command(at_interface_t* h,
                                               const at_interface_command_t* cmd,
                                               const char* params,
                                               at_interface_response_t** response);
-void at_interface_free_response(at_interface_response_t* r);
 
-#ifndef AT_MOCK
-    #define at_interface_open_tty at_interface_open
-    #define at_interface_close_tty at_interface_close
-    #define at_interface_command_tty at_interface_command
-    #define at_interface_free_response_tty at_interface_free_response
-#else
-    #define at_interface_open_mock at_interface_open
-    #define at_interface_close_mock at_interface_close
-    #define at_interface_command_mock at_interface_command
-    #define at_interface_free_response_mock at_interface_free_response
-#endif
+typedef enum at_interface_priority {
+    AT_PRIORITY_REALTIME = 0,   // periodic measurement sampling
+    AT_PRIORITY_INTERACTIVE,    // control and configuration
+    AT_PRIORITY_BACKGROUND,     // network scans and other long queries
+    AT_PRIORITY__MAX,
+} at_interface_priority_t;
+
+/**
+  Threads sharing an interface are served one command at a time, so
+  their bytes never interleave on the port. Waiting commands are ordered
+  by priority class, then by deadline (relative to the call in ms, 0 for
+  none), then by arrival. A query (command string ending in '?', without
+  params) that is waiting or on the wire is shared: later callers of the
+  same command get a copy of its response instead of sending it again. A
+  command on the wire is never preempted, so the realtime class waits at
+  most for the longest command issued on the same port.
+  */
+at_interface_response_status_t at_interface_command_scheduled(at_interface_t* h,
+                                                              const at_interface_command_t* cmd,
+                                                              const char* params,
+                                                              at_interface_priority_t priority,
+                                                              int deadline_ms,
+                                                              at_interface_response_t** response);
+
+/**
+  Serves a query from its last successful response for window_ms after
+  it was sent, 0 disables caching of cmd again. Any other command clears
+  the cache, as it may change the state (e.g. at!reset, at!gpsend).
+  Returns -1 if AT_INTERFACE_MAX_CACHED_COMMANDS are registered.
+  */
+int at_interface_set_cache_window(at_interface_t* h, const at_interface_command_t* cmd, int window_ms);
+/* e.g. after a command on another port of the same modem */
+void at_interface_clear_cache(at_interface_t* h);
+
+typedef struct at_interface_stats {
+    unsigned long nof_commands;                     // sent to the modem
+    unsigned long nof_coalesced;                    // answered by a shared query
+    unsigned long nof_cache_hits;
+    unsigned long max_wait_us[AT_PRIORITY__MAX];    // longest wait for the port per class
+} at_interface_stats_t;
+
+void at_interface_get_stats(at_interface_t* h, at_interface_stats_t* stats);
+void at_interface_free_response(at_interface_response_t* r);
 
 #ifdef __cplusplus
 }
@@ -12,7 +12,9 @@
 #include <gmodule.h>
 
 #include "cmnalib/at_interface.h"
+#include "cmnalib/hotplug.h"
 #include "cmnalib/at_sierra_wireless_common.h"
+#include "cmnalib/meas.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -99,8 +101,17 @@ typedef struct sw_em7565_gps_status {
   int fix_session_status_errcode;
 } sw_em7565_gps_status_t;
 
+/**
+  Handle of one modem. Measurement queries go to the primary AT port.
+  If a secondary port is opened, the long-running and configuration
+  commands (see sw_em7565_is_secondary_command()) go there instead, so
+  a network scan does not stall the polling on the primary port. The
+  handle may be shared between threads: each port serves one command
+  at a time, sampling queries ahead of control commands and scans.
+  */
 typedef struct {
     at_interface_t* tty;
+    at_interface_t* tty_secondary;      // NULL if not opened
 } sw_em7565_t;
 
 typedef struct {
@@ -138,12 +149,102 @@ typedef struct {
     float rsrp;
     float rssi;
     int rxlv;
+    int serving_valid;          // 1 if the fields above were reported, the modem may list no serving cell
     int nof_intrafreq_neighbours;
     sw_em7565_lteinfo_intrafreq_neighbour_t* intrafreq_neighbours;
     int nof_interfreq_neighbours;
     sw_em7565_lteinfo_interfreq_neighbour_t* interfreq_neighbours;
+    int _intrafreq_capacity;    // allocated neighbour entries, reused by sw_em7565_get_lteinfo()
+    int _interfreq_capacity;
 } sw_em7565_lteinfo_response_t;
 
+/**
+  Fields of sw_em7565_gstatus_response_t, in declaration order. Used as
+  bit index for the request mask of sw_em7565_get_status_fields() and
+  for the valid mask of the response.
+  */
+typedef enum sw_em7565_gstatus_field {
+    SW_EM7565_GSTATUS_CURRENT_TIME = 0,
+    SW_EM7565_GSTATUS_TEMPERATURE,
+    SW_EM7565_GSTATUS_RESET_COUNTER,
+    SW_EM7565_GSTATUS_MODE,
+    SW_EM7565_GSTATUS_SYSTEM_MODE,
+    SW_EM7565_GSTATUS_PS_STATE,
+    SW_EM7565_GSTATUS_LTE_BAND,
+    SW_EM7565_GSTATUS_LTE_BW_MHZ,
+    SW_EM7565_GSTATUS_LTE_RX_CHAN,
+    SW_EM7565_GSTATUS_LTE_TX_CHAN,
+    SW_EM7565_GSTATUS_LTE_SCC1_STATE,
+    SW_EM7565_GSTATUS_LTE_SCC1_BAND,
+    SW_EM7565_GSTATUS_LTE_SCC1_BW_MHZ,
+    SW_EM7565_GSTATUS_LTE_SCC1_CHAN,
+    SW_EM7565_GSTATUS_LTE_SCC2_STATE,
+    SW_EM7565_GSTATUS_LTE_SCC2_BAND,
+    SW_EM7565_GSTATUS_LTE_SCC2_BW_MHZ,
+    SW_EM7565_GSTATUS_LTE_SCC2_CHAN,
+    SW_EM7565_GSTATUS_LTE_SCC3_STATE,
+    SW_EM7565_GSTATUS_LTE_SCC3_BAND,
+    SW_EM7565_GSTATUS_LTE_SCC3_BW_MHZ,
+    SW_EM7565_GSTATUS_LTE_SCC3_CHAN,
+    SW_EM7565_GSTATUS_LTE_SCC4_STATE,
+    SW_EM7565_GSTATUS_LTE_SCC4_BAND,
+    SW_EM7565_GSTATUS_LTE_SCC4_BW_MHZ,
+    SW_EM7565_GSTATUS_LTE_SCC4_CHAN,
+    SW_EM7565_GSTATUS_EMM_STATE,
+    SW_EM7565_GSTATUS_RRC_STATE,
+    SW_EM7565_GSTATUS_IMS_REG_STATE,
+    SW_EM7565_GSTATUS_PCC_RXM_RSSI,
+    SW_EM7565_GSTATUS_PCC_RXM_RSRP,
+    SW_EM7565_GSTATUS_PCC_RXD_RSSI,
+    SW_EM7565_GSTATUS_PCC_RXD_RSRP,
+    SW_EM7565_GSTATUS_SCC1_RXM_RSSI,
+    SW_EM7565_GSTATUS_SCC1_RXM_RSRP,
+    SW_EM7565_GSTATUS_SCC1_RXD_RSSI,
+    SW_EM7565_GSTATUS_SCC1_RXD_RSRP,
+    SW_EM7565_GSTATUS_SCC2_RXM_RSSI,
+    SW_EM7565_GSTATUS_SCC2_RXM_RSRP,
+    SW_EM7565_GSTATUS_SCC2_RXD_RSSI,
+    SW_EM7565_GSTATUS_SCC2_RXD_RSRP,
+    SW_EM7565_GSTATUS_SCC3_RXM_RSSI,
+    SW_EM7565_GSTATUS_SCC3_RXM_RSRP,
+    SW_EM7565_GSTATUS_SCC3_RXD_RSSI,
+    SW_EM7565_GSTATUS_SCC3_RXD_RSRP,
+    SW_EM7565_GSTATUS_SCC4_RXM_RSSI,
+    SW_EM7565_GSTATUS_SCC4_RXM_RSRP,
+    SW_EM7565_GSTATUS_SCC4_RXD_RSSI,
+    SW_EM7565_GSTATUS_SCC4_RXD_RSRP,
+    SW_EM7565_GSTATUS_TX_POWER,
+    SW_EM7565_GSTATUS_TAC,
+    SW_EM7565_GSTATUS_RSRQ,
+    SW_EM7565_GSTATUS_CELL_ID,
+    SW_EM7565_GSTATUS_SINR,
+    SW_EM7565_GSTATUS__MAX
+} sw_em7565_gstatus_field_t;
+
+#define SW_EM7565_GSTATUS_BIT(FIELD) (1ull << (FIELD))
+#define SW_EM7565_GSTATUS_ALL ((1ull << SW_EM7565_GSTATUS__MAX) - 1)
+/* fields written to a trace_data_t */
+#define SW_EM7565_GSTATUS_TRACE ( \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_LTE_BAND) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_LTE_BW_MHZ) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_LTE_RX_CHAN) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_LTE_TX_CHAN) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_LTE_SCC1_BAND) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_LTE_SCC1_BW_MHZ) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_LTE_SCC1_CHAN) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_PCC_RXM_RSSI) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_PCC_RXM_RSRP) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_PCC_RXD_RSSI) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_PCC_RXD_RSRP) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_SCC1_RXM_RSSI) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_SCC1_RXM_RSRP) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_SCC1_RXD_RSSI) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_SCC1_RXD_RSRP) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_TX_POWER) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_RSRQ) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_CELL_ID) | \
+    SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_SINR))
+
 #define SW_EM7565_GSTATUS_RESPONSE_STRLEN 64
 typedef struct {
     int current_time;
@@ -202,8 +303,13 @@ typedef struct {
     int cell_id;
     float sinr;
 
+    uint64_t valid;     // SW_EM7565_GSTATUS_BIT() of the fields found in the last response
 } sw_em7565_gstatus_response_t;
 
+static inline int sw_em7565_status_has(const sw_em7565_gstatus_response_t* s, sw_em7565_gstatus_field_t field) {
+    return (s->valid & SW_EM7565_GSTATUS_BIT(field)) != 0;
+}
+
 #define SW_EM7565_INFORMATION_RESPONSE_STRLEN 128
 typedef struct {
     char manufacturer[SW_EM7565_INFORMATION_RESPONSE_STRLEN];
@@ -320,10 +426,28 @@ typedef struct sw_em7565_current_operator {
 double sw_em7565_gps_raw_to_double(int32_t int_value);
 
 GSList* sw_em7565_enumerate_devices();
+/* AT ports beside the primary one, the interface number depends on the USB composition */
+GSList* sw_em7565_enumerate_devices_on_interface(const char* usb_interface_num);
 void sw_em7565_enumerate_devices_free(GSList* list);
 
+/* AT port of the modem as seen by the hotplug monitor */
+extern const hotplug_match_t sw_em7565_hotplug_match;
+
 sw_em7565_t* sw_em7565_init_first();
+/* opens the first AT port added after the given generation, see hotplug_wait_for_device() */
+sw_em7565_t* sw_em7565_init_hotplug(hotplug_monitor_t* monitor, unsigned long added_after, int timeout_ms);
 sw_em7565_t* sw_em7565_init(const char* tty_device_path);
+/* secondary_device_path may be NULL, then all commands use the primary port */
+sw_em7565_t* sw_em7565_init_ports(const char* tty_device_path, const char* secondary_device_path);
+int sw_em7565_is_secondary_command(sw_em7565_cmd_t cmd);
+/* scheduling class of a command on its port, see at_interface_command_scheduled() */
+at_interface_priority_t sw_em7565_command_priority(sw_em7565_cmd_t cmd);
+/**
+  Lets consumers sharing the handle reuse a recent response, e.g.
+  SW_EM7565_AT_GSTATUS for 100 ms, instead of querying the modem again.
+  See at_interface_set_cache_window(), 0 disables it.
+  */
+int sw_em7565_set_cache_window(sw_em7565_t* h, sw_em7565_cmd_t cmd, int window_ms);
 void sw_em7565_destroy(sw_em7565_t* h);
 
 sw_response_t sw_em7565_is_ready(sw_em7565_t* h);
@@ -341,15 +465,28 @@ sw_em7565_band_profile_list_t* sw_em7565_allocate_band_config_profile_list();
 void sw_em7565_free_band_config_profile_list(sw_em7565_band_profile_list_t* s);
 
 sw_response_t sw_em7565_get_status(sw_em7565_t* h, sw_em7565_gstatus_response_t *result);
+/* parses only the fields in mask, e.g. SW_EM7565_GSTATUS_TRACE, others keep their value */
+sw_response_t sw_em7565_get_status_fields(sw_em7565_t* h, uint64_t mask, sw_em7565_gstatus_response_t *result);
 sw_em7565_gstatus_response_t* sw_em7565_allocate_status();
 void sw_em7565_free_status(sw_em7565_gstatus_response_t* s);
 
+/**
+  Fills the fields of a normalized sample that status (only its valid
+  fields) and lteinfo carry, either may be NULL. The cell measurements
+  of lteinfo take precedence over the per-antenna values of status.
+  */
+void sw_em7565_fill_meas_sample(const sw_em7565_gstatus_response_t* status,
+                                const sw_em7565_lteinfo_response_t* lteinfo,
+                                meas_sample_t* sample);
+
 sw_response_t sw_em7565_get_information(sw_em7565_t* h, sw_em7565_information_response_t *result);
 sw_em7565_information_response_t* sw_em7565_allocate_information();
 void sw_em7565_free_information(sw_em7565_information_response_t* s);
 
 sw_response_t sw_em7565_get_lteinfo(sw_em7565_t* h, sw_em7565_lteinfo_response_t* result);
 sw_em7565_lteinfo_response_t* sw_em7565_allocate_lteinfo();
+/* zeroes all values but keeps the neighbour buffers for the next refill */
+void sw_em7565_clear_lteinfo(sw_em7565_lteinfo_response_t* s);
 void sw_em7565_free_lteinfo(sw_em7565_lteinfo_response_t* s);
 
 sw_response_t sw_em7565_get_gps_autostart_mode(sw_em7565_t* h, sw_em7565_gps_autostart_mode_t* autostart_mode);
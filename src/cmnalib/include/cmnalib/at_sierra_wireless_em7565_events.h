@@ -0,0 +1,90 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "cmnalib/at_sierra_wireless_em7565.h"
+#include "cmnalib/meas.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Online detection of handovers and cell configuration changes from
+  consecutive AT!GSTATUS? and AT!LTEINFO? samples. After a transition
+  the detector asks for a shorter sampling interval for a while, so the
+  surrounding samples are captured at high resolution.
+  */
+
+typedef enum sw_em7565_event_type {
+    SW_EM7565_EVENT_PCI_CHANGE = 0,
+    SW_EM7565_EVENT_CELL_ID_CHANGE,
+    SW_EM7565_EVENT_EARFCN_CHANGE,
+    SW_EM7565_EVENT_BAND_CHANGE,
+    SW_EM7565_EVENT_SCC_ADDED,
+    SW_EM7565_EVENT_SCC_REMOVED,
+    SW_EM7565_EVENT_RRC_STATE_CHANGE,
+    SW_EM7565_EVENT__MAX
+} sw_em7565_event_type_t;
+
+#define SW_EM7565_EVENT_NOF_SCC 4
+
+typedef struct sw_em7565_event {
+    sw_em7565_event_type_t type;
+    uint64_t timestamp_us;          // of the sample showing the change
+    int scc;                        // 1..4 for SCC events, 0 otherwise
+    int old_value;                  // pci, cell id, earfcn, band or SCC channel (-1 if unknown)
+    int new_value;
+    char old_state[SW_EM7565_GSTATUS_RESPONSE_STRLEN];     // RRC state or SCC state
+    char new_state[SW_EM7565_GSTATUS_RESPONSE_STRLEN];
+    meas_sample_t before;           // last sample before the change
+    meas_sample_t after;            // first sample after the change
+} sw_em7565_event_t;
+
+typedef void (*sw_em7565_event_callback_t)(const sw_em7565_event_t* event, void* context);
+
+typedef struct sw_em7565_event_detector_config {
+    int interval_ms;                // regular sampling interval
+    int fast_interval_ms;           // interval after a transition
+    int fast_duration_ms;           // time after the last transition to stay fast
+} sw_em7565_event_detector_config_t;
+
+typedef struct sw_em7565_event_detector sw_em7565_event_detector_t;
+
+void sw_em7565_event_detector_default_config(sw_em7565_event_detector_config_t* config);
+
+/* config NULL for the defaults, callback may be NULL */
+sw_em7565_event_detector_t* sw_em7565_event_detector_create(const sw_em7565_event_detector_config_t* config,
+                                                            sw_em7565_event_callback_t callback,
+                                                            void* context);
+void sw_em7565_event_detector_destroy(sw_em7565_event_detector_t* d);
+
+/**
+  Compares a sample to the previous one and reports every transition to
+  the callback. status or lteinfo may be NULL if the query failed, only
+  valid status fields are compared. Returns the number of events.
+  */
+int sw_em7565_event_detector_update(sw_em7565_event_detector_t* d,
+                                    uint64_t timestamp_us,
+                                    const sw_em7565_gstatus_response_t* status,
+                                    const sw_em7565_lteinfo_response_t* lteinfo);
+
+/* sampling interval to use at now_us */
+int sw_em7565_event_detector_get_interval_ms(const sw_em7565_event_detector_t* d, uint64_t now_us);
+
+/* forgets the previous sample, e.g. after a reset of the modem */
+void sw_em7565_event_detector_reset(sw_em7565_event_detector_t* d);
+
+const char* sw_em7565_event_type_str(sw_em7565_event_type_t type);
+
+#ifdef __cplusplus
+}
+#endif
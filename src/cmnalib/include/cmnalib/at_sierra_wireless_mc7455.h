@@ -12,6 +12,7 @@
 #include <gmodule.h>
 
 #include "cmnalib/at_interface.h"
+#include "cmnalib/hotplug.h"
 #include "cmnalib/at_sierra_wireless_common.h"
 
 #ifdef __cplusplus
@@ -114,6 +115,8 @@ typedef struct {
     sw_mc7455_lteinfo_intrafreq_neighbour_t* intrafreq_neighbours;
     int nof_interfreq_neighbours;
     sw_mc7455_lteinfo_interfreq_neighbour_t* interfreq_neighbours;
+    int _intrafreq_capacity;    // allocated neighbour entries, reused by sw_mc7455_get_lteinfo_into()
+    int _interfreq_capacity;
 } sw_mc7455_lteinfo_response_t;
 
 #define SW_MC7455_GSTATUS_RESPONSE_STRLEN 64
@@ -194,23 +197,44 @@ double sw_mc7455_gps_raw_to_double(int32_t int_value);
 GSList* sw_mc7455_enumerate_devices();
 void sw_mc7455_enumerate_devices_free(GSList* list);
 
+/* AT port of the modem as seen by the hotplug monitor */
+extern const hotplug_match_t sw_mc7455_hotplug_match;
+
 sw_mc7455_t* sw_mc7455_init_first();
+/* opens the first AT port added after the given generation, see hotplug_wait_for_device() */
+sw_mc7455_t* sw_mc7455_init_hotplug(hotplug_monitor_t* monitor, unsigned long added_after, int timeout_ms);
 sw_mc7455_t* sw_mc7455_init(const char* tty_device_path);
 void sw_mc7455_destroy(sw_mc7455_t* h);
 
 sw_response_t sw_mc7455_is_ready(sw_mc7455_t* h);
 sw_response_t sw_mc7455_reset(sw_mc7455_t* h);
 
+/**
+  Each getter exists in two forms. The _into variants refill a result the
+  caller allocated once with the matching allocate function, for polling
+  loops. The plain variants allocate a new result on every call and set
+  it to NULL on failure; release it with the matching free function.
+  */
 sw_response_t sw_mc7455_get_status(sw_mc7455_t* h, sw_mc7455_gstatus_response_t **result);
+sw_response_t sw_mc7455_get_status_into(sw_mc7455_t* h, sw_mc7455_gstatus_response_t* result);
+sw_mc7455_gstatus_response_t* sw_mc7455_allocate_status();
 void sw_mc7455_free_status(sw_mc7455_gstatus_response_t* s);
 
 sw_response_t sw_mc7455_get_information(sw_mc7455_t* h, sw_mc7455_information_response_t** result);
+sw_response_t sw_mc7455_get_information_into(sw_mc7455_t* h, sw_mc7455_information_response_t* result);
+sw_mc7455_information_response_t* sw_mc7455_allocate_information();
 void sw_mc7455_free_information(sw_mc7455_information_response_t* s);
 
 sw_response_t sw_mc7455_get_lteinfo(sw_mc7455_t* h, sw_mc7455_lteinfo_response_t **result);
+sw_response_t sw_mc7455_get_lteinfo_into(sw_mc7455_t* h, sw_mc7455_lteinfo_response_t* result);
+sw_mc7455_lteinfo_response_t* sw_mc7455_allocate_lteinfo();
+/* zeroes all values but keeps the neighbour buffers for the next refill */
+void sw_mc7455_clear_lteinfo(sw_mc7455_lteinfo_response_t* s);
 void sw_mc7455_free_lteinfo(sw_mc7455_lteinfo_response_t* s);
 
 sw_response_t sw_mc7455_get_gpsloc(sw_mc7455_t* h, sw_mc7455_gpsloc_response_t **result);
+sw_response_t sw_mc7455_get_gpsloc_into(sw_mc7455_t* h, sw_mc7455_gpsloc_response_t* result);
+sw_mc7455_gpsloc_response_t* sw_mc7455_allocate_gpsloc();
 void sw_mc7455_free_get_gpsloc(sw_mc7455_gpsloc_response_t* s);
 
 sw_response_t sw_mc7455_stop_gps(sw_mc7455_t* h);
@@ -0,0 +1,56 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Modem simulator on a pseudo terminal. Answers AT commands from response
+  files in the unit test format (command line followed by the response
+  lines), so the real tty transport including select/read/tcflush can be
+  exercised and benchmarked without hardware. Commands with several
+  recorded responses cycle through them; unknown commands get ERROR.
+  */
+
+typedef struct at_simulator_config {
+    int latency_us;             // delay before the first byte of a response
+    int chunk_size;             // bytes per write, 0 for the whole response at once
+    int chunk_gap_us;           // additional delay between chunks
+    int baud;                   // throttles output to baud/10 bytes per second, 0 for no limit
+
+    /* fault injection, probability per command in [0, 1] */
+    double timeout_probability;     // leave the command unanswered
+    double garbage_probability;     // send a line of random bytes before the response
+    double partial_probability;     // cut the response before its final line
+    unsigned int seed;
+} at_simulator_config_t;
+
+typedef struct at_simulator_stats {
+    unsigned long nof_commands;
+    unsigned long nof_unknown;
+    unsigned long nof_timeouts;
+    unsigned long nof_garbage;
+    unsigned long nof_partial;
+} at_simulator_stats_t;
+
+typedef struct at_simulator at_simulator_t;
+
+/* loads the response files, config may be NULL for an ideal modem */
+at_simulator_t* at_simulator_create(const at_simulator_config_t* config);
+/* returns the number of commands loaded from the file or -1 */
+int at_simulator_load_file(at_simulator_t* sim, const char* response_file);
+/* loads all *.txt files of a directory, returns the total number of commands or -1 */
+int at_simulator_load_directory(at_simulator_t* sim, const char* directory);
+
+/* opens the pseudo terminal and starts answering */
+int at_simulator_start(at_simulator_t* sim);
+/* slave side for at_interface_open() or the driver init functions */
+const char* at_simulator_get_device(at_simulator_t* sim);
+void at_simulator_get_stats(at_simulator_t* sim, at_simulator_stats_t* stats);
+
+/* stops if running */
+void at_simulator_destroy(at_simulator_t* sim);
+
+#ifdef __cplusplus
+}
+#endif
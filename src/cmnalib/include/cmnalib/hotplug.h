@@ -0,0 +1,117 @@
+#pragma once
+
+#include <gmodule.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Hotplug monitor. Keeps a live table of devices and notifies
+  subscribers when a matching device appears or disappears, so that
+  a modem can be reopened as soon as its port comes back after a reset.
+  Events are taken from a hotplug source: udev for real hardware or a
+  fake source which is fed by hand, e.g. in tests.
+  */
+
+typedef enum hotplug_action {
+    HOTPLUG_ACTION_ADD = 0,
+    HOTPLUG_ACTION_REMOVE,
+} hotplug_action_t;
+
+typedef struct hotplug_device {
+    char* device_name;          // e.g. /dev/ttyUSB2, interface name for net devices
+    char* device_path;          // sysfs path, unique key of the table
+    char* subsystem;            // e.g. tty
+    char* vendor_id;            // ID_VENDOR_ID, e.g. 1199
+    char* model_id;             // ID_MODEL_ID, e.g. 9071
+    char* usb_interface_num;    // ID_USB_INTERFACE_NUM, e.g. 03
+    char* serial;               // ID_SERIAL_SHORT, optional
+} hotplug_device_t;
+
+/* same semantics as enumerate_supported_devices(): NULL matches anything, values match by substring */
+typedef struct hotplug_match {
+    const char* vendor_id;
+    const char* model_id;
+    const char* subsystem;
+    const char* usb_interface_num;
+} hotplug_match_t;
+
+hotplug_device_t* hotplug_device_create(const char* device_name,
+                                        const char* device_path,
+                                        const char* subsystem,
+                                        const char* vendor_id,
+                                        const char* model_id,
+                                        const char* usb_interface_num);
+hotplug_device_t* hotplug_device_copy(const hotplug_device_t* device);
+void hotplug_device_set_serial(hotplug_device_t* device, const char* serial);
+void hotplug_device_destroy(hotplug_device_t* device);
+int hotplug_device_matches(const hotplug_device_t* device, const hotplug_match_t* match);
+
+/**
+  Event source. All functions are called from the monitor thread,
+  except scan() which is called once by hotplug_monitor_start().
+  get_fd:  pollable descriptor that becomes readable when events are pending
+  scan:    prepends all currently present devices (hotplug_device_t*) to *devices
+  receive: fetches one event; returns 1 with an event, 0 if none is pending, -1 on error
+  */
+typedef struct hotplug_source {
+    int (*get_fd)(void* source_context);
+    int (*scan)(void* source_context, GSList** devices);
+    int (*receive)(void* source_context, hotplug_action_t* action, hotplug_device_t** device);
+    void (*destroy)(void* source_context);
+    void* context;
+} hotplug_source_t;
+
+/* udev source for a comma separated list of subsystems, e.g. "tty,usbmisc,net"; NULL monitors all */
+hotplug_source_t* hotplug_source_udev(const char* subsystem);
+
+/* fake source, events are injected by the functions below */
+hotplug_source_t* hotplug_source_fake();
+int hotplug_source_fake_add(hotplug_source_t* source, const hotplug_device_t* device);
+int hotplug_source_fake_remove(hotplug_source_t* source, const char* device_path);
+
+void hotplug_source_destroy(hotplug_source_t* source);
+
+typedef struct hotplug_monitor hotplug_monitor_t;
+
+/**
+  Callback of a subscription. Called from the monitor thread while the
+  device table is locked, so it must not call into the same monitor.
+  */
+typedef void (hotplug_callback_func)(void* callback_context,
+                                     hotplug_action_t action,
+                                     const hotplug_device_t* device);
+
+/* takes ownership of the source, also on failure */
+hotplug_monitor_t* hotplug_monitor_start(hotplug_source_t* source);
+void hotplug_monitor_stop(hotplug_monitor_t* monitor);
+
+/* devices already present are reported as HOTPLUG_ACTION_ADD right away; returns an id > 0 or -1 */
+int hotplug_subscribe(hotplug_monitor_t* monitor,
+                      const hotplug_match_t* match,
+                      hotplug_callback_func* callback,
+                      void* callback_context);
+void hotplug_unsubscribe(hotplug_monitor_t* monitor, int subscription_id);
+
+/* copy of the matching part of the table, release with hotplug_device_list_free() */
+GSList* hotplug_get_devices(hotplug_monitor_t* monitor, const hotplug_match_t* match);
+void hotplug_device_list_free(GSList* list);
+
+/* 1 after the initial scan, increases with every processed event */
+unsigned long hotplug_get_generation(hotplug_monitor_t* monitor);
+
+/**
+  Waits for a matching device which was added after the given generation
+  (0 accepts devices present from the start, pass hotplug_get_generation()
+  to wait for a new one only). A negative timeout waits
+  forever. Returns a copy of the device or NULL on timeout.
+  */
+hotplug_device_t* hotplug_wait_for_device(hotplug_monitor_t* monitor,
+                                          const hotplug_match_t* match,
+                                          unsigned long added_after,
+                                          int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
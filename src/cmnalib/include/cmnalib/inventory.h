@@ -0,0 +1,68 @@
+#pragma once
+
+#include <gmodule.h>
+
+#include "cmnalib/hotplug.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Device inventory. Groups all endpoints of a modem (AT port, NMEA port,
+  QMI control device, network interface) by their USB device and indexes
+  them by USB path, serial number, IMEI and endpoint name. The inventory
+  follows a hotplug monitor, so it is updated per event instead of being
+  rebuilt by full udev scans.
+  */
+
+typedef enum inventory_endpoint_role {
+    INVENTORY_ENDPOINT_UNKNOWN = 0,
+    INVENTORY_ENDPOINT_AT,
+    INVENTORY_ENDPOINT_NMEA,
+    INVENTORY_ENDPOINT_QMI,
+    INVENTORY_ENDPOINT_NETDEV,
+    INVENTORY_ENDPOINT__MAX
+} inventory_endpoint_role_t;
+
+typedef struct inventory_modem {
+    char* usb_path;     // sysfs path of the USB device, primary key
+    char* vendor_id;
+    char* model_id;
+    char* serial;       // ID_SERIAL_SHORT of any endpoint
+    char* imei;         // only known after inventory_set_imei()
+    char* endpoints[INVENTORY_ENDPOINT__MAX];  // device names indexed by role, NULL if absent
+} inventory_modem_t;
+
+typedef struct inventory inventory_t;
+
+/* the monitor should watch "tty,usbmisc,net" and must outlive the inventory */
+inventory_t* inventory_create(hotplug_monitor_t* monitor);
+void inventory_destroy(inventory_t* inventory);
+
+/* role of a device, INVENTORY_ENDPOINT_UNKNOWN for devices the inventory ignores */
+inventory_endpoint_role_t inventory_classify(const hotplug_device_t* device);
+
+/* sysfs path of the USB device owning an interface path, NULL if it is no USB interface; allocator_free() the result */
+char* inventory_usb_path_of(const char* device_path);
+
+/* lookups return copies, release with inventory_modem_free() */
+inventory_modem_t* inventory_find_by_usb_path(inventory_t* inventory, const char* usb_path);
+inventory_modem_t* inventory_find_by_serial(inventory_t* inventory, const char* serial);
+inventory_modem_t* inventory_find_by_imei(inventory_t* inventory, const char* imei);
+/* by any endpoint name, e.g. "/dev/ttyUSB2" or "wwan0" */
+inventory_modem_t* inventory_find_by_endpoint(inventory_t* inventory, const char* device_name);
+
+/* all modems as inventory_modem_t*, release with inventory_modem_list_free() */
+GSList* inventory_get_modems(inventory_t* inventory);
+void inventory_modem_list_free(GSList* list);
+
+/* the IMEI is not visible to udev, register it once the AT port was queried */
+int inventory_set_imei(inventory_t* inventory, const char* usb_path, const char* imei);
+
+inventory_modem_t* inventory_modem_copy(const inventory_modem_t* modem);
+void inventory_modem_free(inventory_modem_t* modem);
+
+#ifdef __cplusplus
+}
+#endif
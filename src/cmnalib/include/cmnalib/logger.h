@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdio.h>
+#include <stddef.h>
 
 #include <sys/time.h>
 #include <sys/types.h>
@@ -24,7 +25,64 @@ extern "C" {
 //#define LOGGER_LEVEL LOGGER_VERBOSE_INFO
 //#define LOGGER_LEVEL LOGGER_VERBOSE_NONE
 
+/**
+  Modules. A source file selects its module by defining LOGGER_MODULE
+  before including this header, e.g. #define LOGGER_MODULE AT
+  Each module has a compile-time ceiling LOGGER_LEVEL_<MODULE> which
+  defaults to LOGGER_LEVEL, e.g. -DLOGGER_LEVEL_AT=LOGGER_VERBOSE_INFO
+  removes all DEBUG output of the AT layer at compile time.
+  Below that ceiling, the level of each module can be changed at runtime
+  with logger_set_level() or the environment variable CMNALIB_LOG.
+  */
+#define LOGGER_MODULE_DEFAULT   0
+#define LOGGER_MODULE_AT        1
+#define LOGGER_MODULE_TOKENFIND 2
+#define LOGGER_MODULE_DEVICES   3
+#define LOGGER_MODULE_TRAFFIC   4
+#define LOGGER_MODULE_TRACE     5
+#define LOGGER_MODULE_QMI       6
+#define LOGGER_MODULE_COUNT     7
+
+#ifndef LOGGER_MODULE
+#define LOGGER_MODULE DEFAULT
+#endif
+
+#ifndef LOGGER_LEVEL_DEFAULT
+#define LOGGER_LEVEL_DEFAULT LOGGER_LEVEL
+#endif
+#ifndef LOGGER_LEVEL_AT
+#define LOGGER_LEVEL_AT LOGGER_LEVEL
+#endif
+#ifndef LOGGER_LEVEL_TOKENFIND
+#define LOGGER_LEVEL_TOKENFIND LOGGER_LEVEL
+#endif
+#ifndef LOGGER_LEVEL_DEVICES
+#define LOGGER_LEVEL_DEVICES LOGGER_LEVEL
+#endif
+#ifndef LOGGER_LEVEL_TRAFFIC
+#define LOGGER_LEVEL_TRAFFIC LOGGER_LEVEL
+#endif
+#ifndef LOGGER_LEVEL_TRACE
+#define LOGGER_LEVEL_TRACE LOGGER_LEVEL
+#endif
+#ifndef LOGGER_LEVEL_QMI
+#define LOGGER_LEVEL_QMI LOGGER_LEVEL
+#endif
+
+#define _LOGGER_CEILING(m) LOGGER_LEVEL_##m
+#define LOGGER_CEILING(m) _LOGGER_CEILING(m)
+#define LOGGER_COMPILED_LEVEL LOGGER_CEILING(LOGGER_MODULE)
+
+#define _LOGGER_ID(m) LOGGER_MODULE_##m
+#define LOGGER_ID(m) _LOGGER_ID(m)
+#define LOGGER_MODULE_ID LOGGER_ID(LOGGER_MODULE)
 
+/* runtime levels, indexed by module id; a relaxed atomic load on every log call, no lock */
+extern int logger_levels[LOGGER_MODULE_COUNT];
+
+/* compile-time check first, so disabled levels vanish entirely; arguments are only evaluated when enabled */
+#define LOGGER_IS_ENABLED(LEVEL) (LOGGER_ENABLED && LOGGER_COMPILED_LEVEL >= LEVEL && \
+                                  __atomic_load_n(&logger_levels[LOGGER_MODULE_ID], __ATOMIC_RELAXED) >= LEVEL)
 
 #define LOGGER_VERBOSE_ISINFO() (srslte_verbose>=SRSLTE_VERBOSE_INFO)
 #define LOGGER_VERBOSE_ISDEBUG() (srslte_verbose>=SRSLTE_VERBOSE_DEBUG)
@@ -39,16 +97,16 @@ extern "C" {
 #define WARNING_STREAM stdout
 #define ERROR_STREAM stdout
 
-#define FDEBUG(FILESTREAM, _fmt, ...) if (LOGGER_ENABLED && LOGGER_LEVEL >= LOGGER_VERBOSE_DEBUG) \
+#define FDEBUG(FILESTREAM, _fmt, ...) if (LOGGER_IS_ENABLED(LOGGER_VERBOSE_DEBUG)) \
   do_log(FILESTREAM, "[D]: " _fmt, ##__VA_ARGS__)
 
-#define FINFO(FILESTREAM, _fmt, ...) if (LOGGER_ENABLED && LOGGER_LEVEL >= LOGGER_VERBOSE_INFO) \
+#define FINFO(FILESTREAM, _fmt, ...) if (LOGGER_IS_ENABLED(LOGGER_VERBOSE_INFO)) \
   do_log(FILESTREAM, "[I]: " _fmt, ##__VA_ARGS__)
 
-#define FWARNING(FILESTREAM, _fmt, ...) if (LOGGER_ENABLED && LOGGER_LEVEL >= LOGGER_VERBOSE_INFO) \
+#define FWARNING(FILESTREAM, _fmt, ...) if (LOGGER_IS_ENABLED(LOGGER_VERBOSE_INFO)) \
   do_log(FILESTREAM, "[W]: " _fmt, ##__VA_ARGS__)
 
-#define FERROR(FILESTREAM, _fmt, ...) if (LOGGER_ENABLED && LOGGER_LEVEL >= LOGGER_VERBOSE_INFO) \
+#define FERROR(FILESTREAM, _fmt, ...) if (LOGGER_IS_ENABLED(LOGGER_VERBOSE_INFO)) \
   do_log(FILESTREAM, "[E]: " _fmt, ##__VA_ARGS__)
 
 #define DEBUG(_fmt, ...) FDEBUG(DEBUG_STREAM, _fmt, ##__VA_ARGS__)
@@ -59,6 +117,30 @@ extern "C" {
 #define TEE_STREAM(CMDA, STREAMA, CMDB, STREAMB, _fmt, ...) CMDA(STREAMA, _fmt, ##__VA_ARGS__);\
                                                             CMDB(STREAMB, _fmt, ##__VA_ARGS__)
 
+/**
+  Rate-limited variants for messages that repeat at high frequency,
+  e.g. in progress callbacks. At most one message per INTERVAL_SEC is
+  emitted per call site; the number of suppressed messages is appended.
+  The state is updated atomically, call sites may run on several threads.
+  */
+typedef struct logger_ratelimit {
+    unsigned long long last_us;     // 0 until the first message passed
+    unsigned int suppressed;
+} logger_ratelimit_t;
+
+#define _LOG_RATELIMITED(LEVEL, LOGCMD, INTERVAL_SEC, _fmt, ...) do { \
+    static logger_ratelimit_t _ratelimit_ = {0, 0}; \
+    unsigned int _suppressed_; \
+    if(LOGGER_IS_ENABLED(LEVEL) && logger_ratelimit_pass(&_ratelimit_, INTERVAL_SEC, &_suppressed_)) { \
+        LOGCMD(_fmt, ##__VA_ARGS__); \
+        if(_suppressed_ > 0) LOGCMD("%u similar messages suppressed\n", _suppressed_); \
+    } } while(0)
+
+#define DEBUG_RATELIMITED(INTERVAL_SEC, _fmt, ...) _LOG_RATELIMITED(LOGGER_VERBOSE_DEBUG, DEBUG, INTERVAL_SEC, _fmt, ##__VA_ARGS__)
+#define INFO_RATELIMITED(INTERVAL_SEC, _fmt, ...) _LOG_RATELIMITED(LOGGER_VERBOSE_INFO, INFO, INTERVAL_SEC, _fmt, ##__VA_ARGS__)
+#define WARNING_RATELIMITED(INTERVAL_SEC, _fmt, ...) _LOG_RATELIMITED(LOGGER_VERBOSE_INFO, WARNING, INTERVAL_SEC, _fmt, ##__VA_ARGS__)
+#define ERROR_RATELIMITED(INTERVAL_SEC, _fmt, ...) _LOG_RATELIMITED(LOGGER_VERBOSE_INFO, ERROR, INTERVAL_SEC, _fmt, ##__VA_ARGS__)
+
 extern int enable_logger;
 
 void do_log(FILE* stream, const char * format, ...);
@@ -66,6 +148,78 @@ int timeval_subtract (struct timeval *result,
                       struct timeval *x,
                       struct timeval *y);
 
+int logger_ratelimit_pass(logger_ratelimit_t* r, double interval_sec, unsigned int* suppressed);
+
+/**
+  Runtime levels. Modules are addressed by id (LOGGER_MODULE_*) or by
+  their lowercase name: default, at, tokenfind, devices, traffic, trace, qmi.
+  Levels are LOGGER_VERBOSE_NONE/INFO/DEBUG or "none", "info", "debug".
+  */
+void logger_set_level(int module, int level);
+int logger_get_level(int module);
+void logger_set_all_levels(int level);
+int logger_module_from_name(const char* name);
+int logger_level_from_name(const char* name);
+
+/**
+  Applies a configuration string of comma separated key=value pairs:
+    <module>=<level>   level of one module, "*" for all modules
+    sink=<sink>        add a sink: stdout, stderr, syslog[:ident], file:<path>
+    async=<slots>      start asynchronous mode with the given ring size
+  e.g. "*=info,traffic=debug,sink=file:/tmp/cmnalib.log"
+  The same string is read from the environment variable CMNALIB_LOG
+  when the library is loaded. Returns 0 or -1 if any entry was invalid.
+  */
+#define LOGGER_ENV_VARIABLE "CMNALIB_LOG"
+
+int logger_configure(const char* config);
+int logger_configure_from_env();
+
+/**
+  Sinks. Without any sink, messages go to the stream passed to do_log()
+  (stdout for the default macros). Once a sink is added, all messages
+  go to the registered sinks instead.
+  The severity is the letter of the message prefix: 'D', 'I', 'W', 'E' or 0.
+  */
+typedef void (logger_sink_write_func)(void* sink_context,
+                                      char severity,
+                                      const char* line,
+                                      size_t len);
+
+typedef struct logger_sink {
+    logger_sink_write_func* write;
+    void (*close)(void* sink_context);
+    void* context;
+} logger_sink_t;
+
+#define LOGGER_MAX_SINKS 4
+
+int logger_add_sink(logger_sink_t* sink);
+void logger_remove_sink(logger_sink_t* sink);
+void logger_remove_all_sinks();
+
+/* built-in sinks, release with logger_sink_destroy() after removing them */
+logger_sink_t* logger_sink_stream(FILE* stream);
+logger_sink_t* logger_sink_file(const char* filename);
+logger_sink_t* logger_sink_syslog(const char* ident);
+logger_sink_t* logger_sink_memory(size_t capacity);
+void logger_sink_destroy(logger_sink_t* sink);
+
+/* copies the most recent text of a memory sink, returns nof bytes without terminating 0 */
+size_t logger_sink_memory_read(logger_sink_t* sink, char* buf, size_t buf_size);
+
+/**
+  Asynchronous mode. Messages are formatted into a lock-free ring on the
+  calling thread and written to the sinks by a background thread, so the
+  caller never blocks on I/O. If the ring is full, messages are dropped
+  and counted. logger_stop_async() drains the ring; it must not be called
+  while other threads are still logging.
+  */
+int logger_start_async(size_t ring_slots);
+void logger_stop_async();
+void logger_flush();
+size_t logger_get_dropped();
+
 #ifdef __cplusplus
 }
 #endif
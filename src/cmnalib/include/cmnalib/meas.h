@@ -0,0 +1,76 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Normalized measurement sample. Independent of the modem and of the
+  backend (AT polling, QMI indications) that produced it. Only fields
+  with their bit set in valid carry a value.
+  */
+
+typedef enum meas_field {
+    MEAS_FIELD_RSRP = 0,
+    MEAS_FIELD_RSRQ,
+    MEAS_FIELD_RSSI,
+    MEAS_FIELD_SINR,
+    MEAS_FIELD_TX_POWER,
+    MEAS_FIELD_PCI,
+    MEAS_FIELD_CELL_ID,
+    MEAS_FIELD_TAC,
+    MEAS_FIELD_EARFCN,
+    MEAS_FIELD_BAND,
+    MEAS_FIELD_BANDWIDTH,
+    MEAS_FIELD_POSITION,    // latitude, longitude and altitude
+    MEAS_FIELD__MAX
+} meas_field_t;
+
+#define MEAS_FIELD_BIT(FIELD) (1u << (FIELD))
+
+typedef enum meas_source {
+    MEAS_SOURCE_UNKNOWN = 0,
+    MEAS_SOURCE_POLL,           // result of a getter
+    MEAS_SOURCE_INDICATION,     // pushed by the modem
+} meas_source_t;
+
+typedef struct meas_sample {
+    uint64_t timestamp_us;  // unix time
+    meas_source_t source;
+    uint32_t valid;         // MEAS_FIELD_BIT() of the set fields
+    float rsrp;             // dBm
+    float rsrq;             // dB
+    float rssi;             // dBm
+    float sinr;             // dB
+    int tx_power;           // dBm
+    int pci;
+    int cell_id;
+    int tac;
+    int earfcn;
+    int band;
+    int bandwidth_MHz;
+    double latitude;
+    double longitude;
+    float altitude;         // meter
+} meas_sample_t;
+
+/* empty sample stamped with the current time */
+void meas_sample_init(meas_sample_t* sample, meas_source_t source);
+
+static inline int meas_sample_has(const meas_sample_t* sample, meas_field_t field) {
+    return (sample->valid & MEAS_FIELD_BIT(field)) != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,97 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "cmnalib/meas.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Serves the samples of one modem to local processes over a Unix domain
+  socket, so that a single owner of the modem polls once for any number
+  of readers.
+
+  The socket is of type SOCK_SEQPACKET, every packet is one message: a
+  header of MEAS_BROKER_HEADER_SIZE bytes (type, version, payload length
+  as uint16) followed by the payload, all in host byte order.
+
+  GET_LATEST    -> LATEST with the last published sample, or NO_SAMPLE
+  SUBSCRIBE     -> SAMPLE for every published sample until UNSUBSCRIBE
+  */
+
+#define MEAS_BROKER_PROTOCOL_VERSION 1
+#define MEAS_BROKER_HEADER_SIZE 4
+#define MEAS_BROKER_SAMPLE_SIZE 77
+#define MEAS_BROKER_MAX_MESSAGE_SIZE (MEAS_BROKER_HEADER_SIZE + MEAS_BROKER_SAMPLE_SIZE)
+
+typedef enum meas_broker_msg_type {
+    MEAS_BROKER_MSG_GET_LATEST = 1,
+    MEAS_BROKER_MSG_SUBSCRIBE,
+    MEAS_BROKER_MSG_UNSUBSCRIBE,
+    MEAS_BROKER_MSG_LATEST,
+    MEAS_BROKER_MSG_NO_SAMPLE,
+    MEAS_BROKER_MSG_SAMPLE,
+    MEAS_BROKER_MSG_ERROR,
+} meas_broker_msg_type_t;
+
+/* fixed layout of a sample payload, returns MEAS_BROKER_SAMPLE_SIZE */
+int meas_broker_encode_sample(const meas_sample_t* sample, uint8_t* buf);
+/* returns 0, or -1 if len does not match */
+int meas_broker_decode_sample(const uint8_t* buf, int len, meas_sample_t* sample);
+
+/**
+  Server side, owned by the process that polls the modem. publish and
+  process may be called from different threads.
+  */
+typedef struct meas_broker meas_broker_t;
+
+/* replaces a stale socket file at socket_path */
+meas_broker_t* meas_broker_create(const char* socket_path);
+void meas_broker_destroy(meas_broker_t* broker);
+
+/**
+  Accepts clients and answers their requests for up to timeout_ms.
+  Returns the number of handled requests, -1 on error.
+  */
+int meas_broker_process(meas_broker_t* broker, int timeout_ms);
+
+/**
+  Stores the sample as latest and sends it to all subscribers. A
+  subscriber that cannot take it right away misses this sample.
+  Returns the number of subscribers reached.
+  */
+int meas_broker_publish(meas_broker_t* broker, const meas_sample_t* sample);
+
+int meas_broker_get_nof_clients(meas_broker_t* broker);
+
+/**
+  Client side. A connection either polls with get_latest or receives a
+  subscription, not both.
+  */
+typedef struct meas_broker_client meas_broker_client_t;
+
+meas_broker_client_t* meas_broker_connect(const char* socket_path);
+void meas_broker_disconnect(meas_broker_client_t* client);
+
+/* returns 1 with the sample, 0 if none was published yet, -1 on error or timeout */
+int meas_broker_get_latest(meas_broker_client_t* client, meas_sample_t* sample, int timeout_ms);
+
+int meas_broker_subscribe(meas_broker_client_t* client);
+int meas_broker_unsubscribe(meas_broker_client_t* client);
+
+/* waits up to timeout_ms (forever if negative); returns 1 with the sample, 0 on timeout, -1 if closed */
+int meas_broker_receive(meas_broker_client_t* client, meas_sample_t* sample, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
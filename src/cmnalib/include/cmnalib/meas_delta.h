@@ -0,0 +1,108 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "cmnalib/meas.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Change-only encoding of a sample sequence. Every record starts with
+  its length (one byte, not counting itself) and a flags byte.
+
+  Keyframe: absolute timestamp (uint64), source, valid mask, then the
+            value of every valid field in meas_field_t order.
+  Delta:    timestamp difference, source and valid mask only if they
+            changed (see flags), a mask of the changed fields, then the
+            new values of the changed fields that are valid.
+
+  Masks and integers are LEB128 varints, integers of a delta are zigzag
+  encoded differences to the previous sample. Floats and the position
+  are stored raw, so decoding reproduces the samples exactly. All values
+  are in host byte order.
+
+  A keyframe depends on no earlier record, a reader can start decoding
+  at any of them.
+  */
+
+#define MEAS_DELTA_FLAG_KEYFRAME 0x01
+#define MEAS_DELTA_FLAG_SOURCE   0x02
+#define MEAS_DELTA_FLAG_VALID    0x04
+
+#define MEAS_DELTA_MAX_RECORD_SIZE 128
+#define MEAS_DELTA_DEFAULT_KEYFRAME_INTERVAL 60
+
+typedef struct meas_delta_encoder {
+    meas_sample_t last;
+    int has_last;
+    int keyframe_interval;      // records per keyframe, 1 for keyframes only
+    int since_keyframe;
+} meas_delta_encoder_t;
+
+typedef struct meas_delta_decoder {
+    meas_sample_t last;
+    int has_last;
+} meas_delta_decoder_t;
+
+void meas_delta_encoder_init(meas_delta_encoder_t* e, int keyframe_interval);
+/* makes the next record a keyframe */
+void meas_delta_force_keyframe(meas_delta_encoder_t* e);
+/**
+  Encodes sample relative to the previous one into buf, which must hold
+  MEAS_DELTA_MAX_RECORD_SIZE bytes. A timestamp running backwards starts
+  a keyframe. Returns the record size.
+  */
+int meas_delta_encode(meas_delta_encoder_t* e, const meas_sample_t* sample, uint8_t* buf);
+
+void meas_delta_decoder_init(meas_delta_decoder_t* d);
+/**
+  Decodes the record at buf. Returns the number of consumed bytes, 0 if
+  len does not hold a complete record, -1 if the record is corrupt or a
+  delta arrives before the first keyframe.
+  */
+int meas_delta_decode(meas_delta_decoder_t* d, const uint8_t* buf, int len, meas_sample_t* sample);
+
+/**
+  Record files
+  */
+typedef struct meas_delta_writer {
+    FILE* file;
+    meas_delta_encoder_t encoder;
+    unsigned long nof_records;
+    unsigned long nof_bytes;
+} meas_delta_writer_t;
+
+typedef struct meas_delta_reader {
+    FILE* file;
+    meas_delta_decoder_t decoder;
+} meas_delta_reader_t;
+
+meas_delta_writer_t* meas_delta_writer_init(const char* filename, int keyframe_interval);
+void meas_delta_writer_destroy(meas_delta_writer_t* w);
+int meas_delta_write(meas_delta_writer_t* w, const meas_sample_t* sample);
+
+meas_delta_reader_t* meas_delta_reader_init(const char* filename);
+void meas_delta_reader_destroy(meas_delta_reader_t* r);
+/* returns 1 with the next sample, 0 at the end of the file, -1 if corrupt */
+int meas_delta_read(meas_delta_reader_t* r, meas_sample_t* sample);
+/**
+  Positions the reader at the last keyframe not after timestamp_us by
+  skipping over the records, without decoding the deltas. Returns 0,
+  or -1 if there is no such keyframe.
+  */
+int meas_delta_seek(meas_delta_reader_t* r, uint64_t timestamp_us);
+
+#ifdef __cplusplus
+}
+#endif
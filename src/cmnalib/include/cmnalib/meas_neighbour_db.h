@@ -0,0 +1,95 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "cmnalib/meas.h"
+#include "cmnalib/at_sierra_wireless_em7565.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Statistics of every neighbour cell seen during a drive, keyed by
+  (EARFCN, PCI). Observations are folded into running statistics, so
+  the memory grows with the number of distinct cells only.
+  */
+
+/* Welford's running mean and variance */
+typedef struct meas_running_stats {
+    uint32_t count;
+    float min;
+    float max;
+    double mean;
+    double m2;              // sum of squared differences from the mean
+} meas_running_stats_t;
+
+void meas_running_stats_add(meas_running_stats_t* s, float value);
+/* combines two partial statistics as if all values were added to dst */
+void meas_running_stats_merge(meas_running_stats_t* dst, const meas_running_stats_t* src);
+/* sample variance, 0 for fewer than two values */
+double meas_running_stats_variance(const meas_running_stats_t* s);
+
+typedef struct meas_neighbour {
+    int earfcn;
+    int pci;
+    meas_running_stats_t rsrp;
+    meas_running_stats_t rsrq;
+    uint64_t first_seen_us;
+    uint64_t last_seen_us;
+    int has_position;       // bounding box of the positions with valid GPS
+    double min_latitude;
+    double max_latitude;
+    double min_longitude;
+    double max_longitude;
+} meas_neighbour_t;
+
+typedef struct meas_neighbour_db meas_neighbour_db_t;
+
+meas_neighbour_db_t* meas_neighbour_db_create(int initial_capacity);
+void meas_neighbour_db_destroy(meas_neighbour_db_t* db);
+
+/**
+  Adds one observation. at provides the timestamp and, if its position
+  is valid, the location. Returns 0, -1 if out of memory.
+  */
+int meas_neighbour_db_add(meas_neighbour_db_t* db, int earfcn, int pci, float rsrp, float rsrq,
+                          const meas_sample_t* at);
+
+/* adds all intra- and inter-frequency neighbours; returns the number added, -1 on error */
+int meas_neighbour_db_add_lteinfo(meas_neighbour_db_t* db, const sw_em7565_lteinfo_response_t* lteinfo,
+                                  const meas_sample_t* at);
+
+/* NULL if the cell was not seen */
+const meas_neighbour_t* meas_neighbour_db_find(const meas_neighbour_db_t* db, int earfcn, int pci);
+
+int meas_neighbour_db_get_size(const meas_neighbour_db_t* db);
+
+/**
+  Iterates all cells in unspecified order. Start with *iterator = 0,
+  returns NULL at the end. The table must not change meanwhile.
+  */
+const meas_neighbour_t* meas_neighbour_db_iterate(const meas_neighbour_db_t* db, int* iterator);
+
+/**
+  Binary file: a header (magic, version, record size, number of cells)
+  followed by one fixed-size record per cell, in host byte order.
+  */
+#define MEAS_NEIGHBOUR_DB_MAGIC 0x444e4d43     // "CMND"
+#define MEAS_NEIGHBOUR_DB_VERSION 1
+
+int meas_neighbour_db_save(const meas_neighbour_db_t* db, const char* filename);
+/* merges the cells of the file into db, e.g. to combine several drives; returns the number of records */
+int meas_neighbour_db_load(meas_neighbour_db_t* db, const char* filename);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,64 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "cmnalib/meas.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Publishes the latest sample of one modem in a POSIX shared memory
+  segment, so that local readers get it without any syscall and without
+  touching the modem.
+
+  The segment starts with meas_shm_header_t followed by one
+  meas_sample_t. Writes are guarded by a seqlock: the sequence number is
+  odd while the writer updates the sample, readers copy the sample and
+  retry if the sequence changed meanwhile. There must be only one
+  writer per segment.
+  */
+
+#define MEAS_SHM_MAGIC 0x4d4e4d53      // "SMNM"
+#define MEAS_SHM_VERSION 1
+
+typedef struct meas_shm_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t record_size;           // sizeof(meas_sample_t) of the writer
+    uint32_t sequence;              // accessed atomically, 0 until the first publish
+} meas_shm_header_t;
+
+typedef struct meas_shm meas_shm_t;
+
+/* writer; name as for shm_open(), e.g. "/cmnalib_em7565_0" */
+meas_shm_t* meas_shm_create(const char* name);
+/* reader; fails if the segment does not exist or its layout differs */
+meas_shm_t* meas_shm_open(const char* name);
+/* unmaps, a writer also removes the segment name */
+void meas_shm_close(meas_shm_t* shm);
+
+void meas_shm_publish(meas_shm_t* shm, const meas_sample_t* sample);
+
+/**
+  Returns 1 with the latest sample, 0 if none was published yet, -1 if
+  the writer did not complete an update (e.g. it died while writing).
+  */
+int meas_shm_read(meas_shm_t* shm, meas_sample_t* sample);
+
+/* changes with every publish; lets readers skip unchanged samples */
+uint32_t meas_shm_get_sequence(meas_shm_t* shm);
+
+#ifdef __cplusplus
+}
+#endif
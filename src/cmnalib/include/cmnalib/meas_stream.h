@@ -0,0 +1,47 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#pragma once
+
+#include "cmnalib/meas.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Bounded queue of measurement samples between a producer (e.g. the
+  indication handler of a modem backend) and any number of consumer
+  threads. A full stream drops its oldest sample, so a slow consumer
+  always sees the most recent state.
+  */
+
+typedef struct meas_stream meas_stream_t;
+
+meas_stream_t* meas_stream_create(int capacity);
+void meas_stream_destroy(meas_stream_t* stream);
+
+/* never blocks; returns 1 if an older sample was dropped, 0 otherwise, -1 if closed */
+int meas_stream_push(meas_stream_t* stream, const meas_sample_t* sample);
+
+/**
+  Takes the oldest sample. Waits up to timeout_ms, forever if negative.
+  Returns 1 if a sample was taken, 0 on timeout, -1 if the stream is
+  closed and empty.
+  */
+int meas_stream_pop(meas_stream_t* stream, meas_sample_t* sample, int timeout_ms);
+
+/* wakes all waiting consumers, further pushes fail */
+void meas_stream_close(meas_stream_t* stream);
+
+int meas_stream_get_length(meas_stream_t* stream);
+unsigned long meas_stream_get_dropped(meas_stream_t* stream);
+
+#ifdef __cplusplus
+}
+#endif
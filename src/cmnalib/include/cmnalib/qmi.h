@@ -0,0 +1,125 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Native QMI (Qualcomm MSM Interface) over the QMUX framing of a
+  cdc-wdm control device. Requests are synchronous like the AT
+  interface; indications are passed to an optional handler.
+  */
+
+#define QMI_SERVICE_CTL 0x00
+#define QMI_SERVICE_WDS 0x01
+#define QMI_SERVICE_DMS 0x02
+#define QMI_SERVICE_NAS 0x03
+#define QMI_SERVICE_LOC 0x10
+
+#define QMI_CTL_ALLOCATE_CID 0x0022
+#define QMI_CTL_RELEASE_CID  0x0023
+
+#define QMI_TLV_RESULT 0x02
+
+#define QMI_MESSAGE_MAX_SIZE 4096
+#define QMI_DEFAULT_TIMEOUT_MS 2000
+
+typedef enum qmi_message_type {
+    QMI_MESSAGE_REQUEST = 0,
+    QMI_MESSAGE_RESPONSE,
+    QMI_MESSAGE_INDICATION,
+} qmi_message_type_t;
+
+typedef struct qmi_message {
+    uint8_t service;
+    uint8_t client_id;
+    qmi_message_type_t type;
+    uint16_t transaction_id;
+    uint16_t message_id;
+    uint16_t tlv_len;
+    uint8_t tlv[QMI_MESSAGE_MAX_SIZE];
+} qmi_message_t;
+
+void qmi_message_init(qmi_message_t* msg, uint8_t service, uint8_t client_id, uint16_t message_id);
+int qmi_message_add_tlv(qmi_message_t* msg, uint8_t type, uint16_t len, const void* value);
+int qmi_message_add_tlv_u8(qmi_message_t* msg, uint8_t type, uint8_t value);
+int qmi_message_add_tlv_u32(qmi_message_t* msg, uint8_t type, uint32_t value);
+/* value of a TLV or NULL if absent */
+const uint8_t* qmi_message_find_tlv(const qmi_message_t* msg, uint8_t type, uint16_t* len);
+/* QMI error code of a response, 0 on success, -1 if the result TLV is missing */
+int qmi_message_get_error(const qmi_message_t* msg);
+
+/* QMUX frame (starting with the 0x01 marker) <-> message; return frame length / 0, or -1 */
+int qmi_message_encode(const qmi_message_t* msg, uint8_t* buf, size_t buf_size);
+int qmi_message_decode(const uint8_t* buf, size_t len, qmi_message_t* msg);
+
+/* little endian accessors for TLV values */
+uint16_t qmi_le16(const uint8_t* p);
+uint32_t qmi_le32(const uint8_t* p);
+
+/**
+  Transport of whole QMUX frames.
+  read returns the frame length, 0 on timeout or -1 on error.
+  */
+typedef struct qmi_transport {
+    int (*write)(void* transport_context, const uint8_t* buf, size_t len);
+    int (*read)(void* transport_context, uint8_t* buf, size_t buf_size, int timeout_ms);
+    void (*close)(void* transport_context);
+    void* context;
+} qmi_transport_t;
+
+qmi_transport_t* qmi_transport_cdc_wdm(const char* device_path);
+
+/**
+  Replay of a recorded conversation. Each line holds one frame as hex bytes,
+  prefixed by '>' for frames written by the host and '<' for frames of the
+  modem; '#' starts a comment. A write must match the next '>' frame, the
+  '<' frames following it become readable. '<' frames before the first
+  '>' are readable right away.
+  */
+qmi_transport_t* qmi_transport_replay(const char* filename);
+
+/* passes everything through to inner and appends it to filename in replay format */
+qmi_transport_t* qmi_transport_recorder(qmi_transport_t* inner, const char* filename);
+
+void qmi_transport_destroy(qmi_transport_t* transport);
+
+typedef struct qmi_device qmi_device_t;
+
+typedef void (qmi_indication_func)(void* indication_context, const qmi_message_t* indication);
+
+/* takes ownership of the transport, also on failure */
+qmi_device_t* qmi_device_open(qmi_transport_t* transport);
+/* releases all allocated clients */
+void qmi_device_close(qmi_device_t* dev);
+
+void qmi_device_set_indication_handler(qmi_device_t* dev, qmi_indication_func* handler, void* indication_context);
+
+/* client id > 0 or -1 */
+int qmi_device_allocate_client(qmi_device_t* dev, uint8_t service);
+int qmi_device_release_client(qmi_device_t* dev, uint8_t service, uint8_t client_id);
+
+/**
+  Sends a request and waits for its response. Transaction id and type
+  of the request are set here. Returns 0 if the response arrived, -1 on
+  timeout or transport failure; the QMI result is left to the caller.
+  */
+int qmi_device_request(qmi_device_t* dev, qmi_message_t* request, qmi_message_t* response, int timeout_ms);
+
+/* waits up to timeout_ms for a frame, then dispatches all pending indications; returns their number or -1 */
+int qmi_device_poll(qmi_device_t* dev, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
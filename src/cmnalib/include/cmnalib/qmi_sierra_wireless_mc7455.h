@@ -0,0 +1,93 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#pragma once
+
+#include "cmnalib/qmi.h"
+#include "cmnalib/meas_stream.h"
+#include "cmnalib/at_sierra_wireless_common.h"
+#include "cmnalib/at_sierra_wireless_mc7455.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  QMI measurement backend of the MC7455. The getters fill the same
+  response structs as their AT counterparts and are released with the
+  same free functions, so both backends can be used interchangeably,
+  e.g. QMI for high-rate metrics while the AT port stays available.
+  Fields without a QMI source keep their zero/empty value, except
+  tx_power which is SW_GSTATUS_TX_POWER_INACTIVE outside of traffic.
+  */
+
+#define QMI_NAS_REGISTER_INDICATIONS 0x0003
+#define QMI_NAS_GET_RF_BAND_INFO    0x0031
+#define QMI_NAS_GET_CELL_LOCATION   0x0043
+#define QMI_NAS_GET_SIGNAL_INFO     0x004F
+#define QMI_NAS_CONFIG_SIGNAL_INFO  0x0050
+#define QMI_NAS_SIGNAL_INFO         0x0051
+#define QMI_NAS_GET_TX_RX_INFO      0x005A
+
+#define QMI_LOC_REGISTER_EVENTS     0x0021
+#define QMI_LOC_START               0x0022
+#define QMI_LOC_STOP                0x0023
+#define QMI_LOC_POSITION_REPORT     0x0024
+
+typedef struct qmi_mc7455 qmi_mc7455_t;
+
+qmi_mc7455_t* qmi_mc7455_init(const char* cdc_wdm_path);
+/* takes ownership of the transport, e.g. a replay in tests */
+qmi_mc7455_t* qmi_mc7455_init_transport(qmi_transport_t* transport);
+void qmi_mc7455_destroy(qmi_mc7455_t* h);
+
+/* same result types and allocation forms as the AT driver, see sw_mc7455_get_status() */
+sw_response_t qmi_mc7455_get_status(qmi_mc7455_t* h, sw_mc7455_gstatus_response_t **result);
+sw_response_t qmi_mc7455_get_status_into(qmi_mc7455_t* h, sw_mc7455_gstatus_response_t* result);
+sw_response_t qmi_mc7455_get_lteinfo(qmi_mc7455_t* h, sw_mc7455_lteinfo_response_t **result);
+sw_response_t qmi_mc7455_get_lteinfo_into(qmi_mc7455_t* h, sw_mc7455_lteinfo_response_t* result);
+
+/* position tracking runs in the modem, get_gpsloc returns the latest fix */
+sw_response_t qmi_mc7455_start_gps(qmi_mc7455_t* h);
+sw_response_t qmi_mc7455_stop_gps(qmi_mc7455_t* h);
+sw_response_t qmi_mc7455_get_gpsloc(qmi_mc7455_t* h, sw_mc7455_gpsloc_response_t **result);
+sw_response_t qmi_mc7455_get_gpsloc_into(qmi_mc7455_t* h, sw_mc7455_gpsloc_response_t* result);
+
+/**
+  Signal levels at which the modem reports a change. Crossing any of
+  the thresholds triggers a signal info indication. At most
+  QMI_MC7455_MAX_THRESHOLDS per metric, empty lists keep the modem's
+  defaults.
+  */
+#define QMI_MC7455_MAX_THRESHOLDS 16
+
+typedef struct qmi_mc7455_signal_thresholds {
+    const float* rsrp;      // dBm
+    int nof_rsrp;
+    const float* rsrq;      // dB
+    int nof_rsrq;
+    const float* snr;       // dB
+    int nof_snr;
+} qmi_mc7455_signal_thresholds_t;
+
+/**
+  Configures the thresholds and enables signal info indications. Signal
+  indications and position reports (see qmi_mc7455_start_gps()) are
+  pushed into the stream as samples of MEAS_SOURCE_INDICATION while
+  qmi_mc7455_process_indications() runs. The stream must outlive the
+  subscription. thresholds may be NULL.
+  */
+sw_response_t qmi_mc7455_subscribe(qmi_mc7455_t* h, const qmi_mc7455_signal_thresholds_t* thresholds, meas_stream_t* stream);
+sw_response_t qmi_mc7455_unsubscribe(qmi_mc7455_t* h);
+
+/* waits up to timeout_ms for indications and handles all pending ones; returns their number or -1 */
+int qmi_mc7455_process_indications(qmi_mc7455_t* h, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,7 @@ typedef struct {
     const char* regex_string;
     regex_t* regex_cache;
     int opt_param;              /* optional param, for integer-batch: BASE*/
+    int field;                  /* bit index in the mask of the _masked batch variants */
 } tokenfind_batch_t;
 
 typedef struct {
@@ -36,6 +37,17 @@ int tokenfind_integer_batch(const char* src_sequence,
                             tokenfind_batch_t* job,
                             int n_jobs);
 
+/**
+  The _masked variants run only the jobs whose field bit is set in mask
+  and set the field bit of every successful job in found (may be NULL).
+  */
+int tokenfind_integer_batch_masked(const char* src_sequence,
+                                   void* base,
+                                   tokenfind_batch_t* job,
+                                   int n_jobs,
+                                   uint64_t mask,
+                                   uint64_t* found);
+
 int tokenfind_integer_single(const char* src_sequence,
                              int* result,
                              const char* regex_string,
@@ -47,6 +59,13 @@ int tokenfind_float_batch(const char* src_sequence,
                           tokenfind_batch_t* job,
                           int n_jobs);
 
+int tokenfind_float_batch_masked(const char* src_sequence,
+                                 void *base_ptr,
+                                 tokenfind_batch_t* job,
+                                 int n_jobs,
+                                 uint64_t mask,
+                                 uint64_t* found);
+
 int tokenfind_float_single(const char* src_sequence,
                            float* result,
                            const char* regex_string,
@@ -58,6 +77,14 @@ int tokenfind_string_batch(const char* src_sequence,
                            int n_jobs,
                            int str_len);
 
+int tokenfind_string_batch_masked(const char* src_sequence,
+                                  void *base_ptr,
+                                  tokenfind_batch_t* job,
+                                  int n_jobs,
+                                  int str_len,
+                                  uint64_t mask,
+                                  uint64_t* found);
+
 int tokenfind_string_single(const char* src_sequence,
                             char* dst_sequence,
                             int dst_length,
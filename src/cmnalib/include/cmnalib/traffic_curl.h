@@ -20,6 +20,57 @@ int tc_upload_randomdata(const char* url,
                            void* callback_context,
                            double minimal_progress_interval_sec);
 
+/**
+  Variants bound to a specific network interface. The interface is passed
+  to CURLOPT_INTERFACE and may be a netdev name ("wwan0"), an IP address,
+  or be prefixed by "if!" or "host!" to enforce the interpretation.
+  NULL follows the default route.
+  */
+int tc_download_and_discard_on_interface(const char* interface,
+                                         const char* url,
+                                         size_t n_bytes_max,
+                                         progress_callback_func* callback,
+                                         void* callback_context,
+                                         double minimal_progress_interval_sec);
+
+int tc_upload_randomdata_on_interface(const char* interface,
+                                      const char* url,
+                                      size_t n_bytes,
+                                      progress_callback_func* callback,
+                                      void* callback_context,
+                                      double minimal_progress_interval_sec);
+
+/**
+  A traffic session keeps its curl handle across transfers, and thereby
+  the connection pool, the DNS cache and TLS sessions. Consecutive transfers
+  to the same server reuse the established connection unless
+  TC_SESSION_FRESH_CONNECT is set, which forces a new connection and
+  name resolution for every transfer (cold start).
+  The functions above use a temporary session for each call.
+  A session must not be used by multiple threads concurrently.
+  */
+#define TC_SESSION_FRESH_CONNECT 0x1
+
+typedef struct tc_session tc_session_t;
+
+tc_session_t* tc_session_init(const char* interface, int flags);
+void tc_session_destroy(tc_session_t* s);
+void tc_session_set_flags(tc_session_t* s, int flags);
+
+int tc_session_download_and_discard(tc_session_t* s,
+                                    const char* url,
+                                    size_t n_bytes_max,
+                                    progress_callback_func* callback,
+                                    void* callback_context,
+                                    double minimal_progress_interval_sec);
+
+int tc_session_upload_randomdata(tc_session_t* s,
+                                 const char* url,
+                                 size_t n_bytes,
+                                 progress_callback_func* callback,
+                                 void* callback_context,
+                                 double minimal_progress_interval_sec);
+
 #ifdef __cplusplus
 }
 #endif
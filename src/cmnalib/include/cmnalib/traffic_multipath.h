@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "traffic_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum tc_direction {
+    TC_DIRECTION_UPLOAD = 0,
+    TC_DIRECTION_DOWNLOAD,
+} tc_direction_t;
+
+/**
+  A single transfer of a multipath run, typically one per modem.
+  */
+typedef struct tc_multipath_job {
+    const char* interface;      // netdev or source address, NULL for default route
+    const char* url;
+    tc_direction_t direction;
+    size_t n_bytes;             // upload size or download limit
+    progress_callback_func* callback;
+    void* callback_context;
+    double minimal_progress_interval_sec;
+
+    // result, set by tc_multipath_run()
+    int result;
+    double start_time;          // sec since epoch when the jobs were released, identical for all jobs of a run
+} tc_multipath_job_t;
+
+/**
+  Runs all jobs concurrently, one thread per job. The threads are released
+  together once all of them exist, so that all transfers start at the same time.
+  Initializes libcurl globally on the first call, before any thread exists.
+  Blocks until all jobs have finished.
+  Returns 0 if all jobs succeeded, -1 otherwise.
+  */
+int tc_multipath_run(tc_multipath_job_t* jobs, size_t n_jobs);
+
+#ifdef __cplusplus
+}
+#endif
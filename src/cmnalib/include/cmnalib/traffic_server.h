@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TC_SERVER_DEFAULT_PORT 5002
+#define TC_SERVER_DEFAULT_GET_BYTES (1024UL*1024UL*1024UL)
+
+/**
+  Minimal embedded HTTP/1.1 endpoint for loopback traffic measurements.
+  - POST/PUT: the request body is read and discarded
+  - GET /<n>: serves a body of <n> bytes from memory
+    (TC_SERVER_DEFAULT_GET_BYTES if <n> is omitted)
+  Persistent connections (keep-alive) are supported.
+  */
+typedef struct tc_server tc_server_t;
+
+typedef struct tc_server_stats {
+    size_t nof_connections;
+    size_t nof_requests;
+    size_t bytes_received;      // discarded request body bytes
+    size_t bytes_sent;          // response body bytes
+} tc_server_stats_t;
+
+tc_server_t* tc_server_start(const char* bind_address, int port);
+void tc_server_stop(tc_server_t* s);
+
+int tc_server_get_port(tc_server_t* s);
+void tc_server_get_stats(tc_server_t* s, tc_server_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,18 @@ typedef struct transfer_statusreport {
   double datarate_ul;
   double total_transfer_time;
   size_t total_transfered_bytes;
+
+  // UDP only, zero for TCP transfers
+  size_t udp_packets_sent;
+  size_t udp_packets_received;
+  size_t udp_packets_lost;
+  size_t udp_packets_reordered;
+  size_t udp_packets_duplicate;
+  size_t udp_packets_out_of_window; // seq too far from the highest one, ignored
+  double delay_min;         // one-way delay in sec
+  double delay_mean;
+  double delay_max;
+  double jitter;            // interarrival jitter (RFC 3550) in sec
 } transfer_statusreport_t;
 
 typedef int (progress_callback_func)(void* user_context,
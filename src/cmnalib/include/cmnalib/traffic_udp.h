@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "traffic_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TC_UDP_DEFAULT_PORT 5003
+
+#define TC_UDP_MAGIC 0x434d4e55     // "CMNU"
+#define TC_UDP_FLAG_LAST 0x1        // end-of-stream marker, seq holds nof sent packets
+#define TC_UDP_FIN_REPEATS 3
+
+/**
+  Header at the beginning of each UDP test packet (network byte order on the wire).
+  The remaining payload is padding up to the configured packet size.
+  */
+typedef struct tc_udp_header {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t t_sent_ns;     // CLOCK_REALTIME of sender
+} tc_udp_header_t;
+
+#define TC_UDP_HEADER_SIZE 24
+#define TC_UDP_MAX_PACKET_SIZE 65507
+
+typedef enum tc_udp_pattern {
+    TC_UDP_PATTERN_CBR = 0,     // equally spaced packets at bitrate
+    TC_UDP_PATTERN_BURST,       // burst_packets back-to-back every burst_interval_sec
+} tc_udp_pattern_t;
+
+typedef struct tc_udp_config {
+    tc_udp_pattern_t pattern;
+    size_t packet_size;         // UDP payload size in bytes, >= TC_UDP_HEADER_SIZE
+    double bitrate;             // CBR only, bits/sec
+    size_t burst_packets;       // BURST only
+    double burst_interval_sec;  // BURST only
+    double duration_sec;        // stop after duration, 0 for unlimited
+    size_t n_packets_max;       // stop after n packets, 0 for unlimited
+} tc_udp_config_t;
+
+typedef struct tc_udp_packet_record {
+    uint32_t seq;
+    uint32_t size;
+    double t_sent;              // sec, sender clock
+    double t_received;          // sec, receiver clock
+} tc_udp_packet_record_t;
+
+typedef struct tc_udp_receiver tc_udp_receiver_t;
+
+void tc_udp_init_config_cbr(tc_udp_config_t* config, double bitrate, size_t packet_size, double duration_sec);
+void tc_udp_init_config_burst(tc_udp_config_t* config, size_t burst_packets, double burst_interval_sec, size_t packet_size, double duration_sec);
+
+void tc_udp_encode_header(const tc_udp_header_t* header, void* buffer);
+int tc_udp_decode_header(const void* buffer, size_t len, tc_udp_header_t* header);
+
+/**
+  Blocking sender. The callback receives datarate_ul and udp_packets_sent
+  in intervals of minimal_progress_interval_sec; a return value other than 0
+  cancels the transmission. Returns nof sent packets or -1 on error.
+  */
+int tc_udp_send(const char* host,
+                int port,
+                const tc_udp_config_t* config,
+                progress_callback_func* callback,
+                void* callback_context,
+                double minimal_progress_interval_sec);
+
+/**
+  Receiver running in a separate thread. The callback receives datarate_dl
+  and the loss, reordering, delay and jitter statistics. Delays are one-way
+  and require synchronized clocks unless sender and receiver share a host.
+  bind_address is a numeric IPv4 or IPv6 address, NULL listens on all
+  interfaces for both families. Duplicates are detected within a window
+  of sequence numbers around the highest one, packets beyond it are only
+  counted as out of window.
+  */
+tc_udp_receiver_t* tc_udp_receiver_start(const char* bind_address,
+                                         int port,
+                                         progress_callback_func* callback,
+                                         void* callback_context,
+                                         double minimal_progress_interval_sec);
+void tc_udp_receiver_stop(tc_udp_receiver_t* r);
+void tc_udp_receiver_destroy(tc_udp_receiver_t* r);
+
+int tc_udp_receiver_get_port(tc_udp_receiver_t* r);
+int tc_udp_receiver_wait_finished(tc_udp_receiver_t* r, double timeout_sec);
+void tc_udp_receiver_get_report(tc_udp_receiver_t* r, transfer_statusreport_t* report);
+
+/* records are in order of arrival, call after tc_udp_receiver_stop(), valid until tc_udp_receiver_destroy() */
+const tc_udp_packet_record_t* tc_udp_receiver_get_records(tc_udp_receiver_t* r, size_t* n_records);
+void tc_udp_receiver_write_records(tc_udp_receiver_t* r, FILE* stream);
+
+#ifdef __cplusplus
+}
+#endif
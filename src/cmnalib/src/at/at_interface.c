@@ -1,102 +1,116 @@
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <errno.h>
 #include <string.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <unistd.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
 
-#include "cmnalib/at_interface.h" 
+#include "cmnalib/at_interface.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE AT
 #include "cmnalib/logger.h"
 
-#define LINE_SEPARATOR "\r\n"
+#define MAX_TERMINATOR_LENGTH 16
 
-struct timeval t_start, t_end, t_delta;
+typedef enum ticket_state {
+    TICKET_PENDING = 0,
+    TICKET_RUNNING,
+    TICKET_DONE,
+} ticket_state_t;
+
+/* one command waiting for the port, shared by coalesced callers */
+typedef struct ticket {
+    struct ticket* next;
+    const at_interface_command_t* cmd;
+    const char* params;
+    at_interface_priority_t priority;
+    uint64_t deadline_us;       // UINT64_MAX without deadline
+    unsigned long seq;
+    int refs;                   // callers waiting for the result
+    ticket_state_t state;
+    at_interface_response_status_t result;
+    at_interface_response_t* response;
+} ticket_t;
+
+/* last successful response of a query, served within its window */
+typedef struct cache_entry {
+    const at_interface_command_t* cmd;
+    uint64_t window_us;
+    uint64_t stamp_us;          // when the command was sent, 0 if empty
+    at_interface_response_t* response;
+} cache_entry_t;
 
 struct at_interface_t {
-    int filedescr;
+    at_transport_t* transport;
     int nof_timeouts;
-    char* tty_device_path;
-    char* line_separator;
-    struct termios old_tty_settings;
-    struct termios current_tty_settings;
-};
 
-at_interface_t* at_interface_open_tty(const char* tty_device_path) {
-    at_interface_t* h = calloc(1, sizeof(at_interface_t));
-    if(h == NULL) {
-        ERROR("Error in calloc\n");
-        return NULL;
-    }
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    ticket_t* pending;
+    ticket_t* running;
+    int busy;
+    unsigned long seq;
+    at_interface_stats_t stats;
+    cache_entry_t cache[AT_INTERFACE_MAX_CACHED_COMMANDS];
+    int nof_cached;
+};
 
-    /* open tty device */
+static uint64_t now_us() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
 
-    if(tty_device_path == NULL) {
-        ERROR("Missing device path\n");
+at_interface_t* at_interface_open_transport(at_transport_t* transport) {
+    if(transport == NULL) {
         return NULL;
     }
-    h->tty_device_path = malloc(strlen(tty_device_path)+1);
-    h->line_separator = malloc(sizeof(LINE_SEPARATOR));
-    if(h->tty_device_path == NULL || h->line_separator == NULL) {
-        ERROR("Error in malloc\n");
+    at_interface_t* h = allocator_calloc(1, sizeof(at_interface_t));
+    if(h == NULL) {
+        ERROR("Error in calloc\n");
+        at_transport_destroy(transport);
         return NULL;
     }
-    strcpy(h->tty_device_path, tty_device_path);
-    strcpy(h->line_separator, LINE_SEPARATOR);
+    h->transport = transport;
+    pthread_mutex_init(&h->lock, NULL);
+    pthread_cond_init(&h->changed, NULL);
+    return h;
+}
 
-    h->filedescr = open(h->tty_device_path,
-                        O_RDWR |
-                        O_NOCTTY |
-                        O_DSYNC
-                        );
-    if(h->filedescr < 0) {
-        ERROR("Could not open device '%s': %s\n", h->tty_device_path, strerror(errno));
+at_interface_t* at_interface_open(const char* device) {
+    if(device == NULL) {
+        ERROR("Missing device path\n");
         return NULL;
     }
-
-    /* configure tty device into raw mode */
-    tcgetattr(h->filedescr, &h->old_tty_settings);
-    h->current_tty_settings = h->old_tty_settings;
-    h->current_tty_settings.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP
-                                         | INLCR | IGNCR | ICRNL | IXON);
-    h->current_tty_settings.c_oflag &= ~(OPOST);
-    h->current_tty_settings.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
-    h->current_tty_settings.c_cflag &= ~(CSIZE | PARENB);
-    h->current_tty_settings.c_cflag |= CS8;
-    tcsetattr(h->filedescr, TCSANOW, &h->current_tty_settings);
-
-    return h;
+    return at_interface_open_transport(at_transport_open(device));
 }
 
-void at_interface_close_tty(at_interface_t* h) {
+void at_interface_close(at_interface_t* h) {
     if(h != NULL) {
-        DEBUG("Restoring previous tty settings\n");
-        tcsetattr(h->filedescr, TCSANOW, &h->old_tty_settings);
-
-        DEBUG("Closing interface %s\n", h->tty_device_path);
-        close(h->filedescr);
-
         DEBUG("Release AT interface resources\n");
-        free(h->tty_device_path);
-        free(h->line_separator);
-        free(h);
+        at_transport_destroy(h->transport);
+        for(int i = 0; i < h->nof_cached; i++) {
+            allocator_free(h->cache[i].response);
+        }
+        pthread_cond_destroy(&h->changed);
+        pthread_mutex_destroy(&h->lock);
+        allocator_free(h);
     }
 }
 
-at_interface_response_status_t at_interface_command_tty(at_interface_t* h,
+/* writes the command and collects its response, the caller owns the port */
+static at_interface_response_status_t execute(at_interface_t* h,
                                               const at_interface_command_t* cmd,
                                               const char* params,
                                               at_interface_response_t** response) {
 
     at_interface_response_status_t result = AT_RESPONSE_UNKNOWN;
+    struct timeval t_start, t_end, t_delta;
 
-    if(response == NULL) {
-        ERROR("Invalid argument\n");
-        return AT_RESPONSE_INVAL;
-    }
-
-    *response = calloc(1, sizeof(at_interface_response_t));
+    *response = allocator_calloc(1, sizeof(at_interface_response_t));
     if(*response == NULL) {
         ERROR("Error in calloc\n");
         return AT_RESPONSE_OUT_OF_MEMORY;
@@ -104,48 +118,51 @@ at_interface_response_status_t at_interface_command_tty(at_interface_t* h,
 
     char tty_cmd[AT_INTERFACE_MAX_COMMAND_STRING_LENGTH +
             AT_INTERFACE_MAX_LINE_SEPARATOR_LENGTH];
-    fd_set fdset;
-    struct timeval timeout;
+    char ok_terminator[MAX_TERMINATOR_LENGTH];
+    char error_terminator[MAX_TERMINATOR_LENGTH];
+    at_transport_t* t = h->transport;
     int ret, len, pos;
 
     strcpy(tty_cmd, cmd->command_string);
     if(params != NULL) strcat(tty_cmd, params);
-    strcat(tty_cmd, h->line_separator);
+    strcat(tty_cmd, t->line_separator);
+    snprintf(ok_terminator, sizeof(ok_terminator), "OK%s", t->line_separator);
+    snprintf(error_terminator, sizeof(error_terminator), "ERROR%s", t->line_separator);
 
     pos = 0;
     (*response)->response_len = 0;
     (*response)->response_string[0] = 0;
 
     DEBUG("Flushing tty input and output buffers\n");
-    ret = tcflush(h->filedescr, TCIOFLUSH);
-    if(ret == -1) {
+    if(t->flush != NULL && t->flush(t->context) != 0) {
         ERROR("Error flushing tty IO buffers: %s\n", strerror(errno));
         return AT_RESPONSE_IO_ERROR;
     }
 
     DEBUG("Writing command to tty: %s\n", tty_cmd);
     gettimeofday(&t_start, NULL);
-    ret = write(h->filedescr, tty_cmd, strlen(tty_cmd));
-    if(ret == -1) {
+    ret = t->write(t->context, tty_cmd, strlen(tty_cmd));
+    if(ret == AT_TRANSPORT_MISMATCH) {
+        return AT_RESPONSE_TEST_COMMAND_MISMATCH;
+    }
+    if(ret != 0) {
         ERROR("Error while writing to tty: %s\n", strerror(errno));
         return AT_RESPONSE_IO_ERROR;
     }
 
-    FD_ZERO(&fdset);
-    FD_SET(h->filedescr, &fdset);
-
     DEBUG("Reading response from tty\n");
     while(1){
-        timeout.tv_sec = cmd->timeout_sec;
-        timeout.tv_usec = cmd->timeout_usec;
         /* wait for new data in buffer (or timeout)*/
-        ret = select(h->filedescr + 1, &fdset, NULL, NULL, &timeout);
-        if(ret == -1) {
-            ERROR("Error in select(): %s\n", strerror(errno));
+        len = t->read(t->context,
+                      &(*response)->response_string[pos],
+                      sizeof((*response)->response_string)-pos-1,
+                      cmd->timeout_sec * 1000 + cmd->timeout_usec / 1000);
+        if(len == -1) {
+            ERROR("Error while reading from tty: %s\n", strerror(errno));
             result = AT_RESPONSE_IO_ERROR;
             break;
         }
-        else if(ret == 0) {
+        else if(len == 0) {
             WARNING("Timeout for AT command response\n");
             h->nof_timeouts++;
             if(h->nof_timeouts > AT_INTERFACE_MAX_CONSECUTIVE_TIMEOUTS) {
@@ -159,32 +176,18 @@ at_interface_response_status_t at_interface_command_tty(at_interface_t* h,
             }
         }
         else {
-            len = read(h->filedescr,
-                       &(*response)->response_string[pos],
-                       sizeof((*response)->response_string)-pos-1);
-            if(len == -1) {
-                ERROR("Error while reading from tty: %s\n", strerror(errno));
-                result = AT_RESPONSE_IO_ERROR;
-                break;
-            }
-
             h->nof_timeouts = 0;
 
             DEBUG("Read %d chars from tty\n", len);
             pos+=len;
             (*response)->response_string[pos] = 0;
 
-            if(len == 0) {
-                WARNING("Received only 0 bytes, probably I/O issue\n");
-                result = AT_RESPONSE_IO_ERROR;
-                break;
-            }
-            if(strstr((*response)->response_string, "OK\r\n")) {
+            if(strstr((*response)->response_string, ok_terminator)) {
                 DEBUG("Early finished due to complete response: OK\n");
                 result = AT_RESPONSE_SUCCESS;
                 break;
             }
-            if(strstr((*response)->response_string, "ERROR\r\n")) {
+            if(strstr((*response)->response_string, error_terminator)) {
                 DEBUG("Early finished due to complete response: ERROR\n");
                 result = AT_RESPONSE_FAILED;
                 break;
@@ -204,9 +207,233 @@ at_interface_response_status_t at_interface_command_tty(at_interface_t* h,
     return result;
 }
 
-void at_interface_free_response_tty(at_interface_response_t* r) {
+/* earlier priority class first, then earlier deadline, then arrival */
+static int ticket_before(const ticket_t* a, const ticket_t* b) {
+    if(a->priority != b->priority) return a->priority < b->priority;
+    if(a->deadline_us != b->deadline_us) return a->deadline_us < b->deadline_us;
+    return a->seq < b->seq;
+}
+
+static ticket_t* next_ticket(at_interface_t* h) {
+    ticket_t* best = h->pending;
+    for(ticket_t* t = h->pending; t != NULL; t = t->next) {
+        if(ticket_before(t, best)) best = t;
+    }
+    return best;
+}
+
+static void remove_ticket(at_interface_t* h, ticket_t* ticket) {
+    ticket_t** p = &h->pending;
+    while(*p != ticket) p = &(*p)->next;
+    *p = ticket->next;
+}
+
+/* read commands like at!gstatus? only, anything else may change the state of the modem */
+static int is_query(const at_interface_command_t* cmd, const char* params) {
+    size_t len = strlen(cmd->command_string);
+    return params == NULL && len > 0 && cmd->command_string[len - 1] == '?';
+}
+
+/* running or pending ticket of the same query, NULL if none */
+static ticket_t* find_coalescable(at_interface_t* h, const at_interface_command_t* cmd) {
+    if(h->running != NULL && h->running->cmd == cmd && h->running->params == NULL) {
+        return h->running;
+    }
+    for(ticket_t* t = h->pending; t != NULL; t = t->next) {
+        if(t->cmd == cmd && t->params == NULL) return t;
+    }
+    return NULL;
+}
+
+static at_interface_response_t* copy_response(const at_interface_response_t* r) {
+    if(r == NULL) return NULL;
+    at_interface_response_t* copy = allocator_malloc(sizeof(at_interface_response_t));
+    if(copy != NULL) {
+        size_t len = strlen(r->response_string);
+        copy->response_len = r->response_len;
+        memcpy(copy->response_string, r->response_string, len + 1);
+    }
+    return copy;
+}
+
+static cache_entry_t* find_cache_entry(at_interface_t* h, const at_interface_command_t* cmd) {
+    for(int i = 0; i < h->nof_cached; i++) {
+        if(h->cache[i].cmd == cmd) return &h->cache[i];
+    }
+    return NULL;
+}
+
+static void clear_cache(at_interface_t* h) {
+    for(int i = 0; i < h->nof_cached; i++) {
+        h->cache[i].stamp_us = 0;
+    }
+}
+
+/* keeps a copy of a successful query, any other command clears the cache */
+static void update_cache(at_interface_t* h, const ticket_t* ticket, uint64_t t_sent) {
+    if(!is_query(ticket->cmd, ticket->params)) {
+        clear_cache(h);
+        return;
+    }
+    cache_entry_t* e = find_cache_entry(h, ticket->cmd);
+    if(e == NULL || e->window_us == 0 || ticket->result != AT_RESPONSE_SUCCESS || ticket->response == NULL) {
+        return;
+    }
+    if(e->response == NULL) {
+        e->response = allocator_malloc(sizeof(at_interface_response_t));
+        if(e->response == NULL) return;
+    }
+    e->response->response_len = ticket->response->response_len;
+    memcpy(e->response->response_string, ticket->response->response_string,
+           strlen(ticket->response->response_string) + 1);
+    e->stamp_us = t_sent;
+}
+
+int at_interface_set_cache_window(at_interface_t* h, const at_interface_command_t* cmd, int window_ms) {
+    if(h == NULL || cmd == NULL || window_ms < 0) {
+        ERROR("Invalid argument\n");
+        return -1;
+    }
+    pthread_mutex_lock(&h->lock);
+    cache_entry_t* e = find_cache_entry(h, cmd);
+    if(e == NULL) {
+        if(h->nof_cached >= AT_INTERFACE_MAX_CACHED_COMMANDS) {
+            pthread_mutex_unlock(&h->lock);
+            ERROR("Too many cached commands\n");
+            return -1;
+        }
+        e = &h->cache[h->nof_cached++];
+        e->cmd = cmd;
+    }
+    e->window_us = (uint64_t)window_ms * 1000;
+    e->stamp_us = 0;
+    pthread_mutex_unlock(&h->lock);
+    return 0;
+}
+
+void at_interface_clear_cache(at_interface_t* h) {
+    if(h == NULL) return;
+    pthread_mutex_lock(&h->lock);
+    clear_cache(h);
+    pthread_mutex_unlock(&h->lock);
+}
+
+at_interface_response_status_t at_interface_command(at_interface_t* h,
+                                              const at_interface_command_t* cmd,
+                                              const char* params,
+                                              at_interface_response_t** response) {
+    return at_interface_command_scheduled(h, cmd, params, AT_PRIORITY_INTERACTIVE, 0, response);
+}
+
+at_interface_response_status_t at_interface_command_scheduled(at_interface_t* h,
+                                                              const at_interface_command_t* cmd,
+                                                              const char* params,
+                                                              at_interface_priority_t priority,
+                                                              int deadline_ms,
+                                                              at_interface_response_t** response) {
+    if(response == NULL) {
+        ERROR("Invalid argument\n");
+        return AT_RESPONSE_INVAL;
+    }
+    *response = NULL;
+    if(h == NULL || cmd == NULL || priority < 0 || priority >= AT_PRIORITY__MAX) {
+        ERROR("Invalid argument\n");
+        return AT_RESPONSE_INVAL;
+    }
+
+    uint64_t t_arrival = now_us();
+    uint64_t deadline_us = deadline_ms > 0 ? t_arrival + (uint64_t)deadline_ms * 1000 : UINT64_MAX;
+
+    pthread_mutex_lock(&h->lock);
+
+    cache_entry_t* cached = is_query(cmd, params) ? find_cache_entry(h, cmd) : NULL;
+    if(cached != NULL && cached->stamp_us != 0 && t_arrival - cached->stamp_us <= cached->window_us) {
+        DEBUG("Serving %s from cache\n", cmd->command_string);
+        h->stats.nof_cache_hits++;
+        *response = copy_response(cached->response);
+        pthread_mutex_unlock(&h->lock);
+        return *response != NULL ? AT_RESPONSE_SUCCESS : AT_RESPONSE_OUT_OF_MEMORY;
+    }
+
+    ticket_t* ticket = is_query(cmd, params) ? find_coalescable(h, cmd) : NULL;
+    if(ticket != NULL) {
+        DEBUG("Sharing pending %s\n", cmd->command_string);
+        ticket->refs++;
+        if(priority < ticket->priority) ticket->priority = priority;
+        if(deadline_us < ticket->deadline_us) ticket->deadline_us = deadline_us;
+        h->stats.nof_coalesced++;
+        // the order of the pending tickets may have changed
+        pthread_cond_broadcast(&h->changed);
+    }
+    else {
+        ticket = allocator_calloc(1, sizeof(ticket_t));
+        if(ticket == NULL) {
+            pthread_mutex_unlock(&h->lock);
+            ERROR("Error in calloc\n");
+            return AT_RESPONSE_OUT_OF_MEMORY;
+        }
+        ticket->cmd = cmd;
+        ticket->params = params;
+        ticket->priority = priority;
+        ticket->deadline_us = deadline_us;
+        ticket->seq = h->seq++;
+        ticket->refs = 1;
+        ticket->next = h->pending;
+        h->pending = ticket;
+
+        while(h->busy || next_ticket(h) != ticket) {
+            pthread_cond_wait(&h->changed, &h->lock);
+        }
+        remove_ticket(h, ticket);
+        ticket->state = TICKET_RUNNING;
+        h->running = ticket;
+        h->busy = 1;
+        h->stats.nof_commands++;
+        uint64_t t_sent = now_us();
+        uint64_t wait_us = t_sent - t_arrival;
+        if(wait_us > h->stats.max_wait_us[ticket->priority]) {
+            h->stats.max_wait_us[ticket->priority] = wait_us;
+        }
+        pthread_mutex_unlock(&h->lock);
+
+        ticket->result = execute(h, cmd, params, &ticket->response);
+
+        pthread_mutex_lock(&h->lock);
+        update_cache(h, ticket, t_sent);
+        ticket->state = TICKET_DONE;
+        h->running = NULL;
+        h->busy = 0;
+        pthread_cond_broadcast(&h->changed);
+    }
+
+    while(ticket->state != TICKET_DONE) {
+        pthread_cond_wait(&h->changed, &h->lock);
+    }
+
+    // the last caller takes the response, the others get a copy
+    at_interface_response_status_t result = ticket->result;
+    if(--ticket->refs == 0) {
+        *response = ticket->response;
+        allocator_free(ticket);
+    }
+    else {
+        *response = copy_response(ticket->response);
+        if(*response == NULL && ticket->response != NULL) result = AT_RESPONSE_OUT_OF_MEMORY;
+    }
+    pthread_mutex_unlock(&h->lock);
+
+    return result;
+}
+
+void at_interface_get_stats(at_interface_t* h, at_interface_stats_t* stats) {
+    pthread_mutex_lock(&h->lock);
+    *stats = h->stats;
+    pthread_mutex_unlock(&h->lock);
+}
+
+void at_interface_free_response(at_interface_response_t* r) {
     if(r != NULL) {
         r->response_len = 0;
     }
-    free(r);
+    allocator_free(r);
 }
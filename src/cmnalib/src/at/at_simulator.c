@@ -0,0 +1,343 @@
+#define _GNU_SOURCE  // ptsname_r
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <termios.h>
+#include <pthread.h>
+
+#include <gmodule.h>
+
+#include "cmnalib/at_simulator.h"
+#define LOGGER_MODULE AT
+#include "cmnalib/logger.h"
+
+#define SIM_MAX_LINE_LENGTH 4096
+#define SIM_MAX_RESPONSE_LENGTH 100000
+#define SIM_POLL_INTERVAL_MS 50
+#define SIM_GARBAGE_LENGTH 16
+
+typedef struct sim_entry {
+    char** responses;   // tty framed, "\r\n" line endings
+    int nof_responses;
+    int next;
+} sim_entry_t;
+
+struct at_simulator {
+    at_simulator_config_t config;
+    GHashTable* commands;   // command string -> sim_entry_t*
+    int master;
+    int slave;              // kept open so the line settings persist between clients
+    char device[128];
+    pthread_t thread;
+    int running;
+    volatile int stop;
+    pthread_mutex_t lock;
+    at_simulator_stats_t stats;
+};
+
+static void entry_free(gpointer data) {
+    sim_entry_t* entry = (sim_entry_t*)data;
+    for(int i = 0; i < entry->nof_responses; i++) {
+        free(entry->responses[i]);
+    }
+    free(entry->responses);
+    free(entry);
+}
+
+at_simulator_t* at_simulator_create(const at_simulator_config_t* config) {
+    at_simulator_t* sim = calloc(1, sizeof(at_simulator_t));
+    if(sim == NULL) {
+        ERROR("Error in calloc\n");
+        return NULL;
+    }
+    if(config != NULL) sim->config = *config;
+    sim->commands = g_hash_table_new_full(g_str_hash, g_str_equal, free, entry_free);
+    sim->master = -1;
+    sim->slave = -1;
+    pthread_mutex_init(&sim->lock, NULL);
+    return sim;
+}
+
+static int add_response(at_simulator_t* sim, const char* command, const char* response) {
+    sim_entry_t* entry = g_hash_table_lookup(sim->commands, command);
+    if(entry == NULL) {
+        entry = calloc(1, sizeof(sim_entry_t));
+        char* key = strdup(command);
+        if(entry == NULL || key == NULL) {
+            free(entry);
+            free(key);
+            return -1;
+        }
+        g_hash_table_insert(sim->commands, key, entry);
+    }
+    char** responses = realloc(entry->responses, (entry->nof_responses + 1) * sizeof(char*));
+    if(responses == NULL) return -1;
+    entry->responses = responses;
+    entry->responses[entry->nof_responses] = strdup(response);
+    if(entry->responses[entry->nof_responses] == NULL) return -1;
+    entry->nof_responses++;
+    return 0;
+}
+
+/* same final lines as the mock transport */
+static int is_final_line(const char* line) {
+    size_t len = strlen(line);
+    return (len >= 2 && strcmp(line + len - 2, "OK") == 0) || strstr(line, "ERROR") != NULL;
+}
+
+int at_simulator_load_file(at_simulator_t* sim, const char* response_file) {
+    char line[SIM_MAX_LINE_LENGTH];
+    char command[SIM_MAX_LINE_LENGTH] = {0};
+    int nof_commands = 0;
+    size_t pos = 0;
+
+    FILE* file = fopen(response_file, "r");
+    if(file == NULL) {
+        ERROR("Could not open file '%s': %s\n", response_file, strerror(errno));
+        return -1;
+    }
+    char* response = malloc(SIM_MAX_RESPONSE_LENGTH);
+    if(response == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    // a modem frames its response with an empty line in front
+    while(fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\r\n")] = 0;
+        if(command[0] == 0) {
+            if(line[0] == 0) continue;
+            snprintf(command, sizeof(command), "%s", line);
+            pos = snprintf(response, SIM_MAX_RESPONSE_LENGTH, "\r\n");
+            continue;
+        }
+        if(pos + strlen(line) + 3 >= SIM_MAX_RESPONSE_LENGTH) {
+            ERROR("Response too long in '%s'\n", response_file);
+            break;
+        }
+        pos += sprintf(response + pos, "%s\r\n", line);
+        if(is_final_line(line)) {
+            if(add_response(sim, command, response) != 0) break;
+            nof_commands++;
+            command[0] = 0;
+        }
+    }
+    fclose(file);
+    free(response);
+    return nof_commands;
+}
+
+int at_simulator_load_directory(at_simulator_t* sim, const char* directory) {
+    char path[PATH_MAX];
+    int total = 0;
+
+    DIR* dir = opendir(directory);
+    if(dir == NULL) {
+        ERROR("Could not open directory '%s': %s\n", directory, strerror(errno));
+        return -1;
+    }
+    struct dirent* entry;
+    while((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if(len < 4 || strcmp(entry->d_name + len - 4, ".txt") != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        int n = at_simulator_load_file(sim, path);
+        if(n > 0) total += n;
+    }
+    closedir(dir);
+    DEBUG("Loaded %d responses for %u commands\n", total, g_hash_table_size(sim->commands));
+    return total;
+}
+
+static void sleep_us(long us) {
+    if(us <= 0) return;
+    struct timespec t = {us / 1000000, (us % 1000000) * 1000};
+    while(nanosleep(&t, &t) == -1 && errno == EINTR);
+}
+
+/* the master is non-blocking, a client that stopped reading must not hold up a stop */
+static int write_all(at_simulator_t* sim, const char* buf, size_t len) {
+    while(len > 0 && !sim->stop) {
+        ssize_t n = write(sim->master, buf, len);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN) {
+                struct pollfd pfd = {sim->master, POLLOUT, 0};
+                poll(&pfd, 1, SIM_POLL_INTERVAL_MS);
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* writes in chunks at the configured pace */
+static void send_bytes(at_simulator_t* sim, const char* buf, size_t len) {
+    size_t chunk = sim->config.chunk_size > 0 ? (size_t)sim->config.chunk_size : len;
+    while(len > 0 && !sim->stop) {
+        size_t n = len < chunk ? len : chunk;
+        if(write_all(sim, buf, n) != 0) return;
+        buf += n;
+        len -= n;
+        long pause_us = 0;
+        if(sim->config.baud > 0) pause_us += (long)(n * 10 * 1000000LL / sim->config.baud);
+        if(len > 0) pause_us += sim->config.chunk_gap_us;
+        sleep_us(pause_us);
+    }
+}
+
+static int chance(at_simulator_t* sim, double probability) {
+    return probability > 0 && (double)rand_r(&sim->config.seed) / RAND_MAX < probability;
+}
+
+static void handle_command(at_simulator_t* sim, const char* command) {
+    static const char unknown[] = "\r\nERROR\r\n";
+
+    pthread_mutex_lock(&sim->lock);
+    sim->stats.nof_commands++;
+    sim_entry_t* entry = g_hash_table_lookup(sim->commands, command);
+    const char* response = unknown;
+    if(entry != NULL) {
+        response = entry->responses[entry->next];
+        entry->next = (entry->next + 1) % entry->nof_responses;
+    }
+    else {
+        sim->stats.nof_unknown++;
+        DEBUG("Simulator has no response for '%s'\n", command);
+    }
+    int timeout = chance(sim, sim->config.timeout_probability);
+    int garbage = !timeout && chance(sim, sim->config.garbage_probability);
+    int partial = !timeout && chance(sim, sim->config.partial_probability);
+    if(timeout) sim->stats.nof_timeouts++;
+    if(garbage) sim->stats.nof_garbage++;
+    if(partial) sim->stats.nof_partial++;
+    char noise[SIM_GARBAGE_LENGTH + 2];
+    if(garbage) {
+        for(int i = 0; i < SIM_GARBAGE_LENGTH; i++) {
+            noise[i] = (char)(1 + rand_r(&sim->config.seed) % 255);
+        }
+        noise[SIM_GARBAGE_LENGTH] = '\r';
+        noise[SIM_GARBAGE_LENGTH + 1] = '\n';
+    }
+    pthread_mutex_unlock(&sim->lock);
+
+    if(timeout) return;
+
+    sleep_us(sim->config.latency_us);
+    if(garbage) send_bytes(sim, noise, sizeof(noise));
+
+    size_t len = strlen(response);
+    if(partial) {
+        // drop the final line, the "\r\n" before it stays
+        size_t end = len >= 2 ? len - 2 : 0;
+        while(end > 0 && response[end - 1] != '\n') end--;
+        len = end;
+    }
+    send_bytes(sim, response, len);
+}
+
+static void* simulator_thread(void* arg) {
+    at_simulator_t* sim = (at_simulator_t*)arg;
+    char line[SIM_MAX_LINE_LENGTH];
+    size_t pos = 0;
+    char buf[256];
+
+    while(!sim->stop) {
+        struct pollfd pfd = {sim->master, POLLIN, 0};
+        int ret = poll(&pfd, 1, SIM_POLL_INTERVAL_MS);
+        if(ret < 0 && errno != EINTR) break;
+        if(ret <= 0) continue;
+
+        ssize_t n = read(sim->master, buf, sizeof(buf));
+        if(n <= 0) {
+            // EIO while no client has the slave open
+            sleep_us(SIM_POLL_INTERVAL_MS * 1000);
+            continue;
+        }
+        for(ssize_t i = 0; i < n; i++) {
+            if(buf[i] == '\r' || buf[i] == '\n') {
+                if(pos > 0) {
+                    line[pos] = 0;
+                    handle_command(sim, line);
+                    pos = 0;
+                }
+            }
+            else if(pos < sizeof(line) - 1) {
+                line[pos++] = buf[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+int at_simulator_start(at_simulator_t* sim) {
+    if(sim == NULL || sim->running) return -1;
+
+    sim->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(sim->master < 0 || grantpt(sim->master) != 0 || unlockpt(sim->master) != 0 ||
+       ptsname_r(sim->master, sim->device, sizeof(sim->device)) != 0) {
+        ERROR("Could not create pseudo terminal: %s\n", strerror(errno));
+        if(sim->master >= 0) close(sim->master);
+        sim->master = -1;
+        return -1;
+    }
+
+    // raw line settings before any client connects, otherwise the slave echoes
+    sim->slave = open(sim->device, O_RDWR | O_NOCTTY);
+    if(sim->slave < 0) {
+        ERROR("Could not open %s: %s\n", sim->device, strerror(errno));
+        close(sim->master);
+        sim->master = -1;
+        return -1;
+    }
+    struct termios settings;
+    tcgetattr(sim->slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(sim->slave, TCSANOW, &settings);
+
+    sim->stop = 0;
+    if(pthread_create(&sim->thread, NULL, simulator_thread, sim) != 0) {
+        ERROR("Could not start simulator thread\n");
+        close(sim->slave);
+        close(sim->master);
+        sim->slave = sim->master = -1;
+        return -1;
+    }
+    sim->running = 1;
+    DEBUG("Simulated modem on %s\n", sim->device);
+    return 0;
+}
+
+const char* at_simulator_get_device(at_simulator_t* sim) {
+    return sim != NULL && sim->running ? sim->device : NULL;
+}
+
+void at_simulator_get_stats(at_simulator_t* sim, at_simulator_stats_t* stats) {
+    pthread_mutex_lock(&sim->lock);
+    *stats = sim->stats;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void at_simulator_destroy(at_simulator_t* sim) {
+    if(sim == NULL) return;
+    if(sim->running) {
+        sim->stop = 1;
+        pthread_join(sim->thread, NULL);
+        close(sim->slave);
+        close(sim->master);
+    }
+    g_hash_table_destroy(sim->commands);
+    pthread_mutex_destroy(&sim->lock);
+    free(sim);
+}
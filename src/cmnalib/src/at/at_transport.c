@@ -0,0 +1,557 @@
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/select.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cmnalib/at_interface.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE AT
+#include "cmnalib/logger.h"
+
+#define TTY_LINE_SEPARATOR "\r\n"
+#define MOCK_LINE_SEPARATOR "\n"
+
+#define RECORDING_HEADER "# cmnalib AT recording v1: <direction> <time us> <escaped bytes>"
+
+void at_transport_destroy(at_transport_t* transport) {
+    if(transport != NULL) {
+        if(transport->close != NULL) {
+            transport->close(transport->context);
+        }
+        allocator_free(transport);
+    }
+}
+
+static at_transport_t* create_transport(void* context, void (*close_context)(void*)) {
+    at_transport_t* transport = allocator_calloc(1, sizeof(at_transport_t));
+    if(transport == NULL) {
+        ERROR("Error in calloc\n");
+        close_context(context);
+        return NULL;
+    }
+    transport->close = close_context;
+    transport->context = context;
+    return transport;
+}
+
+static uint64_t monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleep_us(uint64_t us) {
+    struct timespec t;
+    t.tv_sec = us / 1000000;
+    t.tv_nsec = (us % 1000000) * 1000;
+    while(nanosleep(&t, &t) == -1 && errno == EINTR);
+}
+
+/*
+ * tty
+ */
+
+typedef struct tty_context {
+    int filedescr;
+    char* tty_device_path;
+    struct termios old_tty_settings;
+    struct termios current_tty_settings;
+} tty_context_t;
+
+static int tty_write(void* transport_context, const char* buf, size_t len) {
+    tty_context_t* c = (tty_context_t*)transport_context;
+    return write(c->filedescr, buf, len) == (ssize_t)len ? 0 : -1;
+}
+
+static int tty_read(void* transport_context, char* buf, size_t buf_size, int timeout_ms) {
+    tty_context_t* c = (tty_context_t*)transport_context;
+    fd_set fdset;
+    struct timeval timeout;
+
+    FD_ZERO(&fdset);
+    FD_SET(c->filedescr, &fdset);
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    int ret = select(c->filedescr + 1, &fdset, NULL, NULL, &timeout);
+    if(ret == -1) {
+        ERROR("Error in select(): %s\n", strerror(errno));
+        return -1;
+    }
+    if(ret == 0) {
+        return 0;
+    }
+    ssize_t len = read(c->filedescr, buf, buf_size);
+    if(len == 0) {
+        WARNING("Received only 0 bytes, probably I/O issue\n");
+        return -1;
+    }
+    return len;
+}
+
+static int tty_flush(void* transport_context) {
+    tty_context_t* c = (tty_context_t*)transport_context;
+    return tcflush(c->filedescr, TCIOFLUSH);
+}
+
+static void tty_close(void* transport_context) {
+    tty_context_t* c = (tty_context_t*)transport_context;
+    if(c->filedescr >= 0) {
+        DEBUG("Restoring previous tty settings\n");
+        tcsetattr(c->filedescr, TCSANOW, &c->old_tty_settings);
+
+        DEBUG("Closing interface %s\n", c->tty_device_path);
+        close(c->filedescr);
+    }
+    allocator_free(c->tty_device_path);
+    allocator_free(c);
+}
+
+at_transport_t* at_transport_tty(const char* tty_device_path) {
+    if(tty_device_path == NULL) {
+        ERROR("Missing device path\n");
+        return NULL;
+    }
+    tty_context_t* c = allocator_calloc(1, sizeof(tty_context_t));
+    if(c == NULL) {
+        ERROR("Error in calloc\n");
+        return NULL;
+    }
+    c->filedescr = -1;
+    c->tty_device_path = allocator_strdup(tty_device_path);
+    if(c->tty_device_path == NULL) {
+        ERROR("Error in malloc\n");
+        tty_close(c);
+        return NULL;
+    }
+
+    /* open tty device */
+    c->filedescr = open(c->tty_device_path,
+                        O_RDWR |
+                        O_NOCTTY |
+                        O_DSYNC
+                        );
+    if(c->filedescr < 0) {
+        ERROR("Could not open device '%s': %s\n", c->tty_device_path, strerror(errno));
+        tty_close(c);
+        return NULL;
+    }
+
+    /* configure tty device into raw mode */
+    tcgetattr(c->filedescr, &c->old_tty_settings);
+    c->current_tty_settings = c->old_tty_settings;
+    c->current_tty_settings.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP
+                                         | INLCR | IGNCR | ICRNL | IXON);
+    c->current_tty_settings.c_oflag &= ~(OPOST);
+    c->current_tty_settings.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    c->current_tty_settings.c_cflag &= ~(CSIZE | PARENB);
+    c->current_tty_settings.c_cflag |= CS8;
+    tcsetattr(c->filedescr, TCSANOW, &c->current_tty_settings);
+
+    at_transport_t* t = create_transport(c, tty_close);
+    if(t != NULL) {
+        t->write = tty_write;
+        t->read = tty_read;
+        t->flush = tty_flush;
+        t->line_separator = TTY_LINE_SEPARATOR;
+    }
+    return t;
+}
+
+/*
+ * file mock
+ */
+
+typedef struct mock_context {
+    FILE* file;
+    int response_pending;   // command matched, response not yet read
+} mock_context_t;
+
+static int mock_write(void* transport_context, const char* buf, size_t len) {
+    mock_context_t* c = (mock_context_t*)transport_context;
+    char tty_cmd_from_file[AT_INTERFACE_MAX_COMMAND_STRING_LENGTH +
+            AT_INTERFACE_MAX_LINE_SEPARATOR_LENGTH] = {0};
+
+    // First read and compare command from file
+    if(fscanf(c->file, "%" TOSTRING(AT_INTERFACE_MAX_COMMAND_STRING_LENGTH) "[^" MOCK_LINE_SEPARATOR "]" MOCK_LINE_SEPARATOR, tty_cmd_from_file) == EOF) {
+        return AT_TRANSPORT_MISMATCH;
+    }
+    strcat(tty_cmd_from_file, MOCK_LINE_SEPARATOR);
+    if(strlen(tty_cmd_from_file) != len || strncmp(buf, tty_cmd_from_file, len) != 0) {
+        return AT_TRANSPORT_MISMATCH;
+    }
+    c->response_pending = 1;
+    return 0;
+}
+
+static int mock_read(void* transport_context, char* buf, size_t buf_size, int timeout_ms) {
+    mock_context_t* c = (mock_context_t*)transport_context;
+    char tty_response_buf[AT_INTERFACE_MAX_RESPONSE_STRING_LENGTH];
+    size_t pos = 0;
+    (void)timeout_ms;
+
+    if(!c->response_pending) {
+        return 0;
+    }
+    c->response_pending = 0;
+
+    // the whole response up to its final line arrives as one chunk
+    while(EOF != fscanf(c->file, "%" TOSTRING(AT_INTERFACE_MAX_COMMAND_STRING_LENGTH) "[^" MOCK_LINE_SEPARATOR "]%*[" MOCK_LINE_SEPARATOR "]", tty_response_buf)) {
+        strcat(tty_response_buf, MOCK_LINE_SEPARATOR);
+        size_t len = strlen(tty_response_buf);
+        if(pos + len >= buf_size) {
+            ERROR("Mock response exceeds buffer\n");
+            return -1;
+        }
+        memcpy(buf + pos, tty_response_buf, len);
+        pos += len;
+
+        if(strstr(tty_response_buf, "OK"MOCK_LINE_SEPARATOR) ||
+           strstr(tty_response_buf, "ERROR"MOCK_LINE_SEPARATOR) ||
+           strstr(tty_response_buf, "+CME ERROR")) {
+            break;
+        }
+    }
+    return pos;
+}
+
+static void mock_close(void* transport_context) {
+    mock_context_t* c = (mock_context_t*)transport_context;
+    if(c->file != NULL) fclose(c->file);
+    allocator_free(c);
+}
+
+at_transport_t* at_transport_file_mock(const char* response_file) {
+    mock_context_t* c = allocator_calloc(1, sizeof(mock_context_t));
+    if(c == NULL) {
+        ERROR("Error in calloc\n");
+        return NULL;
+    }
+    c->file = fopen(response_file, "r");
+    if(c->file == NULL) {
+        ERROR("Could not open file '%s': %s\n", response_file, strerror(errno));
+        mock_close(c);
+        return NULL;
+    }
+
+    at_transport_t* t = create_transport(c, mock_close);
+    if(t != NULL) {
+        t->write = mock_write;
+        t->read = mock_read;
+        t->line_separator = MOCK_LINE_SEPARATOR;
+    }
+    return t;
+}
+
+/*
+ * recorder
+ *
+ * One line per command ('>') and per received chunk ('<'), each with
+ * its time since the start of the recording. Bytes are escaped like C
+ * strings, so chunk boundaries and line separators are preserved.
+ */
+
+typedef struct recorder_context {
+    at_transport_t* inner;
+    FILE* file;
+    uint64_t start_us;
+} recorder_context_t;
+
+static void record(recorder_context_t* c, char direction, const char* buf, size_t len) {
+    fprintf(c->file, "%c %llu ", direction, (unsigned long long)(monotonic_us() - c->start_us));
+    for(size_t i = 0; i < len; i++) {
+        unsigned char ch = buf[i];
+        switch(ch) {
+        case '\r': fputs("\\r", c->file); break;
+        case '\n': fputs("\\n", c->file); break;
+        case '\t': fputs("\\t", c->file); break;
+        case '\\': fputs("\\\\", c->file); break;
+        default:
+            if(isprint(ch)) fputc(ch, c->file);
+            else fprintf(c->file, "\\x%02x", ch);
+        }
+    }
+    fputc('\n', c->file);
+    fflush(c->file);
+}
+
+static int recorder_write(void* transport_context, const char* buf, size_t len) {
+    recorder_context_t* c = (recorder_context_t*)transport_context;
+    record(c, '>', buf, len);
+    return c->inner->write(c->inner->context, buf, len);
+}
+
+static int recorder_read(void* transport_context, char* buf, size_t buf_size, int timeout_ms) {
+    recorder_context_t* c = (recorder_context_t*)transport_context;
+    int len = c->inner->read(c->inner->context, buf, buf_size, timeout_ms);
+    if(len > 0) record(c, '<', buf, len);
+    return len;
+}
+
+static int recorder_flush(void* transport_context) {
+    recorder_context_t* c = (recorder_context_t*)transport_context;
+    return c->inner->flush != NULL ? c->inner->flush(c->inner->context) : 0;
+}
+
+static void recorder_close(void* transport_context) {
+    recorder_context_t* c = (recorder_context_t*)transport_context;
+    at_transport_destroy(c->inner);
+    if(c->file != NULL) fclose(c->file);
+    allocator_free(c);
+}
+
+at_transport_t* at_transport_recorder(at_transport_t* inner, const char* filename) {
+    if(inner == NULL) return NULL;
+    recorder_context_t* c = allocator_calloc(1, sizeof(recorder_context_t));
+    if(c == NULL) {
+        ERROR("Error in calloc\n");
+        at_transport_destroy(inner);
+        return NULL;
+    }
+    c->inner = inner;
+    c->start_us = monotonic_us();
+    c->file = fopen(filename, "w");
+    if(c->file == NULL) {
+        ERROR("Could not open recording '%s': %s\n", filename, strerror(errno));
+        recorder_close(c);
+        return NULL;
+    }
+    fprintf(c->file, RECORDING_HEADER "\n");
+
+    at_transport_t* t = create_transport(c, recorder_close);
+    if(t != NULL) {
+        t->write = recorder_write;
+        t->read = recorder_read;
+        t->flush = recorder_flush;
+        t->line_separator = inner->line_separator;
+    }
+    return t;
+}
+
+/*
+ * replay
+ */
+
+typedef struct replay_record {
+    char direction;
+    uint64_t time_us;
+    size_t len;
+    char* data;
+} replay_record_t;
+
+typedef struct replay_context {
+    replay_record_t* records;
+    size_t nof_records;
+    size_t pos;             // next record
+    size_t offset;          // bytes of records[pos] already delivered
+    int realtime;
+    uint64_t command_time_us;   // recorded time of the last command
+    uint64_t command_start_us;  // when it was written during replay
+} replay_context_t;
+
+static int unescape(const char* in, char* out, size_t out_size) {
+    size_t n = 0;
+    while(*in != 0 && *in != '\n' && n < out_size) {
+        if(*in != '\\') {
+            out[n++] = *in++;
+            continue;
+        }
+        in++;
+        switch(*in) {
+        case 'r': out[n++] = '\r'; in++; break;
+        case 'n': out[n++] = '\n'; in++; break;
+        case 't': out[n++] = '\t'; in++; break;
+        case '\\': out[n++] = '\\'; in++; break;
+        case 'x':
+            if(!isxdigit((unsigned char)in[1]) || !isxdigit((unsigned char)in[2])) return -1;
+            {
+                char byte[3] = {in[1], in[2], 0};
+                out[n++] = (char)strtoul(byte, NULL, 16);
+            }
+            in += 3;
+            break;
+        default:
+            return -1;
+        }
+    }
+    return n;
+}
+
+static int replay_write(void* transport_context, const char* buf, size_t len) {
+    replay_context_t* c = (replay_context_t*)transport_context;
+    // chunks the caller did not wait for are discarded like by tcflush
+    while(c->pos < c->nof_records && c->records[c->pos].direction == '<') {
+        c->pos++;
+    }
+    c->offset = 0;
+    if(c->pos >= c->nof_records) {
+        ERROR("AT replay exhausted\n");
+        return AT_TRANSPORT_MISMATCH;
+    }
+    replay_record_t* r = &c->records[c->pos];
+    if(r->len != len || memcmp(r->data, buf, len) != 0) {
+        ERROR("AT replay mismatch at record %zu\n", c->pos + 1);
+        return AT_TRANSPORT_MISMATCH;
+    }
+    c->command_time_us = r->time_us;
+    c->command_start_us = monotonic_us();
+    c->pos++;
+    return 0;
+}
+
+static int replay_read(void* transport_context, char* buf, size_t buf_size, int timeout_ms) {
+    replay_context_t* c = (replay_context_t*)transport_context;
+    uint64_t timeout_us = (uint64_t)timeout_ms * 1000;
+
+    if(c->pos >= c->nof_records || c->records[c->pos].direction != '<') {
+        // the recording ran into a timeout here
+        if(c->realtime) sleep_us(timeout_us);
+        return 0;
+    }
+    replay_record_t* r = &c->records[c->pos];
+
+    if(c->realtime) {
+        uint64_t due = r->time_us > c->command_time_us ? r->time_us - c->command_time_us : 0;
+        uint64_t elapsed = monotonic_us() - c->command_start_us;
+        if(due > elapsed) {
+            // the timeout restarts with every read, like select() on the tty
+            if(due - elapsed > timeout_us) {
+                sleep_us(timeout_us);
+                return 0;
+            }
+            sleep_us(due - elapsed);
+        }
+    }
+
+    size_t len = r->len - c->offset;
+    if(len > buf_size) len = buf_size;
+    memcpy(buf, r->data + c->offset, len);
+    c->offset += len;
+    if(c->offset == r->len) {
+        c->pos++;
+        c->offset = 0;
+    }
+    return len;
+}
+
+static void replay_close(void* transport_context) {
+    replay_context_t* c = (replay_context_t*)transport_context;
+    for(size_t i = 0; i < c->nof_records; i++) {
+        allocator_free(c->records[i].data);
+    }
+    allocator_free(c->records);
+    allocator_free(c);
+}
+
+at_transport_t* at_transport_replay(const char* filename, int realtime) {
+    FILE* file = fopen(filename, "r");
+    if(file == NULL) {
+        ERROR("Could not open recording '%s': %s\n", filename, strerror(errno));
+        return NULL;
+    }
+    replay_context_t* c = allocator_calloc(1, sizeof(replay_context_t));
+    char* line = allocator_malloc(4 * AT_INTERFACE_MAX_RESPONSE_STRING_LENGTH);
+    char* data = allocator_malloc(AT_INTERFACE_MAX_RESPONSE_STRING_LENGTH);
+    if(c == NULL || line == NULL || data == NULL) {
+        ERROR("Error in malloc\n");
+        fclose(file);
+        allocator_free(c);
+        allocator_free(line);
+        allocator_free(data);
+        return NULL;
+    }
+    c->realtime = realtime;
+
+    int line_number = 0;
+    while(fgets(line, 4 * AT_INTERFACE_MAX_RESPONSE_STRING_LENGTH, file) != NULL) {
+        line_number++;
+        if(line[0] != '>' && line[0] != '<') continue;
+
+        char* payload;
+        unsigned long long time_us = strtoull(line + 1, &payload, 10);
+        int len = *payload == ' ' ? unescape(payload + 1, data, AT_INTERFACE_MAX_RESPONSE_STRING_LENGTH) : -1;
+        if(len <= 0) {
+            ERROR("Invalid record in %s:%d\n", filename, line_number);
+            continue;
+        }
+        replay_record_t* records = allocator_realloc(c->records, (c->nof_records + 1) * sizeof(replay_record_t));
+        if(records == NULL) break;
+        c->records = records;
+        replay_record_t* r = &c->records[c->nof_records];
+        r->direction = line[0];
+        r->time_us = time_us;
+        r->len = len;
+        r->data = allocator_malloc(len);
+        if(r->data == NULL) break;
+        memcpy(r->data, data, len);
+        c->nof_records++;
+    }
+    fclose(file);
+    allocator_free(line);
+    allocator_free(data);
+
+    at_transport_t* t = create_transport(c, replay_close);
+    if(t != NULL) {
+        t->write = replay_write;
+        t->read = replay_read;
+        // the separator of the recorded commands
+        t->line_separator = TTY_LINE_SEPARATOR;
+        for(size_t i = 0; i < c->nof_records; i++) {
+            if(c->records[i].direction == '>') {
+                size_t n = c->records[i].len;
+                if(n < 2 || c->records[i].data[n - 2] != '\r') t->line_separator = MOCK_LINE_SEPARATOR;
+                break;
+            }
+        }
+    }
+    return t;
+}
+
+/*
+ * selection by device string
+ */
+
+static int has_prefix(const char* s, const char* prefix) {
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+at_transport_t* at_transport_open(const char* device) {
+    if(device == NULL) {
+        ERROR("Missing device path\n");
+        return NULL;
+    }
+    if(has_prefix(device, "mock:")) {
+        return at_transport_file_mock(device + strlen("mock:"));
+    }
+    if(has_prefix(device, "replay:")) {
+        return at_transport_replay(device + strlen("replay:"), 0);
+    }
+    if(has_prefix(device, "replay-realtime:")) {
+        return at_transport_replay(device + strlen("replay-realtime:"), 1);
+    }
+    if(has_prefix(device, "record:")) {
+        const char* spec = device + strlen("record:");
+        const char* separator = strchr(spec, '=');
+        if(separator == NULL || separator == spec || separator[1] == 0) {
+            ERROR("Expected record:FILE=TTY, got '%s'\n", device);
+            return NULL;
+        }
+        char* filename = allocator_strndup(spec, separator - spec);
+        if(filename == NULL) return NULL;
+        at_transport_t* t = at_transport_recorder(at_transport_tty(separator + 1), filename);
+        allocator_free(filename);
+        return t;
+    }
+    if(has_prefix(device, "tty:")) {
+        device += strlen("tty:");
+    }
+    return at_transport_tty(device);
+}
@@ -17,13 +17,12 @@
 #include "cmnalib/at_interface.h"
 #include "cmnalib/enumerate.h"
 #include "cmnalib/at_sierra_wireless_em7565.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE DEVICES
 #include "cmnalib/logger.h"
 #include "cmnalib/tokenfind.h"
 #include "cmnalib/conversion.h"
 
-#undef LOGGER_LEVEL
-#define LOGGER_LEVEL LOGGER_VERBOSE_INFO
-
 #define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
 
 #undef ADDCOMMAND
@@ -48,8 +47,27 @@ double sw_em7565_gps_raw_to_double(int32_t int_value) {
     return result;
 }
 
+#define SW_EM7565_USB_VENDOR_ID     "1199"
+#define SW_EM7565_USB_MODEL_ID      "9091"
+#define SW_EM7565_SUBSYSTEM         "tty"
+#define SW_EM7565_USB_INTERFACE_NUM "03"
+
+const hotplug_match_t sw_em7565_hotplug_match = {
+    .vendor_id = SW_EM7565_USB_VENDOR_ID,
+    .model_id = SW_EM7565_USB_MODEL_ID,
+    .subsystem = SW_EM7565_SUBSYSTEM,
+    .usb_interface_num = SW_EM7565_USB_INTERFACE_NUM,
+};
+
 GSList* sw_em7565_enumerate_devices() {
-    return enumerate_supported_devices("1199", "9091", "tty", "03");
+    return sw_em7565_enumerate_devices_on_interface(SW_EM7565_USB_INTERFACE_NUM);
+}
+
+GSList* sw_em7565_enumerate_devices_on_interface(const char* usb_interface_num) {
+    return enumerate_supported_devices(SW_EM7565_USB_VENDOR_ID,
+                                       SW_EM7565_USB_MODEL_ID,
+                                       SW_EM7565_SUBSYSTEM,
+                                       usb_interface_num);
 }
 
 void sw_em7565_enumerate_devices_free(GSList* list) {
@@ -72,24 +90,126 @@ sw_em7565_t* sw_em7565_init_first() {
     return result;
 }
 
+sw_em7565_t* sw_em7565_init_hotplug(hotplug_monitor_t* monitor, unsigned long added_after, int timeout_ms) {
+    sw_em7565_t* result = NULL;
+    hotplug_device_t* device = hotplug_wait_for_device(monitor, &sw_em7565_hotplug_match, added_after, timeout_ms);
+
+    if(device != NULL) {
+        result = sw_em7565_init(device->device_name);
+    }
+    else {
+        ERROR("No supported device appeared\n");
+    }
+
+    hotplug_device_destroy(device);
+    return result;
+}
+
 sw_em7565_t* sw_em7565_init(const char* tty_device_path) {
+    return sw_em7565_init_ports(tty_device_path, NULL);
+}
+
+sw_em7565_t* sw_em7565_init_ports(const char* tty_device_path, const char* secondary_device_path) {
     DEBUG("Opening device %s\n", tty_device_path);
 
-    sw_em7565_t* h = calloc(1, sizeof(sw_em7565_t));
+    sw_em7565_t* h = allocator_calloc(1, sizeof(sw_em7565_t));
+    if(h == NULL) {
+        ERROR("ERROR in calloc\n");
+        return NULL;
+    }
     h->tty = at_interface_open(tty_device_path);
     if(h->tty == NULL) {
-        free(h);
+        allocator_free(h);
         ERROR("Initialization failed\n");
         return NULL;
     }
+    if(secondary_device_path != NULL) {
+        DEBUG("Opening secondary device %s\n", secondary_device_path);
+        h->tty_secondary = at_interface_open(secondary_device_path);
+        if(h->tty_secondary == NULL) {
+            at_interface_close(h->tty);
+            allocator_free(h);
+            ERROR("Initialization of secondary port failed\n");
+            return NULL;
+        }
+    }
     return h;
 }
 
 void sw_em7565_destroy(sw_em7565_t* h) {
     if(h != NULL) {
         at_interface_close(h->tty);
+        if(h->tty_secondary != NULL) at_interface_close(h->tty_secondary);
     }
-    free(h);
+    allocator_free(h);
+}
+
+int sw_em7565_is_secondary_command(sw_em7565_cmd_t cmd) {
+    switch(cmd) {
+    case SW_EM7565_AT_GPSAUTOSTART_SET:
+    case SW_EM7565_AT_WANT_SET:
+    case SW_EM7565_AT_CGDCONT:
+    case SW_EM7565_AT_SET_DATA_CONNECTION:
+    case SW_EM7565_AT_SET_RAT:
+    case SW_EM7565_AT_GET_RAT:
+    case SW_EM7565_AT_SET_BAND_PROFILE:
+    case SW_EM7565_AT_GET_BAND_PROFILE:
+    case SW_EM7565_AT_GET_BAND_PROFILE_LIST:
+    case SW_EM7565_AT_SET_COPS:
+    case SW_EM7565_AT_GET_COPS:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+at_interface_priority_t sw_em7565_command_priority(sw_em7565_cmd_t cmd) {
+    switch(cmd) {
+    case SW_EM7565_AT_GSTATUS:
+    case SW_EM7565_AT_LTEINFO:
+    case SW_EM7565_AT_GPSLOC:
+    case SW_EM7565_AT_GPSSTATUS:
+    case SW_EM7565_AT_GET_COPS_CURRENT:
+        return AT_PRIORITY_REALTIME;
+    case SW_EM7565_AT_GET_COPS:
+    case SW_EM7565_AT_GET_BAND_PROFILE_LIST:
+        return AT_PRIORITY_BACKGROUND;
+    default:
+        return AT_PRIORITY_INTERACTIVE;
+    }
+}
+
+static at_interface_t* sw_em7565_port(sw_em7565_t* h, sw_em7565_cmd_t cmd) {
+    if(h->tty_secondary != NULL && sw_em7565_is_secondary_command(cmd)) {
+        return h->tty_secondary;
+    }
+    return h->tty;
+}
+
+int sw_em7565_set_cache_window(sw_em7565_t* h, sw_em7565_cmd_t cmd, int window_ms) {
+    if(h == NULL || cmd < 0 || cmd >= SW_EM7565_CMD__MAX) {
+        ERROR("Invalid argument\n");
+        return -1;
+    }
+    return at_interface_set_cache_window(sw_em7565_port(h, cmd), &sw_em7565_command_defs[cmd], window_ms);
+}
+
+static at_interface_response_status_t sw_em7565_command(sw_em7565_t* h,
+                                                        sw_em7565_cmd_t cmd,
+                                                        const char* params,
+                                                        at_interface_response_t** response) {
+    at_interface_t* port = sw_em7565_port(h, cmd);
+    at_interface_response_status_t ret = at_interface_command_scheduled(port,
+                                                                        &sw_em7565_command_defs[cmd],
+                                                                        params,
+                                                                        sw_em7565_command_priority(cmd),
+                                                                        0,
+                                                                        response);
+    // the secondary port only sets with params, the queries on the primary port are outdated then
+    if(port != h->tty && params != NULL) {
+        at_interface_clear_cache(h->tty);
+    }
+    return ret;
 }
 
 sw_response_t sw_em7565_is_ready(sw_em7565_t* h) {
@@ -103,7 +223,7 @@ sw_response_t sw_em7565_is_ready(sw_em7565_t* h) {
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_READY], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_READY, NULL, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -139,6 +259,11 @@ sw_response_t sw_em7565_set_protected_commands(sw_em7565_t* h, int enable) {
     at_interface_response_t* response;
     const char* params = enable ? "\"A710\"" : "\"123\"";
     ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_SET_ENTERCND], params, &response);
+    if(ret == AT_RESPONSE_SUCCESS && h->tty_secondary != NULL) {
+        // the protected configuration commands are sent on the secondary port
+        at_interface_free_response(response);
+        ret = at_interface_command(h->tty_secondary, &sw_em7565_command_defs[SW_EM7565_AT_SET_ENTERCND], params, &response);
+    }
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -173,7 +298,7 @@ sw_response_t sw_em7565_get_protected_commands(sw_em7565_t* h, int* enable) {
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GET_ENTERCND], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GET_ENTERCND, NULL, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -211,7 +336,7 @@ sw_response_t sw_em7565_reset(sw_em7565_t* h) {
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_RESET], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_RESET, NULL, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -235,13 +360,13 @@ sw_response_t sw_em7565_reset(sw_em7565_t* h) {
 
 void sw_em7565_free_status(sw_em7565_gstatus_response_t* s) {
     if(s != NULL) {
-        free(s);
+        allocator_free(s);
     }
 }
 
 sw_em7565_gstatus_response_t* sw_em7565_allocate_status() {
   sw_em7565_gstatus_response_t* result = NULL;
-  result = calloc(1, sizeof(sw_em7565_gstatus_response_t));
+  result = allocator_calloc(1, sizeof(sw_em7565_gstatus_response_t));
   if(result != NULL) {
     result->tx_power = SW_GSTATUS_TX_POWER_INACTIVE;
   }
@@ -249,15 +374,20 @@ sw_em7565_gstatus_response_t* sw_em7565_allocate_status() {
 }
 
 sw_response_t sw_em7565_get_status(sw_em7565_t* h, sw_em7565_gstatus_response_t* result) {
+    return sw_em7565_get_status_fields(h, SW_EM7565_GSTATUS_ALL, result);
+}
+
+sw_response_t sw_em7565_get_status_fields(sw_em7565_t* h, uint64_t mask, sw_em7565_gstatus_response_t* result) {
     at_interface_response_status_t ret;
 
     if(h == NULL || h->tty == NULL || result == NULL) {
         ERROR("Incomplete handle\n");
         return SW_RESPONSE_INVAL;
     }
+    result->valid = 0;
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GSTATUS], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GSTATUS, NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_em7565_command_defs[SW_EM7565_AT_GSTATUS].command_string);
@@ -266,79 +396,125 @@ sw_response_t sw_em7565_get_status(sw_em7565_t* h, sw_em7565_gstatus_response_t*
     }
 
     static tokenfind_batch_t int_jobs[] = {
-        {offsetof(sw_em7565_gstatus_response_t, current_time), "Current Time:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, temperature), "Temperature:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, reset_counter), "Reset Counter:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_band), "LTE band:[[:space:]]\\{1,\\}[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_bw_MHz), "LTE bw:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_rx_chan), "LTE Rx chan:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_tx_chan), "LTE Tx chan:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc1_band), "LTE SSC1 band:[[:space:]]*[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc1_bw_MHz), "LTE SSC1 bw  :[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc1_chan), "LTE SSC1 chan:[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc2_band), "LTE SSC2 band:[[:space:]]*[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc2_bw_MHz), "LTE SSC2 bw  :[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc2_chan), "LTE SSC2 chan:[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc3_band), "LTE SSC3 band:[[:space:]]*[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc3_bw_MHz), "LTE SSC3 bw  :[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc3_chan), "LTE SSC3 chan:[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc4_band), "LTE SSC4 band:[[:space:]]*[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc4_bw_MHz), "LTE SSC4 bw  :[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc4_chan), "LTE SSC4 chan:[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, pcc_rxm_rssi), "PCC RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, pcc_rxm_rsrp), "PCC RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}PCC RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, pcc_rxd_rssi), "PCC RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, pcc_rxd_rsrp), "PCC RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}PCC RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc1_rxm_rssi), "SCC1 RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc1_rxm_rsrp), "SCC1 RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC1 RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc1_rxd_rssi), "SCC1 RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc1_rxd_rsrp), "SCC1 RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC1 RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc2_rxm_rssi), "SCC2 RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc2_rxm_rsrp), "SCC2 RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC2 RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc2_rxd_rssi), "SCC2 RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc2_rxd_rsrp), "SCC2 RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC2 RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc3_rxm_rssi), "SCC3 RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc3_rxm_rsrp), "SCC3 RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC3 RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc3_rxd_rssi), "SCC3 RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc3_rxd_rsrp), "SCC3 RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC3 RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc4_rxm_rssi), "SCC4 RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc4_rxm_rsrp), "SCC4 RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC4 RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc4_rxd_rssi), "SCC4 RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, scc4_rxd_rsrp), "SCC4 RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC4 RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, tx_power), "Tx Power:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, tac), "TAC:[[:space:]]\\{1,\\}[[:xdigit:]]\\{1,\\} (\\([[:digit:]]\\{1,\\}\\))[[:space:]]\\{1,\\}", NULL, 10},
-        {offsetof(sw_em7565_gstatus_response_t, cell_id), "Cell ID:[[:space:]]\\{1,\\}[[:xdigit:]]\\{1,\\} (\\([[:digit:]]\\{1,\\}\\))[[:space:]]\\{1,\\}", NULL, 10},
+        {offsetof(sw_em7565_gstatus_response_t, current_time), "Current Time:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_CURRENT_TIME},
+        {offsetof(sw_em7565_gstatus_response_t, temperature), "Temperature:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_TEMPERATURE},
+        {offsetof(sw_em7565_gstatus_response_t, reset_counter), "Reset Counter:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_RESET_COUNTER},
+        {offsetof(sw_em7565_gstatus_response_t, lte_band), "LTE band:[[:space:]]\\{1,\\}[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_BAND},
+        {offsetof(sw_em7565_gstatus_response_t, lte_bw_MHz), "LTE bw:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10, SW_EM7565_GSTATUS_LTE_BW_MHZ},
+        {offsetof(sw_em7565_gstatus_response_t, lte_rx_chan), "LTE Rx chan:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_RX_CHAN},
+        {offsetof(sw_em7565_gstatus_response_t, lte_tx_chan), "LTE Tx chan:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_TX_CHAN},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc1_band), "LTE SSC1 band:[[:space:]]*[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC1_BAND},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc1_bw_MHz), "LTE SSC1 bw  :[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC1_BW_MHZ},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc1_chan), "LTE SSC1 chan:[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC1_CHAN},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc2_band), "LTE SSC2 band:[[:space:]]*[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC2_BAND},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc2_bw_MHz), "LTE SSC2 bw  :[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC2_BW_MHZ},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc2_chan), "LTE SSC2 chan:[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC2_CHAN},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc3_band), "LTE SSC3 band:[[:space:]]*[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC3_BAND},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc3_bw_MHz), "LTE SSC3 bw  :[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC3_BW_MHZ},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc3_chan), "LTE SSC3 chan:[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC3_CHAN},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc4_band), "LTE SSC4 band:[[:space:]]*[[:alpha:]]\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC4_BAND},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc4_bw_MHz), "LTE SSC4 bw  :[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}MHz", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC4_BW_MHZ},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc4_chan), "LTE SSC4 chan:[[:space:]]*\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_LTE_SCC4_CHAN},
+        {offsetof(sw_em7565_gstatus_response_t, pcc_rxm_rssi), "PCC RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_PCC_RXM_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, pcc_rxm_rsrp), "PCC RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}PCC RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_PCC_RXM_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, pcc_rxd_rssi), "PCC RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_PCC_RXD_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, pcc_rxd_rsrp), "PCC RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}PCC RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_PCC_RXD_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, scc1_rxm_rssi), "SCC1 RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC1_RXM_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, scc1_rxm_rsrp), "SCC1 RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC1 RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC1_RXM_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, scc1_rxd_rssi), "SCC1 RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC1_RXD_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, scc1_rxd_rsrp), "SCC1 RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC1 RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC1_RXD_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, scc2_rxm_rssi), "SCC2 RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC2_RXM_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, scc2_rxm_rsrp), "SCC2 RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC2 RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC2_RXM_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, scc2_rxd_rssi), "SCC2 RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC2_RXD_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, scc2_rxd_rsrp), "SCC2 RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC2 RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC2_RXD_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, scc3_rxm_rssi), "SCC3 RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC3_RXM_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, scc3_rxm_rsrp), "SCC3 RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC3 RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC3_RXM_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, scc3_rxd_rssi), "SCC3 RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC3_RXD_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, scc3_rxd_rsrp), "SCC3 RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC3 RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC3_RXD_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, scc4_rxm_rssi), "SCC4 RxM RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC4_RXM_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, scc4_rxm_rsrp), "SCC4 RxM RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC4 RxM RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC4_RXM_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, scc4_rxd_rssi), "SCC4 RxD RSSI:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC4_RXD_RSSI},
+        {offsetof(sw_em7565_gstatus_response_t, scc4_rxd_rsrp), "SCC4 RxD RSSI:[[:space:]]\\{1,\\}-*[[:digit:]]\\{1,\\}[[:space:]]\\{1,\\}SCC4 RxD RSRP:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_SCC4_RXD_RSRP},
+        {offsetof(sw_em7565_gstatus_response_t, tx_power), "Tx Power:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_TX_POWER},
+        {offsetof(sw_em7565_gstatus_response_t, tac), "TAC:[[:space:]]\\{1,\\}[[:xdigit:]]\\{1,\\} (\\([[:digit:]]\\{1,\\}\\))[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_TAC},
+        {offsetof(sw_em7565_gstatus_response_t, cell_id), "Cell ID:[[:space:]]\\{1,\\}[[:xdigit:]]\\{1,\\} (\\([[:digit:]]\\{1,\\}\\))[[:space:]]\\{1,\\}", NULL, 10, SW_EM7565_GSTATUS_CELL_ID},
     };
-    tokenfind_integer_batch(response->response_string, result, int_jobs, NELEMS(int_jobs));
+    tokenfind_integer_batch_masked(response->response_string, result, int_jobs, NELEMS(int_jobs), mask, &result->valid);
 
     static tokenfind_batch_t string_jobs[] = {
-        {offsetof(sw_em7565_gstatus_response_t, mode), "Mode:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, system_mode), "System mode:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, ps_state), "PS state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc1_state), "LTE SSC1 state:[[:space:]]\\{0,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc2_state), "LTE SSC2 state:[[:space:]]\\{0,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc3_state), "LTE SSC3 state:[[:space:]]\\{0,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, lte_scc4_state), "LTE SSC4 state:[[:space:]]\\{0,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, emm_state), "EMM state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, rrc_state), "RRC state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, ims_reg_state), "IMS reg state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
+        {offsetof(sw_em7565_gstatus_response_t, mode), "Mode:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_MODE},
+        {offsetof(sw_em7565_gstatus_response_t, system_mode), "System mode:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_SYSTEM_MODE},
+        {offsetof(sw_em7565_gstatus_response_t, ps_state), "PS state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_PS_STATE},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc1_state), "LTE SSC1 state:[[:space:]]\\{0,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_LTE_SCC1_STATE},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc2_state), "LTE SSC2 state:[[:space:]]\\{0,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_LTE_SCC2_STATE},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc3_state), "LTE SSC3 state:[[:space:]]\\{0,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_LTE_SCC3_STATE},
+        {offsetof(sw_em7565_gstatus_response_t, lte_scc4_state), "LTE SSC4 state:[[:space:]]\\{0,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_LTE_SCC4_STATE},
+        {offsetof(sw_em7565_gstatus_response_t, emm_state), "EMM state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_EMM_STATE},
+        {offsetof(sw_em7565_gstatus_response_t, rrc_state), "RRC state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_RRC_STATE},
+        {offsetof(sw_em7565_gstatus_response_t, ims_reg_state), "IMS reg state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_IMS_REG_STATE},
     };
-    tokenfind_string_batch(response->response_string, result, string_jobs, NELEMS(string_jobs), SW_EM7565_GSTATUS_RESPONSE_STRLEN);
+    tokenfind_string_batch_masked(response->response_string, result, string_jobs, NELEMS(string_jobs), SW_EM7565_GSTATUS_RESPONSE_STRLEN, mask, &result->valid);
 
     static tokenfind_batch_t float_jobs[] = {
-        {offsetof(sw_em7565_gstatus_response_t, rsrq), "RSRQ (dB):[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL},
-        {offsetof(sw_em7565_gstatus_response_t, sinr), "SINR (dB):[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL},
+        {offsetof(sw_em7565_gstatus_response_t, rsrq), "RSRQ (dB):[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_RSRQ},
+        {offsetof(sw_em7565_gstatus_response_t, sinr), "SINR (dB):[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL, 0, SW_EM7565_GSTATUS_SINR},
     };
-    tokenfind_float_batch(response->response_string, result, float_jobs, NELEMS(float_jobs));
+    tokenfind_float_batch_masked(response->response_string, result, float_jobs, NELEMS(float_jobs), mask, &result->valid);
 
     at_interface_free_response(response);
 
     return SW_RESPONSE_SUCCESS;
 }
 
+#define SET_FIELD(S, FIELD, MEMBER, VALUE) do { (S)->MEMBER = (VALUE); (S)->valid |= MEAS_FIELD_BIT(FIELD); } while(0)
+
+void sw_em7565_fill_meas_sample(const sw_em7565_gstatus_response_t* status,
+                                const sw_em7565_lteinfo_response_t* lteinfo,
+                                meas_sample_t* sample) {
+    if(status != NULL) {
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_PCC_RXM_RSRP)) {
+            SET_FIELD(sample, MEAS_FIELD_RSRP, rsrp, status->pcc_rxm_rsrp);
+        }
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_PCC_RXM_RSSI)) {
+            SET_FIELD(sample, MEAS_FIELD_RSSI, rssi, status->pcc_rxm_rssi);
+        }
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_RSRQ)) {
+            SET_FIELD(sample, MEAS_FIELD_RSRQ, rsrq, status->rsrq);
+        }
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_SINR)) {
+            SET_FIELD(sample, MEAS_FIELD_SINR, sinr, status->sinr);
+        }
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_TX_POWER)) {
+            SET_FIELD(sample, MEAS_FIELD_TX_POWER, tx_power, status->tx_power);
+        }
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_CELL_ID)) {
+            SET_FIELD(sample, MEAS_FIELD_CELL_ID, cell_id, status->cell_id);
+        }
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_TAC)) {
+            SET_FIELD(sample, MEAS_FIELD_TAC, tac, status->tac);
+        }
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_LTE_RX_CHAN)) {
+            SET_FIELD(sample, MEAS_FIELD_EARFCN, earfcn, status->lte_rx_chan);
+        }
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_LTE_BAND)) {
+            SET_FIELD(sample, MEAS_FIELD_BAND, band, status->lte_band);
+        }
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_LTE_BW_MHZ)) {
+            SET_FIELD(sample, MEAS_FIELD_BANDWIDTH, bandwidth_MHz, status->lte_bw_MHz);
+        }
+    }
+    if(lteinfo != NULL && lteinfo->serving_valid) {
+        SET_FIELD(sample, MEAS_FIELD_RSRP, rsrp, lteinfo->rsrp);
+        SET_FIELD(sample, MEAS_FIELD_RSRQ, rsrq, lteinfo->rsrq);
+        SET_FIELD(sample, MEAS_FIELD_RSSI, rssi, lteinfo->rssi);
+        SET_FIELD(sample, MEAS_FIELD_PCI, pci, lteinfo->pci);
+        SET_FIELD(sample, MEAS_FIELD_EARFCN, earfcn, lteinfo->earfn);
+    }
+}
+
 sw_em7565_information_response_t* sw_em7565_allocate_information() {
   sw_em7565_information_response_t* result = NULL;
-  result = calloc(1, sizeof(sw_em7565_information_response_t));
+  result = allocator_calloc(1, sizeof(sw_em7565_information_response_t));
   return result;
 }
 
@@ -351,7 +527,7 @@ sw_response_t sw_em7565_get_information(sw_em7565_t* h, sw_em7565_information_re
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_INFO], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_INFO, NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_em7565_command_defs[SW_EM7565_AT_INFO].command_string);
@@ -376,12 +552,37 @@ sw_response_t sw_em7565_get_information(sw_em7565_t* h, sw_em7565_information_re
 }
 
 void sw_em7565_free_information(sw_em7565_information_response_t* s) {
-  free(s);
+  allocator_free(s);
+}
+
+/* grows a neighbour buffer to hold at least n entries */
+static int reserve_neighbours(void** buffer, int* capacity, int n, size_t size) {
+    if(n <= *capacity) return 0;
+    void* grown = allocator_realloc(*buffer, n * size);
+    if(grown == NULL) {
+        ERROR("Error in realloc\n");
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = n;
+    return 0;
+}
+
+void sw_em7565_clear_lteinfo(sw_em7565_lteinfo_response_t* result) {
+    sw_em7565_lteinfo_intrafreq_neighbour_t* intrafreq_neighbours = result->intrafreq_neighbours;
+    sw_em7565_lteinfo_interfreq_neighbour_t* interfreq_neighbours = result->interfreq_neighbours;
+    int intrafreq_capacity = result->_intrafreq_capacity;
+    int interfreq_capacity = result->_interfreq_capacity;
+    memset(result, 0, sizeof(*result));
+    result->intrafreq_neighbours = intrafreq_neighbours;
+    result->interfreq_neighbours = interfreq_neighbours;
+    result->_intrafreq_capacity = intrafreq_capacity;
+    result->_interfreq_capacity = interfreq_capacity;
 }
 
 sw_em7565_lteinfo_response_t* sw_em7565_allocate_lteinfo() {
   sw_em7565_lteinfo_response_t* result = NULL;
-  result = calloc(1, sizeof(sw_em7565_lteinfo_response_t));
+  result = allocator_calloc(1, sizeof(sw_em7565_lteinfo_response_t));
 
   return result;
 }
@@ -395,8 +596,11 @@ sw_response_t sw_em7565_get_lteinfo(sw_em7565_t* h, sw_em7565_lteinfo_response_t
         return SW_RESPONSE_INVAL;
     }
 
+    // nothing of a previous call may survive a response without neighbours
+    sw_em7565_clear_lteinfo(result);
+
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_LTEINFO], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_LTEINFO, NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_em7565_command_defs[SW_EM7565_AT_LTEINFO].command_string);
@@ -431,6 +635,7 @@ sw_response_t sw_em7565_get_lteinfo(sw_em7565_t* h, sw_em7565_lteinfo_response_t
             (result)->rsrp  = conversion_str_to_float(serving_info_tbl->row[1].column[11]);
             (result)->rssi  = conversion_str_to_float(serving_info_tbl->row[1].column[12]);
             (result)->rxlv  = conversion_str_to_int(serving_info_tbl->row[1].column[13], 10);
+            (result)->serving_valid = 1;
         }
         tokenfind_free_table(serving_info_tbl);
     }
@@ -447,11 +652,12 @@ sw_response_t sw_em7565_get_lteinfo(sw_em7565_t* h, sw_em7565_lteinfo_response_t
     if(val > 0) {
         tokenfind_string_table_t* intra_info_tbl = tokenfind_parse_table(slice);
         if(intra_info_tbl != NULL && intra_info_tbl->n_rows > 1) {
-            if(result->intrafreq_neighbours != NULL) {
-              free(result->intrafreq_neighbours);
+            if(reserve_neighbours((void**)&result->intrafreq_neighbours, &result->_intrafreq_capacity,
+                                  intra_info_tbl->n_rows - 1, sizeof(sw_em7565_lteinfo_intrafreq_neighbour_t)) != 0) {
+                tokenfind_free_table(intra_info_tbl);
+                at_interface_free_response(response);
+                return SW_RESPONSE_OUT_OF_MEMORY;
             }
-            (result)->nof_intrafreq_neighbours = 0;
-            (result)->intrafreq_neighbours = calloc((unsigned int)intra_info_tbl->n_rows - 1, sizeof(sw_em7565_lteinfo_intrafreq_neighbour_t));
             for(int row_idx = 1; row_idx < intra_info_tbl->n_rows; row_idx++) {
                 (result)->intrafreq_neighbours[(result)->nof_intrafreq_neighbours].pci =
                         conversion_str_to_int(intra_info_tbl->row[row_idx].column[0], 10);
@@ -482,11 +688,12 @@ sw_response_t sw_em7565_get_lteinfo(sw_em7565_t* h, sw_em7565_lteinfo_response_t
     if(val > 0) {
         tokenfind_string_table_t* inter_info_tbl = tokenfind_parse_table(slice);
         if(inter_info_tbl != NULL && inter_info_tbl->n_rows > 1) {
-            if(result->interfreq_neighbours != NULL) {
-              free(result->interfreq_neighbours);
+            if(reserve_neighbours((void**)&result->interfreq_neighbours, &result->_interfreq_capacity,
+                                  inter_info_tbl->n_rows - 1, sizeof(sw_em7565_lteinfo_interfreq_neighbour_t)) != 0) {
+                tokenfind_free_table(inter_info_tbl);
+                at_interface_free_response(response);
+                return SW_RESPONSE_OUT_OF_MEMORY;
             }
-            (result)->nof_interfreq_neighbours = 0;
-            (result)->interfreq_neighbours = calloc((unsigned int)inter_info_tbl->n_rows - 1, sizeof(sw_em7565_lteinfo_interfreq_neighbour_t));
             for(int row_idx = 1; row_idx < inter_info_tbl->n_rows; row_idx++) {
                 (result)->interfreq_neighbours[(result)->nof_interfreq_neighbours].earfcn =
                         conversion_str_to_int(inter_info_tbl->row[row_idx].column[0], 10);
@@ -522,24 +729,26 @@ void sw_em7565_free_lteinfo(sw_em7565_lteinfo_response_t* s) {
     if(s != NULL) {
       //clear inter
       if(s->interfreq_neighbours != NULL) {
-        free(s->interfreq_neighbours);
+        allocator_free(s->interfreq_neighbours);
         s->interfreq_neighbours = NULL;
       }
       s->nof_interfreq_neighbours = 0;
 
       //clear intra
       if(s->intrafreq_neighbours != NULL) {
-        free(s->intrafreq_neighbours);
+        allocator_free(s->intrafreq_neighbours);
         s->intrafreq_neighbours = NULL;
       }
       s->nof_intrafreq_neighbours = 0;
+      s->_intrafreq_capacity = 0;
+      s->_interfreq_capacity = 0;
     }
-    free(s);
+    allocator_free(s);
 }
 
 sw_em7565_gpsloc_response_t* sw_em7565_allocate_gpsloc() {
   sw_em7565_gpsloc_response_t* result = NULL;
-  result = calloc(1, sizeof(sw_em7565_gpsloc_response_t));
+  result = allocator_calloc(1, sizeof(sw_em7565_gpsloc_response_t));
   return result;
 }
 
@@ -552,7 +761,7 @@ sw_response_t sw_em7565_get_gpsloc(sw_em7565_t* h, sw_em7565_gpsloc_response_t *
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GPSLOC], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GPSLOC, NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_em7565_command_defs[SW_EM7565_AT_GPSLOC].command_string);
@@ -600,7 +809,7 @@ sw_response_t sw_em7565_get_gpsloc(sw_em7565_t* h, sw_em7565_gpsloc_response_t *
 }
 
 void sw_em7565_free_get_gpsloc(sw_em7565_gpsloc_response_t* s) {
-    free(s);
+    allocator_free(s);
 }
 
 sw_response_t sw_em7565_stop_gps(sw_em7565_t* h) {
@@ -613,7 +822,7 @@ sw_response_t sw_em7565_stop_gps(sw_em7565_t* h) {
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GPSEND], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GPSEND, NULL, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -655,7 +864,7 @@ sw_response_t sw_em7565_start_gps(sw_em7565_t* h,
              max_inaccuracy,
              fix_count,
              fix_rate);
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GPSTRACK], params, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GPSTRACK, params, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -704,7 +913,7 @@ sw_response_t sw_em7565_set_antenna_power(sw_em7565_t* h,
     at_interface_response_t* response;
     char params[AT_INTERFACE_MAX_COMMAND_STRING_LENGTH];
     snprintf(params, sizeof(params), "%d", antenna_mode);
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_WANT_SET], params, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_WANT_SET, params, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -734,7 +943,7 @@ sw_em7565_gps_antenna_power_mode_t sw_em7565_get_antenna_power(sw_em7565_t* h) {
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_WANT_GET], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_WANT_GET, NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_em7565_command_defs[SW_EM7565_AT_WANT_GET].command_string);
@@ -774,7 +983,7 @@ sw_response_t sw_em7565_set_APN(sw_em7565_t* h, int slot, const char* ip_vers, c
              slot,
              ip_vers,
              apn);
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_CGDCONT], params, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_CGDCONT, params, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -810,7 +1019,7 @@ sw_response_t sw_em7565_set_data_connection(sw_em7565_t* h, int data_connection_
     snprintf(params, sizeof(params), "%d,%d",
              data_connection_status,
              PDN_CONNECTION_ID);
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_SET_DATA_CONNECTION], params, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_SET_DATA_CONNECTION, params, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -840,7 +1049,7 @@ int sw_em7565_get_data_connection(sw_em7565_t* h) {
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GET_DATA_CONNECTION], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GET_DATA_CONNECTION, NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_em7565_command_defs[SW_EM7565_AT_GET_DATA_CONNECTION].command_string);
@@ -879,7 +1088,7 @@ sw_response_t sw_em7565_set_radio_access_type(sw_em7565_t* h,
     char params[AT_INTERFACE_MAX_COMMAND_STRING_LENGTH];
     snprintf(params, sizeof(params), "%02x",
              radio_access_type);
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_SET_RAT], params, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_SET_RAT, params, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -909,7 +1118,7 @@ sw_response_t sw_em7565_get_radio_access_type(sw_em7565_t* h,
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GET_RAT], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GET_RAT, NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_em7565_command_defs[SW_EM7565_AT_GET_RAT].command_string);
@@ -946,7 +1155,7 @@ sw_response_t sw_em7565_select_band_config_profile(sw_em7565_t* h, int config_id
     at_interface_response_t* response;
     char params[AT_INTERFACE_MAX_COMMAND_STRING_LENGTH];
     snprintf(params, sizeof(params), "%02d", config_idx);
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_SET_BAND_PROFILE], params, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_SET_BAND_PROFILE, params, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -979,7 +1188,7 @@ sw_response_t sw_em7565_remove_band_config_profile(sw_em7565_t* h, int config_id
     at_interface_response_t* response;
     char params[AT_INTERFACE_MAX_COMMAND_STRING_LENGTH];
     snprintf(params, sizeof(params), "%02d,\"\",0", config_idx);
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_SET_BAND_PROFILE], params, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_SET_BAND_PROFILE, params, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -1045,7 +1254,7 @@ sw_response_t sw_em7565_get_band_config_profile(sw_em7565_t* h, sw_em7565_band_p
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GET_BAND_PROFILE], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GET_BAND_PROFILE, NULL, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -1112,7 +1321,7 @@ sw_response_t sw_em7565_add_band_config_profile(sw_em7565_t* h, const sw_em7565_
              profile->mask_tds,
              profile->mask_lte3,
              profile->mask_lte4);
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_SET_BAND_PROFILE], params, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_SET_BAND_PROFILE, params, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -1134,7 +1343,7 @@ sw_response_t sw_em7565_add_band_config_profile(sw_em7565_t* h, const sw_em7565_
 
 sw_em7565_band_profile_list_t* sw_em7565_allocate_band_config_profile_list() {
   sw_em7565_band_profile_list_t* result;
-  result = calloc(1, sizeof(sw_em7565_band_profile_list_t));
+  result = allocator_calloc(1, sizeof(sw_em7565_band_profile_list_t));
   if(result != NULL) {
     result->nof_profiles = 0;
   }
@@ -1151,7 +1360,7 @@ sw_response_t sw_em7565_get_band_config_profile_list(sw_em7565_t* h, sw_em7565_b
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GET_BAND_PROFILE_LIST], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GET_BAND_PROFILE_LIST, NULL, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -1169,7 +1378,7 @@ sw_response_t sw_em7565_get_band_config_profile_list(sw_em7565_t* h, sw_em7565_b
     // clean list first...
     for(int i = 0; i < list->nof_profiles; i++) {
       if(list->profile[i] != NULL) {
-        free(list->profile[i]);
+        allocator_free(list->profile[i]);
         list->profile[i] = NULL;
       }
     }
@@ -1182,7 +1391,7 @@ sw_response_t sw_em7565_get_band_config_profile_list(sw_em7565_t* h, sw_em7565_b
                 //lines starting with space indicate another list. done.
                 break;
             }
-            (list)->profile[p] = calloc(1, sizeof(sw_em7565_band_profile_t));
+            (list)->profile[p] = allocator_calloc(1, sizeof(sw_em7565_band_profile_t));
             (list)->nof_profiles++;
             unsigned long masks[6] = {0};
             parse_band_config_profile_line(rows->token[i],
@@ -1207,15 +1416,15 @@ sw_response_t sw_em7565_get_band_config_profile_list(sw_em7565_t* h, sw_em7565_b
 void sw_em7565_free_band_config_profile_list(sw_em7565_band_profile_list_t* s) {
     if(s != NULL) {
         for(int i=0; i < s->nof_profiles; i++) {
-            free(s->profile[i]);
+            allocator_free(s->profile[i]);
         }
-        free(s);
+        allocator_free(s);
     }
 }
 
 sw_em7565_network_list_t* sw_em7565_allocate_network_list() {
   sw_em7565_network_list_t* result = NULL;
-  result = calloc(1, sizeof(sw_em7565_network_list_t));
+  result = allocator_calloc(1, sizeof(sw_em7565_network_list_t));
   if(result != NULL) {
     result->nof_networks = 0;
   }
@@ -1237,7 +1446,7 @@ sw_response_t sw_em7565_network_search(sw_em7565_t* h, sw_em7565_network_list_t
     }
 
     at_interface_response_t* response;
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GET_COPS], NULL, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_GET_COPS, NULL, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -1254,7 +1463,7 @@ sw_response_t sw_em7565_network_search(sw_em7565_t* h, sw_em7565_network_list_t
 
     // cleanup networks first...
     for(int i=0; i < networks->nof_networks; i++) {
-        free(networks->network[i]);
+        allocator_free(networks->network[i]);
     }
 
     char* networkstr = response->response_string;
@@ -1279,7 +1488,7 @@ sw_response_t sw_em7565_network_search(sw_em7565_t* h, sw_em7565_network_list_t
         }
         if(tmp != NULL) {
             //alloc
-            networks->network[i] = calloc(1, sizeof(network_list_item_t));
+            networks->network[i] = allocator_calloc(1, sizeof(network_list_item_t));
             sscanf(tmp, "(%d,\"%[^\"]\",\"%[^\"]\",\"%d\",%d",
                    (int*)&(networks)->network[i]->state,
                    (networks)->network[i]->name_long,
@@ -1299,9 +1508,9 @@ sw_response_t sw_em7565_network_search(sw_em7565_t* h, sw_em7565_network_list_t
 void sw_em7565_free_network_list(sw_em7565_network_list_t* list) {
     if(list != NULL) {
         for(int i=0; i < list->nof_networks; i++) {
-            free(list->network[i]);
+            allocator_free(list->network[i]);
         }
-        free(list);
+        allocator_free(list);
     }
 }
 
@@ -1361,7 +1570,7 @@ sw_response_t sw_em7565_select_network(sw_em7565_t* h,
         at_interface_free_response(response);
         return SW_RESPONSE_ERROR;
     }
-    ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_SET_COPS], params, &response);
+    ret = sw_em7565_command(h, SW_EM7565_AT_SET_COPS, params, &response);
 
     switch(ret) {
     case AT_RESPONSE_SUCCESS:
@@ -1383,7 +1592,7 @@ sw_response_t sw_em7565_select_network(sw_em7565_t* h,
 
 sw_em7565_current_operator_t* sw_em7565_allocate_current_operator() {
   sw_em7565_current_operator_t* result = NULL;
-  result = calloc(1, sizeof(sw_em7565_current_operator_t));
+  result = allocator_calloc(1, sizeof(sw_em7565_current_operator_t));
   result->name_long[0] = 0;
   return result;
 }
@@ -1398,7 +1607,7 @@ sw_response_t sw_em7565_get_current_operator(sw_em7565_t* h, sw_em7565_current_o
   }
 
   at_interface_response_t* response;
-  ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GET_COPS_CURRENT], NULL, &response);
+  ret = sw_em7565_command(h, SW_EM7565_AT_GET_COPS_CURRENT, NULL, &response);
 
   switch(ret) {
   case AT_RESPONSE_SUCCESS:
@@ -1437,7 +1646,7 @@ sw_response_t sw_em7565_get_current_operator(sw_em7565_t* h, sw_em7565_current_o
 }
 
 void sw_em7565_free_current_operator(sw_em7565_current_operator_t* h) {
-  free(h);
+  allocator_free(h);
 }
 
 sw_response_t sw_em7565_get_gps_autostart_mode(sw_em7565_t *h, sw_em7565_gps_autostart_mode_t *autostart_mode) {
@@ -1451,7 +1660,7 @@ sw_response_t sw_em7565_get_gps_autostart_mode(sw_em7565_t *h, sw_em7565_gps_aut
   *autostart_mode = GPS_AUTOSTART_ERROR;
 
   at_interface_response_t* response;
-  ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GPSAUTOSTART_GET], NULL, &response);
+  ret = sw_em7565_command(h, SW_EM7565_AT_GPSAUTOSTART_GET, NULL, &response);
 
   if(ret >= AT_RESPONSE_FAILED) {
       ERROR("Command failed: %s\n", sw_em7565_command_defs[SW_EM7565_AT_GPSAUTOSTART_GET].command_string);
@@ -1483,7 +1692,7 @@ sw_response_t sw_em7565_set_gps_autostart_mode(sw_em7565_t *h, const sw_em7565_g
   at_interface_response_t* response;
   char params[AT_INTERFACE_MAX_COMMAND_STRING_LENGTH];
   snprintf(params, sizeof(params), "%d", autostart_mode);
-  ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GPSAUTOSTART_SET], params, &response);
+  ret = sw_em7565_command(h, SW_EM7565_AT_GPSAUTOSTART_SET, params, &response);
 
   switch(ret) {
   case AT_RESPONSE_SUCCESS:
@@ -1518,7 +1727,7 @@ sw_response_t sw_em7565_gps_status(sw_em7565_t *h, sw_em7565_gps_status_t *statu
   }
 
   at_interface_response_t* response;
-  ret = at_interface_command(h->tty, &sw_em7565_command_defs[SW_EM7565_AT_GPSSTATUS], NULL, &response);
+  ret = sw_em7565_command(h, SW_EM7565_AT_GPSSTATUS, NULL, &response);
 
   switch(ret) {
   case AT_RESPONSE_SUCCESS:
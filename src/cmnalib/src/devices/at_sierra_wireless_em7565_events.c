@@ -0,0 +1,238 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmnalib/at_sierra_wireless_em7565_events.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE DEVICES
+#include "cmnalib/logger.h"
+
+#define SCC_NOT_ASSIGNED "NOT ASSIGNED"
+
+/* values of one sample that are compared, -1 or empty if unknown */
+typedef struct tracked_state {
+    int pci;
+    int cell_id;
+    int earfcn;
+    int band;
+    char rrc_state[SW_EM7565_GSTATUS_RESPONSE_STRLEN];
+    int scc_known[SW_EM7565_EVENT_NOF_SCC];
+    char scc_state[SW_EM7565_EVENT_NOF_SCC][SW_EM7565_GSTATUS_RESPONSE_STRLEN];
+    int scc_chan[SW_EM7565_EVENT_NOF_SCC];
+    meas_sample_t sample;
+} tracked_state_t;
+
+struct sw_em7565_event_detector {
+    sw_em7565_event_detector_config_t config;
+    sw_em7565_event_callback_t callback;
+    void* context;
+    int has_last;
+    tracked_state_t last;
+    uint64_t fast_until_us;
+};
+
+static const char* event_type_names[SW_EM7565_EVENT__MAX] = {
+    "pci_change",
+    "cell_id_change",
+    "earfcn_change",
+    "band_change",
+    "scc_added",
+    "scc_removed",
+    "rrc_state_change",
+};
+
+const char* sw_em7565_event_type_str(sw_em7565_event_type_t type) {
+    return (unsigned)type < SW_EM7565_EVENT__MAX ? event_type_names[type] : "unknown";
+}
+
+void sw_em7565_event_detector_default_config(sw_em7565_event_detector_config_t* config) {
+    config->interval_ms = 1000;
+    config->fast_interval_ms = 100;
+    config->fast_duration_ms = 5000;
+}
+
+sw_em7565_event_detector_t* sw_em7565_event_detector_create(const sw_em7565_event_detector_config_t* config,
+                                                            sw_em7565_event_callback_t callback,
+                                                            void* context) {
+    sw_em7565_event_detector_t* d = allocator_calloc(1, sizeof(sw_em7565_event_detector_t));
+    if(d == NULL) {
+        ERROR("Could not alloc memory\n");
+        return NULL;
+    }
+    if(config != NULL) {
+        d->config = *config;
+    }
+    else {
+        sw_em7565_event_detector_default_config(&d->config);
+    }
+    d->callback = callback;
+    d->context = context;
+    return d;
+}
+
+void sw_em7565_event_detector_destroy(sw_em7565_event_detector_t* d) {
+    allocator_free(d);
+}
+
+void sw_em7565_event_detector_reset(sw_em7565_event_detector_t* d) {
+    d->has_last = 0;
+    d->fast_until_us = 0;
+}
+
+static int scc_assigned(const tracked_state_t* s, int scc) {
+    return s->scc_known[scc] && strcmp(s->scc_state[scc], SCC_NOT_ASSIGNED) != 0;
+}
+
+static void extract_state(tracked_state_t* s,
+                          uint64_t timestamp_us,
+                          const sw_em7565_gstatus_response_t* status,
+                          const sw_em7565_lteinfo_response_t* lteinfo) {
+    memset(s, 0, sizeof(tracked_state_t));
+    s->pci = s->cell_id = s->earfcn = s->band = -1;
+
+    meas_sample_init(&s->sample, MEAS_SOURCE_POLL);
+    s->sample.timestamp_us = timestamp_us;
+    sw_em7565_fill_meas_sample(status, lteinfo, &s->sample);
+
+    if(status != NULL) {
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_CELL_ID)) s->cell_id = status->cell_id;
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_LTE_RX_CHAN)) s->earfcn = status->lte_rx_chan;
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_LTE_BAND)) s->band = status->lte_band;
+        if(sw_em7565_status_has(status, SW_EM7565_GSTATUS_RRC_STATE)) {
+            strncpy(s->rrc_state, status->rrc_state, sizeof(s->rrc_state) - 1);
+        }
+        const char* states[SW_EM7565_EVENT_NOF_SCC] = {
+            status->lte_scc1_state, status->lte_scc2_state, status->lte_scc3_state, status->lte_scc4_state
+        };
+        const int chans[SW_EM7565_EVENT_NOF_SCC] = {
+            status->lte_scc1_chan, status->lte_scc2_chan, status->lte_scc3_chan, status->lte_scc4_chan
+        };
+        for(int i = 0; i < SW_EM7565_EVENT_NOF_SCC; i++) {
+            // fields of each SCC follow the state in the same order
+            int state_field = SW_EM7565_GSTATUS_LTE_SCC1_STATE + i * 4;
+            int chan_field = SW_EM7565_GSTATUS_LTE_SCC1_CHAN + i * 4;
+            s->scc_known[i] = sw_em7565_status_has(status, state_field);
+            if(s->scc_known[i]) {
+                strncpy(s->scc_state[i], states[i], sizeof(s->scc_state[i]) - 1);
+            }
+            s->scc_chan[i] = sw_em7565_status_has(status, chan_field) ? chans[i] : -1;
+        }
+    }
+    if(lteinfo != NULL && lteinfo->serving_valid) {
+        s->pci = lteinfo->pci;
+        s->earfcn = lteinfo->earfn;
+        if(s->band < 0) s->band = lteinfo->band;
+    }
+}
+
+static void emit(sw_em7565_event_detector_t* d, sw_em7565_event_t* e,
+                 const tracked_state_t* before, const tracked_state_t* after) {
+    e->timestamp_us = after->sample.timestamp_us;
+    e->before = before->sample;
+    e->after = after->sample;
+    INFO("Event %s at %llu: %d -> %d %s%s%s\n", sw_em7565_event_type_str(e->type),
+         (unsigned long long)e->timestamp_us, e->old_value, e->new_value,
+         e->old_state, e->old_state[0] || e->new_state[0] ? " -> " : "", e->new_state);
+    if(d->callback != NULL) {
+        d->callback(e, d->context);
+    }
+}
+
+static int compare_value(sw_em7565_event_detector_t* d, sw_em7565_event_type_t type,
+                         int old_value, int new_value,
+                         const tracked_state_t* before, const tracked_state_t* after) {
+    // an unknown value is no transition
+    if(old_value < 0 || new_value < 0 || old_value == new_value) {
+        return 0;
+    }
+    sw_em7565_event_t e;
+    memset(&e, 0, sizeof(e));
+    e.type = type;
+    e.old_value = old_value;
+    e.new_value = new_value;
+    emit(d, &e, before, after);
+    return 1;
+}
+
+int sw_em7565_event_detector_update(sw_em7565_event_detector_t* d,
+                                    uint64_t timestamp_us,
+                                    const sw_em7565_gstatus_response_t* status,
+                                    const sw_em7565_lteinfo_response_t* lteinfo) {
+    if(status == NULL && lteinfo == NULL) {
+        return 0;
+    }
+
+    tracked_state_t current;
+    extract_state(&current, timestamp_us, status, lteinfo);
+    if(!d->has_last) {
+        d->last = current;
+        d->has_last = 1;
+        return 0;
+    }
+
+    const tracked_state_t* last = &d->last;
+    int nof_events = 0;
+    nof_events += compare_value(d, SW_EM7565_EVENT_PCI_CHANGE, last->pci, current.pci, last, &current);
+    nof_events += compare_value(d, SW_EM7565_EVENT_CELL_ID_CHANGE, last->cell_id, current.cell_id, last, &current);
+    nof_events += compare_value(d, SW_EM7565_EVENT_EARFCN_CHANGE, last->earfcn, current.earfcn, last, &current);
+    nof_events += compare_value(d, SW_EM7565_EVENT_BAND_CHANGE, last->band, current.band, last, &current);
+
+    for(int i = 0; i < SW_EM7565_EVENT_NOF_SCC; i++) {
+        if(!last->scc_known[i] || !current.scc_known[i]) continue;
+        int was = scc_assigned(last, i);
+        int is = scc_assigned(&current, i);
+        if(was == is) continue;
+        sw_em7565_event_t e;
+        memset(&e, 0, sizeof(e));
+        e.type = is ? SW_EM7565_EVENT_SCC_ADDED : SW_EM7565_EVENT_SCC_REMOVED;
+        e.scc = i + 1;
+        e.old_value = last->scc_chan[i];
+        e.new_value = current.scc_chan[i];
+        strcpy(e.old_state, last->scc_state[i]);
+        strcpy(e.new_state, current.scc_state[i]);
+        emit(d, &e, last, &current);
+        nof_events++;
+    }
+
+    if(last->rrc_state[0] && current.rrc_state[0] && strcmp(last->rrc_state, current.rrc_state) != 0) {
+        sw_em7565_event_t e;
+        memset(&e, 0, sizeof(e));
+        e.type = SW_EM7565_EVENT_RRC_STATE_CHANGE;
+        e.old_value = e.new_value = -1;
+        strcpy(e.old_state, last->rrc_state);
+        strcpy(e.new_state, current.rrc_state);
+        emit(d, &e, last, &current);
+        nof_events++;
+    }
+
+    // keep the last known value of what this sample did not report
+    if(current.pci < 0) current.pci = last->pci;
+    if(current.cell_id < 0) current.cell_id = last->cell_id;
+    if(current.earfcn < 0) current.earfcn = last->earfcn;
+    if(current.band < 0) current.band = last->band;
+    if(!current.rrc_state[0]) strcpy(current.rrc_state, last->rrc_state);
+    for(int i = 0; i < SW_EM7565_EVENT_NOF_SCC; i++) {
+        if(!current.scc_known[i] && last->scc_known[i]) {
+            current.scc_known[i] = 1;
+            strcpy(current.scc_state[i], last->scc_state[i]);
+            current.scc_chan[i] = last->scc_chan[i];
+        }
+    }
+
+    if(nof_events > 0) {
+        d->fast_until_us = timestamp_us + (uint64_t)d->config.fast_duration_ms * 1000;
+    }
+    d->last = current;
+    return nof_events;
+}
+
+int sw_em7565_event_detector_get_interval_ms(const sw_em7565_event_detector_t* d, uint64_t now_us) {
+    return now_us < d->fast_until_us ? d->config.fast_interval_ms : d->config.interval_ms;
+}
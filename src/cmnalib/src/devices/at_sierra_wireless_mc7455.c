@@ -17,6 +17,8 @@
 #include "cmnalib/at_interface.h"
 #include "cmnalib/enumerate.h"
 #include "cmnalib/at_sierra_wireless_mc7455.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE DEVICES
 #include "cmnalib/logger.h"
 #include "cmnalib/tokenfind.h"
 #include "cmnalib/conversion.h"
@@ -45,8 +47,23 @@ double sw_mc7455_gps_raw_to_double(int32_t int_value) {
     return result;
 }
 
+#define SW_MC7455_USB_VENDOR_ID     "1199"
+#define SW_MC7455_USB_MODEL_ID      "9071"
+#define SW_MC7455_SUBSYSTEM         "tty"
+#define SW_MC7455_USB_INTERFACE_NUM "03"
+
+const hotplug_match_t sw_mc7455_hotplug_match = {
+    .vendor_id = SW_MC7455_USB_VENDOR_ID,
+    .model_id = SW_MC7455_USB_MODEL_ID,
+    .subsystem = SW_MC7455_SUBSYSTEM,
+    .usb_interface_num = SW_MC7455_USB_INTERFACE_NUM,
+};
+
 GSList* sw_mc7455_enumerate_devices() {
-    return enumerate_supported_devices("1199", "9071", "tty", "03");
+    return enumerate_supported_devices(SW_MC7455_USB_VENDOR_ID,
+                                       SW_MC7455_USB_MODEL_ID,
+                                       SW_MC7455_SUBSYSTEM,
+                                       SW_MC7455_USB_INTERFACE_NUM);
 }
 
 void sw_mc7455_enumerate_devices_free(GSList* list) {
@@ -69,13 +86,28 @@ sw_mc7455_t* sw_mc7455_init_first() {
     return result;
 }
 
+sw_mc7455_t* sw_mc7455_init_hotplug(hotplug_monitor_t* monitor, unsigned long added_after, int timeout_ms) {
+    sw_mc7455_t* result = NULL;
+    hotplug_device_t* device = hotplug_wait_for_device(monitor, &sw_mc7455_hotplug_match, added_after, timeout_ms);
+
+    if(device != NULL) {
+        result = sw_mc7455_init(device->device_name);
+    }
+    else {
+        ERROR("No supported device appeared\n");
+    }
+
+    hotplug_device_destroy(device);
+    return result;
+}
+
 sw_mc7455_t* sw_mc7455_init(const char* tty_device_path) {
     DEBUG("Opening device %s\n", tty_device_path);
 
-    sw_mc7455_t* h = calloc(1, sizeof(sw_mc7455_t));
+    sw_mc7455_t* h = allocator_calloc(1, sizeof(sw_mc7455_t));
     h->tty = at_interface_open(tty_device_path);
     if(h->tty == NULL) {
-        free(h);
+        allocator_free(h);
         ERROR("Initialization failed\n");
         return NULL;
     }
@@ -86,7 +118,7 @@ void sw_mc7455_destroy(sw_mc7455_t* h) {
     if(h != NULL) {
         at_interface_close(h->tty);
     }
-    free(h);
+    allocator_free(h);
 }
 
 sw_response_t sw_mc7455_is_ready(sw_mc7455_t* h) {
@@ -158,31 +190,44 @@ sw_response_t sw_mc7455_reset(sw_mc7455_t* h) {
 
 void sw_mc7455_free_status(sw_mc7455_gstatus_response_t* s) {
     if(s != NULL) {
-        free(s);
+        allocator_free(s);
     }
 }
 
+sw_mc7455_gstatus_response_t* sw_mc7455_allocate_status() {
+    return allocator_calloc(1, sizeof(sw_mc7455_gstatus_response_t));
+}
+
 sw_response_t sw_mc7455_get_status(sw_mc7455_t* h, sw_mc7455_gstatus_response_t** result) {
+    *result = sw_mc7455_allocate_status();
+    if(*result == NULL) {
+        ERROR("ERROR in calloc\n");
+        return SW_RESPONSE_OUT_OF_MEMORY;
+    }
+    sw_response_t ret = sw_mc7455_get_status_into(h, *result);
+    if(ret >= SW_RESPONSE_CRITICAL) {
+        sw_mc7455_free_status(*result);
+        *result = NULL;
+    }
+    return ret;
+}
+
+sw_response_t sw_mc7455_get_status_into(sw_mc7455_t* h, sw_mc7455_gstatus_response_t* result) {
     at_interface_response_status_t ret;
 
-    if(h == NULL || h->tty == NULL) {
+    if(h == NULL || h->tty == NULL || result == NULL) {
         ERROR("Incomplete handle\n");
         return SW_RESPONSE_INVAL;
     }
 
-    *result = calloc(1, sizeof(sw_mc7455_gstatus_response_t));
-    if(*result == NULL) {
-        ERROR("ERROR in calloc\n");
-        return SW_RESPONSE_OUT_OF_MEMORY;
-    }
-    (*result)->tx_power = SW_GSTATUS_TX_POWER_INACTIVE;
+    memset(result, 0, sizeof(*result));
+    result->tx_power = SW_GSTATUS_TX_POWER_INACTIVE;
 
     at_interface_response_t* response;
     ret = at_interface_command(h->tty, &sw_mc7455_command_defs[SW_MC7455_AT_GSTATUS], NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_mc7455_command_defs[SW_MC7455_AT_GSTATUS].command_string);
-        sw_mc7455_free_status(*result);
         at_interface_free_response(response);
         return SW_RESPONSE_ERROR;
     }
@@ -210,7 +255,7 @@ sw_response_t sw_mc7455_get_status(sw_mc7455_t* h, sw_mc7455_gstatus_response_t*
         {offsetof(sw_mc7455_gstatus_response_t, tac), "TAC:[[:space:]]\\{1,\\}[[:xdigit:]]\\{1,\\} (\\([[:digit:]]\\{1,\\}\\))[[:space:]]\\{1,\\}", NULL, 10},
         {offsetof(sw_mc7455_gstatus_response_t, cell_id), "Cell ID:[[:space:]]\\{1,\\}[[:xdigit:]]\\{1,\\} (\\([[:digit:]]\\{1,\\}\\))[[:space:]]\\{1,\\}", NULL, 10},
     };
-    tokenfind_integer_batch(response->response_string, *result, int_jobs, NELEMS(int_jobs));
+    tokenfind_integer_batch(response->response_string, result, int_jobs, NELEMS(int_jobs));
 
     static tokenfind_batch_t string_jobs[] = {
         {offsetof(sw_mc7455_gstatus_response_t, mode), "Mode:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
@@ -221,39 +266,52 @@ sw_response_t sw_mc7455_get_status(sw_mc7455_t* h, sw_mc7455_gstatus_response_t*
         {offsetof(sw_mc7455_gstatus_response_t, rrc_state), "RRC state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
         {offsetof(sw_mc7455_gstatus_response_t, ims_reg_state), "IMS reg state:[[:space:]]\\{1,\\}\\([[:alpha:]]\\{1,\\}\\( [[:alpha:]]\\{1,\\}\\)*\\)[[:space:]]\\{1,\\}", NULL},
     };
-    tokenfind_string_batch(response->response_string, *result, string_jobs, NELEMS(string_jobs), SW_MC7455_GSTATUS_RESPONSE_STRLEN);
+    tokenfind_string_batch(response->response_string, result, string_jobs, NELEMS(string_jobs), SW_MC7455_GSTATUS_RESPONSE_STRLEN);
 
     static tokenfind_batch_t float_jobs[] = {
         {offsetof(sw_mc7455_gstatus_response_t, rsrq), "RSRQ (dB):[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL},
         {offsetof(sw_mc7455_gstatus_response_t, sinr), "SINR (dB):[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL},
     };
-    tokenfind_float_batch(response->response_string, *result, float_jobs, NELEMS(float_jobs));
+    tokenfind_float_batch(response->response_string, result, float_jobs, NELEMS(float_jobs));
 
     at_interface_free_response(response);
 
     return SW_RESPONSE_SUCCESS;
 }
 
+sw_mc7455_information_response_t* sw_mc7455_allocate_information() {
+    return allocator_calloc(1, sizeof(sw_mc7455_information_response_t));
+}
+
 sw_response_t sw_mc7455_get_information(sw_mc7455_t* h, sw_mc7455_information_response_t** result) {
+    *result = sw_mc7455_allocate_information();
+    if(*result == NULL) {
+        ERROR("ERROR in calloc\n");
+        return SW_RESPONSE_OUT_OF_MEMORY;
+    }
+    sw_response_t ret = sw_mc7455_get_information_into(h, *result);
+    if(ret >= SW_RESPONSE_CRITICAL) {
+        sw_mc7455_free_information(*result);
+        *result = NULL;
+    }
+    return ret;
+}
+
+sw_response_t sw_mc7455_get_information_into(sw_mc7455_t* h, sw_mc7455_information_response_t* result) {
     at_interface_response_status_t ret;
 
-    if(h == NULL || h->tty == NULL) {
+    if(h == NULL || h->tty == NULL || result == NULL) {
         ERROR("Incomplete handle\n");
         return SW_RESPONSE_INVAL;
     }
 
-    *result = calloc(1, sizeof(sw_mc7455_information_response_t));
-    if(*result == NULL) {
-        ERROR("ERROR in calloc\n");
-        return SW_RESPONSE_OUT_OF_MEMORY;
-    }
+    memset(result, 0, sizeof(*result));
 
     at_interface_response_t* response;
     ret = at_interface_command(h->tty, &sw_mc7455_command_defs[SW_MC7455_AT_INFO], NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_mc7455_command_defs[SW_MC7455_AT_INFO].command_string);
-        sw_mc7455_free_information(*result);
         at_interface_free_response(response);
         return SW_RESPONSE_ERROR;
     }
@@ -267,7 +325,7 @@ sw_response_t sw_mc7455_get_information(sw_mc7455_t* h, sw_mc7455_information_re
         {offsetof(sw_mc7455_information_response_t, imei_sv), "IMEI SV:[[:space:]]\\{1,\\}\\([^\r\n]*\\)", NULL},
         {offsetof(sw_mc7455_information_response_t, fsn), "FSN:[[:space:]]\\{1,\\}\\([^\r\n]*\\)", NULL},
     };
-    tokenfind_string_batch(response->response_string, *result, string_jobs, NELEMS(string_jobs), SW_MC7455_INFORMATION_RESPONSE_STRLEN);
+    tokenfind_string_batch(response->response_string, result, string_jobs, NELEMS(string_jobs), SW_MC7455_INFORMATION_RESPONSE_STRLEN);
 
     at_interface_free_response(response);
 
@@ -276,31 +334,69 @@ sw_response_t sw_mc7455_get_information(sw_mc7455_t* h, sw_mc7455_information_re
 
 void sw_mc7455_free_information(sw_mc7455_information_response_t* s) {
     if(s != NULL) {
-        free(s);
+        allocator_free(s);
     }
 }
 
+void sw_mc7455_clear_lteinfo(sw_mc7455_lteinfo_response_t* result) {
+    sw_mc7455_lteinfo_intrafreq_neighbour_t* intrafreq_neighbours = result->intrafreq_neighbours;
+    sw_mc7455_lteinfo_interfreq_neighbour_t* interfreq_neighbours = result->interfreq_neighbours;
+    int intrafreq_capacity = result->_intrafreq_capacity;
+    int interfreq_capacity = result->_interfreq_capacity;
+    memset(result, 0, sizeof(*result));
+    result->intrafreq_neighbours = intrafreq_neighbours;
+    result->interfreq_neighbours = interfreq_neighbours;
+    result->_intrafreq_capacity = intrafreq_capacity;
+    result->_interfreq_capacity = interfreq_capacity;
+}
+
+/* grows a neighbour buffer to hold at least n entries */
+static int reserve_neighbours(void** buffer, int* capacity, int n, size_t size) {
+    if(n <= *capacity) return 0;
+    void* grown = allocator_realloc(*buffer, n * size);
+    if(grown == NULL) {
+        ERROR("Error in realloc\n");
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = n;
+    return 0;
+}
+
+sw_mc7455_lteinfo_response_t* sw_mc7455_allocate_lteinfo() {
+    return allocator_calloc(1, sizeof(sw_mc7455_lteinfo_response_t));
+}
+
 sw_response_t sw_mc7455_get_lteinfo(sw_mc7455_t* h, sw_mc7455_lteinfo_response_t** result) {
+    *result = sw_mc7455_allocate_lteinfo();
+    if(*result == NULL) {
+        ERROR("ERROR in calloc\n");
+        return SW_RESPONSE_OUT_OF_MEMORY;
+    }
+    sw_response_t ret = sw_mc7455_get_lteinfo_into(h, *result);
+    if(ret >= SW_RESPONSE_CRITICAL) {
+        sw_mc7455_free_lteinfo(*result);
+        *result = NULL;
+    }
+    return ret;
+}
+
+sw_response_t sw_mc7455_get_lteinfo_into(sw_mc7455_t* h, sw_mc7455_lteinfo_response_t* result) {
     at_interface_response_status_t ret;
     int val = 0;
 
-    if(h == NULL || h->tty == NULL) {
+    if(h == NULL || h->tty == NULL || result == NULL) {
         ERROR("Incomplete handle\n");
         return SW_RESPONSE_INVAL;
     }
 
-    *result = calloc(1, sizeof(sw_mc7455_lteinfo_response_t));
-    if(*result == NULL) {
-        ERROR("ERROR in calloc\n");
-        return SW_RESPONSE_OUT_OF_MEMORY;
-    }
+    sw_mc7455_clear_lteinfo(result);
 
     at_interface_response_t* response;
     ret = at_interface_command(h->tty, &sw_mc7455_command_defs[SW_MC7455_AT_LTEINFO], NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_mc7455_command_defs[SW_MC7455_AT_LTEINFO].command_string);
-        sw_mc7455_free_lteinfo(*result);
         at_interface_free_response(response);
         return SW_RESPONSE_ERROR;
     }
@@ -318,20 +414,20 @@ sw_response_t sw_mc7455_get_lteinfo(sw_mc7455_t* h, sw_mc7455_lteinfo_response_t
     if(val > 0) {
         tokenfind_string_table_t* serving_info_tbl = tokenfind_parse_table(slice);
         if(serving_info_tbl != NULL && serving_info_tbl->n_rows > 1) {
-            (*result)->earfn = conversion_str_to_int(serving_info_tbl->row[1].column[0], 10);
-            (*result)->mcc   = conversion_str_to_int(serving_info_tbl->row[1].column[1], 10);
-            (*result)->mnc   = conversion_str_to_int(serving_info_tbl->row[1].column[2], 10);
-            (*result)->tac   = conversion_str_to_int(serving_info_tbl->row[1].column[3], 10);
-            (*result)->cid   = conversion_str_to_int(serving_info_tbl->row[1].column[4], 16);
-            (*result)->band  = conversion_str_to_int(serving_info_tbl->row[1].column[5], 10);
-            (*result)->d     = conversion_str_to_int(serving_info_tbl->row[1].column[6], 10);
-            (*result)->u     = conversion_str_to_int(serving_info_tbl->row[1].column[7], 10);
-            (*result)->snr   = conversion_str_to_int(serving_info_tbl->row[1].column[8], 10);
-            (*result)->pci   = conversion_str_to_int(serving_info_tbl->row[1].column[9], 10);
-            (*result)->rsrq  = conversion_str_to_float(serving_info_tbl->row[1].column[10]);
-            (*result)->rsrp  = conversion_str_to_float(serving_info_tbl->row[1].column[11]);
-            (*result)->rssi  = conversion_str_to_float(serving_info_tbl->row[1].column[12]);
-            (*result)->rxlv  = conversion_str_to_int(serving_info_tbl->row[1].column[13], 10);
+            result->earfn = conversion_str_to_int(serving_info_tbl->row[1].column[0], 10);
+            result->mcc   = conversion_str_to_int(serving_info_tbl->row[1].column[1], 10);
+            result->mnc   = conversion_str_to_int(serving_info_tbl->row[1].column[2], 10);
+            result->tac   = conversion_str_to_int(serving_info_tbl->row[1].column[3], 10);
+            result->cid   = conversion_str_to_int(serving_info_tbl->row[1].column[4], 16);
+            result->band  = conversion_str_to_int(serving_info_tbl->row[1].column[5], 10);
+            result->d     = conversion_str_to_int(serving_info_tbl->row[1].column[6], 10);
+            result->u     = conversion_str_to_int(serving_info_tbl->row[1].column[7], 10);
+            result->snr   = conversion_str_to_int(serving_info_tbl->row[1].column[8], 10);
+            result->pci   = conversion_str_to_int(serving_info_tbl->row[1].column[9], 10);
+            result->rsrq  = conversion_str_to_float(serving_info_tbl->row[1].column[10]);
+            result->rsrp  = conversion_str_to_float(serving_info_tbl->row[1].column[11]);
+            result->rssi  = conversion_str_to_float(serving_info_tbl->row[1].column[12]);
+            result->rxlv  = conversion_str_to_int(serving_info_tbl->row[1].column[13], 10);
         }
         tokenfind_free_table(serving_info_tbl);
     }
@@ -348,21 +444,25 @@ sw_response_t sw_mc7455_get_lteinfo(sw_mc7455_t* h, sw_mc7455_lteinfo_response_t
     if(val > 0) {
         tokenfind_string_table_t* intra_info_tbl = tokenfind_parse_table(slice);
         if(intra_info_tbl != NULL && intra_info_tbl->n_rows > 1) {
-            (*result)->nof_intrafreq_neighbours = 0;
-            (*result)->intrafreq_neighbours = calloc(intra_info_tbl->n_rows - 1, sizeof(sw_mc7455_lteinfo_intrafreq_neighbour_t));
+            if(reserve_neighbours((void**)&result->intrafreq_neighbours, &result->_intrafreq_capacity,
+                                  intra_info_tbl->n_rows - 1, sizeof(sw_mc7455_lteinfo_intrafreq_neighbour_t)) != 0) {
+                tokenfind_free_table(intra_info_tbl);
+                at_interface_free_response(response);
+                return SW_RESPONSE_OUT_OF_MEMORY;
+            }
             for(int row_idx = 1; row_idx < intra_info_tbl->n_rows; row_idx++) {
-                (*result)->intrafreq_neighbours[(*result)->nof_intrafreq_neighbours].pci =
+                result->intrafreq_neighbours[result->nof_intrafreq_neighbours].pci =
                         conversion_str_to_int(intra_info_tbl->row[row_idx].column[0], 10);
-                (*result)->intrafreq_neighbours[(*result)->nof_intrafreq_neighbours].rsrq =
+                result->intrafreq_neighbours[result->nof_intrafreq_neighbours].rsrq =
                         conversion_str_to_float(intra_info_tbl->row[row_idx].column[1]);
-                (*result)->intrafreq_neighbours[(*result)->nof_intrafreq_neighbours].rsrp =
+                result->intrafreq_neighbours[result->nof_intrafreq_neighbours].rsrp =
                         conversion_str_to_float(intra_info_tbl->row[row_idx].column[2]);
-                (*result)->intrafreq_neighbours[(*result)->nof_intrafreq_neighbours].rssi =
+                result->intrafreq_neighbours[result->nof_intrafreq_neighbours].rssi =
                         conversion_str_to_float(intra_info_tbl->row[row_idx].column[3]);
-                (*result)->intrafreq_neighbours[(*result)->nof_intrafreq_neighbours].rxlv =
+                result->intrafreq_neighbours[result->nof_intrafreq_neighbours].rxlv =
                         conversion_str_to_int(intra_info_tbl->row[row_idx].column[4], 10);
 
-                ((*result)->nof_intrafreq_neighbours)++;
+                (result->nof_intrafreq_neighbours)++;
             }
         }
         tokenfind_free_table(intra_info_tbl);
@@ -380,29 +480,33 @@ sw_response_t sw_mc7455_get_lteinfo(sw_mc7455_t* h, sw_mc7455_lteinfo_response_t
     if(val > 0) {
         tokenfind_string_table_t* inter_info_tbl = tokenfind_parse_table(slice);
         if(inter_info_tbl != NULL && inter_info_tbl->n_rows > 1) {
-            (*result)->nof_interfreq_neighbours = 0;
-            (*result)->interfreq_neighbours = calloc(inter_info_tbl->n_rows - 1, sizeof(sw_mc7455_lteinfo_interfreq_neighbour_t));
+            if(reserve_neighbours((void**)&result->interfreq_neighbours, &result->_interfreq_capacity,
+                                  inter_info_tbl->n_rows - 1, sizeof(sw_mc7455_lteinfo_interfreq_neighbour_t)) != 0) {
+                tokenfind_free_table(inter_info_tbl);
+                at_interface_free_response(response);
+                return SW_RESPONSE_OUT_OF_MEMORY;
+            }
             for(int row_idx = 1; row_idx < inter_info_tbl->n_rows; row_idx++) {
-                (*result)->interfreq_neighbours[(*result)->nof_interfreq_neighbours].earfcn =
+                result->interfreq_neighbours[result->nof_interfreq_neighbours].earfcn =
                         conversion_str_to_int(inter_info_tbl->row[row_idx].column[0], 10);
-                (*result)->interfreq_neighbours[(*result)->nof_interfreq_neighbours].threshold_low =
+                result->interfreq_neighbours[result->nof_interfreq_neighbours].threshold_low =
                         conversion_str_to_int(inter_info_tbl->row[row_idx].column[1], 10);
-                (*result)->interfreq_neighbours[(*result)->nof_interfreq_neighbours].threshold_high =
+                result->interfreq_neighbours[result->nof_interfreq_neighbours].threshold_high =
                         conversion_str_to_int(inter_info_tbl->row[row_idx].column[2], 10);
-                (*result)->interfreq_neighbours[(*result)->nof_interfreq_neighbours].priority =
+                result->interfreq_neighbours[result->nof_interfreq_neighbours].priority =
                         conversion_str_to_int(inter_info_tbl->row[row_idx].column[3], 10);
-                (*result)->interfreq_neighbours[(*result)->nof_interfreq_neighbours].pci =
+                result->interfreq_neighbours[result->nof_interfreq_neighbours].pci =
                         conversion_str_to_int(inter_info_tbl->row[row_idx].column[4], 10);
-                (*result)->interfreq_neighbours[(*result)->nof_interfreq_neighbours].rsrq =
+                result->interfreq_neighbours[result->nof_interfreq_neighbours].rsrq =
                         conversion_str_to_float(inter_info_tbl->row[row_idx].column[5]);
-                (*result)->interfreq_neighbours[(*result)->nof_interfreq_neighbours].rsrp =
+                result->interfreq_neighbours[result->nof_interfreq_neighbours].rsrp =
                         conversion_str_to_float(inter_info_tbl->row[row_idx].column[6]);
-                (*result)->interfreq_neighbours[(*result)->nof_interfreq_neighbours].rssi =
+                result->interfreq_neighbours[result->nof_interfreq_neighbours].rssi =
                         conversion_str_to_float(inter_info_tbl->row[row_idx].column[7]);
-                (*result)->interfreq_neighbours[(*result)->nof_interfreq_neighbours].rxlv =
+                result->interfreq_neighbours[result->nof_interfreq_neighbours].rxlv =
                         conversion_str_to_int(inter_info_tbl->row[row_idx].column[8], 10);
 
-                ((*result)->nof_interfreq_neighbours)++;
+                (result->nof_interfreq_neighbours)++;
             }
         }
         tokenfind_free_table(inter_info_tbl);
@@ -415,35 +519,47 @@ sw_response_t sw_mc7455_get_lteinfo(sw_mc7455_t* h, sw_mc7455_lteinfo_response_t
 
 void sw_mc7455_free_lteinfo(sw_mc7455_lteinfo_response_t* s) {
     if(s != NULL) {
-        free(s->intrafreq_neighbours);
+        allocator_free(s->intrafreq_neighbours);
         s->nof_intrafreq_neighbours = 0;
-        free(s->interfreq_neighbours);
+        allocator_free(s->interfreq_neighbours);
         s->nof_interfreq_neighbours = 0;
     }
-    free(s);
+    allocator_free(s);
+}
+
+sw_mc7455_gpsloc_response_t* sw_mc7455_allocate_gpsloc() {
+    return allocator_calloc(1, sizeof(sw_mc7455_gpsloc_response_t));
 }
 
 sw_response_t sw_mc7455_get_gpsloc(sw_mc7455_t* h, sw_mc7455_gpsloc_response_t** result) {
+    *result = sw_mc7455_allocate_gpsloc();
+    if(*result == NULL) {
+        ERROR("ERROR in calloc\n");
+        return SW_RESPONSE_OUT_OF_MEMORY;
+    }
+    sw_response_t ret = sw_mc7455_get_gpsloc_into(h, *result);
+    if(ret >= SW_RESPONSE_CRITICAL) {
+        sw_mc7455_free_get_gpsloc(*result);
+        *result = NULL;
+    }
+    return ret;
+}
+
+sw_response_t sw_mc7455_get_gpsloc_into(sw_mc7455_t* h, sw_mc7455_gpsloc_response_t* result) {
     at_interface_response_status_t ret;
 
-    if(h == NULL || h->tty == NULL) {
+    if(h == NULL || h->tty == NULL || result == NULL) {
         ERROR("Incomplete handle\n");
         return SW_RESPONSE_INVAL;
     }
 
-    *result = calloc(1, sizeof(sw_mc7455_gpsloc_response_t));
-    if(*result == NULL) {
-        ERROR("ERROR in calloc\n");
-        return SW_RESPONSE_OUT_OF_MEMORY;
-    }
+    memset(result, 0, sizeof(*result));
 
     at_interface_response_t* response;
     ret = at_interface_command(h->tty, &sw_mc7455_command_defs[SW_MC7455_AT_GPSLOC], NULL, &response);
 
     if(ret >= AT_RESPONSE_FAILED) {
         ERROR("Command failed: %s\n", sw_mc7455_command_defs[SW_MC7455_AT_GPSLOC].command_string);
-        sw_mc7455_free_get_gpsloc(*result);
-        *result = NULL;
         at_interface_free_response(response);
         return SW_RESPONSE_ERROR;
     }
@@ -455,7 +571,7 @@ sw_response_t sw_mc7455_get_gpsloc(sw_mc7455_t* h, sw_mc7455_gpsloc_response_t**
 //                                  &regex_not_avail);
 
     if(strstr(response->response_string, "Not Available")) {
-        (*result)->is_invalid = 1;
+        result->is_invalid = 1;
     }
 
     static tokenfind_batch_t int_jobs[] = {
@@ -463,9 +579,9 @@ sw_response_t sw_mc7455_get_gpsloc(sw_mc7455_t* h, sw_mc7455_gpsloc_response_t**
         {offsetof(sw_mc7455_gpsloc_response_t, _raw_longitude), "Lon:[[:space:]]\\{1,\\}[^(]*(0x\\([[:xdigit:]]\\{1,\\}\\))[[:space:]]\\{1,\\}", NULL, 16},
         {offsetof(sw_mc7455_gpsloc_response_t, altitude), "Altitude:[[:space:]]\\{1,\\}\\([[:digit:]]\\{1,\\}\\)[[:space:]]\\{1,\\}", NULL, 10},
     };
-    tokenfind_integer_batch(response->response_string, (*result), int_jobs, NELEMS(int_jobs));
-    (*result)->latitude = sw_mc7455_gps_raw_to_double((*result)->_raw_latitude);
-    (*result)->longitude = sw_mc7455_gps_raw_to_double((*result)->_raw_longitude);
+    tokenfind_integer_batch(response->response_string, result, int_jobs, NELEMS(int_jobs));
+    result->latitude = sw_mc7455_gps_raw_to_double(result->_raw_latitude);
+    result->longitude = sw_mc7455_gps_raw_to_double(result->_raw_longitude);
 
     static tokenfind_batch_t float_jobs[] = {
         {offsetof(sw_mc7455_gpsloc_response_t, loc_unc_angle), "LocUncAngle:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL},
@@ -477,7 +593,7 @@ sw_response_t sw_mc7455_get_gpsloc(sw_mc7455_t* h, sw_mc7455_gpsloc_response_t**
         {offsetof(sw_mc7455_gpsloc_response_t, velocity_h), "VelHoriz:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL},
         {offsetof(sw_mc7455_gpsloc_response_t, velocity_v), "VelVert:[[:space:]]\\{1,\\}\\(-*[[:digit:]]\\{1,\\}\\.*[[:digit:]]*\\)[[:space:]]\\{1,\\}", NULL},
     };
-    tokenfind_float_batch(response->response_string, (*result), float_jobs, NELEMS(float_jobs));
+    tokenfind_float_batch(response->response_string, result, float_jobs, NELEMS(float_jobs));
 
     at_interface_free_response(response);
 
@@ -485,7 +601,7 @@ sw_response_t sw_mc7455_get_gpsloc(sw_mc7455_t* h, sw_mc7455_gpsloc_response_t**
 }
 
 void sw_mc7455_free_get_gpsloc(sw_mc7455_gpsloc_response_t* s) {
-    free(s);
+    allocator_free(s);
 }
 
 sw_response_t sw_mc7455_stop_gps(sw_mc7455_t* h) {
@@ -5,6 +5,8 @@
 #include <libudev.h>
 
 #include "cmnalib/enumerate.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE DEVICES
 #include "cmnalib/logger.h"
 
 #define GPOINTER_TO_DLE_POINTER(P) ((device_list_entry_t*)(P))
@@ -13,13 +15,13 @@
 char* _alloc_copy_string(const char* src) {
     char* result;
     int len = strlen(src)+1;
-    result = calloc(len, sizeof(*src));
+    result = allocator_calloc(len, sizeof(*src));
     strcpy(result, src);
     return result;
 }
 
 device_list_entry_t* device_list_entry_create(const char* device_name, const char* device_path) {
-    device_list_entry_t* entry = calloc(1, sizeof(*entry));
+    device_list_entry_t* entry = allocator_calloc(1, sizeof(*entry));
 
     entry->device_name = _alloc_copy_string(device_name);
     entry->device_path = _alloc_copy_string(device_path);
@@ -32,9 +34,9 @@ device_list_entry_t* device_list_entry_copy(device_list_entry_t * entry) {
 }
 
 void device_list_entry_destroy(device_list_entry_t *entry) {
-    free(entry->device_name);
-    free(entry->device_path);
-    free(entry);
+    allocator_free(entry->device_name);
+    allocator_free(entry->device_path);
+    allocator_free(entry);
 }
 
 void _wrapper_g_destroy_notify(void* entry) {
@@ -0,0 +1,664 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <gmodule.h>
+
+#include <pthread.h>
+#include <libudev.h>
+
+#include "cmnalib/hotplug.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE DEVICES
+#include "cmnalib/logger.h"
+
+#define HOTPLUG_POLL_TIMEOUT_MS 100
+
+#define GPOINTER_TO_HD_POINTER(P) ((hotplug_device_t*)(P))
+
+static char* copy_optional_string(const char* src) {
+    return src != NULL ? allocator_strdup(src) : NULL;
+}
+
+hotplug_device_t* hotplug_device_create(const char* device_name,
+                                        const char* device_path,
+                                        const char* subsystem,
+                                        const char* vendor_id,
+                                        const char* model_id,
+                                        const char* usb_interface_num) {
+    if(device_path == NULL) return NULL;
+
+    hotplug_device_t* device = allocator_calloc(1, sizeof(hotplug_device_t));
+    if(device == NULL) return NULL;
+    device->device_name = copy_optional_string(device_name);
+    device->device_path = copy_optional_string(device_path);
+    device->subsystem = copy_optional_string(subsystem);
+    device->vendor_id = copy_optional_string(vendor_id);
+    device->model_id = copy_optional_string(model_id);
+    device->usb_interface_num = copy_optional_string(usb_interface_num);
+    return device;
+}
+
+hotplug_device_t* hotplug_device_copy(const hotplug_device_t* device) {
+    if(device == NULL) return NULL;
+    hotplug_device_t* copy = hotplug_device_create(device->device_name,
+                                                   device->device_path,
+                                                   device->subsystem,
+                                                   device->vendor_id,
+                                                   device->model_id,
+                                                   device->usb_interface_num);
+    hotplug_device_set_serial(copy, device->serial);
+    return copy;
+}
+
+void hotplug_device_set_serial(hotplug_device_t* device, const char* serial) {
+    if(device != NULL) {
+        allocator_free(device->serial);
+        device->serial = copy_optional_string(serial);
+    }
+}
+
+void hotplug_device_destroy(hotplug_device_t* device) {
+    if(device != NULL) {
+        allocator_free(device->device_name);
+        allocator_free(device->device_path);
+        allocator_free(device->subsystem);
+        allocator_free(device->vendor_id);
+        allocator_free(device->model_id);
+        allocator_free(device->usb_interface_num);
+        allocator_free(device->serial);
+        allocator_free(device);
+    }
+}
+
+static void _wrapper_g_destroy_notify(void* device) {
+    hotplug_device_destroy((hotplug_device_t*)device);
+}
+
+void hotplug_device_list_free(GSList* list) {
+    g_slist_free_full(list, _wrapper_g_destroy_notify);
+}
+
+static int match_value(const char* value, const char* match) {
+    if(match == NULL) return 1;     // no value means match
+    if(value == NULL) return 0;     // property not found - mismatch
+    return strstr(value, match) != NULL;
+}
+
+int hotplug_device_matches(const hotplug_device_t* device, const hotplug_match_t* match) {
+    if(device == NULL) return 0;
+    if(match == NULL) return 1;
+    return match_value(device->vendor_id, match->vendor_id) &&
+           match_value(device->model_id, match->model_id) &&
+           match_value(device->subsystem, match->subsystem) &&
+           match_value(device->usb_interface_num, match->usb_interface_num);
+}
+
+void hotplug_source_destroy(hotplug_source_t* source) {
+    if(source != NULL) {
+        if(source->destroy != NULL) {
+            source->destroy(source->context);
+        }
+        allocator_free(source);
+    }
+}
+
+/*
+ * udev source
+ */
+
+typedef struct udev_source_context {
+    struct udev* udev;
+    struct udev_monitor* monitor;
+    char** subsystems;      // NULL terminated, NULL for all
+} udev_source_context_t;
+
+/* device node, or the interface name for network devices which have no node */
+static const char* udev_device_name(struct udev_device* device) {
+    const char* devnode = udev_device_get_devnode(device);
+    if(devnode != NULL) return devnode;
+    const char* subsystem = udev_device_get_subsystem(device);
+    if(subsystem != NULL && strcmp(subsystem, "net") == 0) {
+        return udev_device_get_sysname(device);
+    }
+    return NULL;
+}
+
+static hotplug_device_t* device_from_udev(struct udev_device* device) {
+    hotplug_device_t* result = hotplug_device_create(udev_device_name(device),
+                                                     udev_device_get_syspath(device),
+                                                     udev_device_get_subsystem(device),
+                                                     udev_device_get_property_value(device, "ID_VENDOR_ID"),
+                                                     udev_device_get_property_value(device, "ID_MODEL_ID"),
+                                                     udev_device_get_property_value(device, "ID_USB_INTERFACE_NUM"));
+    hotplug_device_set_serial(result, udev_device_get_property_value(device, "ID_SERIAL_SHORT"));
+    return result;
+}
+
+static int udev_source_get_fd(void* source_context) {
+    udev_source_context_t* c = (udev_source_context_t*)source_context;
+    return udev_monitor_get_fd(c->monitor);
+}
+
+static int udev_source_scan(void* source_context, GSList** devices) {
+    udev_source_context_t* c = (udev_source_context_t*)source_context;
+    struct udev_enumerate* enumerate = udev_enumerate_new(c->udev);
+    if(enumerate == NULL) return -1;
+
+    // multiple subsystems are combined by logical OR
+    for(char** subsystem = c->subsystems; subsystem != NULL && *subsystem != NULL; subsystem++) {
+        udev_enumerate_add_match_subsystem(enumerate, *subsystem);
+    }
+    udev_enumerate_scan_devices(enumerate);
+
+    struct udev_list_entry *device_item;
+    udev_list_entry_foreach(device_item, udev_enumerate_get_list_entry(enumerate)) {
+        struct udev_device* device = udev_device_new_from_syspath(c->udev, udev_list_entry_get_name(device_item));
+        if(device == NULL) continue;
+        // only devices with a node or interface name can be used
+        if(udev_device_name(device) != NULL) {
+            hotplug_device_t* entry = device_from_udev(device);
+            if(entry != NULL) *devices = g_slist_prepend(*devices, entry);
+        }
+        udev_device_unref(device);
+    }
+    udev_enumerate_unref(enumerate);
+    return 0;
+}
+
+static int udev_source_receive(void* source_context, hotplug_action_t* action, hotplug_device_t** device) {
+    udev_source_context_t* c = (udev_source_context_t*)source_context;
+    struct udev_device* udev_device = udev_monitor_receive_device(c->monitor);
+    if(udev_device == NULL) return 0;
+
+    int ret = 0;
+    const char* action_name = udev_device_get_action(udev_device);
+    if(action_name != NULL && udev_device_name(udev_device) != NULL) {
+        if(strcmp(action_name, "add") == 0) {
+            *action = HOTPLUG_ACTION_ADD;
+            ret = 1;
+        }
+        else if(strcmp(action_name, "remove") == 0) {
+            *action = HOTPLUG_ACTION_REMOVE;
+            ret = 1;
+        }
+    }
+    if(ret == 1) {
+        *device = device_from_udev(udev_device);
+        if(*device == NULL) ret = -1;
+    }
+    udev_device_unref(udev_device);
+    return ret;
+}
+
+static void udev_source_destroy(void* source_context) {
+    udev_source_context_t* c = (udev_source_context_t*)source_context;
+    if(c->monitor != NULL) udev_monitor_unref(c->monitor);
+    if(c->udev != NULL) udev_unref(c->udev);
+    g_strfreev(c->subsystems);
+    allocator_free(c);
+}
+
+hotplug_source_t* hotplug_source_udev(const char* subsystem) {
+    udev_source_context_t* c = allocator_calloc(1, sizeof(udev_source_context_t));
+    if(c == NULL) return NULL;
+    c->subsystems = subsystem != NULL ? g_strsplit(subsystem, ",", -1) : NULL;
+
+    c->udev = udev_new();
+    if(c->udev == NULL) {
+        ERROR("Could not create udev context\n");
+        udev_source_destroy(c);
+        return NULL;
+    }
+    c->monitor = udev_monitor_new_from_netlink(c->udev, "udev");
+    if(c->monitor == NULL) {
+        ERROR("Could not create udev monitor\n");
+        udev_source_destroy(c);
+        return NULL;
+    }
+    for(char** s = c->subsystems; s != NULL && *s != NULL; s++) {
+        udev_monitor_filter_add_match_subsystem_devtype(c->monitor, *s, NULL);
+    }
+    if(udev_monitor_enable_receiving(c->monitor) < 0) {
+        ERROR("Could not enable udev monitor\n");
+        udev_source_destroy(c);
+        return NULL;
+    }
+
+    hotplug_source_t* source = allocator_calloc(1, sizeof(hotplug_source_t));
+    if(source == NULL) {
+        udev_source_destroy(c);
+        return NULL;
+    }
+    source->get_fd = udev_source_get_fd;
+    source->scan = udev_source_scan;
+    source->receive = udev_source_receive;
+    source->destroy = udev_source_destroy;
+    source->context = c;
+    return source;
+}
+
+/*
+ * fake source
+ */
+
+typedef struct fake_event {
+    hotplug_action_t action;
+    hotplug_device_t* device;
+} fake_event_t;
+
+typedef struct fake_source_context {
+    int pipe_fd[2];
+    pthread_mutex_t lock;
+    GQueue* events;
+} fake_source_context_t;
+
+static int fake_source_get_fd(void* source_context) {
+    fake_source_context_t* c = (fake_source_context_t*)source_context;
+    return c->pipe_fd[0];
+}
+
+static void free_fake_event(void* data) {
+    fake_event_t* event = (fake_event_t*)data;
+    hotplug_device_destroy(event->device);
+    allocator_free(event);
+}
+
+/* devices added before the monitor started are reported as present */
+static int fake_source_scan(void* source_context, GSList** devices) {
+    fake_source_context_t* c = (fake_source_context_t*)source_context;
+    pthread_mutex_lock(&c->lock);
+    fake_event_t* event;
+    while((event = g_queue_pop_head(c->events)) != NULL) {
+        if(event->action == HOTPLUG_ACTION_ADD) {
+            *devices = g_slist_append(*devices, event->device);
+            event->device = NULL;
+        }
+        free_fake_event(event);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return 0;
+}
+
+static int fake_source_receive(void* source_context, hotplug_action_t* action, hotplug_device_t** device) {
+    fake_source_context_t* c = (fake_source_context_t*)source_context;
+    char token;
+    if(read(c->pipe_fd[0], &token, 1) != 1) return 0;
+
+    pthread_mutex_lock(&c->lock);
+    fake_event_t* event = g_queue_pop_head(c->events);
+    pthread_mutex_unlock(&c->lock);
+    if(event == NULL) return 0;
+
+    *action = event->action;
+    *device = event->device;
+    allocator_free(event);
+    return 1;
+}
+
+static void fake_source_destroy(void* source_context) {
+    fake_source_context_t* c = (fake_source_context_t*)source_context;
+    close(c->pipe_fd[0]);
+    close(c->pipe_fd[1]);
+    g_queue_free_full(c->events, free_fake_event);
+    pthread_mutex_destroy(&c->lock);
+    allocator_free(c);
+}
+
+hotplug_source_t* hotplug_source_fake() {
+    fake_source_context_t* c = allocator_calloc(1, sizeof(fake_source_context_t));
+    if(c == NULL) return NULL;
+    if(pipe(c->pipe_fd) != 0) {
+        ERROR("Could not create pipe: %s\n", strerror(errno));
+        allocator_free(c);
+        return NULL;
+    }
+    fcntl(c->pipe_fd[0], F_SETFL, O_NONBLOCK);
+    pthread_mutex_init(&c->lock, NULL);
+    c->events = g_queue_new();
+
+    hotplug_source_t* source = allocator_calloc(1, sizeof(hotplug_source_t));
+    if(source == NULL) {
+        fake_source_destroy(c);
+        return NULL;
+    }
+    source->get_fd = fake_source_get_fd;
+    source->scan = fake_source_scan;
+    source->receive = fake_source_receive;
+    source->destroy = fake_source_destroy;
+    source->context = c;
+    return source;
+}
+
+static int fake_source_push(hotplug_source_t* source, hotplug_action_t action, hotplug_device_t* device) {
+    if(source == NULL || source->get_fd != fake_source_get_fd || device == NULL) {
+        hotplug_device_destroy(device);
+        return -1;
+    }
+    fake_source_context_t* c = (fake_source_context_t*)source->context;
+    fake_event_t* event = allocator_calloc(1, sizeof(fake_event_t));
+    if(event == NULL) {
+        hotplug_device_destroy(device);
+        return -1;
+    }
+    event->action = action;
+    event->device = device;
+
+    pthread_mutex_lock(&c->lock);
+    g_queue_push_tail(c->events, event);
+    pthread_mutex_unlock(&c->lock);
+
+    char token = 0;
+    if(write(c->pipe_fd[1], &token, 1) != 1) {
+        ERROR("Could not signal fake hotplug event\n");
+        return -1;
+    }
+    return 0;
+}
+
+int hotplug_source_fake_add(hotplug_source_t* source, const hotplug_device_t* device) {
+    return fake_source_push(source, HOTPLUG_ACTION_ADD, hotplug_device_copy(device));
+}
+
+int hotplug_source_fake_remove(hotplug_source_t* source, const char* device_path) {
+    return fake_source_push(source, HOTPLUG_ACTION_REMOVE,
+                            hotplug_device_create(NULL, device_path, NULL, NULL, NULL, NULL));
+}
+
+/*
+ * monitor
+ */
+
+typedef struct table_entry {
+    hotplug_device_t* device;
+    unsigned long added;    // generation of the add event, 1 for the initial scan
+} table_entry_t;
+
+typedef struct subscription {
+    int id;
+    hotplug_match_t match;
+    char* match_strings[4];     // owned copies behind match
+    hotplug_callback_func* callback;
+    void* callback_context;
+} subscription_t;
+
+struct hotplug_monitor {
+    hotplug_source_t* source;
+    pthread_t thread;
+    volatile int running;
+
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    GSList* table;              // table_entry_t*
+    GSList* subscriptions;      // subscription_t*
+    unsigned long generation;   // starts at 1, so 0 is older than any entry
+    int next_subscription_id;
+};
+
+static void free_table_entry(void* data) {
+    table_entry_t* entry = (table_entry_t*)data;
+    hotplug_device_destroy(entry->device);
+    allocator_free(entry);
+}
+
+static void free_subscription(void* data) {
+    subscription_t* s = (subscription_t*)data;
+    for(int i = 0; i < 4; i++) {
+        allocator_free(s->match_strings[i]);
+    }
+    allocator_free(s);
+}
+
+static GSList* find_entry(GSList* table, const char* device_path) {
+    for(GSList* it = table; it != NULL; it = it->next) {
+        table_entry_t* entry = (table_entry_t*)it->data;
+        if(strcmp(entry->device->device_path, device_path) == 0) {
+            return it;
+        }
+    }
+    return NULL;
+}
+
+static void notify(hotplug_monitor_t* monitor, hotplug_action_t action, const hotplug_device_t* device) {
+    for(GSList* it = monitor->subscriptions; it != NULL; it = it->next) {
+        subscription_t* s = (subscription_t*)it->data;
+        if(hotplug_device_matches(device, &s->match)) {
+            s->callback(s->callback_context, action, device);
+        }
+    }
+}
+
+/* takes ownership of device */
+static void process_event(hotplug_monitor_t* monitor, hotplug_action_t action, hotplug_device_t* device) {
+    pthread_mutex_lock(&monitor->lock);
+    monitor->generation++;
+    GSList* existing = find_entry(monitor->table, device->device_path);
+
+    if(action == HOTPLUG_ACTION_ADD) {
+        DEBUG("Hotplug add: %s (%s)\n", device->device_name, device->device_path);
+        if(existing != NULL) {
+            // re-added without remove in between, replace the stale entry
+            free_table_entry(existing->data);
+            monitor->table = g_slist_delete_link(monitor->table, existing);
+        }
+        table_entry_t* entry = allocator_calloc(1, sizeof(table_entry_t));
+        if(entry != NULL) {
+            entry->device = device;
+            entry->added = monitor->generation;
+            monitor->table = g_slist_prepend(monitor->table, entry);
+            notify(monitor, action, device);
+        }
+        else {
+            hotplug_device_destroy(device);
+        }
+    }
+    else {
+        DEBUG("Hotplug remove: %s\n", device->device_path);
+        if(existing != NULL) {
+            // remove events may lack properties, report the known entry
+            table_entry_t* entry = (table_entry_t*)existing->data;
+            monitor->table = g_slist_delete_link(monitor->table, existing);
+            notify(monitor, action, entry->device);
+            free_table_entry(entry);
+        }
+        hotplug_device_destroy(device);
+    }
+
+    pthread_cond_broadcast(&monitor->changed);
+    pthread_mutex_unlock(&monitor->lock);
+}
+
+static void* monitor_thread(void* void_monitor) {
+    hotplug_monitor_t* monitor = (hotplug_monitor_t*)void_monitor;
+    struct pollfd pfd;
+    pfd.fd = monitor->source->get_fd(monitor->source->context);
+    pfd.events = POLLIN;
+
+    while(monitor->running) {
+        int ret = poll(&pfd, 1, HOTPLUG_POLL_TIMEOUT_MS);
+        if(ret < 0) {
+            if(errno == EINTR) continue;
+            ERROR("Hotplug poll failed: %s\n", strerror(errno));
+            break;
+        }
+        if(ret == 0) continue;
+
+        hotplug_action_t action;
+        hotplug_device_t* device = NULL;
+        ret = monitor->source->receive(monitor->source->context, &action, &device);
+        if(ret < 0) {
+            WARNING("Could not receive hotplug event\n");
+        }
+        else if(ret > 0) {
+            process_event(monitor, action, device);
+        }
+    }
+    return NULL;
+}
+
+hotplug_monitor_t* hotplug_monitor_start(hotplug_source_t* source) {
+    if(source == NULL) return NULL;
+
+    hotplug_monitor_t* monitor = allocator_calloc(1, sizeof(hotplug_monitor_t));
+    if(monitor == NULL) {
+        hotplug_source_destroy(source);
+        return NULL;
+    }
+    monitor->source = source;
+    monitor->running = 1;
+    monitor->next_subscription_id = 1;
+    pthread_mutex_init(&monitor->lock, NULL);
+    pthread_cond_init(&monitor->changed, NULL);
+
+    monitor->generation = 1;
+
+    // events arriving during the scan are queued by the source and applied afterwards
+    GSList* present = NULL;
+    if(source->scan(source->context, &present) != 0) {
+        WARNING("Initial device scan failed\n");
+    }
+    for(GSList* it = present; it != NULL; it = it->next) {
+        table_entry_t* entry = allocator_calloc(1, sizeof(table_entry_t));
+        if(entry == NULL) {
+            hotplug_device_destroy(GPOINTER_TO_HD_POINTER(it->data));
+            continue;
+        }
+        entry->device = GPOINTER_TO_HD_POINTER(it->data);
+        entry->added = 1;
+        monitor->table = g_slist_prepend(monitor->table, entry);
+    }
+    g_slist_free(present);
+
+    if(pthread_create(&monitor->thread, NULL, monitor_thread, monitor) != 0) {
+        ERROR("Could not create hotplug monitor thread\n");
+        monitor->running = 0;
+        hotplug_monitor_stop(monitor);
+        return NULL;
+    }
+    return monitor;
+}
+
+void hotplug_monitor_stop(hotplug_monitor_t* monitor) {
+    if(monitor != NULL) {
+        if(monitor->running) {
+            monitor->running = 0;
+            pthread_join(monitor->thread, NULL);
+        }
+        g_slist_free_full(monitor->table, free_table_entry);
+        g_slist_free_full(monitor->subscriptions, free_subscription);
+        pthread_cond_destroy(&monitor->changed);
+        pthread_mutex_destroy(&monitor->lock);
+        hotplug_source_destroy(monitor->source);
+        allocator_free(monitor);
+    }
+}
+
+int hotplug_subscribe(hotplug_monitor_t* monitor,
+                      const hotplug_match_t* match,
+                      hotplug_callback_func* callback,
+                      void* callback_context) {
+    if(monitor == NULL || callback == NULL) return -1;
+
+    subscription_t* s = allocator_calloc(1, sizeof(subscription_t));
+    if(s == NULL) return -1;
+    if(match != NULL) {
+        s->match.vendor_id = s->match_strings[0] = copy_optional_string(match->vendor_id);
+        s->match.model_id = s->match_strings[1] = copy_optional_string(match->model_id);
+        s->match.subsystem = s->match_strings[2] = copy_optional_string(match->subsystem);
+        s->match.usb_interface_num = s->match_strings[3] = copy_optional_string(match->usb_interface_num);
+    }
+    s->callback = callback;
+    s->callback_context = callback_context;
+
+    pthread_mutex_lock(&monitor->lock);
+    s->id = monitor->next_subscription_id++;
+    monitor->subscriptions = g_slist_append(monitor->subscriptions, s);
+    for(GSList* it = monitor->table; it != NULL; it = it->next) {
+        table_entry_t* entry = (table_entry_t*)it->data;
+        if(hotplug_device_matches(entry->device, &s->match)) {
+            callback(callback_context, HOTPLUG_ACTION_ADD, entry->device);
+        }
+    }
+    pthread_mutex_unlock(&monitor->lock);
+    return s->id;
+}
+
+void hotplug_unsubscribe(hotplug_monitor_t* monitor, int subscription_id) {
+    if(monitor == NULL) return;
+    pthread_mutex_lock(&monitor->lock);
+    for(GSList* it = monitor->subscriptions; it != NULL; it = it->next) {
+        subscription_t* s = (subscription_t*)it->data;
+        if(s->id == subscription_id) {
+            monitor->subscriptions = g_slist_delete_link(monitor->subscriptions, it);
+            free_subscription(s);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&monitor->lock);
+}
+
+GSList* hotplug_get_devices(hotplug_monitor_t* monitor, const hotplug_match_t* match) {
+    GSList* result = NULL;
+    if(monitor == NULL) return NULL;
+    pthread_mutex_lock(&monitor->lock);
+    for(GSList* it = monitor->table; it != NULL; it = it->next) {
+        table_entry_t* entry = (table_entry_t*)it->data;
+        if(hotplug_device_matches(entry->device, match)) {
+            result = g_slist_prepend(result, hotplug_device_copy(entry->device));
+        }
+    }
+    pthread_mutex_unlock(&monitor->lock);
+    return result;
+}
+
+unsigned long hotplug_get_generation(hotplug_monitor_t* monitor) {
+    if(monitor == NULL) return 0;
+    pthread_mutex_lock(&monitor->lock);
+    unsigned long generation = monitor->generation;
+    pthread_mutex_unlock(&monitor->lock);
+    return generation;
+}
+
+hotplug_device_t* hotplug_wait_for_device(hotplug_monitor_t* monitor,
+                                          const hotplug_match_t* match,
+                                          unsigned long added_after,
+                                          int timeout_ms) {
+    hotplug_device_t* result = NULL;
+    struct timespec deadline;
+    if(monitor == NULL) return NULL;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    if(timeout_ms > 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if(deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&monitor->lock);
+    while(result == NULL) {
+        for(GSList* it = monitor->table; it != NULL; it = it->next) {
+            table_entry_t* entry = (table_entry_t*)it->data;
+            if(entry->added > added_after &&
+               hotplug_device_matches(entry->device, match)) {
+                result = hotplug_device_copy(entry->device);
+                break;
+            }
+        }
+        if(result != NULL) break;
+
+        if(timeout_ms < 0) {
+            pthread_cond_wait(&monitor->changed, &monitor->lock);
+        }
+        else if(timeout_ms == 0 || pthread_cond_timedwait(&monitor->changed, &monitor->lock, &deadline) != 0) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&monitor->lock);
+    return result;
+}
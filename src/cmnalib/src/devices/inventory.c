@@ -0,0 +1,358 @@
+#include <stdlib.h>
+#include <string.h>
+#include <gmodule.h>
+
+#include <pthread.h>
+
+#include "cmnalib/inventory.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE DEVICES
+#include "cmnalib/logger.h"
+
+/*
+ * Classification
+ * Interface numbers of the Sierra Wireless MC74xx/EM75xx USB composition.
+ */
+
+typedef struct role_rule {
+    const char* vendor_id;          // NULL matches any
+    const char* subsystem;
+    const char* usb_interface_num;  // NULL matches any
+    inventory_endpoint_role_t role;
+} role_rule_t;
+
+static const role_rule_t role_rules[] = {
+    { "1199", "tty",     "03", INVENTORY_ENDPOINT_AT },
+    { "1199", "tty",     "02", INVENTORY_ENDPOINT_NMEA },
+    { NULL,   "usbmisc", NULL, INVENTORY_ENDPOINT_QMI },
+    { NULL,   "net",     NULL, INVENTORY_ENDPOINT_NETDEV },
+};
+
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
+
+static int rule_value_matches(const char* rule_value, const char* value) {
+    if(rule_value == NULL) return 1;
+    return value != NULL && strcmp(rule_value, value) == 0;
+}
+
+inventory_endpoint_role_t inventory_classify(const hotplug_device_t* device) {
+    if(device == NULL || device->device_name == NULL) return INVENTORY_ENDPOINT_UNKNOWN;
+
+    for(size_t i = 0; i < NELEMS(role_rules); i++) {
+        if(rule_value_matches(role_rules[i].subsystem, device->subsystem) &&
+           rule_value_matches(role_rules[i].vendor_id, device->vendor_id) &&
+           rule_value_matches(role_rules[i].usb_interface_num, device->usb_interface_num)) {
+            // usbmisc also carries e.g. printers, only cdc-wdm speaks QMI
+            if(role_rules[i].role == INVENTORY_ENDPOINT_QMI && strstr(device->device_name, "cdc-wdm") == NULL) {
+                continue;
+            }
+            return role_rules[i].role;
+        }
+    }
+    return INVENTORY_ENDPOINT_UNKNOWN;
+}
+
+/* an interface directory is named after its device, e.g. .../1-1/1-1:1.3/ttyUSB2 */
+char* inventory_usb_path_of(const char* device_path) {
+    if(device_path == NULL) return NULL;
+
+    const char* component = device_path;
+    const char* parent = NULL;
+    size_t parent_len = 0;
+    while(*component != 0) {
+        const char* end = strchr(component, '/');
+        size_t len = end != NULL ? (size_t)(end - component) : strlen(component);
+        const char* colon = memchr(component, ':', len);
+        if(colon != NULL && parent != NULL &&
+           (size_t)(colon - component) == parent_len &&
+           strncmp(component, parent, parent_len) == 0) {
+            return allocator_strndup(device_path, component - device_path - 1);
+        }
+        parent = component;
+        parent_len = len;
+        if(end == NULL) break;
+        component = end + 1;
+    }
+    return NULL;
+}
+
+/*
+ * Modem entries
+ */
+
+static char* copy_optional_string(const char* src) {
+    return src != NULL ? allocator_strdup(src) : NULL;
+}
+
+inventory_modem_t* inventory_modem_copy(const inventory_modem_t* modem) {
+    if(modem == NULL) return NULL;
+    inventory_modem_t* copy = allocator_calloc(1, sizeof(inventory_modem_t));
+    if(copy == NULL) return NULL;
+    copy->usb_path = copy_optional_string(modem->usb_path);
+    copy->vendor_id = copy_optional_string(modem->vendor_id);
+    copy->model_id = copy_optional_string(modem->model_id);
+    copy->serial = copy_optional_string(modem->serial);
+    copy->imei = copy_optional_string(modem->imei);
+    for(int i = 0; i < INVENTORY_ENDPOINT__MAX; i++) {
+        copy->endpoints[i] = copy_optional_string(modem->endpoints[i]);
+    }
+    return copy;
+}
+
+static void modem_free_fields(inventory_modem_t* modem) {
+    allocator_free(modem->usb_path);
+    allocator_free(modem->vendor_id);
+    allocator_free(modem->model_id);
+    allocator_free(modem->serial);
+    allocator_free(modem->imei);
+    for(int i = 0; i < INVENTORY_ENDPOINT__MAX; i++) {
+        allocator_free(modem->endpoints[i]);
+    }
+}
+
+void inventory_modem_free(inventory_modem_t* modem) {
+    if(modem != NULL) {
+        modem_free_fields(modem);
+        allocator_free(modem);
+    }
+}
+
+static void _wrapper_g_destroy_notify(void* modem) {
+    inventory_modem_free((inventory_modem_t*)modem);
+}
+
+void inventory_modem_list_free(GSList* list) {
+    g_slist_free_full(list, _wrapper_g_destroy_notify);
+}
+
+typedef struct modem_entry {
+    inventory_modem_t info;
+    char* endpoint_paths[INVENTORY_ENDPOINT__MAX];  // sysfs paths of the endpoints
+} modem_entry_t;
+
+typedef struct endpoint {
+    modem_entry_t* modem;
+    inventory_endpoint_role_t role;
+} endpoint_t;
+
+static void free_modem_entry(void* data) {
+    modem_entry_t* entry = (modem_entry_t*)data;
+    modem_free_fields(&entry->info);
+    for(int i = 0; i < INVENTORY_ENDPOINT__MAX; i++) {
+        allocator_free(entry->endpoint_paths[i]);
+    }
+    allocator_free(entry);
+}
+
+/*
+ * Inventory
+ * All keys of the secondary indexes are owned by the modem entries,
+ * except the endpoint paths which are owned by their index.
+ */
+
+struct inventory {
+    hotplug_monitor_t* monitor;
+    int subscription_id;
+
+    pthread_mutex_t lock;
+    GHashTable* modems;         // usb_path -> modem_entry_t*, owns the entries
+    GHashTable* by_serial;      // serial -> modem_entry_t*
+    GHashTable* by_imei;        // imei -> modem_entry_t*
+    GHashTable* by_endpoint;    // device name -> modem_entry_t*
+    GHashTable* endpoints;      // device path -> endpoint_t*
+};
+
+static int modem_has_endpoints(const modem_entry_t* entry) {
+    for(int i = 0; i < INVENTORY_ENDPOINT__MAX; i++) {
+        if(entry->info.endpoints[i] != NULL) return 1;
+    }
+    return 0;
+}
+
+static void remove_endpoint(inventory_t* inventory, const char* device_path) {
+    endpoint_t* endpoint = g_hash_table_lookup(inventory->endpoints, device_path);
+    if(endpoint == NULL) return;
+
+    modem_entry_t* entry = endpoint->modem;
+    inventory_endpoint_role_t role = endpoint->role;
+    DEBUG("Inventory: %s leaves %s\n", entry->info.endpoints[role], entry->info.usb_path);
+
+    g_hash_table_remove(inventory->by_endpoint, entry->info.endpoints[role]);
+    allocator_free(entry->info.endpoints[role]);
+    allocator_free(entry->endpoint_paths[role]);
+    entry->info.endpoints[role] = NULL;
+    entry->endpoint_paths[role] = NULL;
+    g_hash_table_remove(inventory->endpoints, device_path);
+
+    if(!modem_has_endpoints(entry)) {
+        DEBUG("Inventory: modem %s removed\n", entry->info.usb_path);
+        if(entry->info.serial != NULL) g_hash_table_remove(inventory->by_serial, entry->info.serial);
+        if(entry->info.imei != NULL) g_hash_table_remove(inventory->by_imei, entry->info.imei);
+        g_hash_table_remove(inventory->modems, entry->info.usb_path);
+    }
+}
+
+static void add_endpoint(inventory_t* inventory, const hotplug_device_t* device) {
+    inventory_endpoint_role_t role = inventory_classify(device);
+    if(role == INVENTORY_ENDPOINT_UNKNOWN) return;
+
+    char* usb_path = inventory_usb_path_of(device->device_path);
+    if(usb_path == NULL) return;
+
+    // re-added without remove in between
+    remove_endpoint(inventory, device->device_path);
+
+    // one endpoint per role, a newer device replaces a stale one
+    modem_entry_t* entry = g_hash_table_lookup(inventory->modems, usb_path);
+    if(entry != NULL && entry->endpoint_paths[role] != NULL) {
+        char* stale_path = allocator_strdup(entry->endpoint_paths[role]);
+        remove_endpoint(inventory, stale_path);
+        allocator_free(stale_path);
+        // the modem is dropped together with its last endpoint
+        entry = g_hash_table_lookup(inventory->modems, usb_path);
+    }
+
+    if(entry == NULL) {
+        entry = allocator_calloc(1, sizeof(modem_entry_t));
+        if(entry == NULL) {
+            allocator_free(usb_path);
+            return;
+        }
+        entry->info.usb_path = usb_path;
+        g_hash_table_insert(inventory->modems, entry->info.usb_path, entry);
+        DEBUG("Inventory: modem %s added\n", usb_path);
+    }
+    else {
+        allocator_free(usb_path);
+    }
+
+    if(entry->info.vendor_id == NULL) entry->info.vendor_id = copy_optional_string(device->vendor_id);
+    if(entry->info.model_id == NULL) entry->info.model_id = copy_optional_string(device->model_id);
+    if(entry->info.serial == NULL && device->serial != NULL) {
+        entry->info.serial = allocator_strdup(device->serial);
+        g_hash_table_insert(inventory->by_serial, entry->info.serial, entry);
+    }
+
+    endpoint_t* endpoint = allocator_calloc(1, sizeof(endpoint_t));
+    if(endpoint == NULL) return;
+    endpoint->modem = entry;
+    endpoint->role = role;
+    entry->info.endpoints[role] = allocator_strdup(device->device_name);
+    entry->endpoint_paths[role] = allocator_strdup(device->device_path);
+    g_hash_table_insert(inventory->endpoints, allocator_strdup(device->device_path), endpoint);
+    g_hash_table_insert(inventory->by_endpoint, entry->info.endpoints[role], entry);
+    DEBUG("Inventory: %s joins %s\n", device->device_name, entry->info.usb_path);
+}
+
+static void hotplug_event(void* callback_context, hotplug_action_t action, const hotplug_device_t* device) {
+    inventory_t* inventory = (inventory_t*)callback_context;
+    pthread_mutex_lock(&inventory->lock);
+    if(action == HOTPLUG_ACTION_ADD) {
+        add_endpoint(inventory, device);
+    }
+    else {
+        remove_endpoint(inventory, device->device_path);
+    }
+    pthread_mutex_unlock(&inventory->lock);
+}
+
+inventory_t* inventory_create(hotplug_monitor_t* monitor) {
+    if(monitor == NULL) return NULL;
+
+    inventory_t* inventory = allocator_calloc(1, sizeof(inventory_t));
+    if(inventory == NULL) return NULL;
+    inventory->monitor = monitor;
+    pthread_mutex_init(&inventory->lock, NULL);
+    inventory->modems = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_modem_entry);
+    inventory->by_serial = g_hash_table_new(g_str_hash, g_str_equal);
+    inventory->by_imei = g_hash_table_new(g_str_hash, g_str_equal);
+    inventory->by_endpoint = g_hash_table_new(g_str_hash, g_str_equal);
+    inventory->endpoints = g_hash_table_new_full(g_str_hash, g_str_equal, allocator_free, allocator_free);
+
+    // replays all present devices
+    inventory->subscription_id = hotplug_subscribe(monitor, NULL, hotplug_event, inventory);
+    if(inventory->subscription_id < 0) {
+        ERROR("Could not subscribe to hotplug events\n");
+        inventory_destroy(inventory);
+        return NULL;
+    }
+    return inventory;
+}
+
+void inventory_destroy(inventory_t* inventory) {
+    if(inventory != NULL) {
+        if(inventory->subscription_id > 0) {
+            hotplug_unsubscribe(inventory->monitor, inventory->subscription_id);
+        }
+        g_hash_table_destroy(inventory->endpoints);
+        g_hash_table_destroy(inventory->by_endpoint);
+        g_hash_table_destroy(inventory->by_imei);
+        g_hash_table_destroy(inventory->by_serial);
+        g_hash_table_destroy(inventory->modems);
+        pthread_mutex_destroy(&inventory->lock);
+        allocator_free(inventory);
+    }
+}
+
+static inventory_modem_t* find_in(inventory_t* inventory, GHashTable* index, const char* key) {
+    inventory_modem_t* result = NULL;
+    if(inventory == NULL || key == NULL) return NULL;
+    pthread_mutex_lock(&inventory->lock);
+    modem_entry_t* entry = g_hash_table_lookup(index, key);
+    if(entry != NULL) {
+        result = inventory_modem_copy(&entry->info);
+    }
+    pthread_mutex_unlock(&inventory->lock);
+    return result;
+}
+
+inventory_modem_t* inventory_find_by_usb_path(inventory_t* inventory, const char* usb_path) {
+    return inventory != NULL ? find_in(inventory, inventory->modems, usb_path) : NULL;
+}
+
+inventory_modem_t* inventory_find_by_serial(inventory_t* inventory, const char* serial) {
+    return inventory != NULL ? find_in(inventory, inventory->by_serial, serial) : NULL;
+}
+
+inventory_modem_t* inventory_find_by_imei(inventory_t* inventory, const char* imei) {
+    return inventory != NULL ? find_in(inventory, inventory->by_imei, imei) : NULL;
+}
+
+inventory_modem_t* inventory_find_by_endpoint(inventory_t* inventory, const char* device_name) {
+    return inventory != NULL ? find_in(inventory, inventory->by_endpoint, device_name) : NULL;
+}
+
+GSList* inventory_get_modems(inventory_t* inventory) {
+    GSList* result = NULL;
+    GHashTableIter iter;
+    gpointer key, value;
+    if(inventory == NULL) return NULL;
+
+    pthread_mutex_lock(&inventory->lock);
+    g_hash_table_iter_init(&iter, inventory->modems);
+    while(g_hash_table_iter_next(&iter, &key, &value)) {
+        modem_entry_t* entry = (modem_entry_t*)value;
+        result = g_slist_prepend(result, inventory_modem_copy(&entry->info));
+    }
+    pthread_mutex_unlock(&inventory->lock);
+    return result;
+}
+
+int inventory_set_imei(inventory_t* inventory, const char* usb_path, const char* imei) {
+    int ret = -1;
+    if(inventory == NULL || usb_path == NULL || imei == NULL) return -1;
+
+    pthread_mutex_lock(&inventory->lock);
+    modem_entry_t* entry = g_hash_table_lookup(inventory->modems, usb_path);
+    if(entry != NULL) {
+        if(entry->info.imei != NULL) {
+            g_hash_table_remove(inventory->by_imei, entry->info.imei);
+            allocator_free(entry->info.imei);
+        }
+        entry->info.imei = allocator_strdup(imei);
+        g_hash_table_insert(inventory->by_imei, entry->info.imei, entry);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&inventory->lock);
+    return ret;
+}
@@ -0,0 +1,439 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "cmnalib/meas_broker.h"
+#include "cmnalib/allocator.h"
+#include "cmnalib/logger.h"
+
+/*
+ * wire format
+ */
+
+#define PUT(P, V) do { memcpy((P), &(V), sizeof(V)); (P) += sizeof(V); } while(0)
+#define GET(P, V) do { memcpy(&(V), (P), sizeof(V)); (P) += sizeof(V); } while(0)
+
+int meas_broker_encode_sample(const meas_sample_t* sample, uint8_t* buf) {
+    uint8_t* p = buf;
+    uint8_t source = sample->source;
+    int32_t ints[] = {sample->tx_power, sample->pci, sample->cell_id, sample->tac,
+                      sample->earfcn, sample->band, sample->bandwidth_MHz};
+    PUT(p, sample->timestamp_us);
+    PUT(p, source);
+    PUT(p, sample->valid);
+    PUT(p, sample->rsrp);
+    PUT(p, sample->rsrq);
+    PUT(p, sample->rssi);
+    PUT(p, sample->sinr);
+    for(int i = 0; i < 7; i++) PUT(p, ints[i]);
+    PUT(p, sample->latitude);
+    PUT(p, sample->longitude);
+    PUT(p, sample->altitude);
+    return p - buf;
+}
+
+int meas_broker_decode_sample(const uint8_t* buf, int len, meas_sample_t* sample) {
+    if(len != MEAS_BROKER_SAMPLE_SIZE) {
+        return -1;
+    }
+    const uint8_t* p = buf;
+    uint8_t source;
+    int32_t ints[7];
+    memset(sample, 0, sizeof(meas_sample_t));
+    GET(p, sample->timestamp_us);
+    GET(p, source);
+    GET(p, sample->valid);
+    GET(p, sample->rsrp);
+    GET(p, sample->rsrq);
+    GET(p, sample->rssi);
+    GET(p, sample->sinr);
+    for(int i = 0; i < 7; i++) GET(p, ints[i]);
+    GET(p, sample->latitude);
+    GET(p, sample->longitude);
+    GET(p, sample->altitude);
+    sample->source = source;
+    sample->tx_power = ints[0];
+    sample->pci = ints[1];
+    sample->cell_id = ints[2];
+    sample->tac = ints[3];
+    sample->earfcn = ints[4];
+    sample->band = ints[5];
+    sample->bandwidth_MHz = ints[6];
+    return 0;
+}
+
+/* returns 0, 1 if the peer could not take it right away, -1 on error */
+static int send_message(int fd, meas_broker_msg_type_t type, const uint8_t* payload, int len) {
+    uint8_t buf[MEAS_BROKER_MAX_MESSAGE_SIZE];
+    uint16_t length = len;
+    buf[0] = type;
+    buf[1] = MEAS_BROKER_PROTOCOL_VERSION;
+    memcpy(&buf[2], &length, sizeof(length));
+    if(len > 0) memcpy(&buf[MEAS_BROKER_HEADER_SIZE], payload, len);
+
+    if(send(fd, buf, MEAS_BROKER_HEADER_SIZE + len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : -1;
+    }
+    return 0;
+}
+
+/* returns the message type with its payload, 0 on timeout, -1 on error or hangup */
+static int receive_message(int fd, uint8_t* payload, int* len, int timeout_ms) {
+    uint8_t buf[MEAS_BROKER_MAX_MESSAGE_SIZE];
+    struct pollfd pfd = {fd, POLLIN, 0};
+
+    int ret = poll(&pfd, 1, timeout_ms);
+    if(ret <= 0) {
+        return ret;
+    }
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return 0;
+    }
+    if(n < MEAS_BROKER_HEADER_SIZE) {
+        return -1;
+    }
+    uint16_t length;
+    memcpy(&length, &buf[2], sizeof(length));
+    if(buf[1] != MEAS_BROKER_PROTOCOL_VERSION || length != n - MEAS_BROKER_HEADER_SIZE) {
+        WARNING("Malformed broker message\n");
+        return MEAS_BROKER_MSG_ERROR;
+    }
+    memcpy(payload, &buf[MEAS_BROKER_HEADER_SIZE], length);
+    *len = length;
+    return buf[0];
+}
+
+/*
+ * server
+ */
+
+typedef struct broker_client {
+    int fd;
+    int subscribed;
+    int closed;     // removed by the next meas_broker_process()
+} broker_client_t;
+
+struct meas_broker {
+    pthread_mutex_t lock;
+    int listen_fd;
+    char* socket_path;
+    broker_client_t* clients;
+    int nof_clients;
+    int capacity;
+    meas_sample_t latest;
+    int has_latest;
+};
+
+meas_broker_t* meas_broker_create(const char* socket_path) {
+    struct sockaddr_un addr;
+    if(socket_path == NULL || strlen(socket_path) >= sizeof(addr.sun_path)) {
+        ERROR("Invalid socket path\n");
+        return NULL;
+    }
+    meas_broker_t* broker = allocator_calloc(1, sizeof(meas_broker_t));
+    if(broker == NULL) {
+        ERROR("ERROR in calloc\n");
+        return NULL;
+    }
+    pthread_mutex_init(&broker->lock, NULL);
+    broker->socket_path = allocator_strdup(socket_path);
+    broker->listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if(broker->socket_path == NULL || broker->listen_fd < 0) {
+        ERROR("Could not create broker socket: %s\n", strerror(errno));
+        meas_broker_destroy(broker);
+        return NULL;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    unlink(socket_path);
+    if(bind(broker->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+       listen(broker->listen_fd, 16) != 0) {
+        ERROR("Could not listen on %s: %s\n", socket_path, strerror(errno));
+        meas_broker_destroy(broker);
+        return NULL;
+    }
+    INFO("Broker listening on %s\n", socket_path);
+    return broker;
+}
+
+void meas_broker_destroy(meas_broker_t* broker) {
+    if(broker == NULL) {
+        return;
+    }
+    for(int i = 0; i < broker->nof_clients; i++) {
+        close(broker->clients[i].fd);
+    }
+    if(broker->listen_fd >= 0) {
+        close(broker->listen_fd);
+        if(broker->socket_path != NULL) unlink(broker->socket_path);
+    }
+    pthread_mutex_destroy(&broker->lock);
+    allocator_free(broker->clients);
+    allocator_free(broker->socket_path);
+    allocator_free(broker);
+}
+
+static void accept_client(meas_broker_t* broker) {
+    int fd = accept4(broker->listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if(fd < 0) {
+        return;
+    }
+    if(broker->nof_clients == broker->capacity) {
+        int capacity = broker->capacity > 0 ? 2 * broker->capacity : 8;
+        broker_client_t* clients = allocator_realloc(broker->clients, capacity * sizeof(broker_client_t));
+        if(clients == NULL) {
+            ERROR("ERROR in realloc\n");
+            close(fd);
+            return;
+        }
+        broker->clients = clients;
+        broker->capacity = capacity;
+    }
+    broker_client_t* c = &broker->clients[broker->nof_clients++];
+    c->fd = fd;
+    c->subscribed = 0;
+    c->closed = 0;
+    DEBUG("Broker client %d connected\n", fd);
+}
+
+static void handle_request(meas_broker_t* broker, broker_client_t* c) {
+    uint8_t payload[MEAS_BROKER_SAMPLE_SIZE];
+    uint8_t buf[MEAS_BROKER_MAX_MESSAGE_SIZE];
+    int len = 0;
+    int type = receive_message(c->fd, buf, &len, 0);
+
+    switch(type) {
+    case 0:
+        return;
+    case MEAS_BROKER_MSG_GET_LATEST:
+        if(broker->has_latest) {
+            meas_broker_encode_sample(&broker->latest, payload);
+            if(send_message(c->fd, MEAS_BROKER_MSG_LATEST, payload, MEAS_BROKER_SAMPLE_SIZE) < 0) c->closed = 1;
+        }
+        else if(send_message(c->fd, MEAS_BROKER_MSG_NO_SAMPLE, NULL, 0) < 0) {
+            c->closed = 1;
+        }
+        break;
+    case MEAS_BROKER_MSG_SUBSCRIBE:
+        c->subscribed = 1;
+        break;
+    case MEAS_BROKER_MSG_UNSUBSCRIBE:
+        c->subscribed = 0;
+        break;
+    case -1:
+        DEBUG("Broker client %d disconnected\n", c->fd);
+        c->closed = 1;
+        break;
+    default:
+        if(send_message(c->fd, MEAS_BROKER_MSG_ERROR, NULL, 0) < 0) c->closed = 1;
+        break;
+    }
+}
+
+static void remove_closed_clients(meas_broker_t* broker) {
+    int n = 0;
+    for(int i = 0; i < broker->nof_clients; i++) {
+        if(broker->clients[i].closed) {
+            close(broker->clients[i].fd);
+        }
+        else {
+            broker->clients[n++] = broker->clients[i];
+        }
+    }
+    broker->nof_clients = n;
+}
+
+int meas_broker_process(meas_broker_t* broker, int timeout_ms) {
+    if(broker == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&broker->lock);
+    int nof_fds = broker->nof_clients + 1;
+    struct pollfd* fds = allocator_calloc(nof_fds, sizeof(struct pollfd));
+    if(fds == NULL) {
+        pthread_mutex_unlock(&broker->lock);
+        ERROR("ERROR in calloc\n");
+        return -1;
+    }
+    fds[0].fd = broker->listen_fd;
+    fds[0].events = POLLIN;
+    for(int i = 1; i < nof_fds; i++) {
+        fds[i].fd = broker->clients[i - 1].fd;
+        fds[i].events = POLLIN;
+    }
+    pthread_mutex_unlock(&broker->lock);
+
+    // clients are only added and removed here, so the indices stay valid
+    int ret = poll(fds, nof_fds, timeout_ms);
+    if(ret < 0 && errno != EINTR) {
+        ERROR("poll failed: %s\n", strerror(errno));
+        allocator_free(fds);
+        return -1;
+    }
+
+    int handled = 0;
+    pthread_mutex_lock(&broker->lock);
+    if(ret > 0) {
+        for(int i = 1; i < nof_fds; i++) {
+            if(fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                handle_request(broker, &broker->clients[i - 1]);
+                handled++;
+            }
+        }
+        if(fds[0].revents & POLLIN) {
+            accept_client(broker);
+        }
+    }
+    remove_closed_clients(broker);
+    pthread_mutex_unlock(&broker->lock);
+
+    allocator_free(fds);
+    return handled;
+}
+
+int meas_broker_publish(meas_broker_t* broker, const meas_sample_t* sample) {
+    uint8_t payload[MEAS_BROKER_SAMPLE_SIZE];
+    int reached = 0;
+
+    if(broker == NULL || sample == NULL) {
+        return -1;
+    }
+    meas_broker_encode_sample(sample, payload);
+
+    pthread_mutex_lock(&broker->lock);
+    broker->latest = *sample;
+    broker->has_latest = 1;
+    for(int i = 0; i < broker->nof_clients; i++) {
+        broker_client_t* c = &broker->clients[i];
+        if(!c->subscribed || c->closed) continue;
+        int ret = send_message(c->fd, MEAS_BROKER_MSG_SAMPLE, payload, MEAS_BROKER_SAMPLE_SIZE);
+        if(ret == 0) {
+            reached++;
+        }
+        else if(ret < 0) {
+            c->closed = 1;
+        }
+    }
+    pthread_mutex_unlock(&broker->lock);
+    return reached;
+}
+
+int meas_broker_get_nof_clients(meas_broker_t* broker) {
+    pthread_mutex_lock(&broker->lock);
+    int n = broker->nof_clients;
+    pthread_mutex_unlock(&broker->lock);
+    return n;
+}
+
+/*
+ * client
+ */
+
+struct meas_broker_client {
+    int fd;
+    int subscribed;
+};
+
+meas_broker_client_t* meas_broker_connect(const char* socket_path) {
+    struct sockaddr_un addr;
+    if(socket_path == NULL || strlen(socket_path) >= sizeof(addr.sun_path)) {
+        ERROR("Invalid socket path\n");
+        return NULL;
+    }
+    meas_broker_client_t* client = allocator_calloc(1, sizeof(meas_broker_client_t));
+    if(client == NULL) {
+        ERROR("ERROR in calloc\n");
+        return NULL;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    client->fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(client->fd < 0 || connect(client->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        ERROR("Could not connect to broker at %s: %s\n", socket_path, strerror(errno));
+        if(client->fd >= 0) close(client->fd);
+        allocator_free(client);
+        return NULL;
+    }
+    return client;
+}
+
+void meas_broker_disconnect(meas_broker_client_t* client) {
+    if(client != NULL) {
+        close(client->fd);
+    }
+    allocator_free(client);
+}
+
+int meas_broker_get_latest(meas_broker_client_t* client, meas_sample_t* sample, int timeout_ms) {
+    uint8_t payload[MEAS_BROKER_SAMPLE_SIZE];
+    int len = 0;
+
+    if(client == NULL || client->subscribed) {
+        return -1;
+    }
+    if(send_message(client->fd, MEAS_BROKER_MSG_GET_LATEST, NULL, 0) != 0) {
+        return -1;
+    }
+    switch(receive_message(client->fd, payload, &len, timeout_ms)) {
+    case MEAS_BROKER_MSG_LATEST:
+        return meas_broker_decode_sample(payload, len, sample) == 0 ? 1 : -1;
+    case MEAS_BROKER_MSG_NO_SAMPLE:
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+int meas_broker_subscribe(meas_broker_client_t* client) {
+    if(client == NULL || send_message(client->fd, MEAS_BROKER_MSG_SUBSCRIBE, NULL, 0) != 0) {
+        return -1;
+    }
+    client->subscribed = 1;
+    return 0;
+}
+
+int meas_broker_unsubscribe(meas_broker_client_t* client) {
+    if(client == NULL || send_message(client->fd, MEAS_BROKER_MSG_UNSUBSCRIBE, NULL, 0) != 0) {
+        return -1;
+    }
+    client->subscribed = 0;
+    return 0;
+}
+
+int meas_broker_receive(meas_broker_client_t* client, meas_sample_t* sample, int timeout_ms) {
+    uint8_t payload[MEAS_BROKER_SAMPLE_SIZE];
+    int len = 0;
+
+    if(client == NULL) {
+        return -1;
+    }
+    while(1) {
+        int type = receive_message(client->fd, payload, &len, timeout_ms);
+        if(type <= 0) {
+            return type;
+        }
+        if(type == MEAS_BROKER_MSG_SAMPLE) {
+            return meas_broker_decode_sample(payload, len, sample) == 0 ? 1 : -1;
+        }
+        // late answers after unsubscribing or an error reply, skip them
+    }
+}
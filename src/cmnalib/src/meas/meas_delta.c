@@ -0,0 +1,382 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "cmnalib/meas_delta.h"
+#include "cmnalib/allocator.h"
+#include "cmnalib/logger.h"
+
+/*
+ * primitives
+ */
+
+static uint8_t* put_varint(uint8_t* p, uint64_t v) {
+    while(v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+/* returns NULL if the varint exceeds end */
+static const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, uint64_t* v) {
+    *v = 0;
+    for(int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        *v |= (uint64_t)(b & 0x7f) << shift;
+        if(!(b & 0x80)) return p;
+    }
+    return NULL;
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+#define PUT(P, V) do { memcpy((P), &(V), sizeof(V)); (P) += sizeof(V); } while(0)
+#define GET(P, END, V) do { if((P) + sizeof(V) > (END)) return -1; memcpy(&(V), (P), sizeof(V)); (P) += sizeof(V); } while(0)
+
+/*
+ * fields
+ */
+
+static float* float_field(meas_sample_t* s, int field) {
+    switch(field) {
+    case MEAS_FIELD_RSRP: return &s->rsrp;
+    case MEAS_FIELD_RSRQ: return &s->rsrq;
+    case MEAS_FIELD_RSSI: return &s->rssi;
+    case MEAS_FIELD_SINR: return &s->sinr;
+    default: return NULL;
+    }
+}
+
+static int* int_field(meas_sample_t* s, int field) {
+    switch(field) {
+    case MEAS_FIELD_TX_POWER: return &s->tx_power;
+    case MEAS_FIELD_PCI: return &s->pci;
+    case MEAS_FIELD_CELL_ID: return &s->cell_id;
+    case MEAS_FIELD_TAC: return &s->tac;
+    case MEAS_FIELD_EARFCN: return &s->earfcn;
+    case MEAS_FIELD_BAND: return &s->band;
+    case MEAS_FIELD_BANDWIDTH: return &s->bandwidth_MHz;
+    default: return NULL;
+    }
+}
+
+/* bitwise comparison, a float that stays NaN is unchanged */
+static int field_equal(const meas_sample_t* a, const meas_sample_t* b, int field) {
+    meas_sample_t* x = (meas_sample_t*)a;
+    meas_sample_t* y = (meas_sample_t*)b;
+    if(float_field(x, field) != NULL) {
+        return memcmp(float_field(x, field), float_field(y, field), sizeof(float)) == 0;
+    }
+    if(int_field(x, field) != NULL) {
+        return *int_field(x, field) == *int_field(y, field);
+    }
+    return memcmp(&a->latitude, &b->latitude, sizeof(double)) == 0 &&
+           memcmp(&a->longitude, &b->longitude, sizeof(double)) == 0 &&
+           memcmp(&a->altitude, &b->altitude, sizeof(float)) == 0;
+}
+
+/* prev is NULL in keyframes */
+static uint8_t* put_field(uint8_t* p, const meas_sample_t* s, const meas_sample_t* prev, int field) {
+    meas_sample_t* x = (meas_sample_t*)s;
+    float* f = float_field(x, field);
+    int* i = int_field(x, field);
+    if(f != NULL) {
+        PUT(p, *f);
+    }
+    else if(i != NULL) {
+        int64_t base = prev != NULL ? *int_field((meas_sample_t*)prev, field) : 0;
+        p = put_varint(p, zigzag((int64_t)*i - base));
+    }
+    else {
+        PUT(p, s->latitude);
+        PUT(p, s->longitude);
+        PUT(p, s->altitude);
+    }
+    return p;
+}
+
+/* returns the new position, NULL if truncated */
+static const uint8_t* get_field(const uint8_t* p, const uint8_t* end, meas_sample_t* s, int delta, int field) {
+    float* f = float_field(s, field);
+    int* i = int_field(s, field);
+    if(f != NULL) {
+        if(p + sizeof(float) > end) return NULL;
+        memcpy(f, p, sizeof(float));
+        return p + sizeof(float);
+    }
+    if(i != NULL) {
+        uint64_t v;
+        p = get_varint(p, end, &v);
+        if(p == NULL) return NULL;
+        *i = (int)((delta ? *i : 0) + unzigzag(v));
+        return p;
+    }
+    if(p + 2 * sizeof(double) + sizeof(float) > end) return NULL;
+    memcpy(&s->latitude, p, sizeof(double));
+    memcpy(&s->longitude, p + sizeof(double), sizeof(double));
+    memcpy(&s->altitude, p + 2 * sizeof(double), sizeof(float));
+    return p + 2 * sizeof(double) + sizeof(float);
+}
+
+/*
+ * encoder
+ */
+
+void meas_delta_encoder_init(meas_delta_encoder_t* e, int keyframe_interval) {
+    memset(e, 0, sizeof(meas_delta_encoder_t));
+    e->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : MEAS_DELTA_DEFAULT_KEYFRAME_INTERVAL;
+}
+
+void meas_delta_force_keyframe(meas_delta_encoder_t* e) {
+    e->has_last = 0;
+}
+
+int meas_delta_encode(meas_delta_encoder_t* e, const meas_sample_t* sample, uint8_t* buf) {
+    uint8_t* p = buf + 2;
+    uint8_t flags = 0;
+    const uint32_t valid = sample->valid & (MEAS_FIELD_BIT(MEAS_FIELD__MAX) - 1);
+
+    if(!e->has_last || e->since_keyframe + 1 >= e->keyframe_interval ||
+       sample->timestamp_us < e->last.timestamp_us) {
+        uint8_t source = sample->source;
+        flags = MEAS_DELTA_FLAG_KEYFRAME;
+        PUT(p, sample->timestamp_us);
+        PUT(p, source);
+        p = put_varint(p, valid);
+        for(int field = 0; field < MEAS_FIELD__MAX; field++) {
+            if(valid & MEAS_FIELD_BIT(field)) {
+                p = put_field(p, sample, NULL, field);
+            }
+        }
+        e->since_keyframe = 0;
+    }
+    else {
+        const meas_sample_t* prev = &e->last;
+        uint32_t changed = 0;
+        for(int field = 0; field < MEAS_FIELD__MAX; field++) {
+            if((valid & MEAS_FIELD_BIT(field)) && !((prev->valid & MEAS_FIELD_BIT(field)) && field_equal(sample, prev, field))) {
+                changed |= MEAS_FIELD_BIT(field);
+            }
+        }
+        p = put_varint(p, sample->timestamp_us - prev->timestamp_us);
+        if(sample->source != prev->source) {
+            uint8_t source = sample->source;
+            flags |= MEAS_DELTA_FLAG_SOURCE;
+            PUT(p, source);
+        }
+        if(valid != prev->valid) {
+            flags |= MEAS_DELTA_FLAG_VALID;
+            p = put_varint(p, valid);
+        }
+        p = put_varint(p, changed);
+        for(int field = 0; field < MEAS_FIELD__MAX; field++) {
+            if(changed & MEAS_FIELD_BIT(field)) {
+                // a field that was invalid has no reliable base value
+                int based = (prev->valid & MEAS_FIELD_BIT(field)) != 0;
+                p = put_field(p, sample, based ? prev : NULL, field);
+            }
+        }
+        e->since_keyframe++;
+    }
+
+    buf[0] = (uint8_t)(p - buf - 1);
+    buf[1] = flags;
+
+    // the encoder keeps only what the decoder can reconstruct
+    e->last = *sample;
+    e->last.valid = valid;
+    e->has_last = 1;
+    return p - buf;
+}
+
+/*
+ * decoder
+ */
+
+void meas_delta_decoder_init(meas_delta_decoder_t* d) {
+    memset(d, 0, sizeof(meas_delta_decoder_t));
+}
+
+int meas_delta_decode(meas_delta_decoder_t* d, const uint8_t* buf, int len, meas_sample_t* sample) {
+    if(len < 1 || len < 1 + buf[0]) {
+        return 0;
+    }
+    const uint8_t* p = buf + 2;
+    const uint8_t* end = buf + 1 + buf[0];
+    if(buf[0] < 1) return -1;
+    uint8_t flags = buf[1];
+    uint64_t v;
+    meas_sample_t s;
+
+    if(flags & MEAS_DELTA_FLAG_KEYFRAME) {
+        uint8_t source;
+        memset(&s, 0, sizeof(meas_sample_t));
+        GET(p, end, s.timestamp_us);
+        GET(p, end, source);
+        if((p = get_varint(p, end, &v)) == NULL) return -1;
+        s.source = source;
+        s.valid = (uint32_t)v;
+        for(int field = 0; field < MEAS_FIELD__MAX; field++) {
+            if(s.valid & MEAS_FIELD_BIT(field)) {
+                if((p = get_field(p, end, &s, 0, field)) == NULL) return -1;
+            }
+        }
+    }
+    else {
+        if(!d->has_last) {
+            WARNING("Delta record without preceding keyframe\n");
+            return -1;
+        }
+        s = d->last;
+        if((p = get_varint(p, end, &v)) == NULL) return -1;
+        s.timestamp_us += v;
+        if(flags & MEAS_DELTA_FLAG_SOURCE) {
+            uint8_t source;
+            GET(p, end, source);
+            s.source = source;
+        }
+        if(flags & MEAS_DELTA_FLAG_VALID) {
+            if((p = get_varint(p, end, &v)) == NULL) return -1;
+            s.valid = (uint32_t)v;
+        }
+        uint64_t changed;
+        if((p = get_varint(p, end, &changed)) == NULL) return -1;
+        for(int field = 0; field < MEAS_FIELD__MAX; field++) {
+            if(changed & MEAS_FIELD_BIT(field)) {
+                int based = (d->last.valid & MEAS_FIELD_BIT(field)) != 0;
+                if((p = get_field(p, end, &s, based, field)) == NULL) return -1;
+            }
+        }
+    }
+    if(p != end) {
+        return -1;
+    }
+
+    d->last = s;
+    d->has_last = 1;
+    *sample = s;
+    return end - buf;
+}
+
+/*
+ * files
+ */
+
+meas_delta_writer_t* meas_delta_writer_init(const char* filename, int keyframe_interval) {
+    meas_delta_writer_t* w = allocator_calloc(1, sizeof(meas_delta_writer_t));
+    if(w == NULL) {
+        ERROR("Could not alloc memory\n");
+        return NULL;
+    }
+    errno = 0;
+    w->file = fopen(filename, "wb");
+    if(w->file == NULL) {
+        ERROR("Could not open file '%s': %s\n", filename, strerror(errno));
+        allocator_free(w);
+        return NULL;
+    }
+    meas_delta_encoder_init(&w->encoder, keyframe_interval);
+    return w;
+}
+
+void meas_delta_writer_destroy(meas_delta_writer_t* w) {
+    if(w == NULL) return;
+    if(w->file != NULL) fclose(w->file);
+    allocator_free(w);
+}
+
+int meas_delta_write(meas_delta_writer_t* w, const meas_sample_t* sample) {
+    uint8_t buf[MEAS_DELTA_MAX_RECORD_SIZE];
+    int len = meas_delta_encode(&w->encoder, sample, buf);
+    if(fwrite(buf, 1, len, w->file) != (size_t)len) {
+        ERROR("Could not write record: %s\n", strerror(errno));
+        // the reader must not apply later deltas to a lost record
+        meas_delta_force_keyframe(&w->encoder);
+        return -1;
+    }
+    w->nof_records++;
+    w->nof_bytes += len;
+    return 0;
+}
+
+meas_delta_reader_t* meas_delta_reader_init(const char* filename) {
+    meas_delta_reader_t* r = allocator_calloc(1, sizeof(meas_delta_reader_t));
+    if(r == NULL) {
+        ERROR("Could not alloc memory\n");
+        return NULL;
+    }
+    errno = 0;
+    r->file = fopen(filename, "rb");
+    if(r->file == NULL) {
+        ERROR("Could not open file '%s': %s\n", filename, strerror(errno));
+        allocator_free(r);
+        return NULL;
+    }
+    meas_delta_decoder_init(&r->decoder);
+    return r;
+}
+
+void meas_delta_reader_destroy(meas_delta_reader_t* r) {
+    if(r == NULL) return;
+    if(r->file != NULL) fclose(r->file);
+    allocator_free(r);
+}
+
+/* returns the record length, 0 at the end of the file, -1 if truncated */
+static int read_record(FILE* file, uint8_t* buf) {
+    int c = fgetc(file);
+    if(c == EOF) return 0;
+    buf[0] = (uint8_t)c;
+    if(fread(buf + 1, 1, buf[0], file) != buf[0]) return -1;
+    return 1 + buf[0];
+}
+
+int meas_delta_read(meas_delta_reader_t* r, meas_sample_t* sample) {
+    uint8_t buf[256];
+    int len = read_record(r->file, buf);
+    if(len <= 0) {
+        if(len < 0) WARNING("Truncated record at end of file\n");
+        return len;
+    }
+    return meas_delta_decode(&r->decoder, buf, len, sample) == len ? 1 : -1;
+}
+
+int meas_delta_seek(meas_delta_reader_t* r, uint64_t timestamp_us) {
+    uint8_t buf[256];
+    long found = -1;
+    rewind(r->file);
+    for(;;) {
+        long offset = ftell(r->file);
+        int len = read_record(r->file, buf);
+        if(len <= 0) break;
+        if(len >= 2 + (int)sizeof(uint64_t) && (buf[1] & MEAS_DELTA_FLAG_KEYFRAME)) {
+            uint64_t t;
+            memcpy(&t, buf + 2, sizeof(t));
+            if(t > timestamp_us) break;
+            found = offset;
+        }
+    }
+    meas_delta_decoder_init(&r->decoder);
+    if(found < 0) {
+        rewind(r->file);
+        return -1;
+    }
+    fseek(r->file, found, SEEK_SET);
+    return 0;
+}
@@ -0,0 +1,353 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include "cmnalib/meas_neighbour_db.h"
+#include "cmnalib/allocator.h"
+#include "cmnalib/logger.h"
+
+/*
+ * statistics
+ */
+
+void meas_running_stats_add(meas_running_stats_t* s, float value) {
+    if(s->count == 0 || value < s->min) s->min = value;
+    if(s->count == 0 || value > s->max) s->max = value;
+    s->count++;
+    double delta = value - s->mean;
+    s->mean += delta / s->count;
+    s->m2 += delta * (value - s->mean);
+}
+
+void meas_running_stats_merge(meas_running_stats_t* dst, const meas_running_stats_t* src) {
+    if(src->count == 0) return;
+    if(dst->count == 0) {
+        *dst = *src;
+        return;
+    }
+    double n = (double)dst->count + src->count;
+    double delta = src->mean - dst->mean;
+    dst->mean += delta * src->count / n;
+    dst->m2 += src->m2 + delta * delta * dst->count * src->count / n;
+    dst->count += src->count;
+    if(src->min < dst->min) dst->min = src->min;
+    if(src->max > dst->max) dst->max = src->max;
+}
+
+double meas_running_stats_variance(const meas_running_stats_t* s) {
+    return s->count > 1 ? s->m2 / (s->count - 1) : 0;
+}
+
+/*
+ * table
+ */
+
+/* open addressing with linear probing, grown at 3/4 load */
+struct meas_neighbour_db {
+    meas_neighbour_t* cells;
+    uint8_t* used;
+    int capacity;           // power of two
+    int size;
+};
+
+static uint32_t hash_key(int earfcn, int pci) {
+    uint64_t key = ((uint64_t)(uint32_t)earfcn << 32) | (uint32_t)pci;
+    key *= 0x9e3779b97f4a7c15ull;
+    return (uint32_t)(key >> 32);
+}
+
+/* slot of the cell, or of the empty slot it would go to */
+static int find_slot(const meas_neighbour_db_t* db, int earfcn, int pci) {
+    int mask = db->capacity - 1;
+    int i = hash_key(earfcn, pci) & mask;
+    while(db->used[i] && (db->cells[i].earfcn != earfcn || db->cells[i].pci != pci)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int resize(meas_neighbour_db_t* db, int capacity) {
+    meas_neighbour_t* cells = allocator_calloc(capacity, sizeof(meas_neighbour_t));
+    uint8_t* used = allocator_calloc(capacity, sizeof(uint8_t));
+    if(cells == NULL || used == NULL) {
+        ERROR("Could not alloc memory\n");
+        allocator_free(cells);
+        allocator_free(used);
+        return -1;
+    }
+    meas_neighbour_db_t grown = { cells, used, capacity, db->size };
+    for(int i = 0; i < db->capacity; i++) {
+        if(db->used[i]) {
+            int slot = find_slot(&grown, db->cells[i].earfcn, db->cells[i].pci);
+            grown.cells[slot] = db->cells[i];
+            grown.used[slot] = 1;
+        }
+    }
+    allocator_free(db->cells);
+    allocator_free(db->used);
+    *db = grown;
+    return 0;
+}
+
+meas_neighbour_db_t* meas_neighbour_db_create(int initial_capacity) {
+    meas_neighbour_db_t* db = allocator_calloc(1, sizeof(meas_neighbour_db_t));
+    if(db == NULL) {
+        ERROR("Could not alloc memory\n");
+        return NULL;
+    }
+    int capacity = 16;
+    while(capacity < initial_capacity) capacity *= 2;
+    if(resize(db, capacity) != 0) {
+        allocator_free(db);
+        return NULL;
+    }
+    return db;
+}
+
+void meas_neighbour_db_destroy(meas_neighbour_db_t* db) {
+    if(db == NULL) return;
+    allocator_free(db->cells);
+    allocator_free(db->used);
+    allocator_free(db);
+}
+
+/* returns the entry of the cell, inserting an empty one if needed */
+static meas_neighbour_t* lookup_or_insert(meas_neighbour_db_t* db, int earfcn, int pci) {
+    int slot = find_slot(db, earfcn, pci);
+    if(db->used[slot]) {
+        return &db->cells[slot];
+    }
+    if((db->size + 1) * 4 > db->capacity * 3) {
+        if(resize(db, db->capacity * 2) != 0) return NULL;
+        slot = find_slot(db, earfcn, pci);
+    }
+    meas_neighbour_t* n = &db->cells[slot];
+    memset(n, 0, sizeof(meas_neighbour_t));
+    n->earfcn = earfcn;
+    n->pci = pci;
+    db->used[slot] = 1;
+    db->size++;
+    return n;
+}
+
+static void extend_position(meas_neighbour_t* n, double min_lat, double max_lat, double min_lon, double max_lon) {
+    if(!n->has_position) {
+        n->min_latitude = min_lat;
+        n->max_latitude = max_lat;
+        n->min_longitude = min_lon;
+        n->max_longitude = max_lon;
+        n->has_position = 1;
+        return;
+    }
+    if(min_lat < n->min_latitude) n->min_latitude = min_lat;
+    if(max_lat > n->max_latitude) n->max_latitude = max_lat;
+    if(min_lon < n->min_longitude) n->min_longitude = min_lon;
+    if(max_lon > n->max_longitude) n->max_longitude = max_lon;
+}
+
+int meas_neighbour_db_add(meas_neighbour_db_t* db, int earfcn, int pci, float rsrp, float rsrq,
+                          const meas_sample_t* at) {
+    meas_neighbour_t* n = lookup_or_insert(db, earfcn, pci);
+    if(n == NULL) return -1;
+
+    if(n->rsrp.count == 0 || at->timestamp_us < n->first_seen_us) n->first_seen_us = at->timestamp_us;
+    if(at->timestamp_us > n->last_seen_us) n->last_seen_us = at->timestamp_us;
+    meas_running_stats_add(&n->rsrp, rsrp);
+    meas_running_stats_add(&n->rsrq, rsrq);
+    if(meas_sample_has(at, MEAS_FIELD_POSITION)) {
+        extend_position(n, at->latitude, at->latitude, at->longitude, at->longitude);
+    }
+    return 0;
+}
+
+int meas_neighbour_db_add_lteinfo(meas_neighbour_db_t* db, const sw_em7565_lteinfo_response_t* lteinfo,
+                                  const meas_sample_t* at) {
+    int added = 0;
+    for(int i = 0; i < lteinfo->nof_intrafreq_neighbours; i++) {
+        const sw_em7565_lteinfo_intrafreq_neighbour_t* n = &lteinfo->intrafreq_neighbours[i];
+        if(meas_neighbour_db_add(db, lteinfo->earfn, n->pci, n->rsrp, n->rsrq, at) != 0) return -1;
+        added++;
+    }
+    for(int i = 0; i < lteinfo->nof_interfreq_neighbours; i++) {
+        const sw_em7565_lteinfo_interfreq_neighbour_t* n = &lteinfo->interfreq_neighbours[i];
+        if(meas_neighbour_db_add(db, n->earfcn, n->pci, n->rsrp, n->rsrq, at) != 0) return -1;
+        added++;
+    }
+    return added;
+}
+
+const meas_neighbour_t* meas_neighbour_db_find(const meas_neighbour_db_t* db, int earfcn, int pci) {
+    int slot = find_slot(db, earfcn, pci);
+    return db->used[slot] ? &db->cells[slot] : NULL;
+}
+
+int meas_neighbour_db_get_size(const meas_neighbour_db_t* db) {
+    return db->size;
+}
+
+const meas_neighbour_t* meas_neighbour_db_iterate(const meas_neighbour_db_t* db, int* iterator) {
+    while(*iterator < db->capacity) {
+        int i = (*iterator)++;
+        if(db->used[i]) return &db->cells[i];
+    }
+    return NULL;
+}
+
+/*
+ * files
+ */
+
+#define PUT(P, V) do { memcpy((P), &(V), sizeof(V)); (P) += sizeof(V); } while(0)
+#define GET(P, V) do { memcpy(&(V), (P), sizeof(V)); (P) += sizeof(V); } while(0)
+
+#define HEADER_SIZE 12
+#define STATS_SIZE 28
+#define RECORD_SIZE (2 * 4 + 2 * STATS_SIZE + 2 * 8 + 1 + 4 * 8)
+
+static uint8_t* put_stats(uint8_t* p, const meas_running_stats_t* s) {
+    PUT(p, s->count);
+    PUT(p, s->min);
+    PUT(p, s->max);
+    PUT(p, s->mean);
+    PUT(p, s->m2);
+    return p;
+}
+
+static const uint8_t* get_stats(const uint8_t* p, meas_running_stats_t* s) {
+    GET(p, s->count);
+    GET(p, s->min);
+    GET(p, s->max);
+    GET(p, s->mean);
+    GET(p, s->m2);
+    return p;
+}
+
+static void encode_record(const meas_neighbour_t* n, uint8_t* buf) {
+    uint8_t* p = buf;
+    int32_t earfcn = n->earfcn, pci = n->pci;
+    uint8_t has_position = n->has_position != 0;
+    PUT(p, earfcn);
+    PUT(p, pci);
+    p = put_stats(p, &n->rsrp);
+    p = put_stats(p, &n->rsrq);
+    PUT(p, n->first_seen_us);
+    PUT(p, n->last_seen_us);
+    PUT(p, has_position);
+    PUT(p, n->min_latitude);
+    PUT(p, n->max_latitude);
+    PUT(p, n->min_longitude);
+    PUT(p, n->max_longitude);
+}
+
+static void decode_record(const uint8_t* buf, meas_neighbour_t* n) {
+    const uint8_t* p = buf;
+    int32_t earfcn, pci;
+    uint8_t has_position;
+    memset(n, 0, sizeof(meas_neighbour_t));
+    GET(p, earfcn);
+    GET(p, pci);
+    p = get_stats(p, &n->rsrp);
+    p = get_stats(p, &n->rsrq);
+    GET(p, n->first_seen_us);
+    GET(p, n->last_seen_us);
+    GET(p, has_position);
+    GET(p, n->min_latitude);
+    GET(p, n->max_latitude);
+    GET(p, n->min_longitude);
+    GET(p, n->max_longitude);
+    n->earfcn = earfcn;
+    n->pci = pci;
+    n->has_position = has_position;
+}
+
+int meas_neighbour_db_save(const meas_neighbour_db_t* db, const char* filename) {
+    errno = 0;
+    FILE* file = fopen(filename, "wb");
+    if(file == NULL) {
+        ERROR("Could not open file '%s': %s\n", filename, strerror(errno));
+        return -1;
+    }
+    uint8_t buf[RECORD_SIZE];
+    uint8_t* p = buf;
+    uint32_t magic = MEAS_NEIGHBOUR_DB_MAGIC, count = db->size;
+    uint16_t version = MEAS_NEIGHBOUR_DB_VERSION, record_size = RECORD_SIZE;
+    PUT(p, magic);
+    PUT(p, version);
+    PUT(p, record_size);
+    PUT(p, count);
+    int ret = fwrite(buf, 1, HEADER_SIZE, file) == HEADER_SIZE ? 0 : -1;
+
+    int it = 0;
+    const meas_neighbour_t* n;
+    while(ret == 0 && (n = meas_neighbour_db_iterate(db, &it)) != NULL) {
+        encode_record(n, buf);
+        if(fwrite(buf, 1, RECORD_SIZE, file) != RECORD_SIZE) ret = -1;
+    }
+    if(fclose(file) != 0) ret = -1;
+    if(ret != 0) {
+        ERROR("Could not write file '%s'\n", filename);
+    }
+    return ret;
+}
+
+int meas_neighbour_db_load(meas_neighbour_db_t* db, const char* filename) {
+    errno = 0;
+    FILE* file = fopen(filename, "rb");
+    if(file == NULL) {
+        ERROR("Could not open file '%s': %s\n", filename, strerror(errno));
+        return -1;
+    }
+    uint8_t buf[RECORD_SIZE];
+    const uint8_t* p = buf;
+    uint32_t magic, count;
+    uint16_t version, record_size;
+    if(fread(buf, 1, HEADER_SIZE, file) != HEADER_SIZE) {
+        ERROR("Truncated header in '%s'\n", filename);
+        fclose(file);
+        return -1;
+    }
+    GET(p, magic);
+    GET(p, version);
+    GET(p, record_size);
+    GET(p, count);
+    if(magic != MEAS_NEIGHBOUR_DB_MAGIC || version != MEAS_NEIGHBOUR_DB_VERSION || record_size != RECORD_SIZE) {
+        ERROR("'%s' is no neighbour database of version %d\n", filename, MEAS_NEIGHBOUR_DB_VERSION);
+        fclose(file);
+        return -1;
+    }
+
+    int loaded = 0;
+    for(uint32_t i = 0; i < count; i++) {
+        meas_neighbour_t record;
+        if(fread(buf, 1, RECORD_SIZE, file) != RECORD_SIZE) {
+            ERROR("Truncated record in '%s'\n", filename);
+            loaded = -1;
+            break;
+        }
+        decode_record(buf, &record);
+        meas_neighbour_t* n = lookup_or_insert(db, record.earfcn, record.pci);
+        if(n == NULL) {
+            loaded = -1;
+            break;
+        }
+        if(n->rsrp.count == 0 || record.first_seen_us < n->first_seen_us) n->first_seen_us = record.first_seen_us;
+        if(record.last_seen_us > n->last_seen_us) n->last_seen_us = record.last_seen_us;
+        meas_running_stats_merge(&n->rsrp, &record.rsrp);
+        meas_running_stats_merge(&n->rsrq, &record.rsrq);
+        if(record.has_position) {
+            extend_position(n, record.min_latitude, record.max_latitude, record.min_longitude, record.max_longitude);
+        }
+        loaded++;
+    }
+    fclose(file);
+    return loaded;
+}
@@ -0,0 +1,157 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cmnalib/meas_shm.h"
+#include "cmnalib/allocator.h"
+#include "cmnalib/logger.h"
+
+/* a reader gives up on a writer that stays in an update this long */
+#define MEAS_SHM_MAX_RETRIES 10000
+
+typedef struct meas_shm_segment {
+    meas_shm_header_t header;
+    meas_sample_t sample;
+} meas_shm_segment_t;
+
+struct meas_shm {
+    meas_shm_segment_t* segment;
+    char* name;                 // set for the writer only
+};
+
+meas_shm_t* meas_shm_create(const char* name) {
+    meas_shm_t* shm = allocator_calloc(1, sizeof(meas_shm_t));
+    if(shm == NULL) return NULL;
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if(fd < 0) {
+        ERROR("Could not create shared memory %s: %s\n", name, strerror(errno));
+        allocator_free(shm);
+        return NULL;
+    }
+    if(ftruncate(fd, sizeof(meas_shm_segment_t)) != 0) {
+        ERROR("Could not resize shared memory %s: %s\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        allocator_free(shm);
+        return NULL;
+    }
+    void* p = mmap(NULL, sizeof(meas_shm_segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(p == MAP_FAILED) {
+        ERROR("Could not map shared memory %s: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        allocator_free(shm);
+        return NULL;
+    }
+    shm->segment = p;
+    shm->name = allocator_strdup(name);
+
+    // a stale segment of a previous writer is reset, readers see no sample
+    meas_shm_header_t* h = &shm->segment->header;
+    __atomic_store_n(&h->magic, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->sequence, 0, __ATOMIC_RELAXED);
+    memset(&shm->segment->sample, 0, sizeof(meas_sample_t));
+    h->version = MEAS_SHM_VERSION;
+    h->header_size = sizeof(meas_shm_header_t);
+    h->record_size = sizeof(meas_sample_t);
+    __atomic_store_n(&h->magic, MEAS_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    INFO("Publishing measurements in shared memory %s\n", name);
+    return shm;
+}
+
+meas_shm_t* meas_shm_open(const char* name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0) {
+        WARNING("Could not open shared memory %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(meas_shm_segment_t)) {
+        ERROR("Shared memory %s is too small\n", name);
+        close(fd);
+        return NULL;
+    }
+    void* p = mmap(NULL, sizeof(meas_shm_segment_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(p == MAP_FAILED) {
+        ERROR("Could not map shared memory %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    meas_shm_segment_t* segment = p;
+    if(__atomic_load_n(&segment->header.magic, __ATOMIC_ACQUIRE) != MEAS_SHM_MAGIC ||
+       segment->header.version != MEAS_SHM_VERSION ||
+       segment->header.header_size != sizeof(meas_shm_header_t) ||
+       segment->header.record_size != sizeof(meas_sample_t)) {
+        ERROR("Shared memory %s has an incompatible layout\n", name);
+        munmap(p, sizeof(meas_shm_segment_t));
+        return NULL;
+    }
+
+    meas_shm_t* shm = allocator_calloc(1, sizeof(meas_shm_t));
+    if(shm == NULL) {
+        munmap(p, sizeof(meas_shm_segment_t));
+        return NULL;
+    }
+    shm->segment = segment;
+    return shm;
+}
+
+void meas_shm_close(meas_shm_t* shm) {
+    if(shm == NULL) return;
+    munmap(shm->segment, sizeof(meas_shm_segment_t));
+    if(shm->name != NULL) {
+        shm_unlink(shm->name);
+        allocator_free(shm->name);
+    }
+    allocator_free(shm);
+}
+
+void meas_shm_publish(meas_shm_t* shm, const meas_sample_t* sample) {
+    uint32_t* sequence = &shm->segment->header.sequence;
+    uint32_t seq = __atomic_load_n(sequence, __ATOMIC_RELAXED);
+
+    // odd while writing; the fence keeps the sample stores behind it
+    __atomic_store_n(sequence, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&shm->segment->sample, sample, sizeof(meas_sample_t));
+    __atomic_store_n(sequence, seq + 2, __ATOMIC_RELEASE);
+}
+
+int meas_shm_read(meas_shm_t* shm, meas_sample_t* sample) {
+    uint32_t* sequence = &shm->segment->header.sequence;
+
+    for(int i = 0; i < MEAS_SHM_MAX_RETRIES; i++) {
+        uint32_t begin = __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+        if(begin == 0) return 0;
+        if(begin & 1) {
+            sched_yield();
+            continue;
+        }
+        memcpy(sample, &shm->segment->sample, sizeof(meas_sample_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(sequence, __ATOMIC_RELAXED) == begin) {
+            return 1;
+        }
+    }
+    WARNING("Shared memory writer did not complete an update\n");
+    return -1;
+}
+
+uint32_t meas_shm_get_sequence(meas_shm_t* shm) {
+    return __atomic_load_n(&shm->segment->header.sequence, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,151 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "cmnalib/meas_stream.h"
+#include "cmnalib/allocator.h"
+#include "cmnalib/logger.h"
+
+struct meas_stream {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    meas_sample_t* ring;
+    int capacity;
+    int head;       // oldest sample
+    int length;
+    int closed;
+    unsigned long dropped;
+};
+
+void meas_sample_init(meas_sample_t* sample, meas_source_t source) {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    memset(sample, 0, sizeof(meas_sample_t));
+    sample->timestamp_us = (uint64_t)t.tv_sec * 1000000 + t.tv_usec;
+    sample->source = source;
+}
+
+meas_stream_t* meas_stream_create(int capacity) {
+    if(capacity <= 0) {
+        ERROR("Invalid stream capacity %d\n", capacity);
+        return NULL;
+    }
+    meas_stream_t* stream = allocator_calloc(1, sizeof(meas_stream_t));
+    if(stream == NULL) {
+        ERROR("ERROR in calloc\n");
+        return NULL;
+    }
+    stream->ring = allocator_calloc(capacity, sizeof(meas_sample_t));
+    if(stream->ring == NULL) {
+        ERROR("ERROR in calloc\n");
+        allocator_free(stream);
+        return NULL;
+    }
+    stream->capacity = capacity;
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->changed, NULL);
+    return stream;
+}
+
+void meas_stream_destroy(meas_stream_t* stream) {
+    if(stream != NULL) {
+        pthread_cond_destroy(&stream->changed);
+        pthread_mutex_destroy(&stream->lock);
+        allocator_free(stream->ring);
+        allocator_free(stream);
+    }
+}
+
+int meas_stream_push(meas_stream_t* stream, const meas_sample_t* sample) {
+    int dropped = 0;
+    if(stream == NULL) return -1;
+
+    pthread_mutex_lock(&stream->lock);
+    if(stream->closed) {
+        pthread_mutex_unlock(&stream->lock);
+        return -1;
+    }
+    if(stream->length == stream->capacity) {
+        stream->head = (stream->head + 1) % stream->capacity;
+        stream->length--;
+        stream->dropped++;
+        dropped = 1;
+    }
+    stream->ring[(stream->head + stream->length) % stream->capacity] = *sample;
+    stream->length++;
+    pthread_cond_signal(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    return dropped;
+}
+
+int meas_stream_pop(meas_stream_t* stream, meas_sample_t* sample, int timeout_ms) {
+    struct timespec deadline;
+    int ret = 0;
+    if(stream == NULL) return -1;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    if(timeout_ms > 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if(deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    while(stream->length == 0) {
+        if(stream->closed) {
+            ret = -1;
+            break;
+        }
+        if(timeout_ms < 0) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        else if(timeout_ms == 0 || pthread_cond_timedwait(&stream->changed, &stream->lock, &deadline) != 0) {
+            break;
+        }
+    }
+    if(stream->length > 0) {
+        *sample = stream->ring[stream->head];
+        stream->head = (stream->head + 1) % stream->capacity;
+        stream->length--;
+        ret = 1;
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return ret;
+}
+
+void meas_stream_close(meas_stream_t* stream) {
+    if(stream == NULL) return;
+    pthread_mutex_lock(&stream->lock);
+    stream->closed = 1;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+}
+
+int meas_stream_get_length(meas_stream_t* stream) {
+    if(stream == NULL) return 0;
+    pthread_mutex_lock(&stream->lock);
+    int length = stream->length;
+    pthread_mutex_unlock(&stream->lock);
+    return length;
+}
+
+unsigned long meas_stream_get_dropped(meas_stream_t* stream) {
+    if(stream == NULL) return 0;
+    pthread_mutex_lock(&stream->lock);
+    unsigned long dropped = stream->dropped;
+    pthread_mutex_unlock(&stream->lock);
+    return dropped;
+}
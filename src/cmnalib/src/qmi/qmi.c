@@ -0,0 +1,577 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "cmnalib/qmi.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE QMI
+#include "cmnalib/logger.h"
+
+#define QMUX_MARKER 0x01
+#define QMUX_HEADER_LEN 6           // marker, length, flags, service, client id
+#define QMUX_FLAG_SERVICE 0x80      // sent by the modem
+
+#define CTL_SDU_HEADER_LEN 2        // flags, 8 bit transaction id
+#define SERVICE_SDU_HEADER_LEN 3    // flags, 16 bit transaction id
+#define MESSAGE_HEADER_LEN 4        // message id, tlv length
+
+#define CTL_FLAG_RESPONSE   0x01
+#define CTL_FLAG_INDICATION 0x02
+#define SERVICE_FLAG_RESPONSE   0x02
+#define SERVICE_FLAG_INDICATION 0x04
+
+#define QMI_MAX_CLIENTS 16
+
+/*
+ * Messages
+ */
+
+uint16_t qmi_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t qmi_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+void qmi_message_init(qmi_message_t* msg, uint8_t service, uint8_t client_id, uint16_t message_id) {
+    msg->service = service;
+    msg->client_id = client_id;
+    msg->type = QMI_MESSAGE_REQUEST;
+    msg->transaction_id = 0;
+    msg->message_id = message_id;
+    msg->tlv_len = 0;
+}
+
+int qmi_message_add_tlv(qmi_message_t* msg, uint8_t type, uint16_t len, const void* value) {
+    if((size_t)msg->tlv_len + 3 + len > sizeof(msg->tlv)) {
+        ERROR("QMI message too long\n");
+        return -1;
+    }
+    uint8_t* p = msg->tlv + msg->tlv_len;
+    p[0] = type;
+    put_le16(p + 1, len);
+    memcpy(p + 3, value, len);
+    msg->tlv_len += 3 + len;
+    return 0;
+}
+
+int qmi_message_add_tlv_u8(qmi_message_t* msg, uint8_t type, uint8_t value) {
+    return qmi_message_add_tlv(msg, type, 1, &value);
+}
+
+int qmi_message_add_tlv_u32(qmi_message_t* msg, uint8_t type, uint32_t value) {
+    uint8_t buf[4] = {value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, value >> 24};
+    return qmi_message_add_tlv(msg, type, sizeof(buf), buf);
+}
+
+const uint8_t* qmi_message_find_tlv(const qmi_message_t* msg, uint8_t type, uint16_t* len) {
+    size_t pos = 0;
+    while(pos + 3 <= msg->tlv_len) {
+        uint16_t tlv_len = qmi_le16(msg->tlv + pos + 1);
+        if(pos + 3 + tlv_len > msg->tlv_len) break;
+        if(msg->tlv[pos] == type) {
+            if(len != NULL) *len = tlv_len;
+            return msg->tlv + pos + 3;
+        }
+        pos += 3 + tlv_len;
+    }
+    return NULL;
+}
+
+int qmi_message_get_error(const qmi_message_t* msg) {
+    uint16_t len;
+    const uint8_t* result = qmi_message_find_tlv(msg, QMI_TLV_RESULT, &len);
+    if(result == NULL || len < 4) return -1;
+    return qmi_le16(result) == 0 ? 0 : qmi_le16(result + 2);
+}
+
+int qmi_message_encode(const qmi_message_t* msg, uint8_t* buf, size_t buf_size) {
+    int is_ctl = msg->service == QMI_SERVICE_CTL;
+    size_t sdu_header_len = is_ctl ? CTL_SDU_HEADER_LEN : SERVICE_SDU_HEADER_LEN;
+    size_t len = QMUX_HEADER_LEN + sdu_header_len + MESSAGE_HEADER_LEN + msg->tlv_len;
+    if(len > buf_size) return -1;
+
+    uint8_t flags = 0;
+    if(msg->type == QMI_MESSAGE_RESPONSE) flags = is_ctl ? CTL_FLAG_RESPONSE : SERVICE_FLAG_RESPONSE;
+    if(msg->type == QMI_MESSAGE_INDICATION) flags = is_ctl ? CTL_FLAG_INDICATION : SERVICE_FLAG_INDICATION;
+
+    buf[0] = QMUX_MARKER;
+    put_le16(buf + 1, len - 1);
+    buf[3] = msg->type == QMI_MESSAGE_REQUEST ? 0 : QMUX_FLAG_SERVICE;
+    buf[4] = msg->service;
+    buf[5] = msg->client_id;
+    uint8_t* p = buf + QMUX_HEADER_LEN;
+    p[0] = flags;
+    if(is_ctl) {
+        p[1] = msg->transaction_id & 0xff;
+    }
+    else {
+        put_le16(p + 1, msg->transaction_id);
+    }
+    p += sdu_header_len;
+    put_le16(p, msg->message_id);
+    put_le16(p + 2, msg->tlv_len);
+    memcpy(p + MESSAGE_HEADER_LEN, msg->tlv, msg->tlv_len);
+    return len;
+}
+
+int qmi_message_decode(const uint8_t* buf, size_t len, qmi_message_t* msg) {
+    if(len < QMUX_HEADER_LEN || buf[0] != QMUX_MARKER) return -1;
+    if((size_t)qmi_le16(buf + 1) + 1 > len) return -1;
+    len = qmi_le16(buf + 1) + 1;
+
+    msg->service = buf[4];
+    msg->client_id = buf[5];
+    int is_ctl = msg->service == QMI_SERVICE_CTL;
+    size_t sdu_header_len = is_ctl ? CTL_SDU_HEADER_LEN : SERVICE_SDU_HEADER_LEN;
+    if(len < QMUX_HEADER_LEN + sdu_header_len + MESSAGE_HEADER_LEN) return -1;
+
+    const uint8_t* p = buf + QMUX_HEADER_LEN;
+    uint8_t flags = p[0];
+    if(is_ctl) {
+        msg->transaction_id = p[1];
+        msg->type = flags & CTL_FLAG_INDICATION ? QMI_MESSAGE_INDICATION :
+                    flags & CTL_FLAG_RESPONSE ? QMI_MESSAGE_RESPONSE : QMI_MESSAGE_REQUEST;
+    }
+    else {
+        msg->transaction_id = qmi_le16(p + 1);
+        msg->type = flags & SERVICE_FLAG_INDICATION ? QMI_MESSAGE_INDICATION :
+                    flags & SERVICE_FLAG_RESPONSE ? QMI_MESSAGE_RESPONSE : QMI_MESSAGE_REQUEST;
+    }
+    p += sdu_header_len;
+    msg->message_id = qmi_le16(p);
+    msg->tlv_len = qmi_le16(p + 2);
+    if(QMUX_HEADER_LEN + sdu_header_len + MESSAGE_HEADER_LEN + msg->tlv_len > len ||
+       msg->tlv_len > sizeof(msg->tlv)) {
+        return -1;
+    }
+    memcpy(msg->tlv, p + MESSAGE_HEADER_LEN, msg->tlv_len);
+    return 0;
+}
+
+/*
+ * Transports
+ */
+
+void qmi_transport_destroy(qmi_transport_t* transport) {
+    if(transport != NULL) {
+        if(transport->close != NULL) {
+            transport->close(transport->context);
+        }
+        allocator_free(transport);
+    }
+}
+
+static qmi_transport_t* create_transport(int (*write)(void*, const uint8_t*, size_t),
+                                         int (*read)(void*, uint8_t*, size_t, int),
+                                         void (*close)(void*),
+                                         void* context) {
+    qmi_transport_t* transport = allocator_calloc(1, sizeof(qmi_transport_t));
+    if(transport == NULL) {
+        close(context);
+        return NULL;
+    }
+    transport->write = write;
+    transport->read = read;
+    transport->close = close;
+    transport->context = context;
+    return transport;
+}
+
+/* cdc-wdm delivers exactly one QMUX frame per read */
+
+typedef struct cdc_wdm_context {
+    int fd;
+} cdc_wdm_context_t;
+
+static int cdc_wdm_write(void* transport_context, const uint8_t* buf, size_t len) {
+    cdc_wdm_context_t* c = (cdc_wdm_context_t*)transport_context;
+    ssize_t n = write(c->fd, buf, len);
+    if(n != (ssize_t)len) {
+        ERROR("QMI write failed: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int cdc_wdm_read(void* transport_context, uint8_t* buf, size_t buf_size, int timeout_ms) {
+    cdc_wdm_context_t* c = (cdc_wdm_context_t*)transport_context;
+    struct pollfd pfd = {c->fd, POLLIN, 0};
+    int ret = poll(&pfd, 1, timeout_ms);
+    if(ret < 0) return errno == EINTR ? 0 : -1;
+    if(ret == 0) return 0;
+    ssize_t n = read(c->fd, buf, buf_size);
+    if(n < 0) {
+        if(errno == EAGAIN || errno == EINTR) return 0;
+        ERROR("QMI read failed: %s\n", strerror(errno));
+        return -1;
+    }
+    return n;
+}
+
+static void cdc_wdm_close(void* transport_context) {
+    cdc_wdm_context_t* c = (cdc_wdm_context_t*)transport_context;
+    if(c->fd >= 0) close(c->fd);
+    allocator_free(c);
+}
+
+qmi_transport_t* qmi_transport_cdc_wdm(const char* device_path) {
+    cdc_wdm_context_t* c = allocator_calloc(1, sizeof(cdc_wdm_context_t));
+    if(c == NULL) return NULL;
+    c->fd = open(device_path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(c->fd < 0) {
+        ERROR("Could not open %s: %s\n", device_path, strerror(errno));
+        allocator_free(c);
+        return NULL;
+    }
+    return create_transport(cdc_wdm_write, cdc_wdm_read, cdc_wdm_close, c);
+}
+
+/* replay */
+
+typedef struct replay_frame {
+    char direction;     // '>' host to modem, '<' modem to host
+    size_t len;
+    uint8_t* data;
+} replay_frame_t;
+
+typedef struct replay_context {
+    replay_frame_t* frames;
+    size_t nof_frames;
+    size_t pos;         // next frame to be consumed
+} replay_context_t;
+
+static int parse_hex_line(const char* line, uint8_t* buf, size_t buf_size) {
+    size_t n = 0;
+    while(*line != 0 && *line != '#') {
+        if(isspace((unsigned char)*line)) {
+            line++;
+            continue;
+        }
+        if(!isxdigit((unsigned char)line[0]) || !isxdigit((unsigned char)line[1]) || n >= buf_size) {
+            return -1;
+        }
+        char byte[3] = {line[0], line[1], 0};
+        buf[n++] = (uint8_t)strtoul(byte, NULL, 16);
+        line += 2;
+    }
+    return n;
+}
+
+static int replay_write(void* transport_context, const uint8_t* buf, size_t len) {
+    replay_context_t* c = (replay_context_t*)transport_context;
+    // unread modem frames of the previous exchange are skipped
+    while(c->pos < c->nof_frames && c->frames[c->pos].direction == '<') {
+        c->pos++;
+    }
+    if(c->pos >= c->nof_frames) {
+        ERROR("QMI replay exhausted\n");
+        return -1;
+    }
+    replay_frame_t* expected = &c->frames[c->pos];
+    if(expected->len != len || memcmp(expected->data, buf, len) != 0) {
+        ERROR("QMI replay mismatch at frame %zu\n", c->pos + 1);
+        return -1;
+    }
+    c->pos++;
+    return 0;
+}
+
+static int replay_read(void* transport_context, uint8_t* buf, size_t buf_size, int timeout_ms) {
+    replay_context_t* c = (replay_context_t*)transport_context;
+    (void)timeout_ms;
+    if(c->pos >= c->nof_frames || c->frames[c->pos].direction != '<') {
+        return 0;
+    }
+    replay_frame_t* frame = &c->frames[c->pos++];
+    if(frame->len > buf_size) return -1;
+    memcpy(buf, frame->data, frame->len);
+    return frame->len;
+}
+
+static void replay_close(void* transport_context) {
+    replay_context_t* c = (replay_context_t*)transport_context;
+    for(size_t i = 0; i < c->nof_frames; i++) {
+        allocator_free(c->frames[i].data);
+    }
+    allocator_free(c->frames);
+    allocator_free(c);
+}
+
+qmi_transport_t* qmi_transport_replay(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if(file == NULL) {
+        ERROR("Could not open replay %s: %s\n", filename, strerror(errno));
+        return NULL;
+    }
+    replay_context_t* c = allocator_calloc(1, sizeof(replay_context_t));
+    if(c == NULL) {
+        fclose(file);
+        return NULL;
+    }
+
+    char line[3 * QMI_MESSAGE_MAX_SIZE];
+    uint8_t frame[QMI_MESSAGE_MAX_SIZE];
+    int line_number = 0;
+    while(fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        if(line[0] != '>' && line[0] != '<') continue;
+        int len = parse_hex_line(line + 1, frame, sizeof(frame));
+        if(len <= 0) {
+            ERROR("Invalid frame in %s:%d\n", filename, line_number);
+            continue;
+        }
+        replay_frame_t* frames = allocator_realloc(c->frames, (c->nof_frames + 1) * sizeof(replay_frame_t));
+        if(frames == NULL) break;
+        c->frames = frames;
+        c->frames[c->nof_frames].direction = line[0];
+        c->frames[c->nof_frames].len = len;
+        c->frames[c->nof_frames].data = allocator_malloc(len);
+        if(c->frames[c->nof_frames].data == NULL) break;
+        memcpy(c->frames[c->nof_frames].data, frame, len);
+        c->nof_frames++;
+    }
+    fclose(file);
+    return create_transport(replay_write, replay_read, replay_close, c);
+}
+
+/* recorder */
+
+typedef struct recorder_context {
+    qmi_transport_t* inner;
+    FILE* file;
+} recorder_context_t;
+
+static void record_frame(recorder_context_t* c, char direction, const uint8_t* buf, size_t len) {
+    fputc(direction, c->file);
+    for(size_t i = 0; i < len; i++) {
+        fprintf(c->file, " %02x", buf[i]);
+    }
+    fputc('\n', c->file);
+    fflush(c->file);
+}
+
+static int recorder_write(void* transport_context, const uint8_t* buf, size_t len) {
+    recorder_context_t* c = (recorder_context_t*)transport_context;
+    record_frame(c, '>', buf, len);
+    return c->inner->write(c->inner->context, buf, len);
+}
+
+static int recorder_read(void* transport_context, uint8_t* buf, size_t buf_size, int timeout_ms) {
+    recorder_context_t* c = (recorder_context_t*)transport_context;
+    int n = c->inner->read(c->inner->context, buf, buf_size, timeout_ms);
+    if(n > 0) record_frame(c, '<', buf, n);
+    return n;
+}
+
+static void recorder_close(void* transport_context) {
+    recorder_context_t* c = (recorder_context_t*)transport_context;
+    qmi_transport_destroy(c->inner);
+    if(c->file != NULL) fclose(c->file);
+    allocator_free(c);
+}
+
+qmi_transport_t* qmi_transport_recorder(qmi_transport_t* inner, const char* filename) {
+    if(inner == NULL) return NULL;
+    recorder_context_t* c = allocator_calloc(1, sizeof(recorder_context_t));
+    if(c == NULL) {
+        qmi_transport_destroy(inner);
+        return NULL;
+    }
+    c->inner = inner;
+    c->file = fopen(filename, "a");
+    if(c->file == NULL) {
+        ERROR("Could not open recording %s: %s\n", filename, strerror(errno));
+        recorder_close(c);
+        return NULL;
+    }
+    return create_transport(recorder_write, recorder_read, recorder_close, c);
+}
+
+/*
+ * Device
+ */
+
+typedef struct qmi_client {
+    uint8_t service;
+    uint8_t client_id;
+} qmi_client_t;
+
+struct qmi_device {
+    qmi_transport_t* transport;
+    uint8_t ctl_transaction_id;
+    uint16_t transaction_id;
+    qmi_client_t clients[QMI_MAX_CLIENTS];
+    int nof_clients;
+    qmi_indication_func* indication_handler;
+    void* indication_context;
+};
+
+qmi_device_t* qmi_device_open(qmi_transport_t* transport) {
+    if(transport == NULL) return NULL;
+    qmi_device_t* dev = allocator_calloc(1, sizeof(qmi_device_t));
+    if(dev == NULL) {
+        qmi_transport_destroy(transport);
+        return NULL;
+    }
+    dev->transport = transport;
+    return dev;
+}
+
+void qmi_device_close(qmi_device_t* dev) {
+    if(dev != NULL) {
+        // releasing drops the client from the list, also on failure
+        while(dev->nof_clients > 0) {
+            qmi_client_t client = dev->clients[dev->nof_clients - 1];
+            qmi_device_release_client(dev, client.service, client.client_id);
+        }
+        qmi_transport_destroy(dev->transport);
+        allocator_free(dev);
+    }
+}
+
+void qmi_device_set_indication_handler(qmi_device_t* dev, qmi_indication_func* handler, void* indication_context) {
+    dev->indication_handler = handler;
+    dev->indication_context = indication_context;
+}
+
+static int read_message(qmi_device_t* dev, qmi_message_t* msg, int timeout_ms) {
+    uint8_t buf[QMI_MESSAGE_MAX_SIZE];
+    int n = dev->transport->read(dev->transport->context, buf, sizeof(buf), timeout_ms);
+    if(n <= 0) return n;
+    if(qmi_message_decode(buf, n, msg) != 0) {
+        WARNING("Dropping malformed QMI frame of %d bytes\n", n);
+        return 0;
+    }
+    return 1;
+}
+
+static void dispatch_indication(qmi_device_t* dev, const qmi_message_t* msg) {
+    if(dev->indication_handler != NULL) {
+        dev->indication_handler(dev->indication_context, msg);
+    }
+}
+
+int qmi_device_request(qmi_device_t* dev, qmi_message_t* request, qmi_message_t* response, int timeout_ms) {
+    uint8_t buf[QMI_MESSAGE_MAX_SIZE];
+    if(dev == NULL) return -1;
+
+    request->type = QMI_MESSAGE_REQUEST;
+    if(request->service == QMI_SERVICE_CTL) {
+        if(++dev->ctl_transaction_id == 0) dev->ctl_transaction_id = 1;
+        request->transaction_id = dev->ctl_transaction_id;
+    }
+    else {
+        if(++dev->transaction_id == 0) dev->transaction_id = 1;
+        request->transaction_id = dev->transaction_id;
+    }
+
+    int len = qmi_message_encode(request, buf, sizeof(buf));
+    if(len < 0 || dev->transport->write(dev->transport->context, buf, len) != 0) {
+        return -1;
+    }
+    DEBUG("QMI request service 0x%02x message 0x%04x\n", request->service, request->message_id);
+
+    // frames are delivered by the modem without delay, so the timeout applies per frame
+    while(1) {
+        int ret = read_message(dev, response, timeout_ms);
+        if(ret < 0) return -1;
+        if(ret == 0) {
+            WARNING("QMI request 0x%04x timed out\n", request->message_id);
+            return -1;
+        }
+        if(response->type == QMI_MESSAGE_INDICATION) {
+            dispatch_indication(dev, response);
+            continue;
+        }
+        if(response->type == QMI_MESSAGE_RESPONSE &&
+           response->service == request->service &&
+           response->client_id == request->client_id &&
+           response->transaction_id == request->transaction_id) {
+            return 0;
+        }
+        DEBUG("Ignoring unrelated QMI message 0x%04x\n", response->message_id);
+    }
+}
+
+int qmi_device_poll(qmi_device_t* dev, int timeout_ms) {
+    qmi_message_t msg;
+    int ret;
+    int nof_indications = 0;
+    if(dev == NULL) return -1;
+    // only the first frame is waited for, the rest is what the modem already sent
+    while((ret = read_message(dev, &msg, timeout_ms)) > 0) {
+        if(msg.type == QMI_MESSAGE_INDICATION) {
+            dispatch_indication(dev, &msg);
+            nof_indications++;
+        }
+        timeout_ms = 0;
+    }
+    return ret < 0 ? -1 : nof_indications;
+}
+
+int qmi_device_allocate_client(qmi_device_t* dev, uint8_t service) {
+    qmi_message_t request, response;
+    if(dev == NULL || dev->nof_clients >= QMI_MAX_CLIENTS) return -1;
+
+    qmi_message_init(&request, QMI_SERVICE_CTL, 0, QMI_CTL_ALLOCATE_CID);
+    qmi_message_add_tlv_u8(&request, 0x01, service);
+    if(qmi_device_request(dev, &request, &response, QMI_DEFAULT_TIMEOUT_MS) != 0) {
+        return -1;
+    }
+    int error = qmi_message_get_error(&response);
+    uint16_t len;
+    const uint8_t* allocation = qmi_message_find_tlv(&response, 0x01, &len);
+    if(error != 0 || allocation == NULL || len < 2 || allocation[0] != service) {
+        ERROR("Could not allocate QMI client for service 0x%02x (error %d)\n", service, error);
+        return -1;
+    }
+
+    dev->clients[dev->nof_clients].service = service;
+    dev->clients[dev->nof_clients].client_id = allocation[1];
+    dev->nof_clients++;
+    DEBUG("Allocated QMI client %d for service 0x%02x\n", allocation[1], service);
+    return allocation[1];
+}
+
+int qmi_device_release_client(qmi_device_t* dev, uint8_t service, uint8_t client_id) {
+    qmi_message_t request, response;
+    if(dev == NULL) return -1;
+
+    for(int i = 0; i < dev->nof_clients; i++) {
+        if(dev->clients[i].service == service && dev->clients[i].client_id == client_id) {
+            dev->clients[i] = dev->clients[dev->nof_clients - 1];
+            dev->nof_clients--;
+            break;
+        }
+    }
+
+    uint8_t value[2] = {service, client_id};
+    qmi_message_init(&request, QMI_SERVICE_CTL, 0, QMI_CTL_RELEASE_CID);
+    qmi_message_add_tlv(&request, 0x01, sizeof(value), value);
+    if(qmi_device_request(dev, &request, &response, QMI_DEFAULT_TIMEOUT_MS) != 0 ||
+       qmi_message_get_error(&response) != 0) {
+        WARNING("Could not release QMI client %d\n", client_id);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,725 @@
+/*
+ *
+ *
+ *
+ *
+ *   Copyright (C) 2018 Robert Falkenberg <robert.falkenberg@tu-dortmund.de>
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cmnalib/qmi_sierra_wireless_mc7455.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE QMI
+#include "cmnalib/logger.h"
+
+#define QMI_NAS_RADIO_IF_LTE 0x08
+
+#define QMI_LOC_EVENT_POSITION_REPORT 0x01
+#define QMI_LOC_SESSION_ID 1
+#define QMI_LOC_RECURRENCE_PERIODIC 1
+#define QMI_LOC_SESSION_STATUS_SUCCESS 0
+
+/* the same factor is used by sw_mc7455_gps_raw_to_double() */
+#define RAW_GPS_PER_DEGREE (1.0 / sw_mc7455_gps_raw_to_double(1))
+
+struct qmi_mc7455 {
+    qmi_device_t* dev;
+    int nas_client;
+    int loc_client;     // allocated by qmi_mc7455_start_gps()
+    int has_fix;
+    sw_mc7455_gpsloc_response_t fix;
+    meas_stream_t* stream;  // set by qmi_mc7455_subscribe()
+};
+
+/* bounded reader for TLV values, reads past the end yield 0 and set error */
+
+typedef struct tlv_reader {
+    const uint8_t* p;
+    uint16_t left;
+    int error;
+} tlv_reader_t;
+
+static const uint8_t* reader_take(tlv_reader_t* r, uint16_t n) {
+    if(r->error || r->left < n) {
+        r->error = 1;
+        return NULL;
+    }
+    const uint8_t* p = r->p;
+    r->p += n;
+    r->left -= n;
+    return p;
+}
+
+static uint8_t read_u8(tlv_reader_t* r) {
+    const uint8_t* p = reader_take(r, 1);
+    return p != NULL ? p[0] : 0;
+}
+
+static uint16_t read_u16(tlv_reader_t* r) {
+    const uint8_t* p = reader_take(r, 2);
+    return p != NULL ? qmi_le16(p) : 0;
+}
+
+static uint32_t read_u32(tlv_reader_t* r) {
+    const uint8_t* p = reader_take(r, 4);
+    return p != NULL ? qmi_le32(p) : 0;
+}
+
+static float tlv_float(const uint8_t* p) {
+    uint32_t bits = qmi_le32(p);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static double tlv_double(const uint8_t* p) {
+    uint64_t bits = (uint64_t)qmi_le32(p) | ((uint64_t)qmi_le32(p + 4) << 32);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief nas_band_to_lte_band Map the QMI NAS active band enumeration
+ * to the E-UTRA operating band number.
+ * @return band number or 0 if the value is no (known) LTE band
+ */
+static int nas_band_to_lte_band(uint16_t nas_band) {
+    if(nas_band >= 120 && nas_band <= 133) return nas_band - 119;
+    if(nas_band >= 135 && nas_band <= 142) return nas_band - 102;
+    switch(nas_band) {
+    case 134: return 17;
+    case 143: return 18;
+    case 144: return 19;
+    case 145: return 20;
+    case 146: return 21;
+    case 147: return 24;
+    case 148: return 25;
+    case 149: return 41;
+    case 150: return 42;
+    case 151: return 43;
+    case 152: return 23;
+    case 153: return 26;
+    case 154: return 32;
+    case 158: return 28;
+    case 159: return 29;
+    case 160: return 30;
+    case 161: return 66;
+    default: return 0;
+    }
+}
+
+static int nas_bandwidth_to_MHz(uint32_t bandwidth) {
+    static const int MHz[] = {1, 3, 5, 10, 15, 20};  // 1.4 MHz is reported as 1 like AT!GSTATUS
+    return bandwidth < sizeof(MHz) / sizeof(MHz[0]) ? MHz[bandwidth] : 0;
+}
+
+/**
+ * @brief nas_request Send a NAS request and check the QMI result.
+ * @return SW_RESPONSE_SUCCESS, SW_RESPONSE_FAILED if the modem reported
+ * an error (e.g. no service), SW_RESPONSE_ERROR if no response arrived
+ */
+static sw_response_t nas_request(qmi_mc7455_t* h, qmi_message_t* request, qmi_message_t* response) {
+    if(qmi_device_request(h->dev, request, response, QMI_DEFAULT_TIMEOUT_MS) != 0) {
+        ERROR("QMI NAS request 0x%04x failed\n", request->message_id);
+        return SW_RESPONSE_ERROR;
+    }
+    int error = qmi_message_get_error(response);
+    if(error != 0) {
+        DEBUG("QMI NAS request 0x%04x returned error %d\n", request->message_id, error);
+        return SW_RESPONSE_FAILED;
+    }
+    return SW_RESPONSE_SUCCESS;
+}
+
+static void position_report(qmi_mc7455_t* h, const qmi_message_t* indication) {
+    uint16_t len;
+    const uint8_t* value;
+
+    value = qmi_message_find_tlv(indication, 0x01, &len);
+    if(value == NULL || len < 4 || qmi_le32(value) != QMI_LOC_SESSION_STATUS_SUCCESS) {
+        DEBUG("QMI position report without fix\n");
+        return;
+    }
+    const uint8_t* latitude = qmi_message_find_tlv(indication, 0x10, &len);
+    if(latitude == NULL || len < 8) return;
+    const uint8_t* longitude = qmi_message_find_tlv(indication, 0x11, &len);
+    if(longitude == NULL || len < 8) return;
+
+    sw_mc7455_gpsloc_response_t fix = {0};
+    fix.latitude = tlv_double(latitude);
+    fix.longitude = tlv_double(longitude);
+    fix._raw_latitude = (int)lround(fix.latitude * RAW_GPS_PER_DEGREE);
+    fix._raw_longitude = (int)lround(fix.longitude * RAW_GPS_PER_DEGREE);
+
+    static const struct {
+        uint8_t type;
+        size_t offset;
+    } float_fields[] = {
+        {0x12, offsetof(sw_mc7455_gpsloc_response_t, hepe)},
+        {0x13, offsetof(sw_mc7455_gpsloc_response_t, loc_unc_p)},
+        {0x14, offsetof(sw_mc7455_gpsloc_response_t, loc_unc_a)},
+        {0x15, offsetof(sw_mc7455_gpsloc_response_t, loc_unc_angle)},
+        {0x18, offsetof(sw_mc7455_gpsloc_response_t, velocity_h)},
+        {0x1B, offsetof(sw_mc7455_gpsloc_response_t, loc_unc_ve)},
+        {0x1E, offsetof(sw_mc7455_gpsloc_response_t, velocity_v)},
+        {0x1F, offsetof(sw_mc7455_gpsloc_response_t, heading)},
+    };
+    for(size_t i = 0; i < sizeof(float_fields) / sizeof(float_fields[0]); i++) {
+        value = qmi_message_find_tlv(indication, float_fields[i].type, &len);
+        if(value != NULL && len >= 4) {
+            *(float*)((char*)&fix + float_fields[i].offset) = tlv_float(value);
+        }
+    }
+    value = qmi_message_find_tlv(indication, 0x1A, &len);
+    if(value != NULL && len >= 4) {
+        fix.altitude = (int)lroundf(tlv_float(value));
+    }
+
+    h->fix = fix;
+    h->has_fix = 1;
+
+    if(h->stream != NULL) {
+        meas_sample_t sample;
+        meas_sample_init(&sample, MEAS_SOURCE_INDICATION);
+        sample.latitude = fix.latitude;
+        sample.longitude = fix.longitude;
+        sample.altitude = fix.altitude;
+        sample.valid = MEAS_FIELD_BIT(MEAS_FIELD_POSITION);
+        meas_stream_push(h->stream, &sample);
+    }
+}
+
+static void signal_info(qmi_mc7455_t* h, const qmi_message_t* indication) {
+    uint16_t len;
+    const uint8_t* value = qmi_message_find_tlv(indication, 0x14, &len);
+    if(value == NULL || h->stream == NULL) return;
+
+    tlv_reader_t r = {value, len, 0};
+    int8_t rssi = (int8_t)read_u8(&r);
+    int8_t rsrq = (int8_t)read_u8(&r);
+    int16_t rsrp = (int16_t)read_u16(&r);
+    int16_t snr = (int16_t)read_u16(&r);
+    if(r.error) {
+        WARNING("Malformed LTE signal info indication\n");
+        return;
+    }
+
+    meas_sample_t sample;
+    meas_sample_init(&sample, MEAS_SOURCE_INDICATION);
+    sample.rssi = rssi;
+    sample.rsrq = rsrq;
+    sample.rsrp = rsrp;
+    sample.sinr = snr / 10.0f;
+    sample.valid = MEAS_FIELD_BIT(MEAS_FIELD_RSSI) | MEAS_FIELD_BIT(MEAS_FIELD_RSRQ) |
+                   MEAS_FIELD_BIT(MEAS_FIELD_RSRP) | MEAS_FIELD_BIT(MEAS_FIELD_SINR);
+    if(meas_stream_push(h->stream, &sample) > 0) {
+        DEBUG("Measurement stream full, dropped oldest sample\n");
+    }
+}
+
+static void handle_indication(void* indication_context, const qmi_message_t* indication) {
+    qmi_mc7455_t* h = (qmi_mc7455_t*)indication_context;
+
+    if(indication->service == QMI_SERVICE_LOC && indication->message_id == QMI_LOC_POSITION_REPORT) {
+        position_report(h, indication);
+    }
+    else if(indication->service == QMI_SERVICE_NAS && indication->message_id == QMI_NAS_SIGNAL_INFO) {
+        signal_info(h, indication);
+    }
+}
+
+qmi_mc7455_t* qmi_mc7455_init_transport(qmi_transport_t* transport) {
+    qmi_mc7455_t* h = allocator_calloc(1, sizeof(qmi_mc7455_t));
+    if(h == NULL) {
+        ERROR("ERROR in calloc\n");
+        qmi_transport_destroy(transport);
+        return NULL;
+    }
+    h->dev = qmi_device_open(transport);
+    if(h->dev == NULL) {
+        ERROR("Could not open QMI device\n");
+        allocator_free(h);
+        return NULL;
+    }
+    h->loc_client = -1;
+    h->nas_client = qmi_device_allocate_client(h->dev, QMI_SERVICE_NAS);
+    if(h->nas_client < 0) {
+        qmi_mc7455_destroy(h);
+        return NULL;
+    }
+    qmi_device_set_indication_handler(h->dev, handle_indication, h);
+    return h;
+}
+
+qmi_mc7455_t* qmi_mc7455_init(const char* cdc_wdm_path) {
+    qmi_transport_t* transport = qmi_transport_cdc_wdm(cdc_wdm_path);
+    if(transport == NULL) {
+        return NULL;
+    }
+    return qmi_mc7455_init_transport(transport);
+}
+
+void qmi_mc7455_destroy(qmi_mc7455_t* h) {
+    if(h != NULL) {
+        qmi_device_close(h->dev);
+        allocator_free(h);
+    }
+}
+
+static void parse_rx_chain(const qmi_message_t* response, uint8_t type, int* rssi, int* rsrp) {
+    uint16_t len;
+    const uint8_t* value = qmi_message_find_tlv(response, type, &len);
+    if(value == NULL) return;
+    tlv_reader_t r = {value, len, 0};
+    uint8_t is_tuned = read_u8(&r);
+    int32_t rx_power = (int32_t)read_u32(&r);
+    read_u32(&r);   // ecio
+    read_u32(&r);   // rscp
+    int32_t chain_rsrp = (int32_t)read_u32(&r);
+    if(!r.error && is_tuned) {
+        *rssi = rx_power / 10;
+        *rsrp = chain_rsrp / 10;
+    }
+}
+
+sw_response_t qmi_mc7455_get_status(qmi_mc7455_t* h, sw_mc7455_gstatus_response_t** result) {
+    *result = sw_mc7455_allocate_status();
+    if(*result == NULL) {
+        ERROR("ERROR in calloc\n");
+        return SW_RESPONSE_OUT_OF_MEMORY;
+    }
+    sw_response_t ret = qmi_mc7455_get_status_into(h, *result);
+    if(ret >= SW_RESPONSE_CRITICAL) {
+        sw_mc7455_free_status(*result);
+        *result = NULL;
+    }
+    return ret;
+}
+
+sw_response_t qmi_mc7455_get_status_into(qmi_mc7455_t* h, sw_mc7455_gstatus_response_t* s) {
+    qmi_message_t request, response;
+    sw_response_t ret;
+    uint16_t len;
+    const uint8_t* value;
+
+    if(h == NULL || h->dev == NULL || s == NULL) {
+        ERROR("Incomplete handle\n");
+        return SW_RESPONSE_INVAL;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->tx_power = SW_GSTATUS_TX_POWER_INACTIVE;
+
+    /* LTE signal: rsrq and snr */
+    qmi_message_init(&request, QMI_SERVICE_NAS, h->nas_client, QMI_NAS_GET_SIGNAL_INFO);
+    ret = nas_request(h, &request, &response);
+    if(ret == SW_RESPONSE_ERROR) goto error;
+    if(ret == SW_RESPONSE_SUCCESS && (value = qmi_message_find_tlv(&response, 0x14, &len)) != NULL) {
+        tlv_reader_t r = {value, len, 0};
+        read_u8(&r);    // rssi, the per chain value below is more precise
+        int8_t rsrq = (int8_t)read_u8(&r);
+        read_u16(&r);   // rsrp
+        int16_t snr = (int16_t)read_u16(&r);
+        if(!r.error) {
+            s->rsrq = rsrq;
+            s->sinr = snr / 10.0f;
+        }
+    }
+
+    /* per antenna rx levels and tx power */
+    qmi_message_init(&request, QMI_SERVICE_NAS, h->nas_client, QMI_NAS_GET_TX_RX_INFO);
+    qmi_message_add_tlv_u8(&request, 0x01, QMI_NAS_RADIO_IF_LTE);
+    ret = nas_request(h, &request, &response);
+    if(ret == SW_RESPONSE_ERROR) goto error;
+    if(ret == SW_RESPONSE_SUCCESS) {
+        parse_rx_chain(&response, 0x10, &s->pcc_rxm_rssi, &s->pcc_rxm_rsrp);
+        parse_rx_chain(&response, 0x11, &s->pcc_rxd_rssi, &s->pcc_rxd_rsrp);
+        if((value = qmi_message_find_tlv(&response, 0x12, &len)) != NULL) {
+            tlv_reader_t r = {value, len, 0};
+            uint8_t is_in_traffic = read_u8(&r);
+            int32_t tx_power = (int32_t)read_u32(&r);
+            if(!r.error && is_in_traffic) {
+                s->tx_power = tx_power / 10;
+            }
+        }
+    }
+
+    /* band, channel and bandwidth */
+    qmi_message_init(&request, QMI_SERVICE_NAS, h->nas_client, QMI_NAS_GET_RF_BAND_INFO);
+    ret = nas_request(h, &request, &response);
+    if(ret == SW_RESPONSE_ERROR) goto error;
+    if(ret == SW_RESPONSE_SUCCESS && (value = qmi_message_find_tlv(&response, 0x01, &len)) != NULL) {
+        tlv_reader_t r = {value, len, 0};
+        uint8_t n = read_u8(&r);
+        for(int i = 0; i < n && !r.error; i++) {
+            uint8_t radio_if = read_u8(&r);
+            uint16_t band = read_u16(&r);
+            uint16_t channel = read_u16(&r);
+            if(!r.error && radio_if == QMI_NAS_RADIO_IF_LTE) {
+                s->lte_band = nas_band_to_lte_band(band);
+                s->lte_rx_chan = channel;
+                snprintf(s->system_mode, sizeof(s->system_mode), "LTE");
+            }
+        }
+        if((value = qmi_message_find_tlv(&response, 0x12, &len)) != NULL) {
+            tlv_reader_t b = {value, len, 0};
+            n = read_u8(&b);
+            for(int i = 0; i < n && !b.error; i++) {
+                uint8_t radio_if = read_u8(&b);
+                uint32_t bandwidth = read_u32(&b);
+                if(!b.error && radio_if == QMI_NAS_RADIO_IF_LTE) {
+                    s->lte_bw_MHz = nas_bandwidth_to_MHz(bandwidth);
+                }
+            }
+        }
+    }
+
+    /* serving cell identity */
+    qmi_message_init(&request, QMI_SERVICE_NAS, h->nas_client, QMI_NAS_GET_CELL_LOCATION);
+    ret = nas_request(h, &request, &response);
+    if(ret == SW_RESPONSE_ERROR) goto error;
+    if(ret == SW_RESPONSE_SUCCESS && (value = qmi_message_find_tlv(&response, 0x13, &len)) != NULL) {
+        tlv_reader_t r = {value, len, 0};
+        read_u8(&r);            // ue in idle
+        reader_take(&r, 3);     // plmn
+        uint16_t tac = read_u16(&r);
+        uint32_t cell_id = read_u32(&r);
+        if(!r.error) {
+            s->tac = tac;
+            s->cell_id = cell_id;
+        }
+    }
+
+    return SW_RESPONSE_SUCCESS;
+
+error:
+    return SW_RESPONSE_ERROR;
+}
+
+static void decode_plmn(const uint8_t* plmn, int* mcc, int* mnc) {
+    int mcc1 = plmn[0] & 0x0f, mcc2 = plmn[0] >> 4, mcc3 = plmn[1] & 0x0f;
+    int mnc1 = plmn[2] & 0x0f, mnc2 = plmn[2] >> 4, mnc3 = plmn[1] >> 4;
+    *mcc = mcc1 * 100 + mcc2 * 10 + mcc3;
+    *mnc = mnc3 == 0x0f ? mnc1 * 10 + mnc2 : mnc1 * 100 + mnc2 * 10 + mnc3;
+}
+
+typedef struct lte_cell {
+    int pci;
+    float rsrq;
+    float rsrp;
+    float rssi;
+    int rxlv;
+} lte_cell_t;
+
+static void read_lte_cell(tlv_reader_t* r, lte_cell_t* cell) {
+    cell->pci = read_u16(r);
+    cell->rsrq = (int16_t)read_u16(r) / 10.0f;
+    cell->rsrp = (int16_t)read_u16(r) / 10.0f;
+    cell->rssi = (int16_t)read_u16(r) / 10.0f;
+    cell->rxlv = (int16_t)read_u16(r);
+}
+
+/* grows a neighbour buffer of a reused result to hold at least n entries */
+static int reserve_neighbours(void** buffer, int* capacity, int n, size_t size) {
+    if(n <= *capacity) return 0;
+    void* grown = allocator_realloc(*buffer, n * size);
+    if(grown == NULL) {
+        ERROR("Error in realloc\n");
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = n;
+    return 0;
+}
+
+static sw_response_t parse_intrafreq(const uint8_t* value, uint16_t len, sw_mc7455_lteinfo_response_t* s) {
+    tlv_reader_t r = {value, len, 0};
+    read_u8(&r);    // ue in idle
+    const uint8_t* plmn = reader_take(&r, 3);
+    s->tac = read_u16(&r);
+    s->cid = read_u32(&r);
+    s->earfn = read_u16(&r);
+    uint16_t serving_pci = read_u16(&r);
+    reader_take(&r, 4); // reselection priority and search thresholds
+    uint8_t nof_cells = read_u8(&r);
+    if(r.error) return SW_RESPONSE_ERROR;
+    decode_plmn(plmn, &s->mcc, &s->mnc);
+    s->pci = serving_pci;
+
+    if(reserve_neighbours((void**)&s->intrafreq_neighbours, &s->_intrafreq_capacity,
+                          nof_cells, sizeof(sw_mc7455_lteinfo_intrafreq_neighbour_t)) != 0) {
+        return SW_RESPONSE_OUT_OF_MEMORY;
+    }
+    for(int i = 0; i < nof_cells; i++) {
+        lte_cell_t cell;
+        read_lte_cell(&r, &cell);
+        if(r.error) return SW_RESPONSE_ERROR;
+        if(cell.pci == serving_pci) {
+            s->rsrq = cell.rsrq;
+            s->rsrp = cell.rsrp;
+            s->rssi = cell.rssi;
+            s->rxlv = cell.rxlv;
+            continue;
+        }
+        sw_mc7455_lteinfo_intrafreq_neighbour_t* n = &s->intrafreq_neighbours[s->nof_intrafreq_neighbours++];
+        n->pci = cell.pci;
+        n->rsrq = cell.rsrq;
+        n->rsrp = cell.rsrp;
+        n->rssi = cell.rssi;
+        n->rxlv = cell.rxlv;
+    }
+    return SW_RESPONSE_SUCCESS;
+}
+
+static sw_response_t parse_interfreq(const uint8_t* value, uint16_t len, sw_mc7455_lteinfo_response_t* s) {
+    tlv_reader_t r = {value, len, 0};
+    read_u8(&r);    // ue in idle
+    uint8_t nof_freqs = read_u8(&r);
+    for(int f = 0; f < nof_freqs; f++) {
+        uint16_t earfcn = read_u16(&r);
+        uint8_t threshold_low = read_u8(&r);
+        uint8_t threshold_high = read_u8(&r);
+        uint8_t priority = read_u8(&r);
+        uint8_t nof_cells = read_u8(&r);
+        if(r.error) return SW_RESPONSE_ERROR;
+        if(nof_cells == 0) continue;
+
+        if(reserve_neighbours((void**)&s->interfreq_neighbours, &s->_interfreq_capacity,
+                              s->nof_interfreq_neighbours + nof_cells, sizeof(sw_mc7455_lteinfo_interfreq_neighbour_t)) != 0) {
+            return SW_RESPONSE_OUT_OF_MEMORY;
+        }
+        for(int i = 0; i < nof_cells; i++) {
+            lte_cell_t cell;
+            read_lte_cell(&r, &cell);
+            if(r.error) return SW_RESPONSE_ERROR;
+            sw_mc7455_lteinfo_interfreq_neighbour_t* n = &s->interfreq_neighbours[s->nof_interfreq_neighbours++];
+            n->earfcn = earfcn;
+            n->threshold_low = threshold_low;
+            n->threshold_high = threshold_high;
+            n->priority = priority;
+            n->pci = cell.pci;
+            n->rsrq = cell.rsrq;
+            n->rsrp = cell.rsrp;
+            n->rssi = cell.rssi;
+            n->rxlv = cell.rxlv;
+        }
+    }
+    return SW_RESPONSE_SUCCESS;
+}
+
+sw_response_t qmi_mc7455_get_lteinfo(qmi_mc7455_t* h, sw_mc7455_lteinfo_response_t** result) {
+    *result = sw_mc7455_allocate_lteinfo();
+    if(*result == NULL) {
+        ERROR("ERROR in calloc\n");
+        return SW_RESPONSE_OUT_OF_MEMORY;
+    }
+    sw_response_t ret = qmi_mc7455_get_lteinfo_into(h, *result);
+    if(ret != SW_RESPONSE_SUCCESS) {
+        sw_mc7455_free_lteinfo(*result);
+        *result = NULL;
+    }
+    return ret;
+}
+
+sw_response_t qmi_mc7455_get_lteinfo_into(qmi_mc7455_t* h, sw_mc7455_lteinfo_response_t* result) {
+    qmi_message_t request, response;
+    sw_response_t ret;
+    uint16_t len;
+    const uint8_t* value;
+
+    if(h == NULL || h->dev == NULL || result == NULL) {
+        ERROR("Incomplete handle\n");
+        return SW_RESPONSE_INVAL;
+    }
+
+    sw_mc7455_clear_lteinfo(result);
+
+    qmi_message_init(&request, QMI_SERVICE_NAS, h->nas_client, QMI_NAS_GET_CELL_LOCATION);
+    ret = nas_request(h, &request, &response);
+    if(ret != SW_RESPONSE_SUCCESS) {
+        ERROR("Could not query LTE cell information\n");
+        goto error;
+    }
+
+    value = qmi_message_find_tlv(&response, 0x13, &len);
+    if(value == NULL) {
+        ERROR("No LTE serving cell reported\n");
+        ret = SW_RESPONSE_FAILED;
+        goto error;
+    }
+    ret = parse_intrafreq(value, len, result);
+    if(ret != SW_RESPONSE_SUCCESS) {
+        ERROR("Malformed LTE intrafrequency information\n");
+        goto error;
+    }
+    value = qmi_message_find_tlv(&response, 0x14, &len);
+    if(value != NULL && (ret = parse_interfreq(value, len, result)) != SW_RESPONSE_SUCCESS) {
+        ERROR("Malformed LTE interfrequency information\n");
+        goto error;
+    }
+    return SW_RESPONSE_SUCCESS;
+
+error:
+    // no partial neighbour lists
+    result->nof_intrafreq_neighbours = 0;
+    result->nof_interfreq_neighbours = 0;
+    return ret;
+}
+
+static sw_response_t loc_request(qmi_mc7455_t* h, qmi_message_t* request) {
+    qmi_message_t response;
+    if(qmi_device_request(h->dev, request, &response, QMI_DEFAULT_TIMEOUT_MS) != 0) {
+        ERROR("QMI LOC request 0x%04x failed\n", request->message_id);
+        return SW_RESPONSE_ERROR;
+    }
+    if(qmi_message_get_error(&response) != 0) {
+        ERROR("QMI LOC request 0x%04x returned error %d\n", request->message_id, qmi_message_get_error(&response));
+        return SW_RESPONSE_FAILED;
+    }
+    return SW_RESPONSE_SUCCESS;
+}
+
+sw_response_t qmi_mc7455_start_gps(qmi_mc7455_t* h) {
+    qmi_message_t request;
+    sw_response_t ret;
+
+    if(h == NULL || h->dev == NULL) {
+        ERROR("Incomplete handle\n");
+        return SW_RESPONSE_INVAL;
+    }
+    if(h->loc_client < 0) {
+        h->loc_client = qmi_device_allocate_client(h->dev, QMI_SERVICE_LOC);
+        if(h->loc_client < 0) return SW_RESPONSE_ERROR;
+    }
+
+    uint8_t event_mask[8] = {QMI_LOC_EVENT_POSITION_REPORT};
+    qmi_message_init(&request, QMI_SERVICE_LOC, h->loc_client, QMI_LOC_REGISTER_EVENTS);
+    qmi_message_add_tlv(&request, 0x01, sizeof(event_mask), event_mask);
+    if((ret = loc_request(h, &request)) != SW_RESPONSE_SUCCESS) return ret;
+
+    qmi_message_init(&request, QMI_SERVICE_LOC, h->loc_client, QMI_LOC_START);
+    qmi_message_add_tlv_u8(&request, 0x01, QMI_LOC_SESSION_ID);
+    qmi_message_add_tlv_u32(&request, 0x10, QMI_LOC_RECURRENCE_PERIODIC);
+    return loc_request(h, &request);
+}
+
+sw_response_t qmi_mc7455_stop_gps(qmi_mc7455_t* h) {
+    qmi_message_t request;
+
+    if(h == NULL || h->dev == NULL || h->loc_client < 0) {
+        ERROR("GPS not started\n");
+        return SW_RESPONSE_INVAL;
+    }
+    qmi_message_init(&request, QMI_SERVICE_LOC, h->loc_client, QMI_LOC_STOP);
+    qmi_message_add_tlv_u8(&request, 0x01, QMI_LOC_SESSION_ID);
+    h->has_fix = 0;
+    return loc_request(h, &request);
+}
+
+sw_response_t qmi_mc7455_get_gpsloc(qmi_mc7455_t* h, sw_mc7455_gpsloc_response_t** result) {
+    *result = sw_mc7455_allocate_gpsloc();
+    if(*result == NULL) {
+        ERROR("ERROR in calloc\n");
+        return SW_RESPONSE_OUT_OF_MEMORY;
+    }
+    sw_response_t ret = qmi_mc7455_get_gpsloc_into(h, *result);
+    if(ret >= SW_RESPONSE_CRITICAL) {
+        sw_mc7455_free_get_gpsloc(*result);
+        *result = NULL;
+    }
+    return ret;
+}
+
+sw_response_t qmi_mc7455_get_gpsloc_into(qmi_mc7455_t* h, sw_mc7455_gpsloc_response_t* result) {
+    if(h == NULL || h->dev == NULL || result == NULL) {
+        ERROR("Incomplete handle\n");
+        return SW_RESPONSE_INVAL;
+    }
+
+    // position reports arrive as indications, take whatever is pending
+    if(qmi_device_poll(h->dev, 0) < 0) {
+        return SW_RESPONSE_ERROR;
+    }
+    if(h->has_fix) {
+        *result = h->fix;
+    }
+    else {
+        memset(result, 0, sizeof(*result));
+        result->is_invalid = 1;
+    }
+    return SW_RESPONSE_SUCCESS;
+}
+
+/* threshold list TLV: count followed by little endian values of the given width, scaled to modem units */
+static int add_threshold_tlv(qmi_message_t* request, uint8_t type, const float* thresholds, int n, int width, float scale) {
+    uint8_t value[1 + QMI_MC7455_MAX_THRESHOLDS * 2];
+    if(n <= 0) return 0;
+    if(n > QMI_MC7455_MAX_THRESHOLDS) {
+        ERROR("Too many thresholds (%d)\n", n);
+        return -1;
+    }
+    value[0] = n;
+    for(int i = 0; i < n; i++) {
+        int16_t v = (int16_t)lroundf(thresholds[i] * scale);
+        value[1 + i * width] = v & 0xff;
+        if(width == 2) value[2 + i * width] = (v >> 8) & 0xff;
+    }
+    return qmi_message_add_tlv(request, type, 1 + n * width, value);
+}
+
+static sw_response_t register_signal_indications(qmi_mc7455_t* h, uint8_t enable) {
+    qmi_message_t request, response;
+    qmi_message_init(&request, QMI_SERVICE_NAS, h->nas_client, QMI_NAS_REGISTER_INDICATIONS);
+    qmi_message_add_tlv_u8(&request, 0x19, enable);
+    return nas_request(h, &request, &response);
+}
+
+sw_response_t qmi_mc7455_subscribe(qmi_mc7455_t* h, const qmi_mc7455_signal_thresholds_t* thresholds, meas_stream_t* stream) {
+    qmi_message_t request, response;
+    sw_response_t ret;
+
+    if(h == NULL || h->dev == NULL || stream == NULL) {
+        ERROR("Incomplete handle\n");
+        return SW_RESPONSE_INVAL;
+    }
+
+    if(thresholds != NULL) {
+        qmi_message_init(&request, QMI_SERVICE_NAS, h->nas_client, QMI_NAS_CONFIG_SIGNAL_INFO);
+        if(add_threshold_tlv(&request, 0x13, thresholds->snr, thresholds->nof_snr, 2, 10.0f) != 0 ||
+           add_threshold_tlv(&request, 0x15, thresholds->rsrq, thresholds->nof_rsrq, 1, 1.0f) != 0 ||
+           add_threshold_tlv(&request, 0x16, thresholds->rsrp, thresholds->nof_rsrp, 2, 1.0f) != 0) {
+            return SW_RESPONSE_INVAL;
+        }
+        if((ret = nas_request(h, &request, &response)) != SW_RESPONSE_SUCCESS) {
+            ERROR("Could not configure signal thresholds\n");
+            return ret;
+        }
+    }
+
+    if((ret = register_signal_indications(h, 1)) != SW_RESPONSE_SUCCESS) {
+        ERROR("Could not register signal indications\n");
+        return ret;
+    }
+    h->stream = stream;
+    return SW_RESPONSE_SUCCESS;
+}
+
+sw_response_t qmi_mc7455_unsubscribe(qmi_mc7455_t* h) {
+    if(h == NULL || h->dev == NULL) {
+        ERROR("Incomplete handle\n");
+        return SW_RESPONSE_INVAL;
+    }
+    h->stream = NULL;
+    return register_signal_indications(h, 0);
+}
+
+int qmi_mc7455_process_indications(qmi_mc7455_t* h, int timeout_ms) {
+    if(h == NULL || h->dev == NULL) return -1;
+    return qmi_device_poll(h->dev, timeout_ms);
+}
@@ -1,6 +1,11 @@
+#include <stdlib.h>
+#include <string.h>
+
 #include <curl/curl.h>
 
 #include "cmnalib/traffic_curl.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE TRAFFIC
 #include "cmnalib/logger.h"
 
 #include "cmnalib/traffic_types.h"
@@ -21,6 +26,13 @@ struct xferinfo_callback_data
     CURL *curl;
 };
 
+struct tc_session
+{
+    CURL *curl;
+    char* interface;
+    int flags;
+};
+
 static size_t discard_silently_callback(void *ptr,
                                         size_t size,
                                         size_t n_memb,
@@ -104,7 +116,9 @@ int xferinfo(void *userdata,
 //                  "\r\n",
 //                  ulnow, ultotal, dlnow, dltotal);
             if(callbackdata->callback != NULL) {
-                transfer_statusreport_t statusreport;
+                transfer_statusreport_t statusreport = {0};
+                statusreport.total_transfer_time = curtime;
+                statusreport.total_transfered_bytes = (size_t)(dlnow + ulnow);
                 statusreport.datarate_dl = dl_delta/timeinterval;
                 statusreport.datarate_ul = ul_delta/timeinterval;
                 return callbackdata->callback(callbackdata->callback_context, &statusreport); // provide datarate
@@ -118,6 +132,61 @@ int xferinfo(void *userdata,
     return 0;
 }
 
+tc_session_t* tc_session_init(const char* interface, int flags) {
+    tc_session_t* s = allocator_calloc(1, sizeof(tc_session_t));
+    if(s == NULL) {
+        ERROR("Error in calloc\n");
+        return NULL;
+    }
+    s->curl = curl_easy_init();
+    if(s->curl == NULL) {
+        ERROR("curl_easy_init() failed\n");
+        allocator_free(s);
+        return NULL;
+    }
+    if(interface != NULL) {
+        s->interface = allocator_strdup(interface);
+    }
+    s->flags = flags;
+    return s;
+}
+
+void tc_session_destroy(tc_session_t* s) {
+    if(s != NULL) {
+        curl_easy_cleanup(s->curl);
+        allocator_free(s->interface);
+        allocator_free(s);
+    }
+}
+
+void tc_session_set_flags(tc_session_t* s, int flags) {
+    if(s != NULL) {
+        s->flags = flags;
+    }
+}
+
+/**
+  Resets all options of the previous transfer. Unlike curl_easy_cleanup(),
+  curl_easy_reset() keeps live connections, the DNS cache and TLS sessions.
+*/
+static CURL* session_prepare(tc_session_t* s) {
+    CURL *curl = s->curl;
+    curl_easy_reset(curl);
+
+    /* bind to a specific netdev or source address */
+    if(s->interface != NULL) {
+        curl_easy_setopt(curl, CURLOPT_INTERFACE, s->interface);
+    }
+
+    /* measure cold start: no reuse of connections or resolved names */
+    if(s->flags & TC_SESSION_FRESH_CONNECT) {
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+        curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 0L);
+    }
+    return curl;
+}
+
 void tc_download(const char* url) {
     CURL *curl = curl_easy_init();
     if(curl) {
@@ -168,15 +237,49 @@ int tc_download_and_discard(const char* url,
                             progress_callback_func* callback,
                             void* callback_context,
                             double minimal_progress_interval_sec) {
+  return tc_download_and_discard_on_interface(NULL,
+                                              url,
+                                              n_bytes_max,
+                                              callback,
+                                              callback_context,
+                                              minimal_progress_interval_sec);
+}
+
+int tc_download_and_discard_on_interface(const char* interface,
+                                         const char* url,
+                                         size_t n_bytes_max,
+                                         progress_callback_func* callback,
+                                         void* callback_context,
+                                         double minimal_progress_interval_sec) {
+  tc_session_t* s = tc_session_init(interface, 0);
+  if(s == NULL) {
+    return -1;
+  }
+  int result = tc_session_download_and_discard(s,
+                                               url,
+                                               n_bytes_max,
+                                               callback,
+                                               callback_context,
+                                               minimal_progress_interval_sec);
+  tc_session_destroy(s);
+  return result;
+}
+
+int tc_session_download_and_discard(tc_session_t* s,
+                                    const char* url,
+                                    size_t n_bytes_max,
+                                    progress_callback_func* callback,
+                                    void* callback_context,
+                                    double minimal_progress_interval_sec) {
   int result = 0;
   CURL *curl;
   CURLcode res;
 
   struct xferinfo_callback_data callbackdata;
 
-  /* get a curl handle */
-  curl = curl_easy_init();
-  if(curl) {
+  if(s != NULL) {
+    /* reuse the session's curl handle */
+    curl = session_prepare(s);
     callbackdata.callback = callback;
     callbackdata.callback_context = callback_context;
     callbackdata.minimal_progress_interval_sec = minimal_progress_interval_sec;
@@ -205,11 +308,14 @@ int tc_download_and_discard(const char* url,
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "c-mnalib traffic generator");
 
     // First statusreport just before starting transmission
-    transfer_statusreport_t statusreport;
+    transfer_statusreport_t statusreport = {0};
     statusreport.total_transfer_time = 0;
+    statusreport.total_transfered_bytes = 0;
     statusreport.datarate_ul = 0;
     statusreport.datarate_dl = 0;
-    callbackdata.callback(callbackdata.callback_context, &statusreport);
+    if(callbackdata.callback != NULL) {
+      callbackdata.callback(callbackdata.callback_context, &statusreport);
+    }
 
     /* Perform the request, res will get the return code */
     res = curl_easy_perform(curl);
@@ -240,12 +346,13 @@ int tc_download_and_discard(const char* url,
 
     // Final statusreport after finishing transmission
     statusreport.total_transfer_time = transmissiontime;
+    statusreport.total_transfered_bytes = n_bytes_max-callbackdata.remaining_bytes;
     statusreport.datarate_dl = speed;
-    callbackdata.callback(callbackdata.callback_context, &statusreport);
-
-    /* always cleanup */
-    curl_easy_cleanup(curl);
+    if(callbackdata.callback != NULL) {
+      callbackdata.callback(callbackdata.callback_context, &statusreport);
+    }
 
+    /* keep the handle and its connection for the next transfer */
     return result;
   }
 
@@ -257,15 +364,49 @@ int tc_upload_randomdata(const char* url,
                            progress_callback_func* callback,
                            void* callback_context,
                            double minimal_progress_interval_sec) {
+    return tc_upload_randomdata_on_interface(NULL,
+                                             url,
+                                             n_bytes,
+                                             callback,
+                                             callback_context,
+                                             minimal_progress_interval_sec);
+}
+
+int tc_upload_randomdata_on_interface(const char* interface,
+                                      const char* url,
+                                      size_t n_bytes,
+                                      progress_callback_func* callback,
+                                      void* callback_context,
+                                      double minimal_progress_interval_sec) {
+    tc_session_t* s = tc_session_init(interface, 0);
+    if(s == NULL) {
+        return -1;
+    }
+    int result = tc_session_upload_randomdata(s,
+                                              url,
+                                              n_bytes,
+                                              callback,
+                                              callback_context,
+                                              minimal_progress_interval_sec);
+    tc_session_destroy(s);
+    return result;
+}
+
+int tc_session_upload_randomdata(tc_session_t* s,
+                                 const char* url,
+                                 size_t n_bytes,
+                                 progress_callback_func* callback,
+                                 void* callback_context,
+                                 double minimal_progress_interval_sec) {
     int result = 0;
     CURL *curl;
     CURLcode res;
 
     struct xferinfo_callback_data callbackdata;
 
-    /* get a curl handle */
-    curl = curl_easy_init();
-    if(curl) {
+    if(s != NULL) {
+        /* reuse the session's curl handle */
+        curl = session_prepare(s);
 
         callbackdata.callback = callback;
         callbackdata.callback_context = callback_context;
@@ -345,11 +486,14 @@ int tc_upload_randomdata(const char* url,
 #endif
 
         // First statusreport just before starting transmission
-        transfer_statusreport_t statusreport;
+        transfer_statusreport_t statusreport = {0};
         statusreport.total_transfer_time = 0;
+        statusreport.total_transfered_bytes = 0;
         statusreport.datarate_ul = 0;
         statusreport.datarate_dl = 0;
-        callbackdata.callback(callbackdata.callback_context, &statusreport);
+        if(callbackdata.callback != NULL) {
+            callbackdata.callback(callbackdata.callback_context, &statusreport);
+        }
 
         /* Perform the request, res will get the return code */
         res = curl_easy_perform(curl);
@@ -379,14 +523,15 @@ int tc_upload_randomdata(const char* url,
 
         // Final statusreport after finishing transmission
         statusreport.total_transfer_time = transmissiontime;
+        statusreport.total_transfered_bytes = n_bytes-callbackdata.remaining_bytes;
         statusreport.datarate_ul = speed;
-        callbackdata.callback(callbackdata.callback_context, &statusreport);
+        if(callbackdata.callback != NULL) {
+            callbackdata.callback(callbackdata.callback_context, &statusreport);
+        }
 
-        /* always cleanup */
-        curl_easy_cleanup(curl);
+        /* keep the handle and its connection for the next transfer */
         return result;
     }
 
-    DEBUG("Dropped %d bytes\n", callbackdata.remaining_bytes);
     return -1;
 }
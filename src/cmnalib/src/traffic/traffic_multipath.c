@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <pthread.h>
+#include <curl/curl.h>
+
+#include "cmnalib/traffic_multipath.h"
+#include "cmnalib/traffic_curl.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE TRAFFIC
+#include "cmnalib/logger.h"
+
+typedef struct multipath_gate {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int open;
+    int abort;
+    double start_time;      // taken when the gate opens
+} multipath_gate_t;
+
+typedef struct multipath_worker {
+    tc_multipath_job_t* job;
+    multipath_gate_t* gate;
+    pthread_t thread;
+} multipath_worker_t;
+
+static void* multipath_worker(void* void_worker) {
+    multipath_worker_t* worker = (multipath_worker_t*)void_worker;
+    tc_multipath_job_t* job = worker->job;
+
+    pthread_mutex_lock(&worker->gate->lock);
+    while(!worker->gate->open) {
+        pthread_cond_wait(&worker->gate->cond, &worker->gate->lock);
+    }
+    int abort = worker->gate->abort;
+    job->start_time = worker->gate->start_time;
+    pthread_mutex_unlock(&worker->gate->lock);
+    if(abort) {
+        return NULL;
+    }
+
+    DEBUG("Starting %s on interface %s\n",
+          job->direction == TC_DIRECTION_UPLOAD ? "upload" : "download",
+          job->interface != NULL ? job->interface : "(default)");
+
+    switch(job->direction) {
+    case TC_DIRECTION_UPLOAD:
+        job->result = tc_upload_randomdata_on_interface(job->interface,
+                                                        job->url,
+                                                        job->n_bytes,
+                                                        job->callback,
+                                                        job->callback_context,
+                                                        job->minimal_progress_interval_sec);
+        break;
+    case TC_DIRECTION_DOWNLOAD:
+        job->result = tc_download_and_discard_on_interface(job->interface,
+                                                           job->url,
+                                                           job->n_bytes,
+                                                           job->callback,
+                                                           job->callback_context,
+                                                           job->minimal_progress_interval_sec);
+        break;
+    default:
+        ERROR("Unknown transfer direction %d\n", job->direction);
+        job->result = -1;
+    }
+    return NULL;
+}
+
+static pthread_once_t curl_init_once = PTHREAD_ONCE_INIT;
+
+static void curl_init() {
+    curl_global_init(CURL_GLOBAL_ALL);
+}
+
+int tc_multipath_run(tc_multipath_job_t* jobs, size_t n_jobs) {
+    struct timeval t;
+
+    if(jobs == NULL || n_jobs == 0) {
+        return -1;
+    }
+
+    // curl_easy_init() would run the global init implicitly, which is not thread-safe in older libcurl
+    pthread_once(&curl_init_once, curl_init);
+
+    multipath_worker_t* workers = allocator_calloc(n_jobs, sizeof(multipath_worker_t));
+    if(workers == NULL) {
+        ERROR("Error in calloc\n");
+        return -1;
+    }
+
+    // no job starts before all threads exist
+    multipath_gate_t gate;
+    pthread_mutex_init(&gate.lock, NULL);
+    pthread_cond_init(&gate.cond, NULL);
+    gate.open = 0;
+    gate.abort = 0;
+
+    size_t n_started = 0;
+    for(size_t i = 0; i < n_jobs; i++) {
+        jobs[i].result = -1;
+        workers[i].job = &jobs[i];
+        workers[i].gate = &gate;
+        if(pthread_create(&workers[i].thread, NULL, multipath_worker, &workers[i]) != 0) {
+            ERROR("Could not create worker thread for job %zu\n", i);
+            break;
+        }
+        n_started++;
+    }
+
+    // release all workers at once
+    pthread_mutex_lock(&gate.lock);
+    gettimeofday(&t, NULL);
+    gate.start_time = t.tv_sec + t.tv_usec * 1e-6;
+    gate.open = 1;
+    gate.abort = n_started < n_jobs;
+    pthread_cond_broadcast(&gate.cond);
+    pthread_mutex_unlock(&gate.lock);
+
+    int result = 0;
+    for(size_t i = 0; i < n_started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if(jobs[i].result != 0) {
+            WARNING("Transfer on interface %s failed\n",
+                    jobs[i].interface != NULL ? jobs[i].interface : "(default)");
+            result = -1;
+        }
+    }
+
+    if(n_started < n_jobs) {
+        result = -1;
+    }
+
+    pthread_cond_destroy(&gate.cond);
+    pthread_mutex_destroy(&gate.lock);
+    allocator_free(workers);
+    return result;
+}
@@ -0,0 +1,448 @@
+#define _GNU_SOURCE  // strcasestr
+
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <pthread.h>
+
+#include "cmnalib/traffic_server.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE TRAFFIC
+#include "cmnalib/logger.h"
+
+#define TC_SERVER_LISTEN_BACKLOG 16
+#define TC_SERVER_MAX_CONNECTIONS 64
+#define TC_SERVER_RX_BUFSIZE (64*1024)
+#define TC_SERVER_TX_BUFSIZE (64*1024)
+#define TC_SERVER_MAX_HEADER_LENGTH 8192
+#define TC_SERVER_POLL_INTERVAL_MS 100
+
+typedef struct tc_server_connection {
+    tc_server_t* server;
+    int socket;
+    pthread_t thread;
+    int finished;
+    // buffered reader
+    char rx_buf[TC_SERVER_RX_BUFSIZE];
+    size_t rx_len;
+    size_t rx_pos;
+} tc_server_connection_t;
+
+struct tc_server {
+    int listen_socket;
+    int port;
+    volatile int running;
+    pthread_t accept_thread;
+    pthread_mutex_t lock;
+    tc_server_connection_t* connection[TC_SERVER_MAX_CONNECTIONS];
+    tc_server_stats_t stats;
+};
+
+/* payload source for GET requests, shared by all connections */
+static char tx_pattern[TC_SERVER_TX_BUFSIZE];
+static pthread_once_t tx_pattern_once = PTHREAD_ONCE_INIT;
+
+static void init_tx_pattern() {
+    for(size_t i = 0; i < sizeof(tx_pattern); i++) {
+        tx_pattern[i] = (char)i;
+    }
+}
+
+static void add_stats(tc_server_t* s, size_t requests, size_t received, size_t sent) {
+    pthread_mutex_lock(&s->lock);
+    s->stats.nof_requests += requests;
+    s->stats.bytes_received += received;
+    s->stats.bytes_sent += sent;
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* returns nof bytes available in rx buffer, 0 on EOF, -1 on error */
+static ssize_t conn_fill(tc_server_connection_t* c) {
+    if(c->rx_pos < c->rx_len) {
+        return (ssize_t)(c->rx_len - c->rx_pos);
+    }
+    c->rx_pos = 0;
+    c->rx_len = 0;
+    ssize_t len;
+    do {
+        len = recv(c->socket, c->rx_buf, sizeof(c->rx_buf), 0);
+    } while(len < 0 && errno == EINTR);
+    if(len <= 0) {
+        return len;
+    }
+    c->rx_len = (size_t)len;
+    return len;
+}
+
+/* read a single CRLF terminated line (without CRLF), returns line length or -1 */
+static int conn_read_line(tc_server_connection_t* c, char* line, size_t line_bufsize) {
+    size_t n = 0;
+    while(1) {
+        if(conn_fill(c) <= 0) {
+            return -1;
+        }
+        char ch = c->rx_buf[c->rx_pos++];
+        if(ch == '\n') {
+            if(n > 0 && line[n-1] == '\r') n--;
+            line[n] = 0;
+            return (int)n;
+        }
+        if(n + 1 >= line_bufsize) {
+            ERROR("Line exceeds %zu bytes\n", line_bufsize);
+            return -1;
+        }
+        line[n++] = ch;
+    }
+}
+
+/* consume n bytes from connection, returns 0 on success */
+static int conn_discard(tc_server_connection_t* c, size_t n) {
+    while(n > 0) {
+        ssize_t avail = conn_fill(c);
+        if(avail <= 0) {
+            return -1;
+        }
+        size_t chunk = (size_t)avail < n ? (size_t)avail : n;
+        c->rx_pos += chunk;
+        n -= chunk;
+    }
+    return 0;
+}
+
+static int conn_send_all(tc_server_connection_t* c, const char* buf, size_t len) {
+    while(len > 0) {
+        ssize_t ret = send(c->socket, buf, len, MSG_NOSIGNAL);
+        if(ret < 0) {
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        buf += ret;
+        len -= (size_t)ret;
+    }
+    return 0;
+}
+
+static int discard_chunked_body(tc_server_connection_t* c, size_t* n_received) {
+    char line[TC_SERVER_MAX_HEADER_LENGTH];
+    while(1) {
+        if(conn_read_line(c, line, sizeof(line)) < 0) return -1;
+        size_t chunk_size = strtoul(line, NULL, 16);
+        if(chunk_size == 0) {
+            // skip trailer section up to the empty line
+            do {
+                if(conn_read_line(c, line, sizeof(line)) < 0) return -1;
+            } while(line[0] != 0);
+            return 0;
+        }
+        if(conn_discard(c, chunk_size) != 0) return -1;
+        *n_received += chunk_size;
+        // CRLF behind chunk data
+        if(conn_read_line(c, line, sizeof(line)) < 0) return -1;
+    }
+}
+
+static int serve_body(tc_server_connection_t* c, size_t n_bytes, size_t* n_sent) {
+    while(n_bytes > 0) {
+        size_t chunk = n_bytes < sizeof(tx_pattern) ? n_bytes : sizeof(tx_pattern);
+        if(conn_send_all(c, tx_pattern, chunk) != 0) {
+            // typically the client truncated the download
+            DEBUG("Client closed connection after %zu bytes\n", *n_sent);
+            return -1;
+        }
+        *n_sent += chunk;
+        n_bytes -= chunk;
+    }
+    return 0;
+}
+
+/* handle a single request, returns 1 to keep the connection alive, 0 to close */
+static int handle_request(tc_server_connection_t* c) {
+    char line[TC_SERVER_MAX_HEADER_LENGTH];
+    char method[16] = {0};
+    char path[TC_SERVER_MAX_HEADER_LENGTH] = {0};
+    char version[16] = {0};
+    size_t content_length = 0;
+    int chunked = 0;
+    int expect_continue = 0;
+    int keep_alive = 1;
+    size_t n_received = 0;
+    size_t n_sent = 0;
+
+    // request line, skip leading empty lines
+    do {
+        if(conn_read_line(c, line, sizeof(line)) < 0) return 0;
+    } while(line[0] == 0);
+
+    if(sscanf(line, "%15s %8191s %15s", method, path, version) != 3) {
+        WARNING("Malformed request line: %s\n", line);
+        return 0;
+    }
+    if(strcmp(version, "HTTP/1.0") == 0) keep_alive = 0;
+
+    // headers
+    while(1) {
+        if(conn_read_line(c, line, sizeof(line)) < 0) return 0;
+        if(line[0] == 0) break;
+        char* value = strchr(line, ':');
+        if(value == NULL) continue;
+        *value++ = 0;
+        while(*value == ' ' || *value == '\t') value++;
+
+        if(strcasecmp(line, "Content-Length") == 0) {
+            content_length = strtoul(value, NULL, 10);
+        }
+        else if(strcasecmp(line, "Transfer-Encoding") == 0) {
+            chunked = strcasestr(value, "chunked") != NULL;
+        }
+        else if(strcasecmp(line, "Expect") == 0) {
+            expect_continue = strcasestr(value, "100-continue") != NULL;
+        }
+        else if(strcasecmp(line, "Connection") == 0) {
+            if(strcasestr(value, "close") != NULL) keep_alive = 0;
+            if(strcasestr(value, "keep-alive") != NULL) keep_alive = 1;
+        }
+    }
+
+    if(strcmp(method, "POST") == 0 || strcmp(method, "PUT") == 0) {
+        if(expect_continue) {
+            static const char cont[] = "HTTP/1.1 100 Continue\r\n\r\n";
+            if(conn_send_all(c, cont, sizeof(cont)-1) != 0) return 0;
+        }
+        if(chunked) {
+            if(discard_chunked_body(c, &n_received) != 0) {
+                add_stats(c->server, 1, n_received, 0);
+                return 0;
+            }
+        }
+        else {
+            if(conn_discard(c, content_length) != 0) {
+                add_stats(c->server, 1, n_received, 0);
+                return 0;
+            }
+            n_received = content_length;
+        }
+        char header[256];
+        int len = snprintf(header, sizeof(header),
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Length: 0\r\n"
+                           "Connection: %s\r\n\r\n",
+                           keep_alive ? "keep-alive" : "close");
+        if(conn_send_all(c, header, (size_t)len) != 0) keep_alive = 0;
+    }
+    else if(strcmp(method, "GET") == 0 || strcmp(method, "HEAD") == 0) {
+        size_t n_bytes = TC_SERVER_DEFAULT_GET_BYTES;
+        const char* size_str = strrchr(path, '/');
+        if(size_str != NULL && size_str[1] >= '0' && size_str[1] <= '9') {
+            n_bytes = strtoul(size_str+1, NULL, 10);
+        }
+        char header[256];
+        int len = snprintf(header, sizeof(header),
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: application/octet-stream\r\n"
+                           "Content-Length: %zu\r\n"
+                           "Connection: %s\r\n\r\n",
+                           n_bytes,
+                           keep_alive ? "keep-alive" : "close");
+        if(conn_send_all(c, header, (size_t)len) != 0) {
+            keep_alive = 0;
+        }
+        else if(strcmp(method, "GET") == 0) {
+            if(serve_body(c, n_bytes, &n_sent) != 0) keep_alive = 0;
+        }
+    }
+    else {
+        static const char not_allowed[] = "HTTP/1.1 405 Method Not Allowed\r\n"
+                                           "Content-Length: 0\r\n"
+                                           "Connection: close\r\n\r\n";
+        conn_send_all(c, not_allowed, sizeof(not_allowed)-1);
+        keep_alive = 0;
+    }
+
+    add_stats(c->server, 1, n_received, n_sent);
+    return keep_alive;
+}
+
+static void* connection_handler(void* void_connection) {
+    tc_server_connection_t* c = (tc_server_connection_t*)void_connection;
+
+    while(c->server->running && handle_request(c)) {
+        /* keep-alive */
+    }
+
+    shutdown(c->socket, SHUT_RDWR);
+    pthread_mutex_lock(&c->server->lock);
+    c->finished = 1;
+    pthread_mutex_unlock(&c->server->lock);
+    return NULL;
+}
+
+/* join finished connection threads, must be called with lock held */
+static void reap_connections(tc_server_t* s, int force) {
+    for(int i = 0; i < TC_SERVER_MAX_CONNECTIONS; i++) {
+        tc_server_connection_t* c = s->connection[i];
+        if(c == NULL) continue;
+        if(force && !c->finished) {
+            // unblock a pending recv()/send()
+            shutdown(c->socket, SHUT_RDWR);
+        }
+        if(force || c->finished) {
+            pthread_mutex_unlock(&s->lock);
+            pthread_join(c->thread, NULL);
+            pthread_mutex_lock(&s->lock);
+            close(c->socket);
+            allocator_free(c);
+            s->connection[i] = NULL;
+        }
+    }
+}
+
+static void* accept_loop(void* void_server) {
+    tc_server_t* s = (tc_server_t*)void_server;
+    struct pollfd pfd;
+    pfd.fd = s->listen_socket;
+    pfd.events = POLLIN;
+
+    while(s->running) {
+        int ret = poll(&pfd, 1, TC_SERVER_POLL_INTERVAL_MS);
+        pthread_mutex_lock(&s->lock);
+        reap_connections(s, 0);
+        pthread_mutex_unlock(&s->lock);
+        if(ret <= 0) continue;
+
+        int sock = accept(s->listen_socket, NULL, NULL);
+        if(sock < 0) {
+            if(errno != EINTR && errno != EAGAIN) {
+                ERROR("Error in accept(): %s\n", strerror(errno));
+            }
+            continue;
+        }
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        pthread_mutex_lock(&s->lock);
+        int slot = -1;
+        for(int i = 0; i < TC_SERVER_MAX_CONNECTIONS; i++) {
+            if(s->connection[i] == NULL) {
+                slot = i;
+                break;
+            }
+        }
+        tc_server_connection_t* c = NULL;
+        if(slot >= 0) {
+            c = allocator_calloc(1, sizeof(tc_server_connection_t));
+        }
+        if(c == NULL) {
+            pthread_mutex_unlock(&s->lock);
+            WARNING("Rejecting connection, too many clients\n");
+            close(sock);
+            continue;
+        }
+        c->server = s;
+        c->socket = sock;
+        if(pthread_create(&c->thread, NULL, connection_handler, c) != 0) {
+            pthread_mutex_unlock(&s->lock);
+            ERROR("Could not create connection thread\n");
+            close(sock);
+            allocator_free(c);
+            continue;
+        }
+        s->connection[slot] = c;
+        s->stats.nof_connections++;
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    pthread_mutex_lock(&s->lock);
+    reap_connections(s, 1);
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+tc_server_t* tc_server_start(const char* bind_address, int port) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+
+    pthread_once(&tx_pattern_once, init_tx_pattern);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if(bind_address == NULL) {
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+    else if(inet_pton(AF_INET, bind_address, &addr.sin_addr) != 1) {
+        ERROR("Invalid bind address '%s'\n", bind_address);
+        return NULL;
+    }
+
+    tc_server_t* s = allocator_calloc(1, sizeof(tc_server_t));
+    if(s == NULL) {
+        ERROR("Error in calloc\n");
+        return NULL;
+    }
+
+    s->listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if(s->listen_socket < 0) {
+        ERROR("Could not create socket: %s\n", strerror(errno));
+        allocator_free(s);
+        return NULL;
+    }
+    int one = 1;
+    setsockopt(s->listen_socket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if(bind(s->listen_socket, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+       listen(s->listen_socket, TC_SERVER_LISTEN_BACKLOG) != 0 ||
+       getsockname(s->listen_socket, (struct sockaddr*)&addr, &addr_len) != 0) {
+        ERROR("Could not listen on port %d: %s\n", port, strerror(errno));
+        close(s->listen_socket);
+        allocator_free(s);
+        return NULL;
+    }
+    s->port = ntohs(addr.sin_port);
+
+    pthread_mutex_init(&s->lock, NULL);
+    s->running = 1;
+    if(pthread_create(&s->accept_thread, NULL, accept_loop, s) != 0) {
+        ERROR("Could not create server thread\n");
+        pthread_mutex_destroy(&s->lock);
+        close(s->listen_socket);
+        allocator_free(s);
+        return NULL;
+    }
+
+    INFO("Traffic server listening on port %d\n", s->port);
+    return s;
+}
+
+void tc_server_stop(tc_server_t* s) {
+    if(s != NULL) {
+        DEBUG("Stopping traffic server on port %d\n", s->port);
+        s->running = 0;
+        pthread_join(s->accept_thread, NULL);
+        close(s->listen_socket);
+        pthread_mutex_destroy(&s->lock);
+        allocator_free(s);
+    }
+}
+
+int tc_server_get_port(tc_server_t* s) {
+    if(s == NULL) return -1;
+    return s->port;
+}
+
+void tc_server_get_stats(tc_server_t* s, tc_server_stats_t* stats) {
+    if(s != NULL && stats != NULL) {
+        pthread_mutex_lock(&s->lock);
+        *stats = s->stats;
+        pthread_mutex_unlock(&s->lock);
+    }
+}
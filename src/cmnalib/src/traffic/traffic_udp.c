@@ -0,0 +1,639 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <endian.h>
+#include <netdb.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <pthread.h>
+
+#include "cmnalib/traffic_udp.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE TRAFFIC
+#include "cmnalib/logger.h"
+
+#define TC_UDP_POLL_INTERVAL_MS 50
+#define TC_UDP_INITIAL_RECORDS 1024
+#define TC_UDP_RCVBUF_SIZE (4*1024*1024)
+#define TC_UDP_SEQ_WINDOW 65536     // sequence numbers tracked around the highest one, in bits
+
+struct tc_udp_receiver {
+    int socket;
+    int port;
+    volatile int running;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t finished_cond;
+    int finished;
+
+    progress_callback_func* callback;
+    void* callback_context;
+    double minimal_progress_interval_sec;
+
+    // per-packet records in order of arrival
+    tc_udp_packet_record_t* records;
+    size_t n_records;
+    size_t records_capacity;
+
+    // ring bitmap of the received sequence numbers within the window, for duplicate detection
+    uint8_t* seen;
+
+    int64_t highest_seq;
+    size_t n_announced;     // nof sent packets from end-of-stream marker
+    size_t n_received;
+    size_t n_reordered;
+    size_t n_duplicate;
+    size_t n_out_of_window;
+    size_t bytes_received;
+
+    double delay_sum;
+    double delay_min;
+    double delay_max;
+    double jitter;
+    double last_transit;
+    double t_first;
+    double t_last;
+};
+
+static double now_realtime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double now_monotonic() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void sleep_until_monotonic(double t) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)t;
+    ts.tv_nsec = (long)((t - (double)ts.tv_sec) * 1e9);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        /* resume */
+    }
+}
+
+void tc_udp_init_config_cbr(tc_udp_config_t* config, double bitrate, size_t packet_size, double duration_sec) {
+    memset(config, 0, sizeof(tc_udp_config_t));
+    config->pattern = TC_UDP_PATTERN_CBR;
+    config->bitrate = bitrate;
+    config->packet_size = packet_size;
+    config->duration_sec = duration_sec;
+}
+
+void tc_udp_init_config_burst(tc_udp_config_t* config, size_t burst_packets, double burst_interval_sec, size_t packet_size, double duration_sec) {
+    memset(config, 0, sizeof(tc_udp_config_t));
+    config->pattern = TC_UDP_PATTERN_BURST;
+    config->burst_packets = burst_packets;
+    config->burst_interval_sec = burst_interval_sec;
+    config->packet_size = packet_size;
+    config->duration_sec = duration_sec;
+}
+
+void tc_udp_encode_header(const tc_udp_header_t* header, void* buffer) {
+    uint8_t* p = (uint8_t*)buffer;
+    uint32_t v32;
+    uint64_t v64;
+    v32 = htonl(header->magic);     memcpy(p, &v32, 4);
+    v32 = htonl(header->seq);       memcpy(p+4, &v32, 4);
+    v32 = htonl(header->flags);     memcpy(p+8, &v32, 4);
+    v32 = htonl(header->reserved);  memcpy(p+12, &v32, 4);
+    v64 = htobe64(header->t_sent_ns);
+    memcpy(p+16, &v64, 8);
+}
+
+int tc_udp_decode_header(const void* buffer, size_t len, tc_udp_header_t* header) {
+    const uint8_t* p = (const uint8_t*)buffer;
+    uint32_t v32;
+    uint64_t v64;
+    if(len < TC_UDP_HEADER_SIZE) {
+        return -1;
+    }
+    memcpy(&v32, p, 4);     header->magic = ntohl(v32);
+    memcpy(&v32, p+4, 4);   header->seq = ntohl(v32);
+    memcpy(&v32, p+8, 4);   header->flags = ntohl(v32);
+    memcpy(&v32, p+12, 4);  header->reserved = ntohl(v32);
+    memcpy(&v64, p+16, 8);  header->t_sent_ns = be64toh(v64);
+    if(header->magic != TC_UDP_MAGIC) {
+        return -1;
+    }
+    return 0;
+}
+
+static int open_sender_socket(const char* host, int port) {
+    struct addrinfo hints;
+    struct addrinfo* result = NULL;
+    char port_str[16];
+    int sock = -1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    snprintf(port_str, sizeof(port_str), "%d", port);
+
+    int ret = getaddrinfo(host, port_str, &hints, &result);
+    if(ret != 0) {
+        ERROR("Could not resolve '%s': %s\n", host, gai_strerror(ret));
+        return -1;
+    }
+    for(struct addrinfo* ai = result; ai != NULL; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if(sock < 0) continue;
+        if(connect(sock, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(sock);
+        sock = -1;
+    }
+    freeaddrinfo(result);
+    if(sock < 0) {
+        ERROR("Could not connect UDP socket to %s:%d\n", host, port);
+    }
+    return sock;
+}
+
+/* scheduled send time of packet i relative to start */
+static double packet_offset(const tc_udp_config_t* config, size_t i) {
+    if(config->pattern == TC_UDP_PATTERN_BURST) {
+        return (double)(i / config->burst_packets) * config->burst_interval_sec;
+    }
+    return (double)i * (double)config->packet_size * 8.0 / config->bitrate;
+}
+
+int tc_udp_send(const char* host,
+                int port,
+                const tc_udp_config_t* config,
+                progress_callback_func* callback,
+                void* callback_context,
+                double minimal_progress_interval_sec) {
+    if(config == NULL ||
+       config->packet_size < TC_UDP_HEADER_SIZE ||
+       config->packet_size > TC_UDP_MAX_PACKET_SIZE ||
+       (config->pattern == TC_UDP_PATTERN_CBR && config->bitrate <= 0) ||
+       (config->pattern == TC_UDP_PATTERN_BURST && (config->burst_packets == 0 || config->burst_interval_sec <= 0)) ||
+       (config->duration_sec <= 0 && config->n_packets_max == 0)) {
+        ERROR("Invalid UDP traffic configuration\n");
+        return -1;
+    }
+
+    int sock = open_sender_socket(host, port);
+    if(sock < 0) {
+        return -1;
+    }
+
+    uint8_t* buffer = allocator_calloc(1, config->packet_size);
+    if(buffer == NULL) {
+        ERROR("Error in calloc\n");
+        close(sock);
+        return -1;
+    }
+    for(size_t i = TC_UDP_HEADER_SIZE; i < config->packet_size; i++) {
+        buffer[i] = (uint8_t)i;
+    }
+
+    tc_udp_header_t header;
+    header.magic = TC_UDP_MAGIC;
+    header.flags = 0;
+    header.reserved = 0;
+
+    transfer_statusreport_t statusreport = {0};
+    if(callback != NULL) {
+        callback(callback_context, &statusreport);
+    }
+
+    size_t n_sent = 0;
+    size_t bytes_sent = 0;
+    size_t last_bytes_sent = 0;
+    double t_start = now_monotonic();
+    double t_last_report = t_start;
+    double t_now = t_start;
+    int canceled = 0;
+    while(!canceled) {
+        if(config->n_packets_max > 0 && n_sent >= config->n_packets_max) break;
+
+        double t_scheduled = t_start + packet_offset(config, n_sent);
+        if(config->duration_sec > 0 && t_scheduled - t_start >= config->duration_sec) break;
+        sleep_until_monotonic(t_scheduled);
+
+        header.seq = (uint32_t)n_sent;
+        header.t_sent_ns = (uint64_t)(now_realtime() * 1e9);
+        tc_udp_encode_header(&header, buffer);
+        if(send(sock, buffer, config->packet_size, 0) < 0) {
+            // e.g. ECONNREFUSED from a previous ICMP error or ENOBUFS, count as lost
+            DEBUG("Error in send() of packet %zu: %s\n", n_sent, strerror(errno));
+        }
+        else {
+            bytes_sent += config->packet_size;
+        }
+        n_sent++;
+
+        t_now = now_monotonic();
+        double timeinterval = t_now - t_last_report;
+        if(callback != NULL && timeinterval > minimal_progress_interval_sec) {
+            statusreport.datarate_ul = (bytes_sent - last_bytes_sent) / timeinterval;
+            statusreport.total_transfer_time = t_now - t_start;
+            statusreport.total_transfered_bytes = bytes_sent;
+            statusreport.udp_packets_sent = n_sent;
+            t_last_report = t_now;
+            last_bytes_sent = bytes_sent;
+            canceled = callback(callback_context, &statusreport);
+        }
+    }
+
+    // end-of-stream marker, repeated since it may get lost as well
+    header.seq = (uint32_t)n_sent;
+    header.flags = TC_UDP_FLAG_LAST;
+    for(int i = 0; i < TC_UDP_FIN_REPEATS; i++) {
+        header.t_sent_ns = (uint64_t)(now_realtime() * 1e9);
+        tc_udp_encode_header(&header, buffer);
+        send(sock, buffer, TC_UDP_HEADER_SIZE, 0);
+    }
+
+    double transmissiontime = t_now - t_start;
+    DEBUG("Sent %zu UDP packets in %f sec\n", n_sent, transmissiontime);
+
+    statusreport.total_transfer_time = transmissiontime;
+    statusreport.total_transfered_bytes = bytes_sent;
+    statusreport.udp_packets_sent = n_sent;
+    statusreport.datarate_ul = transmissiontime > 0 ? bytes_sent / transmissiontime : 0;
+    if(callback != NULL) {
+        callback(callback_context, &statusreport);
+    }
+
+    allocator_free(buffer);
+    close(sock);
+    return (int)n_sent;
+}
+
+/* must be called with lock held */
+static void fill_report(tc_udp_receiver_t* r, transfer_statusreport_t* report) {
+    memset(report, 0, sizeof(transfer_statusreport_t));
+    report->total_transfered_bytes = r->bytes_received;
+    report->total_transfer_time = r->n_received > 0 ? r->t_last - r->t_first : 0;
+    if(report->total_transfer_time > 0) {
+        report->datarate_dl = r->bytes_received / report->total_transfer_time;
+    }
+    report->udp_packets_sent = r->finished ? r->n_announced : (size_t)(r->highest_seq + 1);
+    report->udp_packets_received = r->n_received;
+    report->udp_packets_lost = report->udp_packets_sent > r->n_received ? report->udp_packets_sent - r->n_received : 0;
+    report->udp_packets_reordered = r->n_reordered;
+    report->udp_packets_duplicate = r->n_duplicate;
+    report->udp_packets_out_of_window = r->n_out_of_window;
+    if(r->n_received > 0) {
+        report->delay_min = r->delay_min;
+        report->delay_mean = r->delay_sum / r->n_received;
+        report->delay_max = r->delay_max;
+    }
+    report->jitter = r->jitter;
+}
+
+/**
+  Returns 1 if seq was seen before, -1 if it is too far from the highest
+  sequence number to be tracked, and marks it as seen otherwise. The
+  bitmap has a fixed size, so a forged seq cannot grow it.
+  */
+static int test_and_set_seen(tc_udp_receiver_t* r, uint32_t seq) {
+    int64_t s = seq;
+    if(s > r->highest_seq + TC_UDP_SEQ_WINDOW || s <= r->highest_seq - TC_UDP_SEQ_WINDOW) {
+        return -1;
+    }
+    if(s > r->highest_seq) {
+        // the slots of seq numbers which leave the window are reused
+        if(s - r->highest_seq >= TC_UDP_SEQ_WINDOW) {
+            memset(r->seen, 0, TC_UDP_SEQ_WINDOW / 8);
+        }
+        else {
+            for(int64_t i = r->highest_seq + 1; i <= s; i++) {
+                r->seen[(i % TC_UDP_SEQ_WINDOW) / 8] &= (uint8_t)~(1 << (i % 8));
+            }
+        }
+    }
+    size_t bit = seq % TC_UDP_SEQ_WINDOW;
+    uint8_t mask = (uint8_t)(1 << (bit % 8));
+    int was_seen = (r->seen[bit / 8] & mask) != 0;
+    r->seen[bit / 8] |= mask;
+    return was_seen;
+}
+
+/* must be called with lock held */
+static void account_packet(tc_udp_receiver_t* r, const tc_udp_header_t* header, size_t len, double t_received) {
+    int seen = test_and_set_seen(r, header->seq);
+    if(seen < 0) {
+        r->n_out_of_window++;
+        return;
+    }
+    if(seen) {
+        r->n_duplicate++;
+        return;
+    }
+
+    if((int64_t)header->seq < r->highest_seq) {
+        r->n_reordered++;
+    }
+    else {
+        r->highest_seq = header->seq;
+    }
+
+    double t_sent = header->t_sent_ns * 1e-9;
+    double transit = t_received - t_sent;
+
+    if(r->n_received == 0) {
+        r->t_first = t_received;
+        r->delay_min = transit;
+        r->delay_max = transit;
+    }
+    else {
+        // interarrival jitter according to RFC 3550, section 6.4.1
+        double d = fabs(transit - r->last_transit);
+        r->jitter += (d - r->jitter) / 16.0;
+    }
+    if(transit < r->delay_min) r->delay_min = transit;
+    if(transit > r->delay_max) r->delay_max = transit;
+    r->delay_sum += transit;
+    r->last_transit = transit;
+    r->t_last = t_received;
+    r->n_received++;
+    r->bytes_received += len;
+
+    if(r->n_records == r->records_capacity) {
+        size_t capacity = r->records_capacity * 2;
+        tc_udp_packet_record_t* records = allocator_realloc(r->records, capacity * sizeof(tc_udp_packet_record_t));
+        if(records == NULL) {
+            ERROR("Error in realloc, dropping packet record\n");
+            return;
+        }
+        r->records = records;
+        r->records_capacity = capacity;
+    }
+    tc_udp_packet_record_t* record = &r->records[r->n_records++];
+    record->seq = header->seq;
+    record->size = (uint32_t)len;
+    record->t_sent = t_sent;
+    record->t_received = t_received;
+}
+
+static void* receiver_loop(void* void_receiver) {
+    tc_udp_receiver_t* r = (tc_udp_receiver_t*)void_receiver;
+    uint8_t buffer[TC_UDP_MAX_PACKET_SIZE];
+    struct pollfd pfd;
+    pfd.fd = r->socket;
+    pfd.events = POLLIN;
+
+    transfer_statusreport_t statusreport;
+    double t_last_report = now_monotonic();
+    size_t last_bytes_received = 0;
+
+    while(r->running) {
+        int ret = poll(&pfd, 1, TC_UDP_POLL_INTERVAL_MS);
+        if(ret > 0) {
+            ssize_t len = recv(r->socket, buffer, sizeof(buffer), 0);
+            double t_received = now_realtime();
+            tc_udp_header_t header;
+            if(len < 0 || tc_udp_decode_header(buffer, (size_t)len, &header) != 0) {
+                continue;
+            }
+            pthread_mutex_lock(&r->lock);
+            if(header.flags & TC_UDP_FLAG_LAST) {
+                if(!r->finished) {
+                    DEBUG("End of UDP stream, %u packets sent\n", header.seq);
+                    r->n_announced = header.seq;
+                    r->finished = 1;
+                    pthread_cond_broadcast(&r->finished_cond);
+                }
+            }
+            else {
+                account_packet(r, &header, (size_t)len, t_received);
+            }
+            pthread_mutex_unlock(&r->lock);
+        }
+
+        double t_now = now_monotonic();
+        double timeinterval = t_now - t_last_report;
+        if(r->callback != NULL && timeinterval > r->minimal_progress_interval_sec) {
+            pthread_mutex_lock(&r->lock);
+            fill_report(r, &statusreport);
+            pthread_mutex_unlock(&r->lock);
+            statusreport.datarate_dl = (statusreport.total_transfered_bytes - last_bytes_received) / timeinterval;
+            last_bytes_received = statusreport.total_transfered_bytes;
+            t_last_report = t_now;
+            if(r->callback(r->callback_context, &statusreport) != 0) {
+                r->running = 0;
+            }
+        }
+    }
+    return NULL;
+}
+
+static int bind_socket(int family, const struct sockaddr* addr, socklen_t addr_len) {
+    int sock = socket(family, SOCK_DGRAM, 0);
+    if(sock < 0) return -1;
+    if(family == AF_INET6) {
+        // accept IPv4 as mapped addresses as well, the sender may resolve either family
+        int v6only = 0;
+        setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+    }
+    int rcvbuf = TC_UDP_RCVBUF_SIZE;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if(bind(sock, addr, addr_len) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* dual-stack on all interfaces for bind_address NULL, otherwise the family of the numeric address */
+static int open_receiver_socket(const char* bind_address, int port) {
+    int sock = -1;
+    if(bind_address == NULL) {
+        struct sockaddr_in6 any6;
+        memset(&any6, 0, sizeof(any6));
+        any6.sin6_family = AF_INET6;
+        any6.sin6_port = htons((uint16_t)port);
+        any6.sin6_addr = in6addr_any;
+        sock = bind_socket(AF_INET6, (struct sockaddr*)&any6, sizeof(any6));
+        if(sock < 0 && errno == EAFNOSUPPORT) {
+            struct sockaddr_in any;
+            memset(&any, 0, sizeof(any));
+            any.sin_family = AF_INET;
+            any.sin_port = htons((uint16_t)port);
+            any.sin_addr.s_addr = htonl(INADDR_ANY);
+            sock = bind_socket(AF_INET, (struct sockaddr*)&any, sizeof(any));
+        }
+    }
+    else {
+        struct addrinfo hints;
+        struct addrinfo* result = NULL;
+        char port_str[16];
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST;
+        snprintf(port_str, sizeof(port_str), "%d", port);
+        int ret = getaddrinfo(bind_address, port_str, &hints, &result);
+        if(ret != 0) {
+            ERROR("Invalid bind address '%s': %s\n", bind_address, gai_strerror(ret));
+            return -1;
+        }
+        for(struct addrinfo* ai = result; ai != NULL && sock < 0; ai = ai->ai_next) {
+            sock = bind_socket(ai->ai_family, ai->ai_addr, ai->ai_addrlen);
+        }
+        freeaddrinfo(result);
+    }
+    if(sock < 0) {
+        ERROR("Could not bind to port %d: %s\n", port, strerror(errno));
+    }
+    return sock;
+}
+
+tc_udp_receiver_t* tc_udp_receiver_start(const char* bind_address,
+                                         int port,
+                                         progress_callback_func* callback,
+                                         void* callback_context,
+                                         double minimal_progress_interval_sec) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+
+    tc_udp_receiver_t* r = allocator_calloc(1, sizeof(tc_udp_receiver_t));
+    if(r == NULL) {
+        ERROR("Error in calloc\n");
+        return NULL;
+    }
+    r->records_capacity = TC_UDP_INITIAL_RECORDS;
+    r->records = allocator_malloc(r->records_capacity * sizeof(tc_udp_packet_record_t));
+    r->seen = allocator_calloc(TC_UDP_SEQ_WINDOW / 8, 1);
+    if(r->records == NULL || r->seen == NULL) {
+        ERROR("Error in malloc\n");
+        allocator_free(r->seen);
+        allocator_free(r->records);
+        allocator_free(r);
+        return NULL;
+    }
+    r->highest_seq = -1;
+    r->callback = callback;
+    r->callback_context = callback_context;
+    r->minimal_progress_interval_sec = minimal_progress_interval_sec;
+
+    r->socket = open_receiver_socket(bind_address, port);
+    if(r->socket < 0 || getsockname(r->socket, (struct sockaddr*)&addr, &addr_len) != 0) {
+        if(r->socket >= 0) close(r->socket);
+        allocator_free(r->seen);
+        allocator_free(r->records);
+        allocator_free(r);
+        return NULL;
+    }
+    r->port = ntohs(addr.ss_family == AF_INET6 ? ((struct sockaddr_in6*)&addr)->sin6_port
+                                               : ((struct sockaddr_in*)&addr)->sin_port);
+
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->finished_cond, NULL);
+    r->running = 1;
+    if(pthread_create(&r->thread, NULL, receiver_loop, r) != 0) {
+        ERROR("Could not create receiver thread\n");
+        pthread_cond_destroy(&r->finished_cond);
+        pthread_mutex_destroy(&r->lock);
+        close(r->socket);
+        allocator_free(r->seen);
+        allocator_free(r->records);
+        allocator_free(r);
+        return NULL;
+    }
+
+    INFO("UDP receiver listening on port %d\n", r->port);
+    return r;
+}
+
+void tc_udp_receiver_stop(tc_udp_receiver_t* r) {
+    if(r != NULL && r->socket >= 0) {
+        r->running = 0;
+        pthread_join(r->thread, NULL);
+        close(r->socket);
+        r->socket = -1;
+
+        if(r->callback != NULL) {
+            // final statusreport
+            transfer_statusreport_t statusreport;
+            pthread_mutex_lock(&r->lock);
+            fill_report(r, &statusreport);
+            pthread_mutex_unlock(&r->lock);
+            r->callback(r->callback_context, &statusreport);
+        }
+    }
+}
+
+void tc_udp_receiver_destroy(tc_udp_receiver_t* r) {
+    if(r != NULL) {
+        tc_udp_receiver_stop(r);
+        pthread_cond_destroy(&r->finished_cond);
+        pthread_mutex_destroy(&r->lock);
+        allocator_free(r->seen);
+        allocator_free(r->records);
+        allocator_free(r);
+    }
+}
+
+int tc_udp_receiver_get_port(tc_udp_receiver_t* r) {
+    if(r == NULL) return -1;
+    return r->port;
+}
+
+int tc_udp_receiver_wait_finished(tc_udp_receiver_t* r, double timeout_sec) {
+    if(r == NULL) return -1;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    double t = deadline.tv_sec + deadline.tv_nsec * 1e-9 + timeout_sec;
+    deadline.tv_sec = (time_t)t;
+    deadline.tv_nsec = (long)((t - (double)deadline.tv_sec) * 1e9);
+
+    int ret = 0;
+    pthread_mutex_lock(&r->lock);
+    while(!r->finished && ret == 0) {
+        ret = pthread_cond_timedwait(&r->finished_cond, &r->lock, &deadline);
+    }
+    int finished = r->finished;
+    pthread_mutex_unlock(&r->lock);
+    return finished ? 0 : -1;
+}
+
+void tc_udp_receiver_get_report(tc_udp_receiver_t* r, transfer_statusreport_t* report) {
+    if(r != NULL && report != NULL) {
+        pthread_mutex_lock(&r->lock);
+        fill_report(r, report);
+        pthread_mutex_unlock(&r->lock);
+    }
+}
+
+const tc_udp_packet_record_t* tc_udp_receiver_get_records(tc_udp_receiver_t* r, size_t* n_records) {
+    if(r == NULL || n_records == NULL) return NULL;
+    pthread_mutex_lock(&r->lock);
+    *n_records = r->n_records;
+    pthread_mutex_unlock(&r->lock);
+    return r->records;
+}
+
+void tc_udp_receiver_write_records(tc_udp_receiver_t* r, FILE* stream) {
+    if(r != NULL && stream != NULL) {
+        pthread_mutex_lock(&r->lock);
+        fprintf(stream, "seq, size, t_sent, t_received, delay\n");
+        for(size_t i = 0; i < r->n_records; i++) {
+            tc_udp_packet_record_t* record = &r->records[i];
+            fprintf(stream, "%u, %u, %.6f, %.6f, %.6f\n",
+                    record->seq,
+                    record->size,
+                    record->t_sent,
+                    record->t_received,
+                    record->t_received - record->t_sent);
+        }
+        pthread_mutex_unlock(&r->lock);
+    }
+}
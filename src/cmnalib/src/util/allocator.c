@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "cmnalib/allocator.h"
+
+/*
+ * libc
+ */
+
+static void* libc_malloc(void* context, size_t size) {
+    return malloc(size);
+}
+
+static void* libc_calloc(void* context, size_t nmemb, size_t size) {
+    return calloc(nmemb, size);
+}
+
+static void* libc_realloc(void* context, void* ptr, size_t size) {
+    return realloc(ptr, size);
+}
+
+static void libc_free(void* context, void* ptr) {
+    free(ptr);
+}
+
+static const allocator_t libc_allocator = {
+    libc_malloc, libc_calloc, libc_realloc, libc_free, NULL
+};
+
+static allocator_t current = {
+    libc_malloc, libc_calloc, libc_realloc, libc_free, NULL
+};
+
+void allocator_set(const allocator_t* allocator) {
+    current = allocator != NULL ? *allocator : libc_allocator;
+}
+
+void allocator_get(allocator_t* allocator) {
+    *allocator = current;
+}
+
+void* allocator_malloc(size_t size) {
+    return current.malloc(current.context, size);
+}
+
+void* allocator_calloc(size_t nmemb, size_t size) {
+    return current.calloc(current.context, nmemb, size);
+}
+
+void* allocator_realloc(void* ptr, size_t size) {
+    return current.realloc(current.context, ptr, size);
+}
+
+void allocator_free(void* ptr) {
+    if(ptr != NULL) current.free(current.context, ptr);
+}
+
+char* allocator_strdup(const char* str) {
+    size_t len = strlen(str) + 1;
+    char* result = allocator_malloc(len);
+    if(result != NULL) {
+        memcpy(result, str, len);
+    }
+    return result;
+}
+
+char* allocator_strndup(const char* str, size_t n) {
+    size_t len = strnlen(str, n);
+    char* result = allocator_malloc(len + 1);
+    if(result != NULL) {
+        memcpy(result, str, len);
+        result[len] = 0;
+    }
+    return result;
+}
+
+/*
+ * counting
+ */
+
+/* keeps the requested size in front of each block */
+typedef union counting_header {
+    size_t size;
+    max_align_t align;
+} counting_header_t;
+
+static allocator_t counting_inner;
+
+static atomic_ulong nof_allocs;
+static atomic_ulong nof_frees;
+static atomic_ulong bytes_allocated;
+static atomic_ulong bytes_in_use;
+static atomic_ulong peak_bytes_in_use;
+
+static void count_alloc(size_t size) {
+    atomic_fetch_add(&nof_allocs, 1);
+    atomic_fetch_add(&bytes_allocated, size);
+    unsigned long in_use = atomic_fetch_add(&bytes_in_use, size) + size;
+    unsigned long peak = atomic_load(&peak_bytes_in_use);
+    while(in_use > peak && !atomic_compare_exchange_weak(&peak_bytes_in_use, &peak, in_use));
+}
+
+static void* counting_malloc(void* context, size_t size) {
+    if(size > SIZE_MAX - sizeof(counting_header_t)) return NULL;
+    counting_header_t* h = counting_inner.malloc(counting_inner.context, sizeof(counting_header_t) + size);
+    if(h == NULL) return NULL;
+    h->size = size;
+    count_alloc(size);
+    return h + 1;
+}
+
+static void* counting_calloc(void* context, size_t nmemb, size_t size) {
+    if(size != 0 && nmemb > (SIZE_MAX - sizeof(counting_header_t)) / size) return NULL;
+    size_t total = nmemb * size;
+    counting_header_t* h = counting_inner.calloc(counting_inner.context, 1, sizeof(counting_header_t) + total);
+    if(h == NULL) return NULL;
+    h->size = total;
+    count_alloc(total);
+    return h + 1;
+}
+
+static void* counting_realloc(void* context, void* ptr, size_t size) {
+    if(ptr == NULL) return counting_malloc(context, size);
+    if(size > SIZE_MAX - sizeof(counting_header_t)) return NULL;
+    counting_header_t* h = (counting_header_t*)ptr - 1;
+    size_t old_size = h->size;
+    h = counting_inner.realloc(counting_inner.context, h, sizeof(counting_header_t) + size);
+    if(h == NULL) return NULL;
+    h->size = size;
+    atomic_fetch_sub(&bytes_in_use, old_size);
+    count_alloc(size);
+    return h + 1;
+}
+
+static void counting_free(void* context, void* ptr) {
+    counting_header_t* h = (counting_header_t*)ptr - 1;
+    atomic_fetch_add(&nof_frees, 1);
+    atomic_fetch_sub(&bytes_in_use, h->size);
+    counting_inner.free(counting_inner.context, h);
+}
+
+void allocator_counting_install() {
+    if(current.malloc == counting_malloc) return;
+    counting_inner = current;
+    allocator_t counting = {
+        counting_malloc, counting_calloc, counting_realloc, counting_free, NULL
+    };
+    allocator_set(&counting);
+}
+
+void allocator_counting_get_stats(allocator_stats_t* stats) {
+    stats->nof_allocs = atomic_load(&nof_allocs);
+    stats->nof_frees = atomic_load(&nof_frees);
+    stats->bytes_allocated = atomic_load(&bytes_allocated);
+    stats->bytes_in_use = atomic_load(&bytes_in_use);
+    stats->peak_bytes_in_use = atomic_load(&peak_bytes_in_use);
+}
+
+void allocator_counting_reset_stats() {
+    atomic_store(&nof_allocs, 0);
+    atomic_store(&nof_frees, 0);
+    atomic_store(&bytes_allocated, 0);
+    atomic_store(&peak_bytes_in_use, atomic_load(&bytes_in_use));
+}
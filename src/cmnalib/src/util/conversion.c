@@ -8,6 +8,7 @@
 #include "cmnalib/logger.h"
 #include "cmnalib/tokenfind.h"
 #include "cmnalib/conversion.h"
+#include "cmnalib/allocator.h"
 
 int conversion_str_to_int(const char* str, int base) {
     errno = 0;
@@ -61,7 +62,7 @@ const char* conversion_duplicate_str(const char* str) {
     char* result = NULL;
     if(str != NULL) {
         int len = strlen(str);
-        char* result = calloc(len+1, sizeof(char));
+        char* result = allocator_calloc(len+1, sizeof(char));
         if(result != NULL) {
             strcpy(result, str);
         }
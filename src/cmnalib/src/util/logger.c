@@ -1,29 +1,585 @@
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <syslog.h>
 
 #include <sys/time.h>
 #include <sys/types.h>
 
-#include "cmnalib/logger.h" 
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "cmnalib/logger.h"
+
+#define LOGGER_SLOT_TEXT_SIZE 480
+#define LOGGER_TIMESTAMP_SIZE 32
+
+#define LOGGER_CONFIG_ENTRY_SIZE 256
 
 // global flag
 int enable_logger = 1;
 
+/*
+ * Runtime levels
+ * AT, QMI and device layers log every command and response at DEBUG level,
+ * so they start at INFO. Use e.g. CMNALIB_LOG=at=debug to see them.
+ */
+
+int logger_levels[LOGGER_MODULE_COUNT] = {
+    [LOGGER_MODULE_DEFAULT]   = LOGGER_VERBOSE_DEBUG,
+    [LOGGER_MODULE_AT]        = LOGGER_VERBOSE_INFO,
+    [LOGGER_MODULE_TOKENFIND] = LOGGER_VERBOSE_DEBUG,
+    [LOGGER_MODULE_DEVICES]   = LOGGER_VERBOSE_INFO,
+    [LOGGER_MODULE_TRAFFIC]   = LOGGER_VERBOSE_DEBUG,
+    [LOGGER_MODULE_TRACE]     = LOGGER_VERBOSE_DEBUG,
+    [LOGGER_MODULE_QMI]       = LOGGER_VERBOSE_INFO,
+};
+
+static const char* module_names[LOGGER_MODULE_COUNT] = {
+    [LOGGER_MODULE_DEFAULT]   = "default",
+    [LOGGER_MODULE_AT]        = "at",
+    [LOGGER_MODULE_TOKENFIND] = "tokenfind",
+    [LOGGER_MODULE_DEVICES]   = "devices",
+    [LOGGER_MODULE_TRAFFIC]   = "traffic",
+    [LOGGER_MODULE_TRACE]     = "trace",
+    [LOGGER_MODULE_QMI]       = "qmi",
+};
+
+void logger_set_level(int module, int level) {
+    if(module >= 0 && module < LOGGER_MODULE_COUNT) {
+        __atomic_store_n(&logger_levels[module], level, __ATOMIC_RELAXED);
+    }
+}
+
+int logger_get_level(int module) {
+    if(module >= 0 && module < LOGGER_MODULE_COUNT) {
+        return __atomic_load_n(&logger_levels[module], __ATOMIC_RELAXED);
+    }
+    return LOGGER_VERBOSE_NONE;
+}
+
+void logger_set_all_levels(int level) {
+    for(int i = 0; i < LOGGER_MODULE_COUNT; i++) {
+        __atomic_store_n(&logger_levels[i], level, __ATOMIC_RELAXED);
+    }
+}
+
+int logger_module_from_name(const char* name) {
+    for(int i = 0; i < LOGGER_MODULE_COUNT; i++) {
+        if(strcasecmp(name, module_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int logger_level_from_name(const char* name) {
+    if(strcasecmp(name, "debug") == 0 || strcmp(name, "2") == 0) {
+        return LOGGER_VERBOSE_DEBUG;
+    }
+    if(strcasecmp(name, "info") == 0 || strcmp(name, "1") == 0) {
+        return LOGGER_VERBOSE_INFO;
+    }
+    if(strcasecmp(name, "none") == 0 || strcasecmp(name, "off") == 0 || strcmp(name, "0") == 0) {
+        return LOGGER_VERBOSE_NONE;
+    }
+    return -1;
+}
+
+/*
+ * Sinks
+ */
+
+static pthread_mutex_t sink_lock = PTHREAD_MUTEX_INITIALIZER;
+static logger_sink_t* sinks[LOGGER_MAX_SINKS];
+static atomic_int nof_sinks = 0;
+
+int logger_add_sink(logger_sink_t* sink) {
+    int ret = -1;
+    if(sink == NULL) return -1;
+    pthread_mutex_lock(&sink_lock);
+    for(int i = 0; i < LOGGER_MAX_SINKS; i++) {
+        if(sinks[i] == NULL) {
+            sinks[i] = sink;
+            atomic_fetch_add(&nof_sinks, 1);
+            ret = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sink_lock);
+    return ret;
+}
+
+void logger_remove_sink(logger_sink_t* sink) {
+    logger_flush();
+    pthread_mutex_lock(&sink_lock);
+    for(int i = 0; i < LOGGER_MAX_SINKS; i++) {
+        if(sinks[i] != NULL && sinks[i] == sink) {
+            sinks[i] = NULL;
+            atomic_fetch_sub(&nof_sinks, 1);
+        }
+    }
+    pthread_mutex_unlock(&sink_lock);
+}
+
+void logger_remove_all_sinks() {
+    logger_flush();
+    pthread_mutex_lock(&sink_lock);
+    for(int i = 0; i < LOGGER_MAX_SINKS; i++) {
+        sinks[i] = NULL;
+    }
+    atomic_store(&nof_sinks, 0);
+    pthread_mutex_unlock(&sink_lock);
+}
+
+static char severity_of(const char* format) {
+    if(format[0] == '[' && format[1] != 0 && format[2] == ']') {
+        return format[1];
+    }
+    return 0;
+}
+
+/* write a formatted line to all sinks or the legacy stream */
+static void emit(FILE* stream, char severity, const struct timeval* t, const char* text, size_t len) {
+#if DO_LOG_ENABLE_TIMESTAMP
+    char line_buf[LOGGER_TIMESTAMP_SIZE + LOGGER_SLOT_TEXT_SIZE];
+    char* line = line_buf;
+    int prefix_len = snprintf(line_buf, LOGGER_TIMESTAMP_SIZE, "%ld.%06ld ", (long)t->tv_sec, (long)t->tv_usec);
+    size_t line_len = prefix_len + len;
+    if(line_len + 1 > sizeof(line_buf)) {
+        line = malloc(line_len + 1);
+        if(line == NULL) return;
+        memcpy(line, line_buf, prefix_len);
+    }
+    memcpy(line + prefix_len, text, len);
+    line[line_len] = 0;
+#else
+    (void)t;
+    const char* line = text;
+    size_t line_len = len;
+#endif
+
+    if(atomic_load(&nof_sinks) == 0) {
+        fwrite(line, 1, line_len, stream);
+    }
+    else {
+        pthread_mutex_lock(&sink_lock);
+        for(int i = 0; i < LOGGER_MAX_SINKS; i++) {
+            if(sinks[i] != NULL) {
+                sinks[i]->write(sinks[i]->context, severity, line, line_len);
+            }
+        }
+        pthread_mutex_unlock(&sink_lock);
+    }
+
+#if DO_LOG_ENABLE_TIMESTAMP
+    if(line != line_buf) free(line);
+#endif
+}
+
+typedef struct stream_sink_context {
+    FILE* stream;
+    int owned;
+} stream_sink_context_t;
+
+static void stream_sink_write(void* sink_context, char severity, const char* line, size_t len) {
+    stream_sink_context_t* c = (stream_sink_context_t*)sink_context;
+    (void)severity;
+    fwrite(line, 1, len, c->stream);
+}
+
+static void stream_sink_close(void* sink_context) {
+    stream_sink_context_t* c = (stream_sink_context_t*)sink_context;
+    if(c->owned) {
+        fclose(c->stream);
+    }
+    else {
+        fflush(c->stream);
+    }
+    free(c);
+}
+
+static logger_sink_t* create_sink(logger_sink_write_func* write, void (*close)(void*), void* context) {
+    logger_sink_t* sink = calloc(1, sizeof(logger_sink_t));
+    if(sink == NULL) {
+        close(context);
+        return NULL;
+    }
+    sink->write = write;
+    sink->close = close;
+    sink->context = context;
+    return sink;
+}
+
+logger_sink_t* logger_sink_stream(FILE* stream) {
+    stream_sink_context_t* c = calloc(1, sizeof(stream_sink_context_t));
+    if(c == NULL) return NULL;
+    c->stream = stream;
+    c->owned = 0;
+    return create_sink(stream_sink_write, stream_sink_close, c);
+}
+
+logger_sink_t* logger_sink_file(const char* filename) {
+    stream_sink_context_t* c = calloc(1, sizeof(stream_sink_context_t));
+    if(c == NULL) return NULL;
+    c->stream = fopen(filename, "a");
+    if(c->stream == NULL) {
+        fprintf(stderr, "Could not open logfile '%s': %s\n", filename, strerror(errno));
+        free(c);
+        return NULL;
+    }
+    c->owned = 1;
+    return create_sink(stream_sink_write, stream_sink_close, c);
+}
+
+static void syslog_sink_write(void* sink_context, char severity, const char* line, size_t len) {
+    int priority;
+    (void)sink_context;
+    switch(severity) {
+    case 'D': priority = LOG_DEBUG; break;
+    case 'W': priority = LOG_WARNING; break;
+    case 'E': priority = LOG_ERR; break;
+    default:  priority = LOG_INFO; break;
+    }
+    // syslog adds its own timestamp and newline
+    syslog(priority, "%.*s", (int)(len > 0 && line[len-1] == '\n' ? len-1 : len), line);
+}
+
+static void syslog_sink_close(void* sink_context) {
+    (void)sink_context;
+    closelog();
+}
+
+logger_sink_t* logger_sink_syslog(const char* ident) {
+    openlog(ident, LOG_PID, LOG_USER);
+    return create_sink(syslog_sink_write, syslog_sink_close, NULL);
+}
+
+typedef struct memory_sink_context {
+    char* buf;
+    size_t capacity;
+    size_t pos;         // total bytes written
+} memory_sink_context_t;
+
+static void memory_sink_write(void* sink_context, char severity, const char* line, size_t len) {
+    memory_sink_context_t* c = (memory_sink_context_t*)sink_context;
+    (void)severity;
+    if(len > c->capacity) {
+        line += len - c->capacity;
+        len = c->capacity;
+    }
+    for(size_t i = 0; i < len; i++) {
+        c->buf[(c->pos + i) % c->capacity] = line[i];
+    }
+    c->pos += len;
+}
+
+static void memory_sink_close(void* sink_context) {
+    memory_sink_context_t* c = (memory_sink_context_t*)sink_context;
+    free(c->buf);
+    free(c);
+}
+
+logger_sink_t* logger_sink_memory(size_t capacity) {
+    if(capacity == 0) return NULL;
+    memory_sink_context_t* c = calloc(1, sizeof(memory_sink_context_t));
+    if(c == NULL) return NULL;
+    c->buf = malloc(capacity);
+    if(c->buf == NULL) {
+        free(c);
+        return NULL;
+    }
+    c->capacity = capacity;
+    return create_sink(memory_sink_write, memory_sink_close, c);
+}
+
+size_t logger_sink_memory_read(logger_sink_t* sink, char* buf, size_t buf_size) {
+    if(sink == NULL || sink->write != memory_sink_write || buf == NULL || buf_size == 0) {
+        return 0;
+    }
+    logger_flush();
+    pthread_mutex_lock(&sink_lock);
+    memory_sink_context_t* c = (memory_sink_context_t*)sink->context;
+    size_t len = c->pos < c->capacity ? c->pos : c->capacity;
+    if(len > buf_size - 1) len = buf_size - 1;
+    size_t start = c->pos - len;
+    for(size_t i = 0; i < len; i++) {
+        buf[i] = c->buf[(start + i) % c->capacity];
+    }
+    buf[len] = 0;
+    pthread_mutex_unlock(&sink_lock);
+    return len;
+}
+
+void logger_sink_destroy(logger_sink_t* sink) {
+    if(sink != NULL) {
+        if(sink->close != NULL) {
+            sink->close(sink->context);
+        }
+        free(sink);
+    }
+}
+
+/*
+ * Asynchronous ring (bounded multi-producer queue with per-slot sequence numbers)
+ */
+
+typedef struct log_slot {
+    atomic_size_t seq;
+    FILE* stream;
+    char severity;
+    struct timeval t;
+    size_t len;
+    char* heap_text;    // for messages exceeding the slot
+    char text[LOGGER_SLOT_TEXT_SIZE];
+} log_slot_t;
+
+typedef struct log_ring {
+    log_slot_t* slots;
+    size_t mask;
+    atomic_size_t enqueue_pos;
+    size_t dequeue_pos;
+    atomic_size_t processed;
+    atomic_size_t dropped;
+    sem_t pending;
+    atomic_int running;
+    pthread_t thread;
+} log_ring_t;
+
+static log_ring_t* _Atomic ring = NULL;
+
+static log_slot_t* ring_claim(log_ring_t* r) {
+    size_t pos = atomic_load_explicit(&r->enqueue_pos, memory_order_relaxed);
+    while(1) {
+        log_slot_t* slot = &r->slots[pos & r->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if(diff == 0) {
+            if(atomic_compare_exchange_weak_explicit(&r->enqueue_pos, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed)) {
+                return slot;
+            }
+        }
+        else if(diff < 0) {
+            return NULL;    // full
+        }
+        else {
+            pos = atomic_load_explicit(&r->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static void ring_publish(log_ring_t* r, log_slot_t* slot) {
+    size_t pos = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    sem_post(&r->pending);
+}
+
+/* single consumer, returns 1 if a message was written */
+static int ring_consume(log_ring_t* r) {
+    log_slot_t* slot = &r->slots[r->dequeue_pos & r->mask];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if(seq != r->dequeue_pos + 1) {
+        return 0;
+    }
+    if(slot->heap_text != NULL) {
+        emit(slot->stream, slot->severity, &slot->t, slot->heap_text, slot->len);
+        free(slot->heap_text);
+        slot->heap_text = NULL;
+    }
+    else {
+        emit(slot->stream, slot->severity, &slot->t, slot->text, slot->len);
+    }
+    atomic_store_explicit(&slot->seq, r->dequeue_pos + r->mask + 1, memory_order_release);
+    r->dequeue_pos++;
+    atomic_fetch_add_explicit(&r->processed, 1, memory_order_release);
+    return 1;
+}
+
+static void* ring_writer(void* void_ring) {
+    log_ring_t* r = (log_ring_t*)void_ring;
+    while(1) {
+        sem_wait(&r->pending);
+        // a slot may be claimed before its predecessor is published
+        while(!ring_consume(r)) {
+            if(!atomic_load(&r->running) && atomic_load(&r->enqueue_pos) == r->dequeue_pos) {
+                return NULL;
+            }
+            sched_yield();
+        }
+    }
+}
+
+int logger_start_async(size_t ring_slots) {
+    if(atomic_load(&ring) != NULL) {
+        return 0;
+    }
+    size_t n = 2;
+    while(n < ring_slots) n *= 2;
+
+    log_ring_t* r = calloc(1, sizeof(log_ring_t));
+    if(r == NULL) return -1;
+    r->slots = calloc(n, sizeof(log_slot_t));
+    if(r->slots == NULL) {
+        free(r);
+        return -1;
+    }
+    r->mask = n - 1;
+    for(size_t i = 0; i < n; i++) {
+        atomic_init(&r->slots[i].seq, i);
+    }
+    atomic_init(&r->enqueue_pos, 0);
+    atomic_init(&r->processed, 0);
+    atomic_init(&r->dropped, 0);
+    atomic_init(&r->running, 1);
+    sem_init(&r->pending, 0, 0);
+    if(pthread_create(&r->thread, NULL, ring_writer, r) != 0) {
+        sem_destroy(&r->pending);
+        free(r->slots);
+        free(r);
+        return -1;
+    }
+    atomic_store(&ring, r);
+    return 0;
+}
+
+void logger_stop_async() {
+    log_ring_t* r = atomic_exchange(&ring, NULL);
+    if(r != NULL) {
+        atomic_store(&r->running, 0);
+        sem_post(&r->pending);
+        pthread_join(r->thread, NULL);
+        if(atomic_load(&r->dropped) > 0) {
+            fprintf(stderr, "Logger dropped %zu messages\n", atomic_load(&r->dropped));
+        }
+        sem_destroy(&r->pending);
+        free(r->slots);
+        free(r);
+    }
+}
+
+void logger_flush() {
+    log_ring_t* r = atomic_load(&ring);
+    if(r != NULL) {
+        size_t target = atomic_load(&r->enqueue_pos);
+        struct timespec t = {0, 100000};
+        while(atomic_load_explicit(&r->processed, memory_order_acquire) < target) {
+            nanosleep(&t, NULL);
+        }
+    }
+    fflush(stdout);
+}
+
+size_t logger_get_dropped() {
+    log_ring_t* r = atomic_load(&ring);
+    return r != NULL ? atomic_load(&r->dropped) : 0;
+}
+
+/*
+ * Entry point of all macros
+ */
+
 void do_log(FILE* stream, const char * format, ...) {
     if(enable_logger) {
-#if DO_LOG_ENABLE_TIMESTAMP
         struct timeval t;
+        va_list myargs;
+        log_ring_t* r = atomic_load_explicit(&ring, memory_order_acquire);
+
         gettimeofday(&t, NULL);
-        fprintf(stream, "%ld.%06ld ", t.tv_sec, t.tv_usec);
+
+        if(r != NULL) {
+            log_slot_t* slot = ring_claim(r);
+            if(slot == NULL) {
+                atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+                return;
+            }
+            slot->stream = stream;
+            slot->severity = severity_of(format);
+            slot->t = t;
+            slot->heap_text = NULL;
+            va_start(myargs, format);
+            int len = vsnprintf(slot->text, sizeof(slot->text), format, myargs);
+            va_end(myargs);
+            if(len < 0) len = 0;
+            if((size_t)len >= sizeof(slot->text)) {
+                // long messages (e.g. full AT responses) go to the heap
+                slot->heap_text = malloc(len + 1);
+                if(slot->heap_text != NULL) {
+                    va_start(myargs, format);
+                    vsnprintf(slot->heap_text, len + 1, format, myargs);
+                    va_end(myargs);
+                }
+                else {
+                    len = sizeof(slot->text) - 1;
+                }
+            }
+            slot->len = len;
+            ring_publish(r, slot);
+            return;
+        }
+
+        if(atomic_load(&nof_sinks) == 0) {
+            // legacy synchronous output
+#if DO_LOG_ENABLE_TIMESTAMP
+            fprintf(stream, "%ld.%06ld ", t.tv_sec, t.tv_usec);
 #endif
-        va_list myargs;
+            va_start(myargs, format);
+            vfprintf(stream, format, myargs);
+            va_end(myargs);
+            return;
+        }
+
+        char text[LOGGER_SLOT_TEXT_SIZE];
+        char* heap_text = NULL;
         va_start(myargs, format);
-        vfprintf(stream, format, myargs);
+        int len = vsnprintf(text, sizeof(text), format, myargs);
         va_end(myargs);
+        if(len < 0) return;
+        if((size_t)len >= sizeof(text)) {
+            heap_text = malloc(len + 1);
+            if(heap_text != NULL) {
+                va_start(myargs, format);
+                vsnprintf(heap_text, len + 1, format, myargs);
+                va_end(myargs);
+            }
+            else {
+                len = sizeof(text) - 1;
+            }
+        }
+        emit(stream, severity_of(format), &t, heap_text != NULL ? heap_text : text, len);
+        free(heap_text);
     }
 }
 
+int logger_ratelimit_pass(logger_ratelimit_t* r, double interval_sec, unsigned int* suppressed) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    unsigned long long now_us = (unsigned long long)now.tv_sec * 1000000 + now.tv_usec;
+    unsigned long long last_us = __atomic_load_n(&r->last_us, __ATOMIC_ACQUIRE);
+
+    // a clock running backwards lets the message pass
+    if(last_us != 0 && now_us >= last_us && now_us - last_us < interval_sec * 1e6) {
+        __atomic_fetch_add(&r->suppressed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    // only one of the threads racing for the same interval wins
+    if(!__atomic_compare_exchange_n(&r->last_us, &last_us, now_us, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_add(&r->suppressed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    *suppressed = __atomic_exchange_n(&r->suppressed, 0, __ATOMIC_RELAXED);
+    return 1;
+}
+
 
 int timeval_subtract (struct timeval *result,
                       struct timeval *x,
@@ -48,3 +604,102 @@ int timeval_subtract (struct timeval *result,
     /* Return 1 if result is negative. */
     return x->tv_sec < y->tv_sec;
 }
+
+/*
+ * Configuration string
+ */
+
+static logger_sink_t* sink_from_name(const char* name) {
+    if(strcmp(name, "stdout") == 0) {
+        return logger_sink_stream(stdout);
+    }
+    if(strcmp(name, "stderr") == 0) {
+        return logger_sink_stream(stderr);
+    }
+    if(strcmp(name, "syslog") == 0) {
+        return logger_sink_syslog("cmnalib");
+    }
+    if(strncmp(name, "syslog:", 7) == 0) {
+        // openlog keeps the pointer, so the ident must stay valid
+        char* ident = strdup(name + 7);
+        return ident != NULL ? logger_sink_syslog(ident) : NULL;
+    }
+    if(strncmp(name, "file:", 5) == 0) {
+        return logger_sink_file(name + 5);
+    }
+    return NULL;
+}
+
+static int apply_config_entry(char* entry) {
+    char* value = strchr(entry, '=');
+    if(value == NULL) return -1;
+    *value++ = 0;
+
+    if(strcmp(entry, "sink") == 0) {
+        // configured sinks live until the process exits
+        logger_sink_t* sink = sink_from_name(value);
+        if(sink == NULL || logger_add_sink(sink) != 0) {
+            logger_sink_destroy(sink);
+            return -1;
+        }
+        return 0;
+    }
+    if(strcmp(entry, "async") == 0) {
+        int slots = atoi(value);
+        return slots > 0 ? logger_start_async(slots) : -1;
+    }
+
+    int level = logger_level_from_name(value);
+    if(level < 0) return -1;
+    if(strcmp(entry, "*") == 0) {
+        logger_set_all_levels(level);
+        return 0;
+    }
+    int module = logger_module_from_name(entry);
+    if(module < 0) return -1;
+    logger_set_level(module, level);
+    return 0;
+}
+
+int logger_configure(const char* config) {
+    char entry[LOGGER_CONFIG_ENTRY_SIZE];
+    int ret = 0;
+    if(config == NULL) return 0;
+
+    while(*config != 0) {
+        size_t len = strcspn(config, ",");
+        // trim surrounding whitespace
+        const char* start = config;
+        size_t n = len;
+        while(n > 0 && isspace((unsigned char)*start)) { start++; n--; }
+        while(n > 0 && isspace((unsigned char)start[n-1])) n--;
+
+        if(n > 0) {
+            if(n < sizeof(entry)) {
+                memcpy(entry, start, n);
+                entry[n] = 0;
+                if(apply_config_entry(entry) != 0) {
+                    fprintf(stderr, "Invalid logger configuration '%.*s'\n", (int)n, start);
+                    ret = -1;
+                }
+            }
+            else {
+                fprintf(stderr, "Logger configuration entry too long\n");
+                ret = -1;
+            }
+        }
+        config += len;
+        if(*config == ',') config++;
+    }
+    return ret;
+}
+
+int logger_configure_from_env() {
+    return logger_configure(getenv(LOGGER_ENV_VARIABLE));
+}
+
+/* every application picks up CMNALIB_LOG without code changes */
+__attribute__((constructor))
+static void logger_init_from_env() {
+    logger_configure_from_env();
+}
@@ -7,6 +7,8 @@
 
 #include <regex.h>
 
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE TOKENFIND
 #include "cmnalib/logger.h"
 #include "cmnalib/tokenfind.h"
 #include "cmnalib/conversion.h"
@@ -17,11 +19,21 @@ int tokenfind_integer_batch(const char* src_sequence,
                             void *base_ptr,
                             tokenfind_batch_t* job,
                             int n_jobs) {
+    return tokenfind_integer_batch_masked(src_sequence, base_ptr, job, n_jobs, UINT64_MAX, NULL);
+}
+
+int tokenfind_integer_batch_masked(const char* src_sequence,
+                                   void *base_ptr,
+                                   tokenfind_batch_t* job,
+                                   int n_jobs,
+                                   uint64_t mask,
+                                   uint64_t* found) {
     int n_success = 0;
     int ret = 0;
     int* target = NULL;
 
     for(int i=0; i<n_jobs; i++) {
+        if(!(mask & (1ull << job[i].field))) continue;
         int tmp_result = 0;
         ret = tokenfind_integer_single(src_sequence,
                                        &tmp_result,
@@ -31,6 +43,7 @@ int tokenfind_integer_batch(const char* src_sequence,
         if(ret > 0) {
             target = ((int*)base_ptr + job[i].member_offset/sizeof(int));
             *target = tmp_result;
+            if(found != NULL) *found |= 1ull << job[i].field;
             n_success++;
         }
     }
@@ -77,11 +90,21 @@ int tokenfind_float_batch(const char* src_sequence,
                             void *base_ptr,
                             tokenfind_batch_t* job,
                             int n_jobs) {
+    return tokenfind_float_batch_masked(src_sequence, base_ptr, job, n_jobs, UINT64_MAX, NULL);
+}
+
+int tokenfind_float_batch_masked(const char* src_sequence,
+                                 void *base_ptr,
+                                 tokenfind_batch_t* job,
+                                 int n_jobs,
+                                 uint64_t mask,
+                                 uint64_t* found) {
     int n_success = 0;
     int ret = 0;
     float* target = NULL;
 
     for(int i=0; i<n_jobs; i++) {
+        if(!(mask & (1ull << job[i].field))) continue;
         float tmp_result = 0;
         ret = tokenfind_float_single(src_sequence,
                                        &tmp_result,
@@ -90,6 +113,7 @@ int tokenfind_float_batch(const char* src_sequence,
         if(ret > 0) {
             target = ((float*)base_ptr + job[i].member_offset/sizeof(float));
             *target = tmp_result;
+            if(found != NULL) *found |= 1ull << job[i].field;
             n_success++;
         }
     }
@@ -132,17 +156,28 @@ int tokenfind_string_batch(const char* src_sequence,
                            tokenfind_batch_t* job,
                            int n_jobs,
                            int str_len) {
+    return tokenfind_string_batch_masked(src_sequence, base_ptr, job, n_jobs, str_len, UINT64_MAX, NULL);
+}
+
+int tokenfind_string_batch_masked(const char* src_sequence,
+                                  void *base_ptr,
+                                  tokenfind_batch_t* job,
+                                  int n_jobs,
+                                  int str_len,
+                                  uint64_t mask,
+                                  uint64_t* found) {
     int n_success = 0;
     int len = 0;
     char* target = NULL;
 
-    char* tmp_result = calloc(str_len, sizeof(char));
+    char* tmp_result = allocator_calloc(str_len, sizeof(char));
     if(tmp_result == NULL) {
         ERROR("calloc failed\n");
         return 0;
     }
 
     for(int i=0; i<n_jobs; i++) {
+        if(!(mask & (1ull << job[i].field))) continue;
         tmp_result[0] = 0;
         len = tokenfind_string_single(src_sequence,
                                       tmp_result,
@@ -153,11 +188,12 @@ int tokenfind_string_batch(const char* src_sequence,
             target = ((char*)base_ptr + job[i].member_offset/sizeof(char));
             strncpy(target, tmp_result, MIN(str_len, len));
             target[MIN(str_len, len)] = 0;
+            if(found != NULL) *found |= 1ull << job[i].field;
             n_success++;
         }
     }
 
-    free(tmp_result);
+    allocator_free(tmp_result);
 
     return n_success;
 }
@@ -217,7 +253,7 @@ int tokenfind_match_regex_single(const char* src_sequence,
 
     if(regex_cache == NULL || *regex_cache == NULL) {
         /* Allocate new regex automaton */
-        regex = calloc(1, sizeof(regex_t));
+        regex = allocator_calloc(1, sizeof(regex_t));
         if(regex == NULL) {
             ERROR("Could not allocate memory for regex_t\n");
             return -1;
@@ -226,7 +262,7 @@ int tokenfind_match_regex_single(const char* src_sequence,
         ret = regcomp(regex, regex_string, 0);
         if(ret) {
             regfree(regex);
-            free(regex);
+            allocator_free(regex);
             regex = NULL;
             ERROR("Could not compile regex\n");
             return -1;
@@ -244,7 +280,7 @@ int tokenfind_match_regex_single(const char* src_sequence,
     ret = regexec(regex, src_sequence, N_MATCHES + 1, matches, 0);
     if(ret) {
         regfree(regex);
-        free(regex);
+        allocator_free(regex);
         regex = NULL;
         if(regex_cache != NULL) *regex_cache = NULL;
         char err_msg_buf[100];
@@ -286,7 +322,7 @@ int tokenfind_match_regex_multi(const char* src_sequence,
 
     if(regex_cache == NULL || *regex_cache == NULL) {
         /* Allocate new regex automaton */
-        regex = calloc(1, sizeof(regex_t));
+        regex = allocator_calloc(1, sizeof(regex_t));
         if(regex == NULL) {
             ERROR("Could not allocate memory for regex_t\n");
             return -1;
@@ -295,7 +331,7 @@ int tokenfind_match_regex_multi(const char* src_sequence,
         ret = regcomp(regex, regex_string, 0);
         if(ret) {
             regfree(regex);
-            free(regex);
+            allocator_free(regex);
             regex = NULL;
             ERROR("Could not compile regex\n");
             return -1;
@@ -319,7 +355,7 @@ int tokenfind_match_regex_multi(const char* src_sequence,
     else if(ret != 0) {
         /* Error */
         regfree(regex);
-        free(regex);
+        allocator_free(regex);
         regex = NULL;
         if(regex_cache != NULL) *regex_cache = NULL;
         char err_msg_buf[100];
@@ -347,27 +383,27 @@ int tokenfind_match_regex_multi(const char* src_sequence,
 void tokenfind_split_string_free(tokenfind_split_string_t* s) {
     if(s != NULL) {
         if(s->_strbuf != NULL) {
-            free(s->_strbuf);
+            allocator_free(s->_strbuf);
         }
         if(s->token != NULL) {
-            free(s->token);
+            allocator_free(s->token);
         }
         s->n_tokens = 0;
     }
-    free(s);
+    allocator_free(s);
 }
 
 tokenfind_split_string_t* tokenfind_split_string(const char* src_sequence, const char* delimiter) {
     char* context = NULL;
 
-    tokenfind_split_string_t* result = malloc(sizeof(tokenfind_split_string_t));
+    tokenfind_split_string_t* result = allocator_malloc(sizeof(tokenfind_split_string_t));
     if(result == NULL) {
         ERROR("Error in calloc\n");
         return NULL;
     }
     result->n_tokens = 0;
     result->token = NULL;
-    result->_strbuf = calloc(strlen(src_sequence)+1, sizeof(char));
+    result->_strbuf = allocator_calloc(strlen(src_sequence)+1, sizeof(char));
     if(result->_strbuf == NULL) {
         ERROR("Error in calloc\n");
         tokenfind_split_string_free(result);
@@ -377,7 +413,7 @@ tokenfind_split_string_t* tokenfind_split_string(const char* src_sequence, const
     strcpy(result->_strbuf, src_sequence);
     char* pos = strtok_r(result->_strbuf, delimiter, &context);
     while(pos != NULL) {
-        result->token = realloc(result->token, sizeof(char*) * ++(result->n_tokens));
+        result->token = allocator_realloc(result->token, sizeof(char*) * ++(result->n_tokens));
         if(result->token == NULL) {
             ERROR("Error in realloc\n");
             tokenfind_split_string_free(result);
@@ -391,7 +427,7 @@ tokenfind_split_string_t* tokenfind_split_string(const char* src_sequence, const
 }
 
 tokenfind_string_table_t* tokenfind_parse_table(const char* src_sequence) {
-    tokenfind_string_table_t* t = malloc(sizeof(tokenfind_string_table_t));
+    tokenfind_string_table_t* t = allocator_malloc(sizeof(tokenfind_string_table_t));
     if(t == NULL) {
         ERROR("Error in malloc\n");
         return NULL;
@@ -404,7 +440,7 @@ tokenfind_string_table_t* tokenfind_parse_table(const char* src_sequence) {
     tokenfind_split_string_t* rows = tokenfind_split_string(src_sequence, "\r\n");
 
     if(rows != NULL && rows->n_tokens > 0) {
-        t->row = calloc(rows->n_tokens, sizeof(tokenfind_string_table_row_t));
+        t->row = allocator_calloc(rows->n_tokens, sizeof(tokenfind_string_table_row_t));
         if(t->row == NULL) {
             ERROR("Error in calloc\n");
             tokenfind_free_table(t);
@@ -415,7 +451,7 @@ tokenfind_string_table_t* tokenfind_parse_table(const char* src_sequence) {
             /* split each row into columns */
             tokenfind_split_string_t* columns = tokenfind_split_string(rows->token[row_idx], " \t");
             if(columns != NULL && columns->n_tokens > 0) {
-                t->row[row_idx].column = calloc(columns->n_tokens, sizeof(char*));
+                t->row[row_idx].column = allocator_calloc(columns->n_tokens, sizeof(char*));
                 if(t->row[row_idx].column == NULL) {
                     ERROR("Error in calloc\n");
                     tokenfind_free_table(t);
@@ -426,7 +462,7 @@ tokenfind_string_table_t* tokenfind_parse_table(const char* src_sequence) {
                 for(int col_idx = 0; col_idx < columns->n_tokens; col_idx++) {
                     // copy each item
                     int elem_len = strlen(columns->token[col_idx]);
-                    t->row[row_idx].column[col_idx] = calloc(elem_len+1, sizeof(char));
+                    t->row[row_idx].column[col_idx] = allocator_calloc(elem_len+1, sizeof(char));
                     if(t->row[row_idx].column[col_idx] == NULL) {
                         ERROR("Error in calloc\n");
                         tokenfind_free_table(t);
@@ -449,16 +485,16 @@ void tokenfind_free_table(tokenfind_string_table_t* t) {
             for(int row_idx = 0; row_idx < t->n_rows; row_idx++) {
                 if(t->row[row_idx].column != NULL) {
                     for(int col_idx = 0; col_idx < t->row[row_idx].n_columns; col_idx++) {
-                        free(t->row[row_idx].column[col_idx]);
+                        allocator_free(t->row[row_idx].column[col_idx]);
                     }
                     t->row[row_idx].n_columns = 0;
                 }
-                free(t->row[row_idx].column);
+                allocator_free(t->row[row_idx].column);
             }
         }
-        free(t->row);
+        allocator_free(t->row);
         t->n_colums = 0;
         t->n_rows = 0;
-        free(t);
+        allocator_free(t);
     }
 }
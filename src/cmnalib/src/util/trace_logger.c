@@ -8,10 +8,12 @@
 #include <sys/types.h>
 
 #include "cmnalib/trace_logger.h"
+#include "cmnalib/allocator.h"
+#define LOGGER_MODULE TRACE
 #include "cmnalib/logger.h"
 
 trace_handle_t* trace_init(const char *filename) {
-    trace_handle_t* h = calloc(1, sizeof(trace_handle_t));
+    trace_handle_t* h = allocator_calloc(1, sizeof(trace_handle_t));
     if(h != NULL) {
         errno = 0;
         h->tracefile = fopen(filename, "w");
@@ -20,7 +22,7 @@ trace_handle_t* trace_init(const char *filename) {
         }
         else {
             ERROR("Could not open file '%s': %s\n", filename, strerror(errno));
-            free(h);
+            allocator_free(h);
             h = NULL;
         }
     }
@@ -36,7 +38,7 @@ void trace_destroy(trace_handle_t* h) {
         fclose(h->tracefile);
         h->tracefile = NULL;
     }
-    free(h);
+    allocator_free(h);
     h = NULL;
 }
 
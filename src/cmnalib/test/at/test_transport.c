@@ -0,0 +1,378 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "cmnalib/logger.h"
+
+#include "cmnalib/allocator.h"
+#include "cmnalib/at_interface.h"
+#include "cmnalib/at_simulator.h"
+#include "cmnalib/at_sierra_wireless_em7565.h"
+
+#define TEST_SUCCESS EXIT_SUCCESS
+#define TEST_FAIL    EXIT_FAILURE
+
+int __assert_result_summary__(int res) {
+    switch(res) {
+    case TEST_SUCCESS:
+        INFO("Test passed\n");
+        break;
+    case TEST_FAIL:
+        ERROR("Test failed\n");
+        break;
+    }
+    return res;
+}
+
+#define ASSERT_INIT() int __as_result__ = TEST_SUCCESS
+#define ASSERT_FAIL() __as_result__ = TEST_FAIL
+#define ASSERT_RESULT() __assert_result_summary__(__as_result__)
+
+#define ASSERT_CALL(A) INFO("Testing " TOSTRING(A)"\n"); if(A != TEST_SUCCESS) { ASSERT_FAIL(); }
+#define ASSERT_INT(A, B) if(A != B) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_STR(A, B) if(A == NULL || strcmp(A, B) != 0) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_NOT_NULL(A) if(A == NULL) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+
+#define RECORDING_FILE "/tmp/cmnalib_test_recording.txt"
+
+static const at_interface_command_t gstatus = {0, "at!gstatus?", 1, 0};
+static const at_interface_command_t ati = {0, "ati", 1, 0};
+
+static long elapsed_ms(const struct timeval* start) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_usec - start->tv_usec) / 1000;
+}
+
+int record_replay_1() {
+    ASSERT_INIT();
+
+    const char fixture[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    at_interface_response_t* recorded = NULL;
+    at_interface_response_t* replayed = NULL;
+
+    at_interface_t* h = at_interface_open_transport(at_transport_recorder(at_transport_file_mock(fixture), RECORDING_FILE));
+    if(h == NULL) return TEST_FAIL;
+    ASSERT_INT(at_interface_command(h, &gstatus, NULL, &recorded), AT_RESPONSE_SUCCESS);
+    at_interface_close(h);
+
+    h = at_interface_open("replay:" RECORDING_FILE);
+    ASSERT_NOT_NULL(h);
+    if(h != NULL) {
+        ASSERT_INT(at_interface_command(h, &gstatus, NULL, &replayed), AT_RESPONSE_SUCCESS);
+        ASSERT_STR(replayed->response_string, recorded->response_string);
+        at_interface_free_response(replayed);
+
+        // the recording holds only one command
+        ASSERT_INT(at_interface_command(h, &gstatus, NULL, &replayed), AT_RESPONSE_TEST_COMMAND_MISMATCH);
+        at_interface_free_response(replayed);
+        at_interface_close(h);
+    }
+    at_interface_free_response(recorded);
+    unlink(RECORDING_FILE);
+
+    return ASSERT_RESULT();
+}
+
+int replay_timing_1() {
+    ASSERT_INIT();
+
+    const char realtime[] = "replay-realtime:" TOSTRING(TEST_PATH)"/test/at/replay_timing_1.txt";
+    const char fast[] = "replay:" TOSTRING(TEST_PATH)"/test/at/replay_timing_1.txt";
+    at_interface_response_t* response = NULL;
+    struct timeval start;
+
+    // response completes 100 ms after the command
+    at_interface_t* h = at_interface_open(realtime);
+    if(h == NULL) return TEST_FAIL;
+    gettimeofday(&start, NULL);
+    ASSERT_INT(at_interface_command(h, &ati, NULL, &response), AT_RESPONSE_SUCCESS);
+    long duration = elapsed_ms(&start);
+    if(duration < 95 || duration > 1000) {
+        ERROR("Realtime replay took %ld ms\n", duration);
+        ASSERT_FAIL();
+    }
+    ASSERT_STR(response->response_string, "\r\nManufacturer: Sierra Wireless, Incorporated\r\nModel: EM7565\r\n\r\nOK\r\n");
+    at_interface_free_response(response);
+    at_interface_close(h);
+
+    h = at_interface_open(fast);
+    if(h == NULL) return TEST_FAIL;
+    gettimeofday(&start, NULL);
+    ASSERT_INT(at_interface_command(h, &ati, NULL, &response), AT_RESPONSE_SUCCESS);
+    duration = elapsed_ms(&start);
+    if(duration >= 50) {
+        ERROR("Fast replay took %ld ms\n", duration);
+        ASSERT_FAIL();
+    }
+    at_interface_free_response(response);
+    at_interface_close(h);
+
+    return ASSERT_RESULT();
+}
+
+int simulator_1() {
+    ASSERT_INIT();
+
+    const char fixture[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    at_simulator_config_t config = {0};
+    config.chunk_size = 7;      // exercises reassembly over many reads
+    config.latency_us = 1000;
+
+    at_simulator_t* sim = at_simulator_create(&config);
+    if(sim == NULL) return TEST_FAIL;
+    ASSERT_INT(at_simulator_load_file(sim, fixture), 1);
+    ASSERT_INT(at_simulator_start(sim), 0);
+
+    sw_em7565_t* modem = sw_em7565_init(at_simulator_get_device(sim));
+    ASSERT_NOT_NULL(modem);
+    if(modem != NULL) {
+        sw_em7565_gstatus_response_t* status = sw_em7565_allocate_status();
+        for(int i = 0; i < 3; i++) {
+            ASSERT_INT(sw_em7565_get_status(modem, status), SW_RESPONSE_SUCCESS);
+            ASSERT_INT(status->current_time, 7480);
+            ASSERT_INT(status->lte_band, 3);
+            ASSERT_INT(status->cell_id, 0x01c07902);
+        }
+        sw_em7565_free_status(status);
+        // unknown to the simulator
+        ASSERT_INT(sw_em7565_reset(modem), SW_RESPONSE_FAILED);
+        sw_em7565_destroy(modem);
+    }
+
+    at_simulator_stats_t stats;
+    at_simulator_get_stats(sim, &stats);
+    ASSERT_INT(stats.nof_commands, 4);
+    ASSERT_INT(stats.nof_unknown, 1);
+    at_simulator_destroy(sim);
+
+    return ASSERT_RESULT();
+}
+
+int simulator_fault_1() {
+    ASSERT_INIT();
+
+    const char fixture[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    at_simulator_config_t config = {0};
+    config.timeout_probability = 1;
+
+    at_simulator_t* sim = at_simulator_create(&config);
+    if(sim == NULL) return TEST_FAIL;
+    at_simulator_load_file(sim, fixture);
+    ASSERT_INT(at_simulator_start(sim), 0);
+
+    at_interface_t* h = at_interface_open(at_simulator_get_device(sim));
+    ASSERT_NOT_NULL(h);
+    if(h != NULL) {
+        const at_interface_command_t quick_gstatus = {0, "at!gstatus?", 0, 100000};
+        at_interface_response_t* response = NULL;
+        ASSERT_INT(at_interface_command(h, &quick_gstatus, NULL, &response), AT_RESPONSE_TIMEOUT);
+        at_interface_free_response(response);
+        at_interface_close(h);
+    }
+    at_simulator_destroy(sim);
+
+    return ASSERT_RESULT();
+}
+
+/* answers OK to everything, holds the first command until released */
+typedef struct gated_transport {
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    int is_released;
+    int nof_writes;
+    char order[8][AT_INTERFACE_MAX_COMMAND_STRING_LENGTH];
+    int response_pending;
+} gated_transport_t;
+
+static int gated_write(void* context, const char* buf, size_t len) {
+    gated_transport_t* g = (gated_transport_t*)context;
+    pthread_mutex_lock(&g->lock);
+    if(g->nof_writes < 8) snprintf(g->order[g->nof_writes], AT_INTERFACE_MAX_COMMAND_STRING_LENGTH, "%.*s", (int)len - 1, buf);
+    if(g->nof_writes++ == 0) {
+        while(!g->is_released) pthread_cond_wait(&g->released, &g->lock);
+    }
+    g->response_pending = 1;
+    pthread_mutex_unlock(&g->lock);
+    return 0;
+}
+
+static int gated_read(void* context, char* buf, size_t buf_size, int timeout_ms) {
+    gated_transport_t* g = (gated_transport_t*)context;
+    if(!g->response_pending) return 0;
+    g->response_pending = 0;
+    return snprintf(buf, buf_size, "OK\n");
+}
+
+typedef struct scheduled_call {
+    at_interface_t* h;
+    const at_interface_command_t* cmd;
+    at_interface_priority_t priority;
+    int deadline_ms;
+    at_interface_response_status_t result;
+    pthread_t thread;
+} scheduled_call_t;
+
+static void* scheduled_call(void* arg) {
+    scheduled_call_t* c = (scheduled_call_t*)arg;
+    at_interface_response_t* response = NULL;
+    c->result = at_interface_command_scheduled(c->h, c->cmd, NULL, c->priority, c->deadline_ms, &response);
+    at_interface_free_response(response);
+    return NULL;
+}
+
+int scheduler_1() {
+    ASSERT_INIT();
+
+    static const at_interface_command_t scan = {0, "at+cops=?", 1, 0};
+    static const at_interface_command_t band = {0, "at!band?", 1, 0};
+    static const at_interface_command_t selrat = {0, "at!selrat?", 1, 0};
+    static const at_interface_command_t gpsend = {0, "at!gpsend", 1, 0};
+
+    gated_transport_t g = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+    at_transport_t* t = allocator_calloc(1, sizeof(at_transport_t));
+    t->write = gated_write;
+    t->read = gated_read;
+    t->context = &g;
+    t->line_separator = "\n";
+    at_interface_t* h = at_interface_open_transport(t);
+    if(h == NULL) return TEST_FAIL;
+
+    // ati holds the port while the others queue up
+    scheduled_call_t calls[] = {
+        {h, &ati, AT_PRIORITY_INTERACTIVE, 0},
+        {h, &scan, AT_PRIORITY_BACKGROUND, 0},
+        {h, &selrat, AT_PRIORITY_INTERACTIVE, 0},
+        {h, &band, AT_PRIORITY_INTERACTIVE, 100},
+        {h, &gstatus, AT_PRIORITY_REALTIME, 0},
+        {h, &gstatus, AT_PRIORITY_REALTIME, 0},
+        {h, &gpsend, AT_PRIORITY_BACKGROUND, 0},
+        {h, &gpsend, AT_PRIORITY_BACKGROUND, 0},
+    };
+    for(int i = 0; i < 8; i++) {
+        pthread_create(&calls[i].thread, NULL, scheduled_call, &calls[i]);
+        usleep(20000);
+    }
+    pthread_mutex_lock(&g.lock);
+    g.is_released = 1;
+    pthread_cond_broadcast(&g.released);
+    pthread_mutex_unlock(&g.lock);
+    for(int i = 0; i < 8; i++) {
+        pthread_join(calls[i].thread, NULL);
+        ASSERT_INT(calls[i].result, AT_RESPONSE_SUCCESS);
+    }
+
+    // sampling first and only once, then by deadline, scans last;
+    // commands which are no query are sent each time
+    ASSERT_INT(g.nof_writes, 7);
+    ASSERT_STR(g.order[0], "ati");
+    ASSERT_STR(g.order[1], "at!gstatus?");
+    ASSERT_STR(g.order[2], "at!band?");
+    ASSERT_STR(g.order[3], "at!selrat?");
+    ASSERT_STR(g.order[4], "at+cops=?");
+    ASSERT_STR(g.order[5], "at!gpsend");
+    ASSERT_STR(g.order[6], "at!gpsend");
+
+    at_interface_stats_t stats;
+    at_interface_get_stats(h, &stats);
+    ASSERT_INT(stats.nof_commands, 7);
+    ASSERT_INT(stats.nof_coalesced, 1);
+
+    at_interface_close(h);
+
+    return ASSERT_RESULT();
+}
+
+int cache_1() {
+    ASSERT_INIT();
+
+    // two threads asking while the first query is on the wire
+    gated_transport_t g = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+    at_transport_t* t = allocator_calloc(1, sizeof(at_transport_t));
+    t->write = gated_write;
+    t->read = gated_read;
+    t->context = &g;
+    t->line_separator = "\n";
+    at_interface_t* h = at_interface_open_transport(t);
+    if(h == NULL) return TEST_FAIL;
+    ASSERT_INT(at_interface_set_cache_window(h, &gstatus, 10000), 0);
+
+    scheduled_call_t calls[] = {
+        {h, &gstatus, AT_PRIORITY_REALTIME, 0},
+        {h, &gstatus, AT_PRIORITY_REALTIME, 0},
+    };
+    for(int i = 0; i < 2; i++) {
+        pthread_create(&calls[i].thread, NULL, scheduled_call, &calls[i]);
+        usleep(20000);
+    }
+    pthread_mutex_lock(&g.lock);
+    g.is_released = 1;
+    pthread_cond_broadcast(&g.released);
+    pthread_mutex_unlock(&g.lock);
+    for(int i = 0; i < 2; i++) {
+        pthread_join(calls[i].thread, NULL);
+        ASSERT_INT(calls[i].result, AT_RESPONSE_SUCCESS);
+    }
+    ASSERT_INT(g.nof_writes, 1);
+
+    // a command without params which is no query clears the cache
+    const at_interface_command_t gpsend = {0, "at!gpsend", 1, 0};
+    at_interface_response_t* response = NULL;
+    ASSERT_INT(at_interface_command(h, &gstatus, NULL, &response), AT_RESPONSE_SUCCESS);
+    at_interface_free_response(response);
+    ASSERT_INT(g.nof_writes, 1);
+    ASSERT_INT(at_interface_command(h, &gpsend, NULL, &response), AT_RESPONSE_SUCCESS);
+    at_interface_free_response(response);
+    ASSERT_INT(at_interface_command(h, &gstatus, NULL, &response), AT_RESPONSE_SUCCESS);
+    at_interface_free_response(response);
+    ASSERT_INT(g.nof_writes, 3);
+    at_interface_close(h);
+
+    // the fixture answers at!gstatus? only once
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    sw_em7565_t* modem = sw_em7565_init(responses);
+    if(modem == NULL) return TEST_FAIL;
+    sw_em7565_gstatus_response_t* status = sw_em7565_allocate_status();
+
+    ASSERT_INT(sw_em7565_set_cache_window(modem, SW_EM7565_AT_GSTATUS, 10000), 0);
+    ASSERT_INT(sw_em7565_get_status(modem, status), SW_RESPONSE_SUCCESS);
+    status->lte_band = 0;
+    ASSERT_INT(sw_em7565_get_status(modem, status), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(status->lte_band, 3);
+
+    at_interface_stats_t stats;
+    at_interface_get_stats(modem->tty, &stats);
+    ASSERT_INT(stats.nof_commands, 1);
+    ASSERT_INT(stats.nof_cache_hits, 1);
+
+    // outside of the window the modem is asked again
+    ASSERT_INT(sw_em7565_set_cache_window(modem, SW_EM7565_AT_GSTATUS, 1), 0);
+    usleep(2000);
+    ASSERT_INT(sw_em7565_get_status(modem, status), SW_RESPONSE_ERROR);
+
+    sw_em7565_free_status(status);
+    sw_em7565_destroy(modem);
+
+    return ASSERT_RESULT();
+}
+
+int main(int argc, char** argv) {
+
+    ASSERT_INIT();
+
+    logger_set_all_levels(LOGGER_VERBOSE_DEBUG);
+
+    ASSERT_CALL(record_replay_1());
+    ASSERT_CALL(replay_timing_1());
+    ASSERT_CALL(simulator_1());
+    ASSERT_CALL(simulator_fault_1());
+    ASSERT_CALL(scheduler_1());
+    ASSERT_CALL(cache_1());
+
+    return ASSERT_RESULT();
+}
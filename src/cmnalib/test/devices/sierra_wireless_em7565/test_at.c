@@ -8,6 +8,7 @@
 #include "cmnalib/logger.h"
 
 #include "cmnalib/at_sierra_wireless_em7565.h"
+#include "cmnalib/at_sierra_wireless_em7565_events.h"
 
 #define TEST_SUCCESS EXIT_SUCCESS
 #define TEST_FAIL    EXIT_FAILURE
@@ -34,12 +35,13 @@ int __assert_result_summary__(int res) {
 #define ASSERT_INT(A, B) if(A != B) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
 #define ASSERT_FLOAT(A, B, C) if(fabs(A - B) > C) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
 #define ASSERT_STRING(A, B) if(strcmp(A, B) != 0) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_TRUE(A) if(!(A)) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
 
 int cmd_gstatus_1() {
 
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -93,7 +95,7 @@ int cmd_gstatus_2() {
 
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_2.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_2.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -122,7 +124,7 @@ int cmd_gstatus_2() {
 int cmd_gstatus_3() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_3.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_3.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -181,7 +183,7 @@ int cmd_gstatus_3() {
 int cmd_gstatus_4() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_4.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_4.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -236,10 +238,64 @@ int cmd_gstatus_4() {
     return ASSERT_RESULT();
 }
 
+int cmd_gstatus_fields_1() {
+    ASSERT_INIT();
+
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    sw_em7565_t* modem;
+    modem = sw_em7565_init(responses);
+    if(modem == NULL) return TEST_FAIL;
+
+    sw_em7565_gstatus_response_t* ltestatus = sw_em7565_allocate_status();
+    ASSERT_INT(sw_em7565_get_status_fields(modem, SW_EM7565_GSTATUS_TRACE, ltestatus), SW_RESPONSE_SUCCESS);
+
+    ASSERT_INT((ltestatus->valid & ~SW_EM7565_GSTATUS_TRACE), 0);
+    ASSERT_INT(sw_em7565_status_has(ltestatus, SW_EM7565_GSTATUS_LTE_BAND), 1);
+    ASSERT_INT(ltestatus->lte_band, 3);
+    ASSERT_INT(sw_em7565_status_has(ltestatus, SW_EM7565_GSTATUS_PCC_RXD_RSRP), 1);
+    ASSERT_INT(ltestatus->pcc_rxd_rsrp, -131);
+    ASSERT_INT(sw_em7565_status_has(ltestatus, SW_EM7565_GSTATUS_SINR), 1);
+    ASSERT_FLOAT(ltestatus->sinr, 5.2, FLOAT_TOLERANCE);
+    // requested, but not reported
+    ASSERT_INT(sw_em7565_status_has(ltestatus, SW_EM7565_GSTATUS_TX_POWER), 0);
+    ASSERT_INT(ltestatus->tx_power, SW_GSTATUS_TX_POWER_INACTIVE);
+    ASSERT_INT(sw_em7565_status_has(ltestatus, SW_EM7565_GSTATUS_SCC1_RXM_RSRP), 0);
+    // not requested
+    ASSERT_INT(sw_em7565_status_has(ltestatus, SW_EM7565_GSTATUS_CURRENT_TIME), 0);
+    ASSERT_INT(ltestatus->current_time, 0);
+    ASSERT_STRING(ltestatus->mode, "");
+
+    sw_em7565_free_status(ltestatus);
+    sw_em7565_destroy(modem);
+
+    return ASSERT_RESULT();
+}
+
+int cmd_info_1() {
+    ASSERT_INIT();
+
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_info_1.txt";
+    sw_em7565_t* modem = sw_em7565_init(responses);
+    if(modem == NULL) return TEST_FAIL;
+
+    sw_em7565_information_response_t* info = sw_em7565_allocate_information();
+    ASSERT_INT(sw_em7565_get_information(modem, info), SW_RESPONSE_SUCCESS);
+    ASSERT_STRING(info->manufacturer, "Sierra Wireless, Incorporated");
+    ASSERT_STRING(info->model, "EM7565");
+    ASSERT_STRING(info->imei, "359072061234567");
+    ASSERT_STRING(info->imei_sv, "11");
+    ASSERT_STRING(info->fsn, "UF83860123456");
+
+    sw_em7565_free_information(info);
+    sw_em7565_destroy(modem);
+
+    return ASSERT_RESULT();
+}
+
 int cmd_lteinfo_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_lteinfo_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_lteinfo_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -312,10 +368,81 @@ int cmd_lteinfo_1() {
     return ASSERT_RESULT();
 }
 
+int cmd_lteinfo_2() {
+    ASSERT_INIT();
+
+    // a full response followed by one without serving cell and neighbours
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_lteinfo_2.txt";
+    sw_em7565_t* modem = sw_em7565_init(responses);
+    if(modem == NULL) return TEST_FAIL;
+
+    sw_em7565_lteinfo_response_t* lteinfo = sw_em7565_allocate_lteinfo();
+    ASSERT_INT(sw_em7565_get_lteinfo(modem, lteinfo), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(lteinfo->pci, 167);
+    ASSERT_INT(lteinfo->nof_intrafreq_neighbours, 4);
+    ASSERT_INT(lteinfo->nof_interfreq_neighbours, 5);
+
+    // the buffers are reused, nothing of the first response remains
+    ASSERT_INT(sw_em7565_get_lteinfo(modem, lteinfo), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(lteinfo->pci, 0);
+    ASSERT_INT(lteinfo->earfn, 0);
+    ASSERT_INT(lteinfo->nof_intrafreq_neighbours, 0);
+    ASSERT_INT(lteinfo->nof_interfreq_neighbours, 0);
+    ASSERT_TRUE(lteinfo->intrafreq_neighbours != NULL);
+
+    sw_em7565_free_lteinfo(lteinfo);
+    sw_em7565_destroy(modem);
+
+    return ASSERT_RESULT();
+}
+
+int meas_sample_1() {
+    ASSERT_INIT();
+
+    const char status_responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    const char lteinfo_responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_lteinfo_2.txt";
+
+    sw_em7565_t* modem = sw_em7565_init(status_responses);
+    if(modem == NULL) return TEST_FAIL;
+    sw_em7565_gstatus_response_t* status = sw_em7565_allocate_status();
+    ASSERT_INT(sw_em7565_get_status_fields(modem, SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_PCC_RXM_RSRP), status),
+               SW_RESPONSE_SUCCESS);
+    sw_em7565_destroy(modem);
+
+    modem = sw_em7565_init(lteinfo_responses);
+    if(modem == NULL) return TEST_FAIL;
+    sw_em7565_lteinfo_response_t* lteinfo = sw_em7565_allocate_lteinfo();
+
+    meas_sample_t sample;
+    ASSERT_INT(sw_em7565_get_lteinfo(modem, lteinfo), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(lteinfo->serving_valid, 1);
+    meas_sample_init(&sample, MEAS_SOURCE_POLL);
+    sw_em7565_fill_meas_sample(status, lteinfo, &sample);
+    ASSERT_INT(meas_sample_has(&sample, MEAS_FIELD_PCI), 1);
+    ASSERT_INT(sample.pci, 167);
+    ASSERT_FLOAT(sample.rsrp, -78.5, FLOAT_TOLERANCE);
+
+    // no serving cell, the status values are kept
+    ASSERT_INT(sw_em7565_get_lteinfo(modem, lteinfo), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(lteinfo->serving_valid, 0);
+    meas_sample_init(&sample, MEAS_SOURCE_POLL);
+    sw_em7565_fill_meas_sample(status, lteinfo, &sample);
+    ASSERT_INT(meas_sample_has(&sample, MEAS_FIELD_PCI), 0);
+    ASSERT_INT(meas_sample_has(&sample, MEAS_FIELD_EARFCN), 0);
+    ASSERT_INT(meas_sample_has(&sample, MEAS_FIELD_RSRP), 1);
+    ASSERT_FLOAT(sample.rsrp, -80, FLOAT_TOLERANCE);
+
+    sw_em7565_free_lteinfo(lteinfo);
+    sw_em7565_free_status(status);
+    sw_em7565_destroy(modem);
+
+    return ASSERT_RESULT();
+}
+
 int cmd_APN_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_apn_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_apn_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -336,7 +463,7 @@ int cmd_APN_1() {
 int cmd_scact_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_scact_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_scact_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -369,10 +496,39 @@ int cmd_scact_1() {
     return ASSERT_RESULT();
 }
 
+int cmd_ports_1() {
+    ASSERT_INIT();
+
+    const char primary[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    const char secondary[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_selrat_1.txt";
+    sw_em7565_t* modem;
+    modem = sw_em7565_init_ports(primary, secondary);
+    if(modem == NULL) return TEST_FAIL;
+
+    ASSERT_INT(sw_em7565_is_secondary_command(SW_EM7565_AT_GET_COPS), 1);
+    ASSERT_INT(sw_em7565_is_secondary_command(SW_EM7565_AT_GSTATUS), 0);
+
+    // each mock only knows the commands routed to its port
+    sw_em7565_radio_access_type_t rat;
+    ASSERT_INT(sw_em7565_get_radio_access_type(modem, &rat), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(rat, SW_RAT_LTE_ONLY);
+
+    sw_em7565_gstatus_response_t* ltestatus = sw_em7565_allocate_status();
+    ASSERT_INT(sw_em7565_get_status(modem, ltestatus), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(ltestatus->lte_band, 3);
+
+    ASSERT_INT(sw_em7565_set_radio_access_type(modem, SW_RAT_AUTOMATIC), SW_RESPONSE_SUCCESS);
+
+    sw_em7565_free_status(ltestatus);
+    sw_em7565_destroy(modem);
+
+    return ASSERT_RESULT();
+}
+
 int cmd_selrat_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_selrat_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_selrat_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -405,7 +561,7 @@ int cmd_selrat_1() {
 int cmd_reset_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_reset_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_reset_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -425,7 +581,7 @@ int cmd_reset_1() {
 int cmd_ready_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_ready_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_ready_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -445,7 +601,7 @@ int cmd_ready_1() {
 int cmd_want_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_want_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_want_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -473,7 +629,7 @@ int cmd_want_1() {
 int cmd_gpsautostart_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gpsautostart_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gpsautostart_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -507,7 +663,7 @@ int cmd_gpsautostart_1() {
 int cmd_gpsstatus_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gpsstatus_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gpsstatus_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -546,7 +702,7 @@ int cmd_gpsstatus_1() {
 int cmd_gps_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gps_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gps_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -597,7 +753,7 @@ int cmd_gps_1() {
 int cmd_entercnd_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_entercnd_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_entercnd_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -633,7 +789,7 @@ int cmd_entercnd_1() {
 int cmd_band_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_band_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_band_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -713,7 +869,7 @@ int cmd_band_1() {
 int cmd_network_selection_1() {
     ASSERT_INIT();
 
-    const char responses[] = TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_cops_1.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_cops_1.txt";
     sw_em7565_t* modem;
     modem = sw_em7565_init(responses);
     if(modem == NULL) return TEST_FAIL;
@@ -798,6 +954,128 @@ int cmd_network_selection_1() {
     return ASSERT_RESULT();
 }
 
+static sw_response_t load_status(const char* responses, sw_em7565_gstatus_response_t* status) {
+    sw_em7565_t* modem = sw_em7565_init(responses);
+    if(modem == NULL) return SW_RESPONSE_ERROR;
+    sw_response_t ret = sw_em7565_get_status(modem, status);
+    sw_em7565_destroy(modem);
+    return ret;
+}
+
+typedef struct recorded_events {
+    int n;
+    sw_em7565_event_t events[8];
+} recorded_events_t;
+
+static void record_event(const sw_em7565_event_t* event, void* context) {
+    recorded_events_t* r = (recorded_events_t*)context;
+    if(r->n < 8) r->events[r->n++] = *event;
+}
+
+int events_1() {
+    ASSERT_INIT();
+
+    const char idle[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    const char scc_active[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_3.txt";
+    const char scc_inactive[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_4.txt";
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_lteinfo_1.txt";
+
+    sw_em7565_gstatus_response_t* status_idle = sw_em7565_allocate_status();
+    sw_em7565_gstatus_response_t* status_active = sw_em7565_allocate_status();
+    sw_em7565_gstatus_response_t* status_inactive = sw_em7565_allocate_status();
+    sw_em7565_lteinfo_response_t* lteinfo = sw_em7565_allocate_lteinfo();
+    ASSERT_INT(load_status(idle, status_idle), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(load_status(scc_active, status_active), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(load_status(scc_inactive, status_inactive), SW_RESPONSE_SUCCESS);
+    sw_em7565_t* modem = sw_em7565_init(responses);
+    if(modem == NULL) return TEST_FAIL;
+    ASSERT_INT(sw_em7565_get_lteinfo(modem, lteinfo), SW_RESPONSE_SUCCESS);
+    sw_em7565_destroy(modem);
+
+    recorded_events_t r = {0};
+    sw_em7565_event_detector_config_t config = {1000, 100, 5000};
+    sw_em7565_event_detector_t* d = sw_em7565_event_detector_create(&config, record_event, &r);
+    if(d == NULL) return TEST_FAIL;
+    const uint64_t t0 = 1500000000000000ull;
+
+    ASSERT_INT(sw_em7565_event_detector_update(d, t0, status_idle, lteinfo), 0);
+    ASSERT_INT(sw_em7565_event_detector_get_interval_ms(d, t0), 1000);
+
+    // connection setup with carrier aggregation
+    ASSERT_INT(sw_em7565_event_detector_update(d, t0 + 1000000, status_active, lteinfo), 2);
+    ASSERT_INT(r.events[0].type, SW_EM7565_EVENT_SCC_ADDED);
+    ASSERT_INT(r.events[0].scc, 1);
+    ASSERT_INT(r.events[0].new_value, 1444);
+    ASSERT_INT(r.events[1].type, SW_EM7565_EVENT_RRC_STATE_CHANGE);
+    ASSERT_STRING(r.events[1].old_state, "RRC Idle");
+    ASSERT_STRING(r.events[1].new_state, "RRC Connected");
+    ASSERT_TRUE(r.events[1].timestamp_us == t0 + 1000000);
+    ASSERT_INT(sw_em7565_event_detector_get_interval_ms(d, t0 + 1500000), 100);
+    ASSERT_INT(sw_em7565_event_detector_get_interval_ms(d, t0 + 6000000), 1000);
+
+    // a deactivated SCC stays configured, a failed query changes nothing
+    ASSERT_INT(sw_em7565_event_detector_update(d, t0 + 2000000, status_inactive, lteinfo), 0);
+    ASSERT_INT(sw_em7565_event_detector_update(d, t0 + 2500000, NULL, NULL), 0);
+
+    // intra-LTE handover to another PCI and carrier
+    r.n = 0;
+    lteinfo->pci = 166;
+    lteinfo->earfn = 1444;
+    lteinfo->rsrp = -70.5;
+    ASSERT_INT(sw_em7565_event_detector_update(d, t0 + 3000000, NULL, lteinfo), 2);
+    ASSERT_INT(r.events[0].type, SW_EM7565_EVENT_PCI_CHANGE);
+    ASSERT_INT(r.events[0].old_value, 167);
+    ASSERT_INT(r.events[0].new_value, 166);
+    ASSERT_FLOAT(r.events[0].before.rsrp, -78.5, FLOAT_TOLERANCE);
+    ASSERT_FLOAT(r.events[0].after.rsrp, -70.5, FLOAT_TOLERANCE);
+    ASSERT_INT(r.events[1].type, SW_EM7565_EVENT_EARFCN_CHANGE);
+    ASSERT_INT(r.events[1].new_value, 1444);
+
+    // release
+    r.n = 0;
+    ASSERT_INT(sw_em7565_event_detector_update(d, t0 + 4000000, status_idle, lteinfo), 2);
+    ASSERT_INT(r.events[0].type, SW_EM7565_EVENT_SCC_REMOVED);
+    ASSERT_INT(r.events[1].type, SW_EM7565_EVENT_RRC_STATE_CHANGE);
+    ASSERT_STRING(sw_em7565_event_type_str(r.events[1].type), "rrc_state_change");
+
+    sw_em7565_event_detector_destroy(d);
+    sw_em7565_free_status(status_idle);
+    sw_em7565_free_status(status_active);
+    sw_em7565_free_status(status_inactive);
+    sw_em7565_free_lteinfo(lteinfo);
+    return ASSERT_RESULT();
+}
+
+int events_2() {
+    ASSERT_INIT();
+
+    // a full response followed by one without serving cell
+    const char responses[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_lteinfo_2.txt";
+    sw_em7565_t* modem = sw_em7565_init(responses);
+    if(modem == NULL) return TEST_FAIL;
+    sw_em7565_lteinfo_response_t* lteinfo = sw_em7565_allocate_lteinfo();
+
+    recorded_events_t r = {0};
+    sw_em7565_event_detector_config_t config = {1000, 100, 5000};
+    sw_em7565_event_detector_t* d = sw_em7565_event_detector_create(&config, record_event, &r);
+    if(d == NULL) return TEST_FAIL;
+    const uint64_t t0 = 1500000000000000ull;
+
+    ASSERT_INT(sw_em7565_get_lteinfo(modem, lteinfo), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(sw_em7565_event_detector_update(d, t0, NULL, lteinfo), 0);
+
+    // an unknown cell is no handover
+    ASSERT_INT(sw_em7565_get_lteinfo(modem, lteinfo), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(sw_em7565_event_detector_update(d, t0 + 1000000, NULL, lteinfo), 0);
+    ASSERT_INT(r.n, 0);
+    ASSERT_INT(sw_em7565_event_detector_get_interval_ms(d, t0 + 1500000), 1000);
+
+    sw_em7565_event_detector_destroy(d);
+    sw_em7565_free_lteinfo(lteinfo);
+    sw_em7565_destroy(modem);
+    return ASSERT_RESULT();
+}
+
 int main(int argc, char** argv) {
 
     ASSERT_INIT();
@@ -809,9 +1087,14 @@ int main(int argc, char** argv) {
     ASSERT_CALL(cmd_gstatus_2());
     ASSERT_CALL(cmd_gstatus_3());
     ASSERT_CALL(cmd_gstatus_4());
+    ASSERT_CALL(cmd_gstatus_fields_1());
+    ASSERT_CALL(cmd_info_1());
     ASSERT_CALL(cmd_lteinfo_1());
+    ASSERT_CALL(cmd_lteinfo_2());
+    ASSERT_CALL(meas_sample_1());
     ASSERT_CALL(cmd_scact_1());
     ASSERT_CALL(cmd_selrat_1());
+    ASSERT_CALL(cmd_ports_1());
     ASSERT_CALL(cmd_gpsautostart_1());
     ASSERT_CALL(cmd_gpsstatus_1());
     ASSERT_CALL(cmd_want_1());
@@ -819,6 +1102,8 @@ int main(int argc, char** argv) {
     ASSERT_CALL(cmd_entercnd_1());
     ASSERT_CALL(cmd_band_1());
     ASSERT_CALL(cmd_network_selection_1());
+    ASSERT_CALL(events_1());
+    ASSERT_CALL(events_2());
 
     return ASSERT_RESULT();
 }
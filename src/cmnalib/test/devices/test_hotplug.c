@@ -0,0 +1,275 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pthread.h>
+
+#include "cmnalib/logger.h"
+#include "cmnalib/allocator.h"
+
+#include "cmnalib/hotplug.h"
+#include "cmnalib/inventory.h"
+#include "cmnalib/at_sierra_wireless_mc7455.h"
+
+#define TEST_SUCCESS EXIT_SUCCESS
+#define TEST_FAIL    EXIT_FAILURE
+
+int __assert_result_summary__(int res) {
+    switch(res) {
+    case TEST_SUCCESS:
+        INFO("Test passed\n");
+        break;
+    case TEST_FAIL:
+        ERROR("Test failed\n");
+        break;
+    }
+    return res;
+}
+
+#define ASSERT_INIT() int __as_result__ = TEST_SUCCESS
+#define ASSERT_FAIL() __as_result__ = TEST_FAIL
+#define ASSERT_RESULT() __assert_result_summary__(__as_result__)
+
+#define ASSERT_CALL(A) INFO("Testing " TOSTRING(A)"\n"); if(A != TEST_SUCCESS) { ASSERT_FAIL(); }
+#define ASSERT_INT(A, B) if(A != B) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_NOT_NULL(A) if(A == NULL) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_STR(A, B) if(A == NULL || strcmp(A, B) != 0) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+
+#define EVENT_TIMEOUT_MS 1000
+
+#define MODEM_PATH "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-1/1-1:1.3/ttyUSB2/tty/ttyUSB2"
+#define OTHER_PATH "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/ttyUSB0/tty/ttyUSB0"
+
+typedef struct event_counter {
+    pthread_mutex_t lock;
+    int nof_added;
+    int nof_removed;
+    char last_name[64];
+} event_counter_t;
+
+static void count_events(void* callback_context, hotplug_action_t action, const hotplug_device_t* device) {
+    event_counter_t* counter = (event_counter_t*)callback_context;
+    pthread_mutex_lock(&counter->lock);
+    if(action == HOTPLUG_ACTION_ADD) counter->nof_added++;
+    if(action == HOTPLUG_ACTION_REMOVE) counter->nof_removed++;
+    snprintf(counter->last_name, sizeof(counter->last_name), "%s", device->device_name);
+    pthread_mutex_unlock(&counter->lock);
+}
+
+/* events are processed by the monitor thread, wait for the table to catch up */
+static void wait_for_generation(hotplug_monitor_t* monitor, unsigned long generation) {
+    for(int i = 0; i < 100 && hotplug_get_generation(monitor) < generation; i++) {
+        usleep(10000);
+    }
+}
+
+int hotplug_fake_1() {
+
+    ASSERT_INIT();
+
+    hotplug_source_t* source = hotplug_source_fake();
+    hotplug_monitor_t* monitor = hotplug_monitor_start(source);
+    if(monitor == NULL) return TEST_FAIL;
+
+    event_counter_t counter = {PTHREAD_MUTEX_INITIALIZER, 0, 0, ""};
+    int id = hotplug_subscribe(monitor, &sw_mc7455_hotplug_match, count_events, &counter);
+    if(id <= 0) ASSERT_FAIL();
+
+    hotplug_device_t* modem = hotplug_device_create("/dev/ttyUSB2", MODEM_PATH, "tty", "1199", "9071", "03");
+    hotplug_device_t* other = hotplug_device_create("/dev/ttyUSB0", OTHER_PATH, "tty", "0403", "6001", "00");
+
+    // only the modem matches the subscription
+    hotplug_source_fake_add(source, other);
+    hotplug_source_fake_add(source, modem);
+    hotplug_device_t* found = hotplug_wait_for_device(monitor, &sw_mc7455_hotplug_match, 0, EVENT_TIMEOUT_MS);
+    ASSERT_NOT_NULL(found);
+    if(found != NULL) ASSERT_STR(found->device_name, "/dev/ttyUSB2");
+    hotplug_device_destroy(found);
+    wait_for_generation(monitor, 3);
+
+    GSList* all = hotplug_get_devices(monitor, NULL);
+    ASSERT_INT(g_slist_length(all), 2);
+    hotplug_device_list_free(all);
+    ASSERT_INT(counter.nof_added, 1);
+    ASSERT_STR(counter.last_name, "/dev/ttyUSB2");
+
+    // modem resets and comes back on another node
+    unsigned long generation = hotplug_get_generation(monitor);
+    hotplug_source_fake_remove(source, MODEM_PATH);
+    wait_for_generation(monitor, generation + 1);
+    ASSERT_INT(counter.nof_removed, 1);
+    found = hotplug_wait_for_device(monitor, &sw_mc7455_hotplug_match, generation, 0);
+    if(found != NULL) ASSERT_FAIL();
+
+    allocator_free(modem->device_name);
+    modem->device_name = allocator_strdup("/dev/ttyUSB3");
+    hotplug_source_fake_add(source, modem);
+    found = hotplug_wait_for_device(monitor, &sw_mc7455_hotplug_match, generation, EVENT_TIMEOUT_MS);
+    ASSERT_NOT_NULL(found);
+    if(found != NULL) ASSERT_STR(found->device_name, "/dev/ttyUSB3");
+    hotplug_device_destroy(found);
+    ASSERT_INT(counter.nof_added, 2);
+
+    // no further device within the timeout
+    generation = hotplug_get_generation(monitor);
+    found = hotplug_wait_for_device(monitor, &sw_mc7455_hotplug_match, generation, 100);
+    if(found != NULL) ASSERT_FAIL();
+
+    // late subscribers see the devices already present
+    event_counter_t late = {PTHREAD_MUTEX_INITIALIZER, 0, 0, ""};
+    hotplug_unsubscribe(monitor, id);
+    hotplug_subscribe(monitor, NULL, count_events, &late);
+    ASSERT_INT(late.nof_added, 2);
+
+    hotplug_device_destroy(modem);
+    hotplug_device_destroy(other);
+    hotplug_monitor_stop(monitor);
+
+    return ASSERT_RESULT();
+}
+
+#define USB_A "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-1"
+#define USB_B "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-2.4"
+
+static void add_fake(hotplug_source_t* source, const char* name, const char* path, const char* subsystem,
+                     const char* interface_num, const char* serial) {
+    hotplug_device_t* device = hotplug_device_create(name, path, subsystem, "1199", "9071", interface_num);
+    hotplug_device_set_serial(device, serial);
+    hotplug_source_fake_add(source, device);
+    hotplug_device_destroy(device);
+}
+
+int inventory_1() {
+
+    ASSERT_INIT();
+
+    char* usb_path = inventory_usb_path_of(USB_B "/1-2.4:1.8/net/wwan1");
+    ASSERT_STR(usb_path, USB_B);
+    allocator_free(usb_path);
+    usb_path = inventory_usb_path_of("/sys/devices/virtual/tty/tty0");
+    if(usb_path != NULL) ASSERT_FAIL();
+    allocator_free(usb_path);
+
+    hotplug_source_t* source = hotplug_source_fake();
+    hotplug_monitor_t* monitor = hotplug_monitor_start(source);
+    if(monitor == NULL) return TEST_FAIL;
+
+    // present before the inventory exists
+    add_fake(source, "/dev/ttyUSB2", USB_A "/1-1:1.3/ttyUSB2/tty/ttyUSB2", "tty", "03", "SERIALA");
+    wait_for_generation(monitor, 2);
+
+    inventory_t* inventory = inventory_create(monitor);
+    ASSERT_NOT_NULL(inventory);
+
+    add_fake(source, "/dev/ttyUSB1", USB_A "/1-1:1.2/ttyUSB1/tty/ttyUSB1", "tty", "02", NULL);
+    add_fake(source, "/dev/cdc-wdm0", USB_A "/1-1:1.8/usbmisc/cdc-wdm0", "usbmisc", "08", NULL);
+    add_fake(source, "wwan0", USB_A "/1-1:1.8/net/wwan0", "net", "08", NULL);
+    add_fake(source, "/dev/ttyUSB6", USB_B "/1-2.4:1.3/ttyUSB6/tty/ttyUSB6", "tty", "03", "SERIALB");
+    add_fake(source, "wwan1", USB_B "/1-2.4:1.8/net/wwan1", "net", "08", NULL);
+    // diagnostic port, not part of the inventory
+    add_fake(source, "/dev/ttyUSB0", USB_A "/1-1:1.0/ttyUSB0/tty/ttyUSB0", "tty", "00", NULL);
+    wait_for_generation(monitor, 8);
+
+    GSList* modems = inventory_get_modems(inventory);
+    ASSERT_INT(g_slist_length(modems), 2);
+    inventory_modem_list_free(modems);
+
+    inventory_modem_t* modem = inventory_find_by_endpoint(inventory, "/dev/ttyUSB2");
+    ASSERT_NOT_NULL(modem);
+    if(modem != NULL) {
+        ASSERT_STR(modem->usb_path, USB_A);
+        ASSERT_STR(modem->serial, "SERIALA");
+        ASSERT_STR(modem->endpoints[INVENTORY_ENDPOINT_AT], "/dev/ttyUSB2");
+        ASSERT_STR(modem->endpoints[INVENTORY_ENDPOINT_NMEA], "/dev/ttyUSB1");
+        ASSERT_STR(modem->endpoints[INVENTORY_ENDPOINT_QMI], "/dev/cdc-wdm0");
+        ASSERT_STR(modem->endpoints[INVENTORY_ENDPOINT_NETDEV], "wwan0");
+    }
+    inventory_modem_free(modem);
+
+    modem = inventory_find_by_serial(inventory, "SERIALB");
+    ASSERT_NOT_NULL(modem);
+    if(modem != NULL) ASSERT_STR(modem->endpoints[INVENTORY_ENDPOINT_NETDEV], "wwan1");
+    inventory_modem_free(modem);
+
+    ASSERT_INT(inventory_set_imei(inventory, USB_B, "359072060000000"), 0);
+    modem = inventory_find_by_imei(inventory, "359072060000000");
+    ASSERT_NOT_NULL(modem);
+    if(modem != NULL) ASSERT_STR(modem->endpoints[INVENTORY_ENDPOINT_AT], "/dev/ttyUSB6");
+    inventory_modem_free(modem);
+
+    // modem B disappears completely
+    unsigned long generation = hotplug_get_generation(monitor);
+    hotplug_source_fake_remove(source, USB_B "/1-2.4:1.3/ttyUSB6/tty/ttyUSB6");
+    hotplug_source_fake_remove(source, USB_B "/1-2.4:1.8/net/wwan1");
+    wait_for_generation(monitor, generation + 2);
+    modem = inventory_find_by_imei(inventory, "359072060000000");
+    if(modem != NULL) ASSERT_FAIL();
+    inventory_modem_free(modem);
+    modem = inventory_find_by_endpoint(inventory, "wwan1");
+    if(modem != NULL) ASSERT_FAIL();
+    inventory_modem_free(modem);
+
+    // modem A loses its AT port only
+    generation = hotplug_get_generation(monitor);
+    hotplug_source_fake_remove(source, USB_A "/1-1:1.3/ttyUSB2/tty/ttyUSB2");
+    wait_for_generation(monitor, generation + 1);
+    modem = inventory_find_by_usb_path(inventory, USB_A);
+    ASSERT_NOT_NULL(modem);
+    if(modem != NULL && modem->endpoints[INVENTORY_ENDPOINT_AT] != NULL) ASSERT_FAIL();
+    inventory_modem_free(modem);
+
+    inventory_destroy(inventory);
+    hotplug_monitor_stop(monitor);
+
+    return ASSERT_RESULT();
+}
+
+int hotplug_scan_1() {
+
+    ASSERT_INIT();
+
+    // the modem is present before the monitor starts
+    hotplug_source_t* source = hotplug_source_fake();
+    hotplug_device_t* modem = hotplug_device_create("/dev/ttyUSB2", MODEM_PATH, "tty", "1199", "9071", "03");
+    hotplug_source_fake_add(source, modem);
+    hotplug_monitor_t* monitor = hotplug_monitor_start(source);
+    if(monitor == NULL) return TEST_FAIL;
+
+    hotplug_device_t* found = hotplug_wait_for_device(monitor, &sw_mc7455_hotplug_match, 0, 0);
+    ASSERT_NOT_NULL(found);
+    hotplug_device_destroy(found);
+
+    // generation taken before any event, the listed port is not new
+    unsigned long generation = hotplug_get_generation(monitor);
+    found = hotplug_wait_for_device(monitor, &sw_mc7455_hotplug_match, generation, 100);
+    if(found != NULL) ASSERT_FAIL();
+    hotplug_device_destroy(found);
+
+    hotplug_source_fake_remove(source, MODEM_PATH);
+    allocator_free(modem->device_name);
+    modem->device_name = allocator_strdup("/dev/ttyUSB3");
+    hotplug_source_fake_add(source, modem);
+    found = hotplug_wait_for_device(monitor, &sw_mc7455_hotplug_match, generation, EVENT_TIMEOUT_MS);
+    ASSERT_NOT_NULL(found);
+    if(found != NULL) ASSERT_STR(found->device_name, "/dev/ttyUSB3");
+    hotplug_device_destroy(found);
+
+    hotplug_device_destroy(modem);
+    hotplug_monitor_stop(monitor);
+
+    return ASSERT_RESULT();
+}
+
+int main(int argc, char** argv) {
+
+    ASSERT_INIT();
+
+    ASSERT_CALL(hotplug_fake_1());
+    ASSERT_CALL(hotplug_scan_1());
+    ASSERT_CALL(inventory_1());
+
+    return ASSERT_RESULT();
+}
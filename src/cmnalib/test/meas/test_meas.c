@@ -0,0 +1,410 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include <pthread.h>
+
+#include "cmnalib/logger.h"
+
+#include "cmnalib/meas_stream.h"
+#include "cmnalib/meas_broker.h"
+#include "cmnalib/meas_shm.h"
+#include "cmnalib/meas_delta.h"
+#include "cmnalib/meas_neighbour_db.h"
+
+#define TEST_SUCCESS EXIT_SUCCESS
+#define TEST_FAIL    EXIT_FAILURE
+
+int __assert_result_summary__(int res) {
+    switch(res) {
+    case TEST_SUCCESS:
+        INFO("Test passed\n");
+        break;
+    case TEST_FAIL:
+        ERROR("Test failed\n");
+        break;
+    }
+    return res;
+}
+
+#define ASSERT_INIT() int __as_result__ = TEST_SUCCESS
+#define ASSERT_FAIL() __as_result__ = TEST_FAIL
+#define ASSERT_RESULT() __assert_result_summary__(__as_result__)
+
+#define ASSERT_CALL(A) INFO("Testing " TOSTRING(A)"\n"); if(A != TEST_SUCCESS) { ASSERT_FAIL(); }
+#define ASSERT_INT(A, B) if(A != B) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_NOT_NULL(A) if(A == NULL) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_TRUE(A) if(!(A)) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+
+static void push_rsrp(meas_stream_t* stream, float rsrp) {
+    meas_sample_t sample;
+    meas_sample_init(&sample, MEAS_SOURCE_POLL);
+    sample.rsrp = rsrp;
+    sample.valid = MEAS_FIELD_BIT(MEAS_FIELD_RSRP);
+    meas_stream_push(stream, &sample);
+}
+
+int stream_overflow_1() {
+    ASSERT_INIT();
+
+    meas_stream_t* stream = meas_stream_create(3);
+    if(stream == NULL) return TEST_FAIL;
+
+    for(int i = 0; i < 5; i++) {
+        push_rsrp(stream, -100 + i);
+    }
+    ASSERT_INT(meas_stream_get_length(stream), 3);
+    ASSERT_INT(meas_stream_get_dropped(stream), 2);
+
+    // oldest samples were dropped, order is kept
+    meas_sample_t sample;
+    for(int i = 2; i < 5; i++) {
+        ASSERT_INT(meas_stream_pop(stream, &sample, 0), 1);
+        ASSERT_INT((int)sample.rsrp, -100 + i);
+        ASSERT_INT(meas_sample_has(&sample, MEAS_FIELD_RSRP), 1);
+        ASSERT_INT(meas_sample_has(&sample, MEAS_FIELD_SINR), 0);
+    }
+    ASSERT_INT(meas_stream_pop(stream, &sample, 0), 0);
+    ASSERT_INT(meas_stream_pop(stream, &sample, 10), 0);
+
+    meas_stream_destroy(stream);
+    return ASSERT_RESULT();
+}
+
+static void* delayed_producer(void* arg) {
+    meas_stream_t* stream = (meas_stream_t*)arg;
+    usleep(20000);
+    push_rsrp(stream, -90);
+    usleep(20000);
+    meas_stream_close(stream);
+    return NULL;
+}
+
+int stream_blocking_1() {
+    ASSERT_INIT();
+
+    meas_stream_t* stream = meas_stream_create(8);
+    if(stream == NULL) return TEST_FAIL;
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, delayed_producer, stream);
+
+    meas_sample_t sample;
+    ASSERT_INT(meas_stream_pop(stream, &sample, -1), 1);
+    ASSERT_INT((int)sample.rsrp, -90);
+    // wakes up on close
+    ASSERT_INT(meas_stream_pop(stream, &sample, -1), -1);
+    ASSERT_INT(meas_stream_push(stream, &sample), -1);
+
+    pthread_join(producer, NULL);
+    meas_stream_destroy(stream);
+    return ASSERT_RESULT();
+}
+
+typedef struct broker_thread {
+    meas_broker_t* broker;
+    volatile int stop;
+} broker_thread_t;
+
+static void* broker_loop(void* arg) {
+    broker_thread_t* t = (broker_thread_t*)arg;
+    while(!t->stop) {
+        meas_broker_process(t->broker, 20);
+    }
+    return NULL;
+}
+
+int broker_1() {
+    ASSERT_INIT();
+
+    const char path[] = "/tmp/cmnalib_test_broker.sock";
+    broker_thread_t t = { meas_broker_create(path), 0 };
+    if(t.broker == NULL) return TEST_FAIL;
+    pthread_t server;
+    pthread_create(&server, NULL, broker_loop, &t);
+
+    meas_broker_client_t* poller = meas_broker_connect(path);
+    meas_broker_client_t* subscriber = meas_broker_connect(path);
+    ASSERT_TRUE(poller != NULL && subscriber != NULL);
+
+    meas_sample_t sample, received;
+    ASSERT_INT(meas_broker_get_latest(poller, &received, 1000), 0);
+    ASSERT_INT(meas_broker_subscribe(subscriber), 0);
+
+    meas_sample_init(&sample, MEAS_SOURCE_POLL);
+    sample.rsrp = -95.5;
+    sample.pci = 167;
+    sample.valid = MEAS_FIELD_BIT(MEAS_FIELD_RSRP) | MEAS_FIELD_BIT(MEAS_FIELD_PCI);
+    // the subscription is handled asynchronously by the server thread
+    int reached = 0;
+    for(int i = 0; i < 100 && reached == 0; i++) {
+        reached = meas_broker_publish(t.broker, &sample);
+        if(reached == 0) usleep(10000);
+    }
+    ASSERT_INT(reached, 1);
+    ASSERT_INT(meas_broker_get_nof_clients(t.broker), 2);
+
+    memset(&received, 0, sizeof(received));
+    ASSERT_INT(meas_broker_receive(subscriber, &received, 1000), 1);
+    ASSERT_TRUE(received.timestamp_us == sample.timestamp_us);
+    ASSERT_INT(received.source, MEAS_SOURCE_POLL);
+    ASSERT_INT(received.pci, 167);
+    ASSERT_TRUE(received.rsrp == sample.rsrp);
+    ASSERT_INT(meas_sample_has(&received, MEAS_FIELD_SINR), 0);
+
+    memset(&received, 0, sizeof(received));
+    ASSERT_INT(meas_broker_get_latest(poller, &received, 1000), 1);
+    ASSERT_INT(received.pci, 167);
+    ASSERT_INT(meas_broker_receive(subscriber, &received, 10), 0);
+
+    meas_broker_disconnect(poller);
+    meas_broker_disconnect(subscriber);
+    t.stop = 1;
+    pthread_join(server, NULL);
+    meas_broker_destroy(t.broker);
+    return ASSERT_RESULT();
+}
+
+typedef struct shm_writer {
+    meas_shm_t* shm;
+    int count;
+} shm_writer_t;
+
+static void* shm_write_loop(void* arg) {
+    shm_writer_t* w = (shm_writer_t*)arg;
+    meas_sample_t sample;
+    for(int i = 1; i <= w->count; i++) {
+        meas_sample_init(&sample, MEAS_SOURCE_POLL);
+        sample.pci = i;
+        sample.cell_id = i;
+        sample.earfcn = i;
+        meas_shm_publish(w->shm, &sample);
+    }
+    return NULL;
+}
+
+int shm_1() {
+    ASSERT_INIT();
+
+    const char name[] = "/cmnalib_test_shm";
+    shm_writer_t w = { meas_shm_create(name), 100000 };
+    if(w.shm == NULL) return TEST_FAIL;
+    meas_shm_t* reader = meas_shm_open(name);
+    ASSERT_NOT_NULL(reader);
+    if(reader == NULL) {
+        meas_shm_close(w.shm);
+        return TEST_FAIL;
+    }
+
+    meas_sample_t sample;
+    ASSERT_INT(meas_shm_read(reader, &sample), 0);
+    ASSERT_INT(meas_shm_get_sequence(reader), 0);
+
+    // concurrent reads never see a partially written sample
+    pthread_t writer;
+    pthread_create(&writer, NULL, shm_write_loop, &w);
+    int torn = 0, last = 0, backwards = 0;
+    while(last < w.count) {
+        if(meas_shm_read(reader, &sample) != 1) continue;
+        if(sample.pci != sample.cell_id || sample.pci != sample.earfcn) torn++;
+        if(sample.pci < last) backwards++;
+        last = sample.pci;
+    }
+    pthread_join(writer, NULL);
+    ASSERT_INT(torn, 0);
+    ASSERT_INT(backwards, 0);
+    ASSERT_INT(meas_shm_get_sequence(reader), 2 * w.count);
+
+    meas_shm_close(reader);
+    meas_shm_close(w.shm);
+    // the writer removed the segment
+    ASSERT_TRUE(meas_shm_open(name) == NULL);
+    return ASSERT_RESULT();
+}
+
+static int same_sample(const meas_sample_t* a, const meas_sample_t* b) {
+    if(a->timestamp_us != b->timestamp_us || a->source != b->source || a->valid != b->valid) return 0;
+    if(meas_sample_has(a, MEAS_FIELD_RSRP) && a->rsrp != b->rsrp) return 0;
+    if(meas_sample_has(a, MEAS_FIELD_SINR) && a->sinr != b->sinr) return 0;
+    if(meas_sample_has(a, MEAS_FIELD_PCI) && a->pci != b->pci) return 0;
+    if(meas_sample_has(a, MEAS_FIELD_EARFCN) && a->earfcn != b->earfcn) return 0;
+    if(meas_sample_has(a, MEAS_FIELD_CELL_ID) && a->cell_id != b->cell_id) return 0;
+    if(meas_sample_has(a, MEAS_FIELD_POSITION) && (a->latitude != b->latitude || a->altitude != b->altitude)) return 0;
+    return 1;
+}
+
+static void stationary_sample(meas_sample_t* s, int i) {
+    memset(s, 0, sizeof(meas_sample_t));
+    s->timestamp_us = 1500000000000000ull + i * 1000000ull + (i % 3) * 17;
+    s->source = i % 50 == 7 ? MEAS_SOURCE_INDICATION : MEAS_SOURCE_POLL;
+    s->rsrp = -95.0 - (i % 7 == 0) * 0.5;
+    s->sinr = 12.0;
+    s->pci = i < 300 ? 167 : 418;
+    s->earfcn = i < 300 ? 1300 : 3350;
+    s->cell_id = i < 300 ? 27447298 : 27447300;
+    s->valid = MEAS_FIELD_BIT(MEAS_FIELD_RSRP) | MEAS_FIELD_BIT(MEAS_FIELD_SINR) |
+               MEAS_FIELD_BIT(MEAS_FIELD_PCI) | MEAS_FIELD_BIT(MEAS_FIELD_EARFCN) |
+               MEAS_FIELD_BIT(MEAS_FIELD_CELL_ID);
+    if(i >= 400 && i < 500) {
+        s->latitude = 51.49;
+        s->longitude = 7.41;
+        s->altitude = 120;
+        s->valid |= MEAS_FIELD_BIT(MEAS_FIELD_POSITION);
+    }
+}
+
+int delta_1() {
+    ASSERT_INIT();
+
+    const char filename[] = "/tmp/cmnalib_test_delta.bin";
+    const int n = 600;
+    meas_delta_writer_t* w = meas_delta_writer_init(filename, 60);
+    if(w == NULL) return TEST_FAIL;
+
+    meas_delta_encoder_t keyframes;
+    meas_delta_encoder_init(&keyframes, 1);
+    unsigned long keyframe_bytes = 0;
+    uint8_t buf[MEAS_DELTA_MAX_RECORD_SIZE];
+
+    meas_sample_t sample, decoded;
+    for(int i = 0; i < n; i++) {
+        stationary_sample(&sample, i);
+        ASSERT_INT(meas_delta_write(w, &sample), 0);
+        keyframe_bytes += meas_delta_encode(&keyframes, &sample, buf);
+    }
+    ASSERT_INT(w->nof_records, n);
+    // mostly unchanged samples cost a few bytes each
+    ASSERT_TRUE(w->nof_bytes < 8ul * n);
+    ASSERT_TRUE(w->nof_bytes * 3 < keyframe_bytes);
+    meas_delta_writer_destroy(w);
+
+    meas_delta_reader_t* r = meas_delta_reader_init(filename);
+    if(r == NULL) return TEST_FAIL;
+    int mismatches = 0;
+    for(int i = 0; i < n; i++) {
+        stationary_sample(&sample, i);
+        ASSERT_INT(meas_delta_read(r, &decoded), 1);
+        if(!same_sample(&sample, &decoded)) mismatches++;
+    }
+    ASSERT_INT(mismatches, 0);
+    ASSERT_INT(meas_delta_read(r, &decoded), 0);
+
+    // random access starts at the keyframe in front of the target
+    stationary_sample(&sample, 450);
+    ASSERT_INT(meas_delta_seek(r, sample.timestamp_us), 0);
+    ASSERT_INT(meas_delta_read(r, &decoded), 1);
+    ASSERT_TRUE(decoded.timestamp_us <= sample.timestamp_us);
+    while(decoded.timestamp_us < sample.timestamp_us && meas_delta_read(r, &decoded) == 1);
+    ASSERT_INT(same_sample(&sample, &decoded), 1);
+    ASSERT_INT(meas_delta_seek(r, 0), -1);
+
+    meas_delta_reader_destroy(r);
+    remove(filename);
+
+    // a delta without its keyframe is rejected
+    meas_delta_decoder_t d;
+    meas_delta_decoder_init(&d);
+    meas_delta_encoder_init(&keyframes, 10);
+    stationary_sample(&sample, 0);
+    meas_delta_encode(&keyframes, &sample, buf);
+    stationary_sample(&sample, 1);
+    int len = meas_delta_encode(&keyframes, &sample, buf);
+    ASSERT_INT(meas_delta_decode(&d, buf, len - 1, &decoded), 0);
+    ASSERT_INT(meas_delta_decode(&d, buf, len, &decoded), -1);
+
+    return ASSERT_RESULT();
+}
+
+int neighbour_db_1() {
+    ASSERT_INIT();
+
+    // small start capacity to exercise growing
+    meas_neighbour_db_t* db = meas_neighbour_db_create(1);
+    if(db == NULL) return TEST_FAIL;
+
+    meas_sample_t at;
+    meas_sample_init(&at, MEAS_SOURCE_POLL);
+    for(int i = 0; i < 1000; i++) {
+        at.timestamp_us = 1000000ull * (i + 1);
+        at.latitude = 51.0 + i * 0.001;
+        at.longitude = 7.0;
+        at.valid = i >= 100 ? MEAS_FIELD_BIT(MEAS_FIELD_POSITION) : 0;
+        // 50 cells on two carriers, every cell seen 20 times
+        int cell = i % 50;
+        ASSERT_INT(meas_neighbour_db_add(db, cell < 25 ? 1300 : 3350, cell, -80.0 - (i / 50) % 4, -10.0, &at), 0);
+    }
+    ASSERT_INT(meas_neighbour_db_get_size(db), 50);
+    ASSERT_TRUE(meas_neighbour_db_find(db, 1300, 30) == NULL);
+
+    const meas_neighbour_t* n = meas_neighbour_db_find(db, 3350, 30);
+    ASSERT_NOT_NULL(n);
+    if(n == NULL) return TEST_FAIL;
+    ASSERT_INT(n->rsrp.count, 20);
+    ASSERT_TRUE(n->rsrp.min == -83.0f && n->rsrp.max == -80.0f);
+    ASSERT_TRUE(fabs(n->rsrp.mean - -81.5) < 1e-9);
+    // -80..-83 five times each
+    ASSERT_TRUE(fabs(meas_running_stats_variance(&n->rsrp) - 25.0 / 19) < 1e-9);
+    ASSERT_TRUE(meas_running_stats_variance(&n->rsrq) == 0);
+    ASSERT_TRUE(n->first_seen_us == 31000000ull && n->last_seen_us == 981000000ull);
+    ASSERT_INT(n->has_position, 1);
+    ASSERT_TRUE(fabs(n->min_latitude - 51.130) < 1e-9 && fabs(n->max_latitude - 51.980) < 1e-9);
+
+    int it = 0, visited = 0;
+    while(meas_neighbour_db_iterate(db, &it) != NULL) visited++;
+    ASSERT_INT(visited, 50);
+
+    // loading the saved drive twice counts every observation twice
+    const char filename[] = "/tmp/cmnalib_test_neighbours.bin";
+    ASSERT_INT(meas_neighbour_db_save(db, filename), 0);
+    meas_neighbour_db_t* merged = meas_neighbour_db_create(0);
+    ASSERT_INT(meas_neighbour_db_load(merged, filename), 50);
+    ASSERT_INT(meas_neighbour_db_load(merged, filename), 50);
+    remove(filename);
+    const meas_neighbour_t* m = meas_neighbour_db_find(merged, 3350, 30);
+    ASSERT_NOT_NULL(m);
+    if(m != NULL) {
+        ASSERT_INT(m->rsrp.count, 40);
+        ASSERT_TRUE(fabs(m->rsrp.mean - n->rsrp.mean) < 1e-9);
+        ASSERT_TRUE(fabs(meas_running_stats_variance(&m->rsrp) - 50.0 / 39) < 1e-9);
+        ASSERT_TRUE(m->first_seen_us == n->first_seen_us && m->max_latitude == n->max_latitude);
+    }
+    ASSERT_INT(meas_neighbour_db_get_size(merged), 50);
+
+    // LTEINFO neighbour lists
+    sw_em7565_lteinfo_intrafreq_neighbour_t intra[2] = {{166, -13.0, -80.9, -58.9, 0}, {167, -9.4, -78.5, -46.1, 0}};
+    sw_em7565_lteinfo_interfreq_neighbour_t inter[1] = {{3350, 0, 0, 0, 30, -12.0, -90.0, -60.0, 0}};
+    sw_em7565_lteinfo_response_t lteinfo;
+    memset(&lteinfo, 0, sizeof(lteinfo));
+    lteinfo.earfn = 1300;
+    lteinfo.nof_intrafreq_neighbours = 2;
+    lteinfo.intrafreq_neighbours = intra;
+    lteinfo.nof_interfreq_neighbours = 1;
+    lteinfo.interfreq_neighbours = inter;
+    ASSERT_INT(meas_neighbour_db_add_lteinfo(merged, &lteinfo, &at), 3);
+    ASSERT_INT(meas_neighbour_db_get_size(merged), 52);
+    ASSERT_INT(meas_neighbour_db_find(merged, 3350, 30)->rsrp.count, 41);
+
+    meas_neighbour_db_destroy(merged);
+    meas_neighbour_db_destroy(db);
+    return ASSERT_RESULT();
+}
+
+int main(int argc, char** argv) {
+
+    ASSERT_INIT();
+
+    logger_set_all_levels(LOGGER_VERBOSE_DEBUG);
+
+    ASSERT_CALL(stream_overflow_1());
+    ASSERT_CALL(stream_blocking_1());
+    ASSERT_CALL(broker_1());
+    ASSERT_CALL(shm_1());
+    ASSERT_CALL(delta_1());
+    ASSERT_CALL(neighbour_db_1());
+
+    return ASSERT_RESULT();
+}
@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "cmnalib/logger.h"
+
+#include "cmnalib/qmi.h"
+#include "cmnalib/qmi_sierra_wireless_mc7455.h"
+
+#define TEST_SUCCESS EXIT_SUCCESS
+#define TEST_FAIL    EXIT_FAILURE
+
+int __assert_result_summary__(int res) {
+    switch(res) {
+    case TEST_SUCCESS:
+        INFO("Test passed\n");
+        break;
+    case TEST_FAIL:
+        ERROR("Test failed\n");
+        break;
+    }
+    return res;
+}
+
+#define ASSERT_INIT() int __as_result__ = TEST_SUCCESS
+#define ASSERT_FAIL() __as_result__ = TEST_FAIL
+#define ASSERT_RESULT() __assert_result_summary__(__as_result__)
+
+#define ASSERT_CALL(A) INFO("Testing " TOSTRING(A)"\n"); if(A != TEST_SUCCESS) { ASSERT_FAIL(); }
+#define ASSERT_INT(A, B) if(A != B) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_NOT_NULL(A) if(A == NULL) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_FLOAT(A, B) if(fabs((A) - (B)) > 0.001) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+
+int message_1() {
+    ASSERT_INIT();
+
+    qmi_message_t msg, decoded;
+    uint8_t buf[QMI_MESSAGE_MAX_SIZE];
+    uint16_t len;
+
+    qmi_message_init(&msg, QMI_SERVICE_NAS, 5, 0x004F);
+    msg.transaction_id = 0x1234;
+    qmi_message_add_tlv_u8(&msg, 0x01, 0x08);
+    qmi_message_add_tlv_u32(&msg, 0x10, 0xdeadbeef);
+
+    int n = qmi_message_encode(&msg, buf, sizeof(buf));
+    ASSERT_INT(n, 6 + 3 + 4 + 4 + 7);
+    ASSERT_INT(qmi_message_decode(buf, n, &decoded), 0);
+    ASSERT_INT(decoded.service, QMI_SERVICE_NAS);
+    ASSERT_INT(decoded.client_id, 5);
+    ASSERT_INT(decoded.transaction_id, 0x1234);
+    ASSERT_INT(decoded.message_id, 0x004F);
+
+    const uint8_t* value = qmi_message_find_tlv(&decoded, 0x10, &len);
+    ASSERT_NOT_NULL(value);
+    if(value != NULL) {
+        ASSERT_INT(len, 4);
+        ASSERT_INT(qmi_le32(value), 0xdeadbeef);
+    }
+    ASSERT_INT(qmi_message_find_tlv(&decoded, 0x11, NULL), NULL);
+    // no result tlv in a request
+    ASSERT_INT(qmi_message_get_error(&decoded), -1);
+
+    // truncated frame
+    ASSERT_INT(qmi_message_decode(buf, n - 1, &decoded), -1);
+
+    return ASSERT_RESULT();
+}
+
+int mc7455_replay_1() {
+    ASSERT_INIT();
+
+    const char replay[] = TOSTRING(TEST_PATH)"/test/qmi/replay_mc7455_1.txt";
+    qmi_mc7455_t* modem = qmi_mc7455_init_transport(qmi_transport_replay(replay));
+    if(modem == NULL) return TEST_FAIL;
+
+    sw_mc7455_gstatus_response_t* status = NULL;
+    ASSERT_INT(qmi_mc7455_get_status(modem, &status), SW_RESPONSE_SUCCESS);
+    ASSERT_NOT_NULL(status);
+    if(status != NULL) {
+        ASSERT_INT(status->lte_band, 7);
+        ASSERT_INT(status->lte_bw_MHz, 20);
+        ASSERT_INT(status->lte_rx_chan, 3350);
+        ASSERT_INT(status->pcc_rxm_rssi, -65);
+        ASSERT_INT(status->pcc_rxm_rsrp, -95);
+        ASSERT_INT(status->pcc_rxd_rssi, -70);
+        ASSERT_INT(status->pcc_rxd_rsrp, -100);
+        ASSERT_INT(status->tx_power, 3);
+        ASSERT_INT(status->tac, 0x1234);
+        ASSERT_INT(status->cell_id, 26385153);
+        ASSERT_FLOAT(status->rsrq, -9.0);
+        ASSERT_FLOAT(status->sinr, 12.3);
+    }
+    sw_mc7455_free_status(status);
+
+    sw_mc7455_lteinfo_response_t* lteinfo = NULL;
+    ASSERT_INT(qmi_mc7455_get_lteinfo(modem, &lteinfo), SW_RESPONSE_SUCCESS);
+    ASSERT_NOT_NULL(lteinfo);
+    if(lteinfo != NULL) {
+        ASSERT_INT(lteinfo->mcc, 262);
+        ASSERT_INT(lteinfo->mnc, 1);
+        ASSERT_INT(lteinfo->earfn, 3350);
+        ASSERT_INT(lteinfo->pci, 101);
+        ASSERT_FLOAT(lteinfo->rsrp, -95.0);
+        ASSERT_INT(lteinfo->nof_intrafreq_neighbours, 1);
+        if(lteinfo->nof_intrafreq_neighbours == 1) {
+            ASSERT_INT(lteinfo->intrafreq_neighbours[0].pci, 202);
+            ASSERT_FLOAT(lteinfo->intrafreq_neighbours[0].rsrp, -110.0);
+        }
+        ASSERT_INT(lteinfo->nof_interfreq_neighbours, 1);
+        if(lteinfo->nof_interfreq_neighbours == 1) {
+            ASSERT_INT(lteinfo->interfreq_neighbours[0].earfcn, 1300);
+            ASSERT_INT(lteinfo->interfreq_neighbours[0].pci, 55);
+            ASSERT_INT(lteinfo->interfreq_neighbours[0].priority, 5);
+        }
+    }
+    sw_mc7455_free_lteinfo(lteinfo);
+
+    // caller-owned result, refilled by both requests
+    sw_mc7455_gpsloc_response_t* gpsloc = sw_mc7455_allocate_gpsloc();
+    ASSERT_NOT_NULL(gpsloc);
+    ASSERT_INT(qmi_mc7455_get_gpsloc_into(modem, gpsloc), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(gpsloc->is_invalid, 1);
+
+    ASSERT_INT(qmi_mc7455_start_gps(modem), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(qmi_mc7455_get_gpsloc_into(modem, gpsloc), SW_RESPONSE_SUCCESS);
+    ASSERT_INT(gpsloc->is_invalid, 0);
+    ASSERT_FLOAT(gpsloc->latitude, 51.4927);
+    ASSERT_FLOAT(gpsloc->longitude, 7.4125);
+    ASSERT_FLOAT(gpsloc->hepe, 5.5);
+    ASSERT_FLOAT(gpsloc->heading, 90.0);
+    ASSERT_INT(gpsloc->altitude, 120);
+    sw_mc7455_free_get_gpsloc(gpsloc);
+
+    qmi_mc7455_destroy(modem);
+
+    return ASSERT_RESULT();
+}
+
+int mc7455_subscribe_1() {
+    ASSERT_INIT();
+
+    const char replay[] = TOSTRING(TEST_PATH)"/test/qmi/replay_mc7455_2.txt";
+    qmi_mc7455_t* modem = qmi_mc7455_init_transport(qmi_transport_replay(replay));
+    if(modem == NULL) return TEST_FAIL;
+
+    meas_stream_t* stream = meas_stream_create(4);
+    ASSERT_NOT_NULL(stream);
+
+    const float rsrp[] = {-110, -100, -90};
+    const float rsrq[] = {-15, -10};
+    const float snr[] = {0, 10};
+    qmi_mc7455_signal_thresholds_t thresholds = {rsrp, 3, rsrq, 2, snr, 2};
+    ASSERT_INT(qmi_mc7455_subscribe(modem, &thresholds, stream), SW_RESPONSE_SUCCESS);
+
+    ASSERT_INT(qmi_mc7455_process_indications(modem, 0), 2);
+    ASSERT_INT(meas_stream_get_length(stream), 2);
+
+    meas_sample_t sample;
+    ASSERT_INT(meas_stream_pop(stream, &sample, 0), 1);
+    ASSERT_INT(sample.source, MEAS_SOURCE_INDICATION);
+    ASSERT_INT(meas_sample_has(&sample, MEAS_FIELD_RSRP), 1);
+    ASSERT_INT(meas_sample_has(&sample, MEAS_FIELD_PCI), 0);
+    ASSERT_FLOAT(sample.rsrp, -95.0);
+    ASSERT_FLOAT(sample.sinr, 12.3);
+    ASSERT_INT(meas_stream_pop(stream, &sample, 0), 1);
+    ASSERT_FLOAT(sample.rsrp, -101.0);
+    ASSERT_FLOAT(sample.rsrq, -11.0);
+    ASSERT_INT(meas_stream_pop(stream, &sample, 0), 0);
+
+    ASSERT_INT(qmi_mc7455_unsubscribe(modem), SW_RESPONSE_SUCCESS);
+    qmi_mc7455_destroy(modem);
+    meas_stream_destroy(stream);
+
+    return ASSERT_RESULT();
+}
+
+int main(int argc, char** argv) {
+
+    ASSERT_INIT();
+
+    logger_set_all_levels(LOGGER_VERBOSE_DEBUG);
+
+    ASSERT_CALL(message_1());
+    ASSERT_CALL(mc7455_replay_1());
+    ASSERT_CALL(mc7455_subscribe_1());
+
+    return ASSERT_RESULT();
+}
@@ -0,0 +1,445 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "cmnalib/logger.h"
+
+#include "cmnalib/traffic_curl.h"
+#include "cmnalib/traffic_server.h"
+#include "cmnalib/traffic_udp.h"
+#include "cmnalib/traffic_multipath.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define TEST_SUCCESS EXIT_SUCCESS
+#define TEST_FAIL    EXIT_FAILURE
+
+int __assert_result_summary__(int res) {
+    switch(res) {
+    case TEST_SUCCESS:
+        INFO("Test passed\n");
+        break;
+    case TEST_FAIL:
+        ERROR("Test failed\n");
+        break;
+    }
+    return res;
+}
+
+#define ASSERT_INIT() int __as_result__ = TEST_SUCCESS
+#define ASSERT_FAIL() __as_result__ = TEST_FAIL
+#define ASSERT_RESULT() __assert_result_summary__(__as_result__)
+
+#define ASSERT_CALL(A) INFO("Testing " TOSTRING(A)"\n"); if(A != TEST_SUCCESS) { ASSERT_FAIL(); }
+#define ASSERT_INT(A, B) if(A != B) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+
+#define URL_BUFSIZE 128
+
+typedef struct report_counter {
+    int nof_reports;
+    transfer_statusreport_t last;
+} report_counter_t;
+
+/* server accounts a request after the response is sent, give it some time */
+static void get_stats_after_requests(tc_server_t* server, size_t nof_requests, tc_server_stats_t* stats) {
+    for(int i = 0; i < 100; i++) {
+        tc_server_get_stats(server, stats);
+        if(stats->nof_requests >= nof_requests) break;
+        usleep(10000);
+    }
+}
+
+static int count_reports(void* user_context, transfer_statusreport_t* statusreport) {
+    report_counter_t* counter = (report_counter_t*)user_context;
+    counter->nof_reports++;
+    counter->last = *statusreport;
+    return 0;
+}
+
+int server_upload_1() {
+
+    ASSERT_INIT();
+
+    tc_server_t* server = tc_server_start(NULL, 0);
+    if(server == NULL) return TEST_FAIL;
+
+    char url[URL_BUFSIZE];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", tc_server_get_port(server));
+
+    report_counter_t counter = {0};
+    int ret = tc_upload_randomdata(url, 1000000, count_reports, &counter, 0.1);
+    ASSERT_INT(ret, 0);
+    ASSERT_INT(counter.last.total_transfered_bytes, 1000000);
+    if(counter.nof_reports < 2) ASSERT_FAIL();
+
+    // no callback must be accepted
+    ret = tc_upload_randomdata(url, 12345, NULL, NULL, 0.1);
+    ASSERT_INT(ret, 0);
+
+    tc_server_stats_t stats;
+    get_stats_after_requests(server, 2, &stats);
+    ASSERT_INT(stats.nof_requests, 2);
+    ASSERT_INT(stats.bytes_received, 1012345);
+
+    tc_server_stop(server);
+
+    return ASSERT_RESULT();
+}
+
+int server_download_1() {
+
+    ASSERT_INIT();
+
+    tc_server_t* server = tc_server_start("127.0.0.1", 0);
+    if(server == NULL) return TEST_FAIL;
+
+    char url[URL_BUFSIZE];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/2000000", tc_server_get_port(server));
+
+    report_counter_t counter = {0};
+    int ret = tc_download_and_discard(url, 5000000, count_reports, &counter, 0.1);
+    ASSERT_INT(ret, 0);
+    ASSERT_INT(counter.last.total_transfered_bytes, 2000000);
+
+    tc_server_stats_t stats;
+    get_stats_after_requests(server, 1, &stats);
+    ASSERT_INT(stats.nof_requests, 1);
+    ASSERT_INT(stats.bytes_sent, 2000000);
+
+    tc_server_stop(server);
+
+    return ASSERT_RESULT();
+}
+
+int server_download_truncated_1() {
+
+    ASSERT_INIT();
+
+    tc_server_t* server = tc_server_start(NULL, 0);
+    if(server == NULL) return TEST_FAIL;
+
+    // default size is much larger than the requested limit
+    char url[URL_BUFSIZE];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", tc_server_get_port(server));
+
+    report_counter_t counter = {0};
+    int ret = tc_download_and_discard(url, 300000, count_reports, &counter, 0.1);
+    ASSERT_INT(ret, 0);
+    ASSERT_INT(counter.last.total_transfered_bytes, 300000);
+
+    tc_server_stop(server);
+
+    return ASSERT_RESULT();
+}
+
+int udp_header_1() {
+    ASSERT_INIT();
+
+    tc_udp_header_t header = {TC_UDP_MAGIC, 0x01020304, 0, 0, 0x0102030405060708ull};
+    uint8_t buffer[TC_UDP_HEADER_SIZE];
+    tc_udp_encode_header(&header, buffer);
+    // network byte order on any host
+    ASSERT_INT(buffer[4], 0x01);
+    ASSERT_INT(buffer[7], 0x04);
+    for(int i = 0; i < 8; i++) {
+        ASSERT_INT(buffer[16 + i], i + 1);
+    }
+
+    tc_udp_header_t decoded;
+    ASSERT_INT(tc_udp_decode_header(buffer, sizeof(buffer), &decoded), 0);
+    ASSERT_INT(decoded.seq, header.seq);
+    ASSERT_INT(decoded.t_sent_ns, header.t_sent_ns);
+    ASSERT_INT(tc_udp_decode_header(buffer, sizeof(buffer) - 1, &decoded), -1);
+
+    return ASSERT_RESULT();
+}
+
+int udp_cbr_1() {
+
+    ASSERT_INIT();
+
+    tc_udp_receiver_t* receiver = tc_udp_receiver_start("127.0.0.1", 0, NULL, NULL, 0.1);
+    if(receiver == NULL) return TEST_FAIL;
+
+    // 200 packets of 250 bytes at 1 MBit/s
+    tc_udp_config_t config;
+    tc_udp_init_config_cbr(&config, 1e6, 250, 0);
+    config.n_packets_max = 200;
+
+    report_counter_t counter = {0};
+    int ret = tc_udp_send("127.0.0.1", tc_udp_receiver_get_port(receiver), &config, count_reports, &counter, 0.1);
+    ASSERT_INT(ret, 200);
+    ASSERT_INT(counter.last.udp_packets_sent, 200);
+    ASSERT_INT(counter.last.total_transfered_bytes, 50000);
+    // nominal duration is 199 * 2 ms
+    if(counter.last.total_transfer_time < 0.39) ASSERT_FAIL();
+
+    ASSERT_INT(tc_udp_receiver_wait_finished(receiver, 1.0), 0);
+    tc_udp_receiver_stop(receiver);
+
+    transfer_statusreport_t report;
+    tc_udp_receiver_get_report(receiver, &report);
+    ASSERT_INT(report.udp_packets_sent, 200);
+    ASSERT_INT(report.udp_packets_received, 200);
+    ASSERT_INT(report.udp_packets_lost, 0);
+    ASSERT_INT(report.udp_packets_duplicate, 0);
+    if(report.delay_min < 0 || report.delay_max > 0.1 || report.delay_mean > report.delay_max) ASSERT_FAIL();
+
+    size_t n_records = 0;
+    const tc_udp_packet_record_t* records = tc_udp_receiver_get_records(receiver, &n_records);
+    ASSERT_INT(n_records, 200);
+    if(records == NULL || records[0].size != 250) ASSERT_FAIL();
+
+    tc_udp_receiver_destroy(receiver);
+
+    return ASSERT_RESULT();
+}
+
+int udp_burst_1() {
+
+    ASSERT_INIT();
+
+    tc_udp_receiver_t* receiver = tc_udp_receiver_start("127.0.0.1", 0, NULL, NULL, 0.1);
+    if(receiver == NULL) return TEST_FAIL;
+
+    // 5 bursts of 10 packets every 50 ms
+    tc_udp_config_t config;
+    tc_udp_init_config_burst(&config, 10, 0.05, 100, 0.25);
+
+    int ret = tc_udp_send("127.0.0.1", tc_udp_receiver_get_port(receiver), &config, NULL, NULL, 0.1);
+    ASSERT_INT(ret, 50);
+
+    ASSERT_INT(tc_udp_receiver_wait_finished(receiver, 1.0), 0);
+    tc_udp_receiver_stop(receiver);
+
+    transfer_statusreport_t report;
+    tc_udp_receiver_get_report(receiver, &report);
+    ASSERT_INT(report.udp_packets_sent, 50);
+    ASSERT_INT(report.udp_packets_received, 50);
+    ASSERT_INT(report.total_transfered_bytes, 5000);
+
+    tc_udp_receiver_destroy(receiver);
+
+    return ASSERT_RESULT();
+}
+
+static void send_test_packet(int sock, struct sockaddr_in* addr, uint32_t seq, uint32_t flags) {
+    uint8_t buffer[TC_UDP_HEADER_SIZE];
+    tc_udp_header_t header = {TC_UDP_MAGIC, seq, flags, 0, 0};
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    header.t_sent_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    tc_udp_encode_header(&header, buffer);
+    sendto(sock, buffer, sizeof(buffer), 0, (struct sockaddr*)addr, sizeof(*addr));
+}
+
+int udp_loss_reorder_1() {
+
+    ASSERT_INIT();
+
+    tc_udp_receiver_t* receiver = tc_udp_receiver_start("127.0.0.1", 0, NULL, NULL, 0.1);
+    if(receiver == NULL) return TEST_FAIL;
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(tc_udp_receiver_get_port(receiver));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // 0, 2, 1 (reordered), 2 (duplicate), 4; 3 and 5 are lost
+    send_test_packet(sock, &addr, 0, 0);
+    send_test_packet(sock, &addr, 2, 0);
+    send_test_packet(sock, &addr, 1, 0);
+    send_test_packet(sock, &addr, 2, 0);
+    send_test_packet(sock, &addr, 4, 0);
+    send_test_packet(sock, &addr, 6, TC_UDP_FLAG_LAST);
+    close(sock);
+
+    ASSERT_INT(tc_udp_receiver_wait_finished(receiver, 1.0), 0);
+    tc_udp_receiver_stop(receiver);
+
+    transfer_statusreport_t report;
+    tc_udp_receiver_get_report(receiver, &report);
+    ASSERT_INT(report.udp_packets_sent, 6);
+    ASSERT_INT(report.udp_packets_received, 4);
+    ASSERT_INT(report.udp_packets_lost, 2);
+    ASSERT_INT(report.udp_packets_reordered, 1);
+    ASSERT_INT(report.udp_packets_duplicate, 1);
+
+    tc_udp_receiver_destroy(receiver);
+
+    return ASSERT_RESULT();
+}
+
+int udp_window_1() {
+
+    ASSERT_INIT();
+
+    tc_udp_receiver_t* receiver = tc_udp_receiver_start("127.0.0.1", 0, NULL, NULL, 0.1);
+    if(receiver == NULL) return TEST_FAIL;
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(tc_udp_receiver_get_port(receiver));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // a forged seq far ahead neither grows the state nor moves the window
+    send_test_packet(sock, &addr, 0, 0);
+    send_test_packet(sock, &addr, 0xffffffff, 0);
+    send_test_packet(sock, &addr, 1, 0);
+    send_test_packet(sock, &addr, 2, TC_UDP_FLAG_LAST);
+    close(sock);
+
+    ASSERT_INT(tc_udp_receiver_wait_finished(receiver, 1.0), 0);
+    tc_udp_receiver_stop(receiver);
+
+    transfer_statusreport_t report;
+    tc_udp_receiver_get_report(receiver, &report);
+    ASSERT_INT(report.udp_packets_received, 2);
+    ASSERT_INT(report.udp_packets_lost, 0);
+    ASSERT_INT(report.udp_packets_reordered, 0);
+    ASSERT_INT(report.udp_packets_out_of_window, 1);
+
+    tc_udp_receiver_destroy(receiver);
+
+    return ASSERT_RESULT();
+}
+
+int udp_localhost_1() {
+
+    ASSERT_INIT();
+
+    // localhost may resolve to ::1 or 127.0.0.1
+    tc_udp_receiver_t* receiver = tc_udp_receiver_start(NULL, 0, NULL, NULL, 0.1);
+    if(receiver == NULL) return TEST_FAIL;
+
+    tc_udp_config_t config;
+    tc_udp_init_config_burst(&config, 10, 0.05, 100, 0.05);
+    int ret = tc_udp_send("localhost", tc_udp_receiver_get_port(receiver), &config, NULL, NULL, 0.1);
+    ASSERT_INT(ret, 10);
+
+    ASSERT_INT(tc_udp_receiver_wait_finished(receiver, 1.0), 0);
+    tc_udp_receiver_stop(receiver);
+
+    transfer_statusreport_t report;
+    tc_udp_receiver_get_report(receiver, &report);
+    ASSERT_INT(report.udp_packets_received, 10);
+
+    tc_udp_receiver_destroy(receiver);
+
+    return ASSERT_RESULT();
+}
+
+int session_reuse_1() {
+
+    ASSERT_INIT();
+
+    tc_server_t* server = tc_server_start(NULL, 0);
+    if(server == NULL) return TEST_FAIL;
+
+    char url_ul[URL_BUFSIZE];
+    char url_dl[URL_BUFSIZE];
+    snprintf(url_ul, sizeof(url_ul), "http://127.0.0.1:%d/", tc_server_get_port(server));
+    snprintf(url_dl, sizeof(url_dl), "http://127.0.0.1:%d/100000", tc_server_get_port(server));
+
+    tc_session_t* session = tc_session_init(NULL, 0);
+    if(session == NULL) return TEST_FAIL;
+
+    report_counter_t counter = {0};
+    for(int i = 0; i < 3; i++) {
+        ASSERT_INT(tc_session_upload_randomdata(session, url_ul, 100000, count_reports, &counter, 0.1), 0);
+        ASSERT_INT(counter.last.total_transfered_bytes, 100000);
+        ASSERT_INT(tc_session_download_and_discard(session, url_dl, 200000, count_reports, &counter, 0.1), 0);
+        ASSERT_INT(counter.last.total_transfered_bytes, 100000);
+    }
+
+    // all transfers on a single connection
+    tc_server_stats_t stats;
+    get_stats_after_requests(server, 6, &stats);
+    ASSERT_INT(stats.nof_requests, 6);
+    ASSERT_INT(stats.nof_connections, 1);
+
+    // cold start: one connection per transfer
+    tc_session_set_flags(session, TC_SESSION_FRESH_CONNECT);
+    for(int i = 0; i < 3; i++) {
+        ASSERT_INT(tc_session_upload_randomdata(session, url_ul, 100000, NULL, NULL, 0.1), 0);
+    }
+    get_stats_after_requests(server, 9, &stats);
+    ASSERT_INT(stats.nof_requests, 9);
+    ASSERT_INT(stats.nof_connections, 4);
+
+    tc_session_destroy(session);
+    tc_server_stop(server);
+
+    return ASSERT_RESULT();
+}
+
+int multipath_1() {
+
+    ASSERT_INIT();
+
+    tc_server_t* server = tc_server_start(NULL, 0);
+    if(server == NULL) return TEST_FAIL;
+
+    char url_ul[URL_BUFSIZE];
+    char url_dl[URL_BUFSIZE];
+    snprintf(url_ul, sizeof(url_ul), "http://127.0.0.1:%d/", tc_server_get_port(server));
+    snprintf(url_dl, sizeof(url_dl), "http://127.0.0.1:%d/400000", tc_server_get_port(server));
+
+    report_counter_t counter[3] = {{0}};
+    tc_multipath_job_t jobs[3] = {
+        {"lo", url_ul, TC_DIRECTION_UPLOAD, 300000, count_reports, &counter[0], 0.1},
+        {"127.0.0.1", url_dl, TC_DIRECTION_DOWNLOAD, 1000000, count_reports, &counter[1], 0.1},
+        {NULL, url_ul, TC_DIRECTION_UPLOAD, 200000, count_reports, &counter[2], 0.1},
+    };
+
+    int ret = tc_multipath_run(jobs, 3);
+    ASSERT_INT(ret, 0);
+    ASSERT_INT(jobs[0].result, 0);
+    ASSERT_INT(jobs[1].result, 0);
+    ASSERT_INT(jobs[2].result, 0);
+    ASSERT_INT(counter[0].last.total_transfered_bytes, 300000);
+    ASSERT_INT(counter[1].last.total_transfered_bytes, 400000);
+    ASSERT_INT(counter[2].last.total_transfered_bytes, 200000);
+    if(jobs[0].start_time != jobs[2].start_time || jobs[0].start_time == 0) ASSERT_FAIL();
+
+    // binding to a non-existing interface must fail that job only
+    jobs[1].interface = "nonexisting0";
+    ret = tc_multipath_run(jobs, 3);
+    ASSERT_INT(ret, -1);
+    ASSERT_INT(jobs[0].result, 0);
+    if(jobs[1].result == 0) ASSERT_FAIL();
+
+    tc_server_stop(server);
+
+    return ASSERT_RESULT();
+}
+
+int main(int argc, char** argv) {
+
+    ASSERT_INIT();
+
+    ASSERT_CALL(server_upload_1());
+    ASSERT_CALL(server_download_1());
+    ASSERT_CALL(server_download_truncated_1());
+    ASSERT_CALL(udp_header_1());
+    ASSERT_CALL(udp_cbr_1());
+    ASSERT_CALL(udp_burst_1());
+    ASSERT_CALL(udp_loss_reorder_1());
+    ASSERT_CALL(udp_window_1());
+    ASSERT_CALL(udp_localhost_1());
+    ASSERT_CALL(session_reuse_1());
+    ASSERT_CALL(multipath_1());
+
+    return ASSERT_RESULT();
+}
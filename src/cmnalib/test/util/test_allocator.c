@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cmnalib/logger.h"
+#include "cmnalib/allocator.h"
+#include "cmnalib/tokenfind.h"
+#include "cmnalib/at_sierra_wireless_em7565.h"
+
+#define TEST_SUCCESS EXIT_SUCCESS
+#define TEST_FAIL    EXIT_FAILURE
+
+int __assert_result_summary__(int res) {
+    switch(res) {
+    case TEST_SUCCESS:
+        INFO("Test passed\n");
+        break;
+    case TEST_FAIL:
+        ERROR("Test failed\n");
+        break;
+    }
+    return res;
+}
+
+#define ASSERT_INIT() int __as_result__ = TEST_SUCCESS
+#define ASSERT_FAIL() __as_result__ = TEST_FAIL
+#define ASSERT_RESULT() __assert_result_summary__(__as_result__)
+
+#define ASSERT_CALL(A) INFO("Testing " TOSTRING(A)"\n"); if(A != TEST_SUCCESS) { ASSERT_FAIL(); }
+#define ASSERT_INT(A, B) if(A != B) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_TRUE(A) if(!(A)) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+
+typedef struct call_counter {
+    int nof_mallocs;
+    int nof_callocs;
+    int nof_reallocs;
+    int nof_frees;
+} call_counter_t;
+
+static void* counter_malloc(void* context, size_t size) {
+    ((call_counter_t*)context)->nof_mallocs++;
+    return malloc(size);
+}
+
+static void* counter_calloc(void* context, size_t nmemb, size_t size) {
+    ((call_counter_t*)context)->nof_callocs++;
+    return calloc(nmemb, size);
+}
+
+static void* counter_realloc(void* context, void* ptr, size_t size) {
+    ((call_counter_t*)context)->nof_reallocs++;
+    return realloc(ptr, size);
+}
+
+static void counter_free(void* context, void* ptr) {
+    ((call_counter_t*)context)->nof_frees++;
+    free(ptr);
+}
+
+int hooks_1() {
+
+    ASSERT_INIT();
+
+    call_counter_t counter = {0};
+    allocator_t hooks = {counter_malloc, counter_calloc, counter_realloc, counter_free, &counter};
+    allocator_set(&hooks);
+
+    tokenfind_string_table_t* t = tokenfind_parse_table("PCI RSRP\n167 -78.5\n418 -92.8\n");
+    ASSERT_TRUE(t != NULL);
+    ASSERT_INT(t->n_rows, 3);
+    tokenfind_free_table(t);
+
+    char* s = allocator_strndup("wwan0:1", 5);
+    ASSERT_INT(strcmp(s, "wwan0"), 0);
+    allocator_free(s);
+
+    allocator_set(NULL);
+
+    ASSERT_TRUE(counter.nof_mallocs + counter.nof_callocs + counter.nof_reallocs > 1);
+    // realloc(NULL, n) allocates as well
+    ASSERT_TRUE(counter.nof_frees >= counter.nof_mallocs + counter.nof_callocs);
+
+    // restored libc allocator does not call the hooks any more
+    int nof_frees = counter.nof_frees;
+    allocator_free(allocator_strdup("x"));
+    ASSERT_INT(counter.nof_frees, nof_frees);
+
+    return ASSERT_RESULT();
+}
+
+static sw_response_t get_status_once(const char* responses, allocator_stats_t* stats) {
+    sw_response_t ret = SW_RESPONSE_ERROR;
+    sw_em7565_t* modem = sw_em7565_init(responses);
+    if(modem == NULL) return ret;
+    sw_em7565_gstatus_response_t* status = sw_em7565_allocate_status();
+
+    allocator_counting_reset_stats();
+    ret = sw_em7565_get_status(modem, status);
+    allocator_counting_get_stats(stats);
+
+    sw_em7565_free_status(status);
+    sw_em7565_destroy(modem);
+    return ret;
+}
+
+int counting_1() {
+
+    ASSERT_INIT();
+
+    const char responses_1[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_1.txt";
+    const char responses_2[] = "mock:" TOSTRING(TEST_PATH)"/test/devices/sierra_wireless_em7565/at_gstatus_2.txt";
+    allocator_stats_t stats;
+
+    allocator_counting_install();
+
+    // first call compiles the regex caches, which are kept
+    ASSERT_INT(get_status_once(responses_1, &stats), SW_RESPONSE_SUCCESS);
+    allocator_counting_get_stats(&stats);
+    unsigned long cached = stats.bytes_in_use;
+
+    ASSERT_INT(get_status_once(responses_2, &stats), SW_RESPONSE_SUCCESS);
+    // the response buffer of the AT command is allocated and released per call
+    ASSERT_TRUE(stats.nof_allocs >= 1);
+    ASSERT_INT(stats.nof_allocs, stats.nof_frees);
+    ASSERT_TRUE(stats.peak_bytes_in_use - stats.bytes_in_use >= sizeof(at_interface_response_t));
+
+    allocator_counting_get_stats(&stats);
+    ASSERT_INT(stats.bytes_in_use, cached);
+
+    return ASSERT_RESULT();
+}
+
+int main(int argc, char** argv) {
+
+    ASSERT_INIT();
+
+    logger_set_all_levels(LOGGER_VERBOSE_DEBUG);
+
+    // the counting allocator stays installed, keep it last
+    ASSERT_CALL(hooks_1());
+    ASSERT_CALL(counting_1());
+
+    return ASSERT_RESULT();
+}
@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pthread.h>
+
+#include "cmnalib/logger.h"
+
+#define TEST_SUCCESS EXIT_SUCCESS
+#define TEST_FAIL    EXIT_FAILURE
+
+int __assert_result_summary__(int res) {
+    switch(res) {
+    case TEST_SUCCESS:
+        INFO("Test passed\n");
+        break;
+    case TEST_FAIL:
+        ERROR("Test failed\n");
+        break;
+    }
+    return res;
+}
+
+#define ASSERT_INIT() int __as_result__ = TEST_SUCCESS
+#define ASSERT_FAIL() __as_result__ = TEST_FAIL
+#define ASSERT_RESULT() __assert_result_summary__(__as_result__)
+
+#define ASSERT_CALL(A) INFO("Testing " TOSTRING(A)"\n"); if(A != TEST_SUCCESS) { ASSERT_FAIL(); }
+#define ASSERT_INT(A, B) if(A != B) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+#define ASSERT_STR_CONTAINS(A, B) if(strstr(A, B) == NULL) { ERROR("Assertion failed: %s:%d\n", __FILE__,__LINE__); ASSERT_FAIL(); }
+
+#define MEMORY_SINK_SIZE (256*1024)
+#define NOF_THREADS 4
+#define NOF_MESSAGES_PER_THREAD 500
+
+static size_t count_occurrences(const char* haystack, const char* needle) {
+    size_t n = 0;
+    const char* p = haystack;
+    while((p = strstr(p, needle)) != NULL) {
+        n++;
+        p += strlen(needle);
+    }
+    return n;
+}
+
+int memory_sink_1() {
+
+    ASSERT_INIT();
+
+    char buf[1024];
+    logger_sink_t* sink = logger_sink_memory(sizeof(buf));
+    ASSERT_INT(logger_add_sink(sink), 0);
+
+    INFO("hello %d\n", 42);
+    WARNING("world %s\n", "foo");
+
+    logger_sink_memory_read(sink, buf, sizeof(buf));
+    ASSERT_STR_CONTAINS(buf, "[I]: hello 42\n");
+    ASSERT_STR_CONTAINS(buf, "[W]: world foo\n");
+
+    logger_remove_sink(sink);
+    logger_sink_destroy(sink);
+
+    return ASSERT_RESULT();
+}
+
+/* one call site, so all calls share the same limiter */
+static void log_repeated() {
+    INFO_RATELIMITED(0.2, "repeated message\n");
+}
+
+int ratelimit_1() {
+
+    ASSERT_INIT();
+
+    char buf[1024];
+    logger_sink_t* sink = logger_sink_memory(sizeof(buf));
+    ASSERT_INT(logger_add_sink(sink), 0);
+
+    for(int i = 0; i < 10; i++) {
+        log_repeated();
+    }
+    // the first call passes, the others are within the interval
+    logger_sink_memory_read(sink, buf, sizeof(buf));
+    ASSERT_INT(count_occurrences(buf, "repeated message"), 1);
+
+    usleep(300000);
+    log_repeated();
+    logger_sink_memory_read(sink, buf, sizeof(buf));
+    ASSERT_INT(count_occurrences(buf, "repeated message"), 2);
+    ASSERT_STR_CONTAINS(buf, "9 similar messages suppressed");
+
+    logger_remove_sink(sink);
+    logger_sink_destroy(sink);
+
+    return ASSERT_RESULT();
+}
+
+static void log_repeated_concurrently() {
+    INFO_RATELIMITED(1.0, "concurrent message\n");
+}
+
+static void* ratelimit_thread(void* arg) {
+    for(int i = 0; i < 250; i++) {
+        log_repeated_concurrently();
+    }
+    return NULL;
+}
+
+int ratelimit_threads_1() {
+
+    ASSERT_INIT();
+
+    char buf[1024];
+    logger_sink_t* sink = logger_sink_memory(sizeof(buf));
+    ASSERT_INT(logger_add_sink(sink), 0);
+
+    pthread_t threads[4];
+    for(int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, ratelimit_thread, NULL);
+    }
+    for(int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    logger_sink_memory_read(sink, buf, sizeof(buf));
+    ASSERT_INT(count_occurrences(buf, "concurrent message"), 1);
+
+    // no suppressed call is lost
+    usleep(1100000);
+    log_repeated_concurrently();
+    logger_sink_memory_read(sink, buf, sizeof(buf));
+    ASSERT_INT(count_occurrences(buf, "concurrent message"), 2);
+    ASSERT_STR_CONTAINS(buf, "999 similar messages suppressed");
+
+    logger_remove_sink(sink);
+    logger_sink_destroy(sink);
+
+    return ASSERT_RESULT();
+}
+
+static int evaluated(int* counter) {
+    (*counter)++;
+    return *counter;
+}
+
+int runtime_level_1() {
+
+    ASSERT_INIT();
+
+    char buf[1024];
+    int counter = 0;
+    logger_sink_t* sink = logger_sink_memory(sizeof(buf));
+    ASSERT_INT(logger_add_sink(sink), 0);
+
+    logger_set_level(LOGGER_MODULE_DEFAULT, LOGGER_VERBOSE_INFO);
+    DEBUG("hidden %d\n", evaluated(&counter));
+    INFO("visible %d\n", evaluated(&counter));
+    // arguments of disabled messages are not evaluated
+    ASSERT_INT(counter, 1);
+
+    logger_set_level(LOGGER_MODULE_DEFAULT, LOGGER_VERBOSE_NONE);
+    ERROR("hidden %d\n", evaluated(&counter));
+    ASSERT_INT(counter, 1);
+
+    logger_set_level(LOGGER_MODULE_DEFAULT, LOGGER_VERBOSE_DEBUG);
+    DEBUG("visible %d\n", evaluated(&counter));
+
+    logger_sink_memory_read(sink, buf, sizeof(buf));
+    ASSERT_INT(count_occurrences(buf, "hidden"), 0);
+    ASSERT_STR_CONTAINS(buf, "[I]: visible 1\n");
+    ASSERT_STR_CONTAINS(buf, "[D]: visible 2\n");
+
+    logger_remove_sink(sink);
+    logger_sink_destroy(sink);
+
+    return ASSERT_RESULT();
+}
+
+int configure_1() {
+
+    ASSERT_INIT();
+
+    ASSERT_INT(logger_configure("*=none, at=debug,traffic=info"), 0);
+    ASSERT_INT(logger_get_level(LOGGER_MODULE_DEFAULT), LOGGER_VERBOSE_NONE);
+    ASSERT_INT(logger_get_level(LOGGER_MODULE_AT), LOGGER_VERBOSE_DEBUG);
+    ASSERT_INT(logger_get_level(LOGGER_MODULE_TRAFFIC), LOGGER_VERBOSE_INFO);
+    ASSERT_INT(logger_get_level(LOGGER_MODULE_DEVICES), LOGGER_VERBOSE_NONE);
+
+    // invalid entries are reported, valid ones still apply
+    ASSERT_INT(logger_configure("foo=debug,devices=loud,trace=debug,sink=nowhere"), -1);
+    ASSERT_INT(logger_get_level(LOGGER_MODULE_TRACE), LOGGER_VERBOSE_DEBUG);
+    ASSERT_INT(logger_get_level(LOGGER_MODULE_DEVICES), LOGGER_VERBOSE_NONE);
+
+    logger_set_all_levels(LOGGER_VERBOSE_DEBUG);
+
+    return ASSERT_RESULT();
+}
+
+static void* log_from_thread(void* void_id) {
+    long id = (long)void_id;
+    for(int i = 0; i < NOF_MESSAGES_PER_THREAD; i++) {
+        INFO("thread %ld message %d\n", id, i);
+    }
+    return NULL;
+}
+
+int async_1() {
+
+    ASSERT_INIT();
+
+    char* buf = malloc(MEMORY_SINK_SIZE);
+    logger_sink_t* sink = logger_sink_memory(MEMORY_SINK_SIZE);
+    ASSERT_INT(logger_add_sink(sink), 0);
+    ASSERT_INT(logger_start_async(NOF_THREADS * NOF_MESSAGES_PER_THREAD), 0);
+
+    pthread_t threads[NOF_THREADS];
+    for(long i = 0; i < NOF_THREADS; i++) {
+        pthread_create(&threads[i], NULL, log_from_thread, (void*)i);
+    }
+    for(int i = 0; i < NOF_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // the ring is large enough, nothing may get lost
+    ASSERT_INT(logger_get_dropped(), 0);
+    logger_sink_memory_read(sink, buf, MEMORY_SINK_SIZE);
+    ASSERT_INT(count_occurrences(buf, "[I]: thread"), NOF_THREADS * NOF_MESSAGES_PER_THREAD);
+
+    // messages of one thread keep their order
+    char first[64], last[64];
+    snprintf(first, sizeof(first), "thread 1 message 0\n");
+    snprintf(last, sizeof(last), "thread 1 message %d\n", NOF_MESSAGES_PER_THREAD - 1);
+    if(strstr(buf, first) == NULL || strstr(buf, last) == NULL || strstr(buf, first) > strstr(buf, last)) {
+        ASSERT_FAIL();
+    }
+
+    logger_stop_async();
+    logger_remove_sink(sink);
+    logger_sink_destroy(sink);
+    free(buf);
+
+    return ASSERT_RESULT();
+}
+
+int main(int argc, char** argv) {
+
+    ASSERT_INIT();
+
+    // independent of CMNALIB_LOG in the environment
+    logger_set_all_levels(LOGGER_VERBOSE_DEBUG);
+
+    ASSERT_CALL(memory_sink_1());
+    ASSERT_CALL(ratelimit_1());
+    ASSERT_CALL(ratelimit_threads_1());
+    ASSERT_CALL(runtime_level_1());
+    ASSERT_CALL(configure_1());
+    ASSERT_CALL(async_1());
+
+    return ASSERT_RESULT();
+}
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <argp.h>
+
+#include "cmnalib/at_simulator.h"
+#include "cmnalib/at_sierra_wireless_em7565.h"
+#include "cmnalib/logger.h"
+
+const char *argp_program_version =
+        "at_sim_bench";
+const char *argp_program_bug_address =
+        "<robert.falkenberg@tu-dortmund.de>";
+
+static char doc[] =
+        "at_sim_bench -- End-to-end benchmark of the AT tty path against simulated modems\n"
+        "Each modem is a pseudo terminal answering from the response files in DIR "
+        "(e.g. src/cmnalib/test/devices/sierra_wireless_em7565)";
+
+static char args_doc[] = "DIR";
+
+static struct argp_option options[] = {
+    {"modems",    'n', "N",     0, "Number of concurrently simulated modems (default: 1)" },
+    {"count",     'c', "N",     0, "Samples per modem, each AT!GSTATUS? and AT!LTEINFO? (default: 1000)" },
+    {"latency",   'l', "us",    0, "Response latency of the modem in us (default: 0)" },
+    {"chunk",     'k', "bytes", 0, "Deliver responses in chunks of this size (default: whole response)" },
+    {"chunk-gap", 'g', "us",    0, "Gap between chunks in us (default: 0)" },
+    {"baud",      'b', "rate",  0, "Throttle the simulated line to this baud rate (default: unlimited)" },
+    {"timeouts",  'T', "p",     0, "Probability of an unanswered command" },
+    {"garbage",   'G', "p",     0, "Probability of garbage before a response" },
+    {"partial",   'P', "p",     0, "Probability of a response cut before its final line" },
+    {"quiet",     'q', 0,       0, "Don't produce any log output" },
+    { 0 }
+};
+
+struct arguments {
+    const char* directory;
+    int nof_modems;
+    int count;
+    int quiet;
+    at_simulator_config_t config;
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state) {
+    struct arguments *arguments = state->input;
+
+    switch (key)
+    {
+    case 'n':
+        arguments->nof_modems = atoi(arg);
+        break;
+    case 'c':
+        arguments->count = atoi(arg);
+        break;
+    case 'l':
+        arguments->config.latency_us = atoi(arg);
+        break;
+    case 'k':
+        arguments->config.chunk_size = atoi(arg);
+        break;
+    case 'g':
+        arguments->config.chunk_gap_us = atoi(arg);
+        break;
+    case 'b':
+        arguments->config.baud = atoi(arg);
+        break;
+    case 'T':
+        arguments->config.timeout_probability = atof(arg);
+        break;
+    case 'G':
+        arguments->config.garbage_probability = atof(arg);
+        break;
+    case 'P':
+        arguments->config.partial_probability = atof(arg);
+        break;
+    case 'q':
+        arguments->quiet = 1;
+        break;
+    case ARGP_KEY_ARG:
+        if(state->arg_num >= 1) argp_usage(state);
+        arguments->directory = arg;
+        break;
+    case ARGP_KEY_END:
+        if(arguments->directory == NULL || arguments->nof_modems < 1 || arguments->count < 1) {
+            argp_usage (state);
+        }
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+typedef struct bench_modem {
+    at_simulator_t* sim;
+    pthread_t thread;
+    int count;
+    double* latencies_ms;   // one per command
+    int nof_latencies;
+    int nof_failures;
+} bench_modem_t;
+
+static double now_ms() {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec * 1e3 + t.tv_usec * 1e-3;
+}
+
+static void* bench_thread(void* arg) {
+    bench_modem_t* m = (bench_modem_t*)arg;
+
+    sw_em7565_t* modem = sw_em7565_init(at_simulator_get_device(m->sim));
+    if(modem == NULL) {
+        m->nof_failures = m->count * 2;
+        return NULL;
+    }
+    sw_em7565_gstatus_response_t* status = sw_em7565_allocate_status();
+    sw_em7565_lteinfo_response_t* lteinfo = sw_em7565_allocate_lteinfo();
+
+    for(int i = 0; i < m->count; i++) {
+        double start = now_ms();
+        if(sw_em7565_get_status(modem, status) != SW_RESPONSE_SUCCESS) m->nof_failures++;
+        double mid = now_ms();
+        if(sw_em7565_get_lteinfo(modem, lteinfo) != SW_RESPONSE_SUCCESS) m->nof_failures++;
+        double end = now_ms();
+        m->latencies_ms[m->nof_latencies++] = mid - start;
+        m->latencies_ms[m->nof_latencies++] = end - mid;
+    }
+
+    sw_em7565_free_status(status);
+    sw_em7565_free_lteinfo(lteinfo);
+    sw_em7565_destroy(modem);
+    return NULL;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double* sorted, int n, double p) {
+    int idx = (int)(p * (n - 1) + 0.5);
+    return sorted[idx];
+}
+
+int main(int argc, char** argv) {
+
+    struct arguments arguments;
+    memset(&arguments, 0, sizeof(arguments));
+    arguments.nof_modems = 1;
+    arguments.count = 1000;
+    arguments.config.seed = 1;
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+
+    if(arguments.quiet) logger_set_all_levels(LOGGER_VERBOSE_NONE);
+
+    bench_modem_t* modems = calloc(arguments.nof_modems, sizeof(bench_modem_t));
+    if(modems == NULL) return EXIT_FAILURE;
+
+    for(int i = 0; i < arguments.nof_modems; i++) {
+        at_simulator_config_t config = arguments.config;
+        config.seed += i;
+        modems[i].count = arguments.count;
+        modems[i].latencies_ms = calloc(2 * arguments.count, sizeof(double));
+        modems[i].sim = at_simulator_create(&config);
+        if(modems[i].latencies_ms == NULL || modems[i].sim == NULL ||
+           at_simulator_load_directory(modems[i].sim, arguments.directory) <= 0 ||
+           at_simulator_start(modems[i].sim) != 0) {
+            ERROR("Could not set up simulated modem %d\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    double start = now_ms();
+    for(int i = 0; i < arguments.nof_modems; i++) {
+        pthread_create(&modems[i].thread, NULL, bench_thread, &modems[i]);
+    }
+    for(int i = 0; i < arguments.nof_modems; i++) {
+        pthread_join(modems[i].thread, NULL);
+    }
+    double duration_ms = now_ms() - start;
+
+    int total = 0, failures = 0;
+    for(int i = 0; i < arguments.nof_modems; i++) {
+        total += modems[i].nof_latencies;
+        failures += modems[i].nof_failures;
+    }
+    double* all = calloc(total > 0 ? total : 1, sizeof(double));
+    int n = 0;
+    for(int i = 0; i < arguments.nof_modems; i++) {
+        memcpy(all + n, modems[i].latencies_ms, modems[i].nof_latencies * sizeof(double));
+        n += modems[i].nof_latencies;
+    }
+    qsort(all, n, sizeof(double), compare_double);
+
+    printf("modems:        %d\n", arguments.nof_modems);
+    printf("commands:      %d (%d failed)\n", total, failures);
+    printf("duration:      %.1f ms\n", duration_ms);
+    printf("throughput:    %.1f commands/s\n", total / (duration_ms * 1e-3));
+    if(n > 0) {
+        printf("latency [ms]:  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+               percentile(all, n, 0.5), percentile(all, n, 0.9), percentile(all, n, 0.99),
+               percentile(all, n, 0.999), all[n - 1]);
+    }
+    for(int i = 0; i < arguments.nof_modems; i++) {
+        at_simulator_stats_t stats;
+        at_simulator_get_stats(modems[i].sim, &stats);
+        printf("modem %d:       %lu commands, %lu unknown, %lu timeouts, %lu garbage, %lu partial\n",
+               i, stats.nof_commands, stats.nof_unknown, stats.nof_timeouts, stats.nof_garbage, stats.nof_partial);
+        at_simulator_destroy(modems[i].sim);
+        free(modems[i].latencies_ms);
+    }
+    free(all);
+    free(modems);
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
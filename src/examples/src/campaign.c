@@ -0,0 +1,578 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <argp.h>
+
+#include <pthread.h>
+
+#include "cmnalib/traffic_curl.h"
+
+#include "cmnalib/traffic_types.h"
+#include "cmnalib/trace_logger.h"
+#include "cmnalib/logger.h"
+
+#include "cmnalib/at_sierra_wireless_mc7455.h"
+
+#define FAULT_RECOVERY_TIME_SEC 5
+#define MAX_TRANSFER_FAULTS 3
+#define STATUS_INTERVAL_SEC 1
+#define SCHEDULE_LINE_LENGTH 512
+#define LOG_RING_SLOTS 1024
+
+typedef enum program_state {
+    STATE_NORMAL_OPERATION = 0,
+    STATE_FAILURE_RESUME,
+    STATE_FINISH,
+} program_state_t;
+
+static volatile program_state_t state = STATE_NORMAL_OPERATION;
+
+const char *argp_program_version =
+        "campaign";
+const char *argp_program_bug_address =
+        "<robert.falkenberg@tu-dortmund.de>";
+
+static char doc[] =
+        "campaign -- long-running measurement campaign\n"
+        "Runs a schedule of transfers in an endless loop while the modem stays open. "
+        "Each line of the schedule file is one step:\n"
+        "  upload <bytes> [url]\n"
+        "  download <bytes> [url]\n"
+        "  idle <sec>\n"
+        "Empty lines and lines starting with # are ignored.";
+
+static char args_doc[] = "";
+
+static struct argp_option options[] = {
+    {"schedule", 'f', "FILE", 0,   "Read schedule from FILE (default: upload 5e6, idle 30)" },
+    {"output",   'o', "DIR",  0,   "Write traces to DIR instead of /tmp" },
+    {"address",  'a', "URL",  0,   "Default URL for transfers (default: mptcp1.pi21.de:5002)" },
+    {"interface",'I', "IFACE",0,   "Bind traffic to network interface or source address" },
+    {"device",   'd', "TTY",  0,   "AT port of the modem (default: first MC7455)" },
+    {"cycles",   'c', "N",    0,   "Number of schedule cycles, 0 for endless (default: 0)" },
+    {"rotate",   'R', "sec",  0,   "Start a new tracefile after sec (default: 3600)" },
+    {"interval", 'i', "sec",  0,   "Minimal interval for status reports in sec (default: 1.0)" },
+    {"wait",     'w', "sec",  0,   "Waittime between modem init and first transmission (default: 3)" },
+    {"fresh",    'F', 0,      0,   "Open a new connection for each transfer instead of reusing it" },
+    { 0 }
+};
+
+struct arguments {
+    char *schedule_file;
+    char *trace_dir;
+    char *url;
+    char *interface;
+    char *device;
+    int cycles;
+    int rotate_sec;
+    double interval_sec;
+    int wait_sec;
+    int fresh_connect;
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state) {
+    struct arguments *arguments = state->input;
+
+    switch (key)
+    {
+    case 'f':
+        arguments->schedule_file = arg;
+        break;
+    case 'o':
+        arguments->trace_dir = arg;
+        break;
+    case 'a':
+        arguments->url = arg;
+        break;
+    case 'I':
+        arguments->interface = arg;
+        break;
+    case 'd':
+        arguments->device = arg;
+        break;
+    case 'c':
+        arguments->cycles = atoi(arg);
+        break;
+    case 'R':
+        arguments->rotate_sec = atoi(arg);
+        break;
+    case 'i':
+        arguments->interval_sec = atof(arg);
+        break;
+    case 'w':
+        arguments->wait_sec = atoi(arg);
+        break;
+    case 'F':
+        arguments->fresh_connect = 1;
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+void int_handler(int sig) {
+    signal(sig, SIG_IGN);
+    INFO("Terminating by Signal %d\n", sig);
+    state = STATE_FINISH;
+}
+
+/*
+ * Schedule
+ */
+
+typedef enum step_type {
+    STEP_UPLOAD = 0,
+    STEP_DOWNLOAD,
+    STEP_IDLE,
+} step_type_t;
+
+typedef struct schedule_step {
+    step_type_t type;
+    size_t n_bytes;
+    double idle_sec;
+    char* url;              // NULL for default URL
+} schedule_step_t;
+
+typedef struct schedule {
+    schedule_step_t* steps;
+    int nof_steps;
+} schedule_t;
+
+static int schedule_add_step(schedule_t* schedule, step_type_t type, size_t n_bytes, double idle_sec, const char* url) {
+    schedule_step_t* steps = realloc(schedule->steps, (schedule->nof_steps + 1) * sizeof(schedule_step_t));
+    if(steps == NULL) {
+        ERROR("Error in realloc\n");
+        return -1;
+    }
+    schedule->steps = steps;
+    schedule_step_t* step = &schedule->steps[schedule->nof_steps++];
+    step->type = type;
+    step->n_bytes = n_bytes;
+    step->idle_sec = idle_sec;
+    step->url = url != NULL ? strdup(url) : NULL;
+    return 0;
+}
+
+void schedule_free(schedule_t* schedule) {
+    for(int i = 0; i < schedule->nof_steps; i++) {
+        free(schedule->steps[i].url);
+    }
+    free(schedule->steps);
+    schedule->steps = NULL;
+    schedule->nof_steps = 0;
+}
+
+int schedule_load(schedule_t* schedule, const char* filename) {
+    char line[SCHEDULE_LINE_LENGTH];
+    char keyword[32];
+    char value[64];
+    char url[SCHEDULE_LINE_LENGTH];
+    int line_number = 0;
+
+    FILE* f = fopen(filename, "r");
+    if(f == NULL) {
+        ERROR("Could not open schedule '%s': %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), f) != NULL) {
+        line_number++;
+        int n = sscanf(line, "%31s %63s %511s", keyword, value, url);
+        if(n <= 0 || keyword[0] == '#') continue;
+        if(n < 2) {
+            ERROR("%s:%d: missing value\n", filename, line_number);
+            goto error;
+        }
+
+        int ret;
+        if(strcasecmp(keyword, "upload") == 0) {
+            ret = schedule_add_step(schedule, STEP_UPLOAD, (size_t)atof(value), 0, n > 2 ? url : NULL);
+        }
+        else if(strcasecmp(keyword, "download") == 0) {
+            ret = schedule_add_step(schedule, STEP_DOWNLOAD, (size_t)atof(value), 0, n > 2 ? url : NULL);
+        }
+        else if(strcasecmp(keyword, "idle") == 0) {
+            ret = schedule_add_step(schedule, STEP_IDLE, 0, atof(value), NULL);
+        }
+        else {
+            ERROR("%s:%d: unknown step '%s'\n", filename, line_number, keyword);
+            goto error;
+        }
+        if(ret != 0) goto error;
+    }
+    fclose(f);
+
+    if(schedule->nof_steps == 0) {
+        ERROR("Schedule '%s' is empty\n", filename);
+        return -1;
+    }
+    INFO("Loaded schedule with %d steps\n", schedule->nof_steps);
+    return 0;
+
+error:
+    fclose(f);
+    schedule_free(schedule);
+    return -1;
+}
+
+/*
+ * Modem and status collection
+ */
+
+typedef struct campaign {
+    struct arguments* arguments;
+    tc_session_t* session;
+    sw_mc7455_t* modem;
+    pthread_t collector;
+    pthread_mutex_t lock;
+    sw_mc7455_gstatus_response_t* ltestatus;
+    sw_mc7455_lteinfo_response_t* lteinfo;
+
+    trace_handle_t* trace;
+    time_t trace_opened;
+    int trace_transmission_counter;
+    step_type_t current_step;
+} campaign_t;
+
+void* status_collector(void* void_campaign) {
+    campaign_t* c = (campaign_t*)void_campaign;
+    // refilled in place and swapped with the published pair
+    sw_mc7455_gstatus_response_t* ltestatus = NULL;
+    sw_mc7455_lteinfo_response_t* lteinfo = NULL;
+    sw_mc7455_gstatus_response_t* ltestatus_old;
+    sw_mc7455_lteinfo_response_t* lteinfo_old;
+
+    while(state == STATE_NORMAL_OPERATION) {
+        if(ltestatus == NULL) ltestatus = sw_mc7455_allocate_status();
+        if(lteinfo == NULL) lteinfo = sw_mc7455_allocate_lteinfo();
+        if(sw_mc7455_get_status_into(c->modem, ltestatus) >= SW_RESPONSE_CRITICAL ||
+           sw_mc7455_get_lteinfo_into(c->modem, lteinfo) >= SW_RESPONSE_CRITICAL) {
+            ERROR("Status collection failed\n");
+            if(state == STATE_NORMAL_OPERATION) state = STATE_FAILURE_RESUME;
+            break;
+        }
+
+        pthread_mutex_lock(&c->lock);
+        ltestatus_old = c->ltestatus;
+        lteinfo_old = c->lteinfo;
+        c->ltestatus = ltestatus;
+        c->lteinfo = lteinfo;
+        pthread_mutex_unlock(&c->lock);
+        ltestatus = ltestatus_old;
+        lteinfo = lteinfo_old;
+
+        sleep(STATUS_INTERVAL_SEC);
+    }
+    sw_mc7455_free_status(ltestatus);
+    sw_mc7455_free_lteinfo(lteinfo);
+    DEBUG("Asynchronous status collection finished\n");
+    return NULL;
+}
+
+int configure_modem(sw_mc7455_t* modem) {
+    sw_response_t ret;
+
+    ret = sw_mc7455_set_radio_access_type(modem, SW_MC7455_RAT_LTE_ONLY);
+    if(ret > SW_RESPONSE_SUCCESS) {
+        WARNING("Could not set radio access type to LTE only\n");
+    }
+
+    if(sw_mc7455_get_data_connection(modem) != DATA_CONNECTION_STATUS_ENABLED) {
+        ret = sw_mc7455_set_data_connection(modem, DATA_CONNECTION_STATUS_ENABLED);
+        if(ret > SW_RESPONSE_SUCCESS) {
+            ERROR("Could not establish data connection\n");
+            return -1;
+        }
+        DEBUG("Data connection established\n");
+    }
+
+    ret = sw_mc7455_start_gps_default(modem);
+    if(ret != SW_RESPONSE_SUCCESS) {
+        WARNING("GPS Activation Failed\n");
+    }
+    return 0;
+}
+
+int open_modem(campaign_t* c) {
+    if(c->arguments->device != NULL) {
+        c->modem = sw_mc7455_init(c->arguments->device);
+    }
+    else {
+        c->modem = sw_mc7455_init_first();
+    }
+    if(c->modem == NULL) {
+        ERROR("Could not initialize modem\n");
+        return -1;
+    }
+    if(configure_modem(c->modem) != 0) {
+        ERROR("Modem setup failed due to critical error\n");
+        sw_mc7455_destroy(c->modem);
+        c->modem = NULL;
+        return -1;
+    }
+    sleep(c->arguments->wait_sec);
+
+    if(pthread_create(&c->collector, NULL, status_collector, c) != 0) {
+        ERROR("Could not create status collector thread\n");
+        sw_mc7455_destroy(c->modem);
+        c->modem = NULL;
+        return -1;
+    }
+    INFO("Modem ready\n");
+    return 0;
+}
+
+void close_modem(campaign_t* c) {
+    if(c->modem != NULL) {
+        pthread_join(c->collector, NULL);
+        sw_mc7455_destroy(c->modem);
+        c->modem = NULL;
+
+        pthread_mutex_lock(&c->lock);
+        sw_mc7455_free_status(c->ltestatus);
+        sw_mc7455_free_lteinfo(c->lteinfo);
+        c->ltestatus = NULL;
+        c->lteinfo = NULL;
+        pthread_mutex_unlock(&c->lock);
+    }
+}
+
+/* re-check the data connection after repeated transfer faults */
+int recover_data_connection(campaign_t* c) {
+    WARNING("Repeated transfer faults, checking data connection\n");
+    if(sw_mc7455_get_data_connection(c->modem) == DATA_CONNECTION_STATUS_ENABLED) {
+        return 0;
+    }
+    if(sw_mc7455_set_data_connection(c->modem, DATA_CONNECTION_STATUS_ENABLED) > SW_RESPONSE_SUCCESS) {
+        return -1;
+    }
+    sleep(c->arguments->wait_sec);
+    return 0;
+}
+
+/*
+ * Traces
+ */
+
+int rotate_trace(campaign_t* c) {
+    time_t now = time(NULL);
+    if(c->trace != NULL && now - c->trace_opened < c->arguments->rotate_sec) {
+        return 0;
+    }
+
+    char timestring[80];
+    char tracefilename[255];
+    strftime(timestring, sizeof(timestring), "%Y%m%d-%H%M%S", localtime(&now));
+    snprintf(tracefilename, sizeof(tracefilename), "%s/cmna-campaign-%s.log", c->arguments->trace_dir, timestring);
+
+    trace_handle_t* trace = trace_init(tracefilename);
+    if(trace == NULL) {
+        return -1;
+    }
+    write_trace_header(trace);
+    trace_destroy(c->trace);
+    c->trace = trace;
+    c->trace_opened = now;
+    return 0;
+}
+
+int progress_callback(void* void_campaign, transfer_statusreport_t* status) {
+    campaign_t* c = (campaign_t*)void_campaign;
+    trace_data_t d = {0};
+    struct timeval t;
+    gettimeofday(&t, NULL);
+
+    d.time_sec = t.tv_sec;
+    d.time_usec = t.tv_usec;
+    d.trace_transmission_counter = c->trace_transmission_counter;
+    d.datarate = c->current_step == STEP_UPLOAD ? status->datarate_ul : status->datarate_dl;
+
+    pthread_mutex_lock(&c->lock);
+    if(c->ltestatus != NULL) {
+        d.sinr = c->ltestatus->sinr;
+        d.rsrq = c->ltestatus->rsrq;
+        d.pcc_rsrp = (c->ltestatus->pcc_rxm_rsrp + c->ltestatus->pcc_rxd_rsrp)/2;
+        d.scc_rsrp = (c->ltestatus->scc_rxm_rsrp + c->ltestatus->scc_rxd_rsrp)/2;
+        d.pcc_rssi = (c->ltestatus->pcc_rxm_rssi + c->ltestatus->pcc_rxd_rssi)/2;
+        d.scc_rssi = (c->ltestatus->scc_rxm_rssi + c->ltestatus->scc_rxd_rssi)/2;
+        d.tx_power = c->ltestatus->tx_power;
+        d.lte_band = c->ltestatus->lte_band;
+        d.lte_bw_MHz = c->ltestatus->lte_bw_MHz;
+        d.lte_rx_chan = c->ltestatus->lte_rx_chan;
+        d.lte_tx_chan = c->ltestatus->lte_tx_chan;
+        d.lte_scell_band = c->ltestatus->lte_scell_band;
+        d.lte_scell_bw_MHz = c->ltestatus->lte_scell_bw_MHz;
+        d.lte_scell_chan = c->ltestatus->lte_scell_chan;
+        d.cell_id = c->ltestatus->cell_id;
+    }
+    if(c->lteinfo != NULL) {
+        d.rxlv = c->lteinfo->rxlv;
+        d.mcc = c->lteinfo->mcc;
+        d.mnc = c->lteinfo->mnc;
+        d.tac = c->lteinfo->tac;
+        d.pci = c->lteinfo->pci;
+        d.nof_intrafreq_neighbours = c->lteinfo->nof_intrafreq_neighbours;
+        d.nof_interfreq_neighbours = c->lteinfo->nof_interfreq_neighbours;
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    write_trace(c->trace, &d);
+
+    // cancel transmission on fault or ctrl+c
+    return state == STATE_NORMAL_OPERATION ? 0 : -1;
+}
+
+/* sleep in small steps to react on state changes */
+void campaign_idle(double sec) {
+    struct timespec t;
+    while(sec > 0 && state == STATE_NORMAL_OPERATION) {
+        double chunk = sec < 1.0 ? sec : 1.0;
+        t.tv_sec = (time_t)chunk;
+        t.tv_nsec = (long)((chunk - t.tv_sec) * 1e9);
+        nanosleep(&t, NULL);
+        sec -= chunk;
+    }
+}
+
+int run_step(campaign_t* c, schedule_step_t* step) {
+    struct arguments* arguments = c->arguments;
+    const char* url = step->url != NULL ? step->url : arguments->url;
+    int ret = 0;
+
+    c->current_step = step->type;
+    switch(step->type) {
+    case STEP_UPLOAD:
+        INFO("Upload %zu bytes to %s\n", step->n_bytes, url);
+        ret = tc_session_upload_randomdata(c->session, url, step->n_bytes,
+                                           progress_callback, c, arguments->interval_sec);
+        c->trace_transmission_counter++;
+        break;
+    case STEP_DOWNLOAD:
+        INFO("Download %zu bytes from %s\n", step->n_bytes, url);
+        ret = tc_session_download_and_discard(c->session, url, step->n_bytes,
+                                              progress_callback, c, arguments->interval_sec);
+        c->trace_transmission_counter++;
+        break;
+    case STEP_IDLE:
+        DEBUG("Idle for %.1f sec\n", step->idle_sec);
+        campaign_idle(step->idle_sec);
+        break;
+    }
+    return ret;
+}
+
+int main(int argc, char** argv) {
+    struct arguments arguments;
+    arguments.schedule_file = NULL;
+    arguments.trace_dir = "/tmp";
+    arguments.url = "mptcp1.pi21.de:5002";
+    arguments.interface = NULL;
+    arguments.device = NULL;
+    arguments.cycles = 0;
+    arguments.rotate_sec = 3600;
+    arguments.interval_sec = 1.0;
+    arguments.wait_sec = 3;
+    arguments.fresh_connect = 0;
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+
+    schedule_t schedule = {0};
+    if(arguments.schedule_file != NULL) {
+        if(schedule_load(&schedule, arguments.schedule_file) != 0) {
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        schedule_add_step(&schedule, STEP_UPLOAD, 5000000, 0, NULL);
+        schedule_add_step(&schedule, STEP_IDLE, 0, 30, NULL);
+    }
+
+    signal(SIGINT, int_handler);
+    signal(SIGTERM, int_handler);
+
+    // Keep log output off the measurement threads
+    logger_start_async(LOG_RING_SLOTS);
+
+    campaign_t campaign;
+    memset(&campaign, 0, sizeof(campaign));
+    campaign.arguments = &arguments;
+    pthread_mutex_init(&campaign.lock, NULL);
+
+    // traffic session, keeps the connection across transfers
+    campaign.session = tc_session_init(arguments.interface,
+                                       arguments.fresh_connect ? TC_SESSION_FRESH_CONNECT : 0);
+    if(campaign.session == NULL) {
+        schedule_free(&schedule);
+        return EXIT_FAILURE;
+    }
+
+    int cycle = 0;
+    int step = 0;
+    int transfer_faults = 0;
+    while(state != STATE_FINISH) {
+        // (re-)open modem, without restarting the process
+        if(campaign.modem == NULL) {
+            if(open_modem(&campaign) != 0) {
+                campaign_idle(FAULT_RECOVERY_TIME_SEC);
+                continue;
+            }
+        }
+        if(rotate_trace(&campaign) != 0) {
+            state = STATE_FINISH;
+            break;
+        }
+
+        if(run_step(&campaign, &schedule.steps[step]) != 0) {
+            transfer_faults++;
+            if(transfer_faults >= MAX_TRANSFER_FAULTS) {
+                transfer_faults = 0;
+                if(recover_data_connection(&campaign) != 0 && state == STATE_NORMAL_OPERATION) {
+                    state = STATE_FAILURE_RESUME;
+                }
+            }
+        }
+        else {
+            transfer_faults = 0;
+        }
+
+        if(state == STATE_FAILURE_RESUME) {
+            WARNING("Modem failure, reopening in %d sec\n", FAULT_RECOVERY_TIME_SEC);
+            close_modem(&campaign);
+            sleep(FAULT_RECOVERY_TIME_SEC);
+            // was there an ctrl+c ? -> quit
+            if(state == STATE_FINISH) break;
+            state = STATE_NORMAL_OPERATION;
+            // repeat the interrupted step
+            continue;
+        }
+
+        step++;
+        if(step == schedule.nof_steps) {
+            step = 0;
+            cycle++;
+            INFO("Finished cycle %d\n", cycle);
+            if(arguments.cycles > 0 && cycle >= arguments.cycles) {
+                state = STATE_FINISH;
+            }
+        }
+    }
+
+    close_modem(&campaign);
+    trace_destroy(campaign.trace);
+    tc_session_destroy(campaign.session);
+    pthread_mutex_destroy(&campaign.lock);
+    schedule_free(&schedule);
+    logger_stop_async();
+
+    return EXIT_SUCCESS;
+}
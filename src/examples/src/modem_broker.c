@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include <argp.h>
+
+#include "cmnalib/at_sierra_wireless_em7565.h"
+#include "cmnalib/at_sierra_wireless_em7565_events.h"
+#include "cmnalib/meas_broker.h"
+#include "cmnalib/meas_shm.h"
+#include "cmnalib/meas_delta.h"
+#include "cmnalib/meas_neighbour_db.h"
+#include "cmnalib/logger.h"
+
+const char *argp_program_version =
+        "modem_broker";
+const char *argp_program_bug_address =
+        "<robert.falkenberg@tu-dortmund.de>";
+
+static char doc[] =
+        "modem_broker -- Polls one EM7565 and serves its samples to local clients over a Unix socket\n"
+        "DEVICE is the AT port of the modem (or mock:FILE). With --subscribe, the program "
+        "connects to a running broker instead and prints the received samples";
+
+static char args_doc[] = "[DEVICE]";
+
+#define DEFAULT_SOCKET_PATH "/tmp/cmnalib_broker.sock"
+
+static struct argp_option options[] = {
+    {"secondary", 's', "DEVICE", 0, "Second AT port for long and configuration commands" },
+    {"socket",    'S', "PATH",   0, "Path of the broker socket (default: " DEFAULT_SOCKET_PATH ")" },
+    {"interval",  'i', "ms",     0, "Sampling interval (default: 1000)" },
+    {"fast",      'f', "ms",     0, "Sampling interval for 5 s after a handover or cell change (default: 100, 0 disables)" },
+    {"shm",       'm', "NAME",   0, "Also publish the latest sample in this shared memory segment (e.g. /cmnalib_em7565_0)" },
+    {"record",    'r', "FILE",   0, "Also record the samples change-only to FILE" },
+    {"neighbours",'n', "FILE",   0, "Aggregate the neighbour cells and save them to FILE on exit" },
+    {"subscribe", 'c', 0,        0, "Run as client and print the samples of a running broker" },
+    {"quiet",     'q', 0,        0, "Don't produce any log output" },
+    { 0 }
+};
+
+struct arguments {
+    const char* device;
+    const char* secondary;
+    const char* socket_path;
+    const char* shm_name;
+    const char* record_file;
+    const char* neighbour_file;
+    int interval_ms;
+    int fast_interval_ms;
+    int subscribe;
+    int quiet;
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state) {
+    struct arguments *arguments = state->input;
+
+    switch (key)
+    {
+    case 's':
+        arguments->secondary = arg;
+        break;
+    case 'S':
+        arguments->socket_path = arg;
+        break;
+    case 'i':
+        arguments->interval_ms = atoi(arg);
+        break;
+    case 'f':
+        arguments->fast_interval_ms = atoi(arg);
+        break;
+    case 'm':
+        arguments->shm_name = arg;
+        break;
+    case 'r':
+        arguments->record_file = arg;
+        break;
+    case 'n':
+        arguments->neighbour_file = arg;
+        break;
+    case 'c':
+        arguments->subscribe = 1;
+        break;
+    case 'q':
+        arguments->quiet = 1;
+        break;
+    case ARGP_KEY_ARG:
+        if(state->arg_num >= 1) argp_usage(state);
+        arguments->device = arg;
+        break;
+    case ARGP_KEY_END:
+        if((arguments->device == NULL && !arguments->subscribe) || arguments->interval_ms < 1 || arguments->fast_interval_ms < 0) {
+            argp_usage (state);
+        }
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+static volatile sig_atomic_t running = 1;
+
+void int_handler(int sig) {
+    signal(sig, SIG_IGN);
+    running = 0;
+}
+
+static int64_t now_ms() {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return (int64_t)t.tv_sec * 1000 + t.tv_usec / 1000;
+}
+
+static void print_sample(const meas_sample_t* s) {
+    printf("%llu.%06llu", (unsigned long long)(s->timestamp_us / 1000000), (unsigned long long)(s->timestamp_us % 1000000));
+    if(meas_sample_has(s, MEAS_FIELD_PCI))      printf(" pci=%d", s->pci);
+    if(meas_sample_has(s, MEAS_FIELD_EARFCN))   printf(" earfcn=%d", s->earfcn);
+    if(meas_sample_has(s, MEAS_FIELD_CELL_ID))  printf(" cell_id=%d", s->cell_id);
+    if(meas_sample_has(s, MEAS_FIELD_RSRP))     printf(" rsrp=%.1f", s->rsrp);
+    if(meas_sample_has(s, MEAS_FIELD_RSRQ))     printf(" rsrq=%.1f", s->rsrq);
+    if(meas_sample_has(s, MEAS_FIELD_SINR))     printf(" sinr=%.1f", s->sinr);
+    if(meas_sample_has(s, MEAS_FIELD_TX_POWER)) printf(" tx_power=%d", s->tx_power);
+    printf("\n");
+    fflush(stdout);
+}
+
+static int run_client(const struct arguments* arguments) {
+    meas_broker_client_t* client = meas_broker_connect(arguments->socket_path);
+    if(client == NULL || meas_broker_subscribe(client) != 0) {
+        meas_broker_disconnect(client);
+        return EXIT_FAILURE;
+    }
+    meas_sample_t sample;
+    while(running) {
+        int ret = meas_broker_receive(client, &sample, 500);
+        if(ret < 0) break;
+        if(ret > 0) print_sample(&sample);
+    }
+    meas_broker_disconnect(client);
+    return EXIT_SUCCESS;
+}
+
+static int run_broker(const struct arguments* arguments) {
+    sw_em7565_t* modem = sw_em7565_init_ports(arguments->device, arguments->secondary);
+    if(modem == NULL) {
+        ERROR("Could not open modem at %s\n", arguments->device);
+        return EXIT_FAILURE;
+    }
+    meas_broker_t* broker = meas_broker_create(arguments->socket_path);
+    meas_shm_t* shm = NULL;
+    if(arguments->shm_name != NULL) {
+        shm = meas_shm_create(arguments->shm_name);
+    }
+    meas_delta_writer_t* record = NULL;
+    if(arguments->record_file != NULL) {
+        record = meas_delta_writer_init(arguments->record_file, MEAS_DELTA_DEFAULT_KEYFRAME_INTERVAL);
+    }
+    if(broker == NULL || (arguments->shm_name != NULL && shm == NULL) ||
+       (arguments->record_file != NULL && record == NULL)) {
+        meas_delta_writer_destroy(record);
+        meas_shm_close(shm);
+        meas_broker_destroy(broker);
+        sw_em7565_destroy(modem);
+        return EXIT_FAILURE;
+    }
+
+    sw_em7565_event_detector_config_t config;
+    sw_em7565_event_detector_default_config(&config);
+    config.interval_ms = arguments->interval_ms;
+    config.fast_interval_ms = arguments->fast_interval_ms > 0 ? arguments->fast_interval_ms : arguments->interval_ms;
+    sw_em7565_event_detector_t* detector = sw_em7565_event_detector_create(&config, NULL, NULL);
+
+    meas_neighbour_db_t* neighbours = NULL;
+    if(arguments->neighbour_file != NULL) {
+        neighbours = meas_neighbour_db_create(64);
+    }
+
+    sw_em7565_gstatus_response_t* status = sw_em7565_allocate_status();
+    sw_em7565_lteinfo_response_t* lteinfo = sw_em7565_allocate_lteinfo();
+    // trace fields plus what the detector compares
+    uint64_t fields = SW_EM7565_GSTATUS_TRACE | SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_TAC) |
+                      SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_RRC_STATE);
+    for(int i = 0; i < SW_EM7565_EVENT_NOF_SCC; i++) {
+        fields |= SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_LTE_SCC1_STATE + i * 4) |
+                  SW_EM7565_GSTATUS_BIT(SW_EM7565_GSTATUS_LTE_SCC1_CHAN + i * 4);
+    }
+
+    INFO("Serving %s on %s\n", arguments->device, arguments->socket_path);
+
+    int64_t next = now_ms();
+    while(running) {
+        meas_sample_t sample;
+        meas_sample_init(&sample, MEAS_SOURCE_POLL);
+        int have_status = sw_em7565_get_status_fields(modem, fields, status) == SW_RESPONSE_SUCCESS;
+        int have_lteinfo = sw_em7565_get_lteinfo(modem, lteinfo) == SW_RESPONSE_SUCCESS;
+        if(have_status || have_lteinfo) {
+            sw_em7565_fill_meas_sample(have_status ? status : NULL, have_lteinfo ? lteinfo : NULL, &sample);
+            if(detector != NULL) {
+                sw_em7565_event_detector_update(detector, sample.timestamp_us,
+                                                have_status ? status : NULL, have_lteinfo ? lteinfo : NULL);
+            }
+            if(neighbours != NULL && have_lteinfo) {
+                meas_neighbour_db_add_lteinfo(neighbours, lteinfo, &sample);
+            }
+            if(shm != NULL) meas_shm_publish(shm, &sample);
+            if(record != NULL) meas_delta_write(record, &sample);
+            int reached = meas_broker_publish(broker, &sample);
+            DEBUG("Published sample to %d of %d clients\n", reached, meas_broker_get_nof_clients(broker));
+        }
+        else {
+            WARNING("No measurement from modem\n");
+        }
+
+        // answer clients until the next sample is due
+        next += detector != NULL ? sw_em7565_event_detector_get_interval_ms(detector, now_ms() * 1000)
+                                 : arguments->interval_ms;
+        int64_t remaining;
+        while(running && (remaining = next - now_ms()) > 0) {
+            if(meas_broker_process(broker, (int)remaining) < 0) {
+                running = 0;
+            }
+        }
+        if(next < now_ms()) next = now_ms();
+    }
+
+    if(neighbours != NULL) {
+        INFO("Saving %d neighbour cells to %s\n", meas_neighbour_db_get_size(neighbours), arguments->neighbour_file);
+        meas_neighbour_db_save(neighbours, arguments->neighbour_file);
+        meas_neighbour_db_destroy(neighbours);
+    }
+    sw_em7565_event_detector_destroy(detector);
+    sw_em7565_free_status(status);
+    sw_em7565_free_lteinfo(lteinfo);
+    if(record != NULL) {
+        INFO("Recorded %lu samples in %lu bytes\n", record->nof_records, record->nof_bytes);
+    }
+    meas_delta_writer_destroy(record);
+    meas_shm_close(shm);
+    meas_broker_destroy(broker);
+    sw_em7565_destroy(modem);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+
+    struct arguments arguments;
+    memset(&arguments, 0, sizeof(arguments));
+    arguments.socket_path = DEFAULT_SOCKET_PATH;
+    arguments.interval_ms = 1000;
+    arguments.fast_interval_ms = 100;
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+
+    if(arguments.quiet) logger_set_all_levels(LOGGER_VERBOSE_NONE);
+
+    signal(SIGINT, int_handler);
+    signal(SIGTERM, int_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    return arguments.subscribe ? run_client(&arguments) : run_broker(&arguments);
+}
@@ -0,0 +1,380 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <argp.h>
+
+#include <pthread.h>
+
+#include "cmnalib/traffic_multipath.h"
+
+#include "cmnalib/traffic_types.h"
+#include "cmnalib/trace_logger.h"
+#include "cmnalib/logger.h"
+
+#include "cmnalib/at_sierra_wireless_mc7455.h"
+#include "cmnalib/hotplug.h"
+#include "cmnalib/inventory.h"
+
+#define MAX_MODEMS 8
+#define STATUS_INTERVAL_SEC 1
+
+static volatile int running = 1;
+
+const char *argp_program_version =
+        "multipath_test";
+const char *argp_program_bug_address =
+        "<robert.falkenberg@tu-dortmund.de>";
+
+static char doc[] =
+        "multipath_test -- concurrent transfers over several modems\n"
+        "Each modem is given as TTY,IFACE, e.g. -m /dev/ttyUSB2,wwan0 -m /dev/ttyUSB5,wwan1. "
+        "If IFACE is omitted, the network interface of the same USB device is used. "
+        "All transfers start at the same time, each modem writes its own trace.";
+
+static char args_doc[] = "";
+
+static struct argp_option options[] = {
+    {"modem",    'm', "TTY[,IFACE]", 0, "Add a modem by its AT port and network interface" },
+    {"output",   'o', "DIR",  0,   "Write traces to DIR instead of /tmp" },
+    {"address",  'a', "URL",  0,   "Set target URL instead of mptcp1.pi21.de:5002" },
+    {"download", 'd', 0,      0,   "Download instead of upload" },
+    {"repeats",  'n', "N",    0,   "Number of repetitions (default: 1)" },
+    {"pause",    'p', "sec",  0,   "Pause between repetitions in sec (default: 30)" },
+    {"size",     's', "bytes",0,   "Payload size in bytes (default: 5e6)" },
+    {"interval", 'i', "sec",  0,   "Minimal interval for status reports in sec (default: 1.0)" },
+    { 0 }
+};
+
+typedef struct modem_config {
+    char* tty;
+    char* interface;
+} modem_config_t;
+
+struct arguments {
+    modem_config_t modems[MAX_MODEMS];
+    int nof_modems;
+    char *trace_dir;
+    char *url;
+    int download;
+    int repeats;
+    int repeat_pause;
+    int payload_size;
+    double interval_sec;
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state) {
+    struct arguments *arguments = state->input;
+    char* separator;
+
+    switch (key)
+    {
+    case 'm':
+        if(arguments->nof_modems >= MAX_MODEMS) {
+            argp_usage (state);
+        }
+        separator = strchr(arg, ',');
+        if(separator != NULL) {
+            *separator = 0;
+        }
+        arguments->modems[arguments->nof_modems].tty = arg;
+        arguments->modems[arguments->nof_modems].interface = separator != NULL ? separator + 1 : NULL;
+        arguments->nof_modems++;
+        break;
+    case 'o':
+        arguments->trace_dir = arg;
+        break;
+    case 'a':
+        arguments->url = arg;
+        break;
+    case 'd':
+        arguments->download = 1;
+        break;
+    case 'n':
+        arguments->repeats = atoi(arg);
+        break;
+    case 'p':
+        arguments->repeat_pause = atoi(arg);
+        break;
+    case 's':
+        arguments->payload_size = atoi(arg);
+        break;
+    case 'i':
+        arguments->interval_sec = atof(arg);
+        break;
+    case ARGP_KEY_END:
+        if(arguments->nof_modems == 0) {
+            argp_usage (state);
+        }
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+/**
+  Fill in missing network interfaces from the device inventory.
+  Resolved names are allocated and returned in resolved[] for release.
+*/
+int resolve_interfaces(modem_config_t* modems, int nof_modems, char** resolved) {
+    int ret = 0;
+    int nof_missing = 0;
+    for(int i = 0; i < nof_modems; i++) {
+        if(modems[i].interface == NULL) nof_missing++;
+    }
+    if(nof_missing == 0) return 0;
+
+    hotplug_monitor_t* monitor = hotplug_monitor_start(hotplug_source_udev("tty,usbmisc,net"));
+    inventory_t* inventory = inventory_create(monitor);
+    if(inventory == NULL) {
+        ERROR("Device inventory unavailable\n");
+        hotplug_monitor_stop(monitor);
+        return -1;
+    }
+
+    for(int i = 0; i < nof_modems; i++) {
+        if(modems[i].interface != NULL) continue;
+
+        inventory_modem_t* modem = inventory_find_by_endpoint(inventory, modems[i].tty);
+        if(modem != NULL && modem->endpoints[INVENTORY_ENDPOINT_NETDEV] != NULL) {
+            resolved[i] = strdup(modem->endpoints[INVENTORY_ENDPOINT_NETDEV]);
+            modems[i].interface = resolved[i];
+            INFO("Using interface %s for %s\n", modems[i].interface, modems[i].tty);
+        }
+        else {
+            ERROR("No network interface found for %s\n", modems[i].tty);
+            ret = -1;
+        }
+        inventory_modem_free(modem);
+    }
+
+    inventory_destroy(inventory);
+    hotplug_monitor_stop(monitor);
+    return ret;
+}
+
+void int_handler(int sig) {
+    signal(sig, SIG_IGN);
+    INFO("Terminating by Signal %d\n", sig);
+    running = 0;
+}
+
+/**
+  Everything belonging to one modem: its AT handle, the latest status
+  gathered by the collector thread and the trace of its transfers.
+*/
+typedef struct modem_path {
+    const modem_config_t* config;
+    sw_mc7455_t* modem;
+    pthread_t collector;
+    pthread_mutex_t lock;
+    sw_mc7455_gstatus_response_t* ltestatus;
+    sw_mc7455_lteinfo_response_t* lteinfo;
+    trace_handle_t* trace;
+    int trace_transmission_counter;
+    int is_upload;
+} modem_path_t;
+
+void* status_collector(void* void_path) {
+    modem_path_t* path = (modem_path_t*)void_path;
+    // refilled in place and swapped with the published pair
+    sw_mc7455_gstatus_response_t* ltestatus = NULL;
+    sw_mc7455_lteinfo_response_t* lteinfo = NULL;
+    sw_mc7455_gstatus_response_t* ltestatus_old;
+    sw_mc7455_lteinfo_response_t* lteinfo_old;
+    int failed;
+
+    while(running) {
+        if(ltestatus == NULL) ltestatus = sw_mc7455_allocate_status();
+        if(lteinfo == NULL) lteinfo = sw_mc7455_allocate_lteinfo();
+        failed = sw_mc7455_get_status_into(path->modem, ltestatus) >= SW_RESPONSE_CRITICAL ||
+                 sw_mc7455_get_lteinfo_into(path->modem, lteinfo) >= SW_RESPONSE_CRITICAL;
+        if(failed) {
+            WARNING("Status collection on %s failed\n", path->config->tty);
+        }
+
+        pthread_mutex_lock(&path->lock);
+        ltestatus_old = path->ltestatus;
+        lteinfo_old = path->lteinfo;
+        path->ltestatus = failed ? NULL : ltestatus;
+        path->lteinfo = failed ? NULL : lteinfo;
+        pthread_mutex_unlock(&path->lock);
+
+        if(failed) {
+            // keep the refilled pair for the next round
+            sw_mc7455_free_status(ltestatus_old);
+            sw_mc7455_free_lteinfo(lteinfo_old);
+        } else {
+            ltestatus = ltestatus_old;
+            lteinfo = lteinfo_old;
+        }
+
+        sleep(STATUS_INTERVAL_SEC);
+    }
+    sw_mc7455_free_status(ltestatus);
+    sw_mc7455_free_lteinfo(lteinfo);
+    return NULL;
+}
+
+int progress_callback(void* void_path, transfer_statusreport_t* status) {
+    modem_path_t* path = (modem_path_t*)void_path;
+    trace_data_t d = {0};
+    struct timeval t;
+    gettimeofday(&t, NULL);
+
+    d.time_sec = t.tv_sec;
+    d.time_usec = t.tv_usec;
+    d.trace_transmission_counter = path->trace_transmission_counter;
+    d.datarate = path->is_upload ? status->datarate_ul : status->datarate_dl;
+
+    pthread_mutex_lock(&path->lock);
+    if(path->ltestatus != NULL) {
+        d.sinr = path->ltestatus->sinr;
+        d.rsrq = path->ltestatus->rsrq;
+        d.pcc_rsrp = (path->ltestatus->pcc_rxm_rsrp + path->ltestatus->pcc_rxd_rsrp)/2;
+        d.scc_rsrp = (path->ltestatus->scc_rxm_rsrp + path->ltestatus->scc_rxd_rsrp)/2;
+        d.pcc_rssi = (path->ltestatus->pcc_rxm_rssi + path->ltestatus->pcc_rxd_rssi)/2;
+        d.scc_rssi = (path->ltestatus->scc_rxm_rssi + path->ltestatus->scc_rxd_rssi)/2;
+        d.tx_power = path->ltestatus->tx_power;
+        d.lte_band = path->ltestatus->lte_band;
+        d.lte_bw_MHz = path->ltestatus->lte_bw_MHz;
+        d.lte_rx_chan = path->ltestatus->lte_rx_chan;
+        d.lte_tx_chan = path->ltestatus->lte_tx_chan;
+        d.lte_scell_band = path->ltestatus->lte_scell_band;
+        d.lte_scell_bw_MHz = path->ltestatus->lte_scell_bw_MHz;
+        d.lte_scell_chan = path->ltestatus->lte_scell_chan;
+        d.cell_id = path->ltestatus->cell_id;
+    }
+    if(path->lteinfo != NULL) {
+        d.rxlv = path->lteinfo->rxlv;
+        d.mcc = path->lteinfo->mcc;
+        d.mnc = path->lteinfo->mnc;
+        d.tac = path->lteinfo->tac;
+        d.pci = path->lteinfo->pci;
+        d.nof_intrafreq_neighbours = path->lteinfo->nof_intrafreq_neighbours;
+        d.nof_interfreq_neighbours = path->lteinfo->nof_interfreq_neighbours;
+    }
+    pthread_mutex_unlock(&path->lock);
+
+    write_trace(path->trace, &d);
+
+    // cancel transmission on ctrl+c
+    return running ? 0 : -1;
+}
+
+int open_path(modem_path_t* path, const modem_config_t* config, const char* trace_dir, int is_upload) {
+    char tracefilename[255];
+    char timestring[80];
+    time_t rawtime;
+    const char* ifname;
+
+    memset(path, 0, sizeof(modem_path_t));
+    path->config = config;
+    path->is_upload = is_upload;
+
+    path->modem = sw_mc7455_init(config->tty);
+    if(path->modem == NULL) {
+        ERROR("Could not initialize modem %s\n", config->tty);
+        return -1;
+    }
+
+    time(&rawtime);
+    strftime(timestring, sizeof(timestring), "%Y%m%d-%H%M%S", localtime(&rawtime));
+    ifname = strrchr(config->interface, '!');
+    ifname = ifname != NULL ? ifname + 1 : config->interface;
+    snprintf(tracefilename, sizeof(tracefilename), "%s/cmna-trace-%s-%s.log", trace_dir, timestring, ifname);
+    path->trace = trace_init(tracefilename);
+    if(path->trace == NULL) {
+        sw_mc7455_destroy(path->modem);
+        return -1;
+    }
+    write_trace_header(path->trace);
+
+    pthread_mutex_init(&path->lock, NULL);
+    if(pthread_create(&path->collector, NULL, status_collector, path) != 0) {
+        ERROR("Could not create status collector thread\n");
+        pthread_mutex_destroy(&path->lock);
+        trace_destroy(path->trace);
+        sw_mc7455_destroy(path->modem);
+        return -1;
+    }
+    return 0;
+}
+
+void close_path(modem_path_t* path) {
+    pthread_join(path->collector, NULL);
+    pthread_mutex_destroy(&path->lock);
+    sw_mc7455_free_status(path->ltestatus);
+    sw_mc7455_free_lteinfo(path->lteinfo);
+    trace_destroy(path->trace);
+    sw_mc7455_destroy(path->modem);
+}
+
+int main(int argc, char** argv) {
+    struct arguments arguments;
+    memset(&arguments, 0, sizeof(arguments));
+    arguments.trace_dir = "/tmp";
+    arguments.url = "mptcp1.pi21.de:5002";
+    arguments.repeats = 1;
+    arguments.repeat_pause = 30;
+    arguments.payload_size = 5e6;
+    arguments.interval_sec = 1.0;
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+
+    signal(SIGINT, int_handler);
+
+    char* resolved_interfaces[MAX_MODEMS] = {0};
+    if(resolve_interfaces(arguments.modems, arguments.nof_modems, resolved_interfaces) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    modem_path_t paths[MAX_MODEMS];
+    tc_multipath_job_t jobs[MAX_MODEMS];
+    int nof_paths = 0;
+    for(int i = 0; i < arguments.nof_modems; i++) {
+        if(open_path(&paths[nof_paths], &arguments.modems[i], arguments.trace_dir, !arguments.download) == 0) {
+            nof_paths++;
+        }
+    }
+    if(nof_paths < arguments.nof_modems) {
+        ERROR("Could not open all modems\n");
+        running = 0;
+    }
+
+    for(int r = 0; r < arguments.repeats && running; r++) {
+        if(r > 0) sleep(arguments.repeat_pause);
+        if(!running) break;
+
+        INFO("Starting Transmission %d/%d on %d modems\n", r+1, arguments.repeats, nof_paths);
+        for(int i = 0; i < nof_paths; i++) {
+            memset(&jobs[i], 0, sizeof(tc_multipath_job_t));
+            jobs[i].interface = paths[i].config->interface;
+            jobs[i].url = arguments.url;
+            jobs[i].direction = arguments.download ? TC_DIRECTION_DOWNLOAD : TC_DIRECTION_UPLOAD;
+            jobs[i].n_bytes = arguments.payload_size;
+            jobs[i].callback = progress_callback;
+            jobs[i].callback_context = &paths[i];
+            jobs[i].minimal_progress_interval_sec = arguments.interval_sec;
+            paths[i].trace_transmission_counter = r;
+        }
+        tc_multipath_run(jobs, nof_paths);
+    }
+
+    running = 0;
+    for(int i = 0; i < nof_paths; i++) {
+        close_path(&paths[i]);
+    }
+    for(int i = 0; i < arguments.nof_modems; i++) {
+        free(resolved_interfaces[i]);
+    }
+
+    return nof_paths == arguments.nof_modems ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -5,26 +5,50 @@
 
 #include "cmnalib/logger.h"
 
-#include "cmnalib/at_sierra_wireless_mc7455.h"
+#include "cmnalib/qmi_sierra_wireless_mc7455.h"
+#include "cmnalib/meas_stream.h"
+
+#define PARAM_LOG_QMI_DEVICE "/dev/cdc-wdm0"
+#define PARAM_LOG_STREAM_SIZE 64
+#define PARAM_LOG_WAIT_MS 1000
 
 int main(int argc, char** argv) {
 
-    sw_mc7455_t* modem;
-    modem = sw_mc7455_init("/dev/ttyUSB3");
+    const char* device = argc > 1 ? argv[1] : PARAM_LOG_QMI_DEVICE;
 
-    sw_mc7455_gstatus_response_t* ltestatus;
-    sw_response_t ret = 0;
+    // the modem reports by itself whenever a threshold is crossed, no polling
+    static const float rsrp[] = {-120, -115, -110, -105, -100, -95, -90, -85, -80};
+    static const float rsrq[] = {-20, -15, -10, -5};
+    static const float snr[] = {-5, 0, 5, 10, 15, 20};
+    qmi_mc7455_signal_thresholds_t thresholds = {
+        rsrp, sizeof(rsrp) / sizeof(rsrp[0]),
+        rsrq, sizeof(rsrq) / sizeof(rsrq[0]),
+        snr, sizeof(snr) / sizeof(snr[0]),
+    };
 
-    if(modem == NULL) ret = SW_RESPONSE_CRITICAL;
+    qmi_mc7455_t* modem = qmi_mc7455_init(device);
+    meas_stream_t* stream = meas_stream_create(PARAM_LOG_STREAM_SIZE);
 
-    while(ret < SW_RESPONSE_CRITICAL) {
-        ret = sw_mc7455_get_status(modem, &ltestatus);
-        ERROR("\n### %d\n", ltestatus->tx_power);
-        struct timespec t;
-        t.tv_nsec = 200000000;
-        t.tv_sec = 0;
-        nanosleep(&t, NULL);
+    sw_response_t ret = 0;
+
+    if(modem == NULL || stream == NULL) ret = SW_RESPONSE_CRITICAL;
+    else ret = qmi_mc7455_subscribe(modem, &thresholds, stream);
+
+    while(ret == SW_RESPONSE_SUCCESS) {
+        if(qmi_mc7455_process_indications(modem, PARAM_LOG_WAIT_MS) < 0) {
+            ret = SW_RESPONSE_ERROR;
+            break;
+        }
+        meas_sample_t sample;
+        while(meas_stream_pop(stream, &sample, 0) > 0) {
+            printf("%llu rsrp %.1f rsrq %.1f sinr %.1f\n",
+                   (unsigned long long)sample.timestamp_us,
+                   sample.rsrp, sample.rsrq, sample.sinr);
+        }
     }
 
-    return EXIT_SUCCESS;
+    qmi_mc7455_destroy(modem);
+    meas_stream_destroy(stream);
+
+    return ret == SW_RESPONSE_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
 }
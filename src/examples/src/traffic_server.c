@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include <argp.h>
+
+#include "cmnalib/traffic_curl.h"
+#include "cmnalib/traffic_server.h"
+
+#include "cmnalib/traffic_types.h"
+#include "cmnalib/logger.h"
+
+#define URL_BUFSIZE 128
+
+static volatile int running = 1;
+
+const char *argp_program_version =
+        "traffic_server";
+const char *argp_program_bug_address =
+        "<robert.falkenberg@tu-dortmund.de>";
+
+static char doc[] =
+        "traffic_server -- a local HTTP sink/source for traffic_test\n"
+        "POST/PUT bodies are discarded, GET /<n> returns <n> bytes";
+
+static char args_doc[] = "";
+
+static struct argp_option options[] = {
+    {"bind",     'b', "ADDR", 0,   "Listen on IPv4 address ADDR (default: 127.0.0.1)" },
+    {"port",     'p', "PORT", 0,   "Listen on PORT (default: 5002, 0 for any)" },
+    {"bench",    'x', 0,      0,   "Run a loopback upload/download benchmark and exit" },
+    {"size",     's', "bytes",0,   "Payload size for the benchmark in bytes (default: 1e9)" },
+    { 0 }
+};
+
+struct arguments {
+    char *bind_address;
+    int port;
+    int bench;
+    size_t payload_size;
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state) {
+    struct arguments *arguments = state->input;
+
+    switch (key)
+    {
+    case 'b':
+        arguments->bind_address = arg;
+        break;
+
+    case 'p':
+        arguments->port = atoi(arg);
+        break;
+
+    case 'x':
+        arguments->bench = 1;
+        break;
+
+    case 's':
+        arguments->payload_size = (size_t)atof(arg);
+        break;
+
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+void int_handler(int sig) {
+    signal(sig, SIG_IGN);
+    INFO("Terminating by Signal %d\n", sig);
+    running = 0;
+}
+
+int print_progress(void* user_context, transfer_statusreport_t* statusreport) {
+    const char* direction = (const char*)user_context;
+    if(statusreport->total_transfer_time > 0) {
+        INFO("%s: %zu bytes in %.3f s, %.1f MBit/s\n",
+             direction,
+             statusreport->total_transfered_bytes,
+             statusreport->total_transfer_time,
+             8e-6 * statusreport->total_transfered_bytes / statusreport->total_transfer_time);
+    }
+    return running ? 0 : 1;
+}
+
+int run_benchmark(tc_server_t* server, size_t payload_size) {
+    char url[URL_BUFSIZE];
+    int ret = 0;
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", tc_server_get_port(server));
+    ret |= tc_upload_randomdata(url, payload_size, print_progress, "Upload", 1.0);
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/%zu", tc_server_get_port(server), payload_size);
+    ret |= tc_download_and_discard(url, payload_size, print_progress, "Download", 1.0);
+
+    return ret;
+}
+
+int main(int argc, char** argv) {
+    struct arguments arguments;
+    arguments.bind_address = "127.0.0.1";
+    arguments.port = TC_SERVER_DEFAULT_PORT;
+    arguments.bench = 0;
+    arguments.payload_size = 1000*1000*1000;
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+
+    signal(SIGINT, int_handler);
+    signal(SIGTERM, int_handler);
+
+    tc_server_t* server = tc_server_start(arguments.bind_address,
+                                          arguments.bench ? 0 : arguments.port);
+    if(server == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    int ret = 0;
+    if(arguments.bench) {
+        ret = run_benchmark(server, arguments.payload_size);
+    }
+    else {
+        while(running) {
+            pause();
+        }
+    }
+
+    tc_server_stats_t stats;
+    tc_server_get_stats(server, &stats);
+    INFO("Served %zu requests on %zu connections, received %zu bytes, sent %zu bytes\n",
+         stats.nof_requests, stats.nof_connections, stats.bytes_received, stats.bytes_sent);
+
+    tc_server_stop(server);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -19,6 +19,7 @@
 #include "cmnalib/logger.h"
 
 #include "cmnalib/at_sierra_wireless_mc7455.h"
+#include "cmnalib/hotplug.h"
 
 #define TRACE_DIR "/tmp"
 #define FAULT_RECOVERY_TIME_SEC 5
@@ -26,7 +27,8 @@
 
 #define VERY_SMALL_VALUE (1e-3)
 
-#define INTERFACE_NAME "eth1"
+#define LOG_RING_SLOTS 1024
+#define LOG_RATELIMIT_SEC 10
 
 typedef enum program_state {
     STATE_NORMAL_OPERATION = 0,
@@ -48,8 +50,8 @@ static char doc[] =
 static char args_doc[] = "[defunct]ARG1 [defunct]ARG2";
 
 static struct argp_option options[] = {
-    {"verbose",  'v', 0,      0,  "[defunct] Produce verbose output" },
-    {"quiet",    'q', 0,      0,  "[defunct] Don't produce any output" },
+    {"verbose",  'v', 0,      0,  "Produce verbose output, including AT commands" },
+    {"quiet",    'q', 0,      0,  "Don't produce any output" },
 //  {"silent",   's', 0,      OPTION_ALIAS },
     {"output",   'o', "DIR",  0,   "Write traces to DIR instead of /tmp" },
     {"address",  'a', "URL",  0,   "Set target URL instead of mptcp1.pi21.de:5002" },
@@ -58,6 +60,8 @@ static struct argp_option options[] = {
     {"size",     's', "bytes",0,   "Payload size in bytes (default: 5e6)" },
     {"interval", 'i', "sec",  0,   "Minimal interval for status reports in sec (default: 1.0)" },
     {"wait",     'w', "sec",  0,   "Waittime between modem init and transmission (default: 3)" },
+    {"interface",'I', "IFACE",0,   "Bind traffic to network interface or source address (default: route)" },
+    {"fresh",    'F', 0,      0,   "Open a new connection for each repetition instead of reusing it" },
     { 0 }
 };
 
@@ -72,6 +76,8 @@ struct arguments {
     int repeat_pause;
     int payload_size;
     double interval_sec;
+    char *interface;
+    int fresh_connect;
 };
 
 /* Parse a single option. */
@@ -131,6 +137,14 @@ parse_opt (int key, char *arg, struct argp_state *state) {
         arguments->wait_sec = atoi(arg);
         break;
 
+    case 'I':
+        arguments->interface = arg;
+        break;
+
+    case 'F':
+        arguments->fresh_connect = 1;
+        break;
+
     default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -185,12 +199,14 @@ void* status_collector(void* void_context) {
     status_collector_context_t* context = (status_collector_context_t*)void_context;
 
     sw_response_t ret;
+    // refilled in place and swapped with the published set, so after the
+    // first two rounds nothing is allocated any more
+    sw_mc7455_gstatus_response_t* ltestatus = NULL;
+    sw_mc7455_lteinfo_response_t* lteinfo = NULL;
+    sw_mc7455_gpsloc_response_t* gps = NULL;
     sw_mc7455_gstatus_response_t* ltestatus_old;
     sw_mc7455_lteinfo_response_t* lteinfo_old;
     sw_mc7455_gpsloc_response_t* gps_old;
-    sw_mc7455_gstatus_response_t* ltestatus;
-    sw_mc7455_lteinfo_response_t* lteinfo;
-    sw_mc7455_gpsloc_response_t* gps;
 
     struct timeval t_start, t_end, t_delta, t_min, t_remain;
     t_min.tv_sec = 1;
@@ -201,17 +217,21 @@ void* status_collector(void* void_context) {
 
         gettimeofday(&t_start, NULL);
 
-        ret = sw_mc7455_get_status(context->modem, &ltestatus);
+        if(ltestatus == NULL) ltestatus = sw_mc7455_allocate_status();
+        if(lteinfo == NULL) lteinfo = sw_mc7455_allocate_lteinfo();
+        if(gps == NULL) gps = sw_mc7455_allocate_gpsloc();
+
+        ret = sw_mc7455_get_status_into(context->modem, ltestatus);
         if(ret >= SW_RESPONSE_CRITICAL) {
             *context->state = STATE_FAILURE_RESUME;
             break;
         }
-        ret = sw_mc7455_get_lteinfo(context->modem, &lteinfo);
+        ret = sw_mc7455_get_lteinfo_into(context->modem, lteinfo);
         if(ret >= SW_RESPONSE_CRITICAL) {
             *context->state = STATE_FAILURE_RESUME;
             break;
         }
-        ret = sw_mc7455_get_gpsloc(context->modem, &gps);
+        ret = sw_mc7455_get_gpsloc_into(context->modem, gps);
         if(ret >= SW_RESPONSE_CRITICAL) {
             *context->state = STATE_FAILURE_RESUME;
             break;
@@ -227,9 +247,9 @@ void* status_collector(void* void_context) {
         context->modem_status->gps = gps;
         pthread_mutex_unlock(&(context->modem_status->lock));
 
-        sw_mc7455_free_status(ltestatus_old);
-        sw_mc7455_free_lteinfo(lteinfo_old);
-        sw_mc7455_free_get_gpsloc(gps_old);
+        ltestatus = ltestatus_old;
+        lteinfo = lteinfo_old;
+        gps = gps_old;
 
         gettimeofday(&t_end, NULL);
         timeval_subtract(&t_delta, &t_end, &t_start);
@@ -242,6 +262,10 @@ void* status_collector(void* void_context) {
     }
     DEBUG("Asynchronous status collection finished\n");
 
+    sw_mc7455_free_status(ltestatus);
+    sw_mc7455_free_lteinfo(lteinfo);
+    sw_mc7455_free_get_gpsloc(gps);
+
     return NULL;
 }
 
@@ -303,7 +327,7 @@ int progress_callback(void* void_context, transfer_statusreport_t* status) {
             d.cell_id = ltestatus->cell_id;
         }
         else {
-            WARNING("INVALID ltestatus Data\n");
+            WARNING_RATELIMITED(LOG_RATELIMIT_SEC, "INVALID ltestatus Data\n");
             d.sinr = 0;
             d.rsrq = 0;
             d.pcc_rsrp = 0;
@@ -335,7 +359,7 @@ int progress_callback(void* void_context, transfer_statusreport_t* status) {
             d.nof_interfreq_neighbours = lteinfo->nof_interfreq_neighbours;
         }
         else {
-            WARNING("INVALID lteinfo Data\n");
+            WARNING_RATELIMITED(LOG_RATELIMIT_SEC, "INVALID lteinfo Data\n");
             d.rxlv = 0;
 
             d.mcc = 0;
@@ -357,7 +381,7 @@ int progress_callback(void* void_context, transfer_statusreport_t* status) {
             d.velocity_v = gps->velocity_v;
         }
         else {
-            WARNING("INVALID gps Data\n");
+            WARNING_RATELIMITED(LOG_RATELIMIT_SEC, "INVALID gps Data\n");
             d.latitude = 0;
             d.longitude = 0;
             d.altitude = 0;
@@ -404,9 +428,11 @@ void init_default_arguments(struct arguments* arguments) {
     arguments->repeat_pause = 30;
     arguments->payload_size = 5e6;
     arguments->interval_sec = 1.0;
+    arguments->interface = NULL;
+    arguments->fresh_connect = 0;
 }
 
-int configure_modem(sw_mc7455_t* modem) {
+int configure_modem(sw_mc7455_t* modem, const char* interface) {
     sw_response_t ret;
 
     // Init data connection
@@ -438,9 +464,11 @@ int configure_modem(sw_mc7455_t* modem) {
     // Restart ethernet interface
 //#define _RESTART_INTERFACE_
 #ifdef _RESTART_INTERFACE_
-    set_if_down(INTERFACE_NAME, 0);
-    sleep(2);
-    set_if_up(INTERFACE_NAME, 0);
+    if(interface != NULL) {
+        set_if_down((char*)interface, 0);
+        sleep(2);
+        set_if_up((char*)interface, 0);
+    }
 #endif
 
     // Configure GPS
@@ -486,6 +514,9 @@ void init_modem_status(modem_status_t* modem_status) {
 }
 
 void release_modem_status(modem_status_t* modem_status) {
+    sw_mc7455_free_status(modem_status->ltestatus);
+    sw_mc7455_free_lteinfo(modem_status->lteinfo);
+    sw_mc7455_free_get_gpsloc(modem_status->gps);
     pthread_mutex_destroy(&modem_status->lock);
 }
 
@@ -540,6 +571,7 @@ int perform_transmissions(int repeats,
                           int skip,
                           int repeat_pause,
                           const char* url,
+                          tc_session_t* session,
                           int payload_size,
                           progress_callback_context_t* context,
                           double interval_sec) {
@@ -548,7 +580,7 @@ int perform_transmissions(int repeats,
         if(i > skip) sleep(repeat_pause);    // skip sleep on first loop
 
         INFO("Starting Transmission %d/%d\n", i+1, repeats);
-        tc_upload_randomdata(url, payload_size, &progress_callback, context, interval_sec);
+        tc_session_upload_randomdata(session, url, payload_size, &progress_callback, context, interval_sec);
         context->trace_transmission_counter++;
 
         i++;
@@ -564,6 +596,16 @@ int main(int argc, char** argv) {
     init_default_arguments(&arguments);
     argp_parse (&argp, argc, argv, 0, 0, &arguments);
 
+    if(arguments.verbose) {
+        logger_set_all_levels(LOGGER_VERBOSE_DEBUG);
+    }
+    if(arguments.silent) {
+        logger_set_all_levels(LOGGER_VERBOSE_NONE);
+    }
+
+    // Keep log output off the measurement threads
+    logger_start_async(LOG_RING_SLOTS);
+
     state = STATE_NORMAL_OPERATION;
 
     // Setup signal handler
@@ -578,6 +620,13 @@ int main(int argc, char** argv) {
     }
     write_trace_header(trace);
 
+    // Track modem ports to reconnect quickly after a reset
+    hotplug_monitor_t* hotplug = hotplug_monitor_start(hotplug_source_udev("tty"));
+    unsigned long opened_generation = 0;
+    if(hotplug == NULL) {
+        WARNING("Hotplug monitor unavailable, falling back to polling\n");
+    }
+
     while(state <= STATE_FAILURE_RESUME) {
         if(state == STATE_FAILURE_RESUME) {
             faultcount++;
@@ -588,7 +637,20 @@ int main(int argc, char** argv) {
                 break;
             }
             WARNING("Try to recover from failure (%d/%d)\n", faultcount, MAX_FAULTS_TO_CANCEL);
-            sleep(FAULT_RECOVERY_TIME_SEC);
+            if(hotplug != NULL) {
+                // continue as soon as the modem re-enumerates, otherwise after the usual delay
+                hotplug_device_t* device = hotplug_wait_for_device(hotplug,
+                                                                   &sw_mc7455_hotplug_match,
+                                                                   opened_generation,
+                                                                   FAULT_RECOVERY_TIME_SEC * 1000);
+                if(device != NULL) {
+                    INFO("Modem reappeared at %s\n", device->device_name);
+                }
+                hotplug_device_destroy(device);
+            }
+            else {
+                sleep(FAULT_RECOVERY_TIME_SEC);
+            }
             // was there an ctrl+c ? -> quit
             if(state > STATE_FAILURE_RESUME) continue;
 
@@ -599,7 +661,13 @@ int main(int argc, char** argv) {
 
         // Open modem interface
         sw_mc7455_t* modem;
-        modem = sw_mc7455_init_first();
+        if(hotplug != NULL) {
+            modem = sw_mc7455_init_hotplug(hotplug, 0, 0);
+            opened_generation = hotplug_get_generation(hotplug);
+        }
+        else {
+            modem = sw_mc7455_init_first();
+        }
         if(modem == NULL) {
             ERROR("Could not initialize modem\n");
             state = STATE_FAILURE_RESUME;
@@ -608,7 +676,7 @@ int main(int argc, char** argv) {
         DEBUG("Opened modem\n");
 
         // Setup Modem for experiment
-        if(configure_modem(modem) != 0) {
+        if(configure_modem(modem, arguments.interface) != 0) {
             ERROR("Modem setup failed due to critical error\n");
             state = STATE_FAILURE_RESUME;
             sw_mc7455_destroy(modem);
@@ -630,15 +698,21 @@ int main(int argc, char** argv) {
         // Reset faultcounter
         faultcount = 0;
 
+        // Traffic session, keeps the connection across repetitions
+        tc_session_t* session = tc_session_init(arguments.interface,
+                                                arguments.fresh_connect ? TC_SESSION_FRESH_CONNECT : 0);
+
         // Run the transmission loop
         finished_repeats = perform_transmissions(arguments.repeats,
                                                  finished_repeats,
                                                  arguments.repeat_pause,
                                                  arguments.url,
+                                                 session,
                                                  arguments.payload_size,
                                                  context,
                                                  arguments.interval_sec);
         release_progress_callback_context(context);
+        tc_session_destroy(session);
 
         if(state == STATE_NORMAL_OPERATION) state = STATE_FINISH;
 
@@ -648,6 +722,8 @@ int main(int argc, char** argv) {
     }
 
     trace_destroy(trace);
+    hotplug_monitor_stop(hotplug);
+    logger_stop_async();
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include <argp.h>
+
+#include "cmnalib/traffic_udp.h"
+
+#include "cmnalib/traffic_types.h"
+#include "cmnalib/logger.h"
+
+static volatile int running = 1;
+
+const char *argp_program_version =
+        "udp_test";
+const char *argp_program_bug_address =
+        "<robert.falkenberg@tu-dortmund.de>";
+
+static char doc[] =
+        "udp_test -- UDP traffic generator with one-way delay and loss measurement\n"
+        "Run with --receive on one end and --address on the other";
+
+static char args_doc[] = "";
+
+static struct argp_option options[] = {
+    {"receive",  'r', 0,      0,   "Run as receiver" },
+    {"address",  'a', "HOST", 0,   "Send to HOST" },
+    {"port",     'p', "PORT", 0,   "UDP port (default: 5003)" },
+    {"rate",     'b', "bps",  0,   "CBR bitrate in bits/sec (default: 1e6)" },
+    {"size",     's', "bytes",0,   "Packet size in bytes (default: 1000)" },
+    {"burst",    'B', "N",    0,   "Send bursts of N packets instead of CBR" },
+    {"burst-interval", 'I', "sec", 0, "Interval between bursts in sec (default: 0.1)" },
+    {"time",     't', "sec",  0,   "Duration of transmission in sec (default: 10)" },
+    {"interval", 'i', "sec",  0,   "Minimal interval for status reports in sec (default: 1.0)" },
+    {"output",   'o', "FILE", 0,   "Receiver: write per-packet records to FILE" },
+    { 0 }
+};
+
+struct arguments {
+    int receive;
+    char *host;
+    int port;
+    double bitrate;
+    int packet_size;
+    int burst_packets;
+    double burst_interval_sec;
+    double duration_sec;
+    double interval_sec;
+    char *record_file;
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state) {
+    struct arguments *arguments = state->input;
+
+    switch (key)
+    {
+    case 'r':
+        arguments->receive = 1;
+        break;
+    case 'a':
+        arguments->host = arg;
+        break;
+    case 'p':
+        arguments->port = atoi(arg);
+        break;
+    case 'b':
+        arguments->bitrate = atof(arg);
+        break;
+    case 's':
+        arguments->packet_size = atoi(arg);
+        break;
+    case 'B':
+        arguments->burst_packets = atoi(arg);
+        break;
+    case 'I':
+        arguments->burst_interval_sec = atof(arg);
+        break;
+    case 't':
+        arguments->duration_sec = atof(arg);
+        break;
+    case 'i':
+        arguments->interval_sec = atof(arg);
+        break;
+    case 'o':
+        arguments->record_file = arg;
+        break;
+    case ARGP_KEY_END:
+        if(!arguments->receive && arguments->host == NULL) {
+            argp_usage (state);
+        }
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+void int_handler(int sig) {
+    signal(sig, SIG_IGN);
+    INFO("Terminating by Signal %d\n", sig);
+    running = 0;
+}
+
+int print_sender_progress(void* user_context, transfer_statusreport_t* statusreport) {
+    INFO("Sent %zu packets, %.3f MBit/s\n",
+         statusreport->udp_packets_sent,
+         8e-6 * statusreport->datarate_ul);
+    return running ? 0 : 1;
+}
+
+int print_receiver_progress(void* user_context, transfer_statusreport_t* statusreport) {
+    INFO("Received %zu/%zu packets, lost %zu, reordered %zu, duplicate %zu, "
+         "delay %.3f/%.3f/%.3f ms, jitter %.3f ms, %.3f MBit/s\n",
+         statusreport->udp_packets_received,
+         statusreport->udp_packets_sent,
+         statusreport->udp_packets_lost,
+         statusreport->udp_packets_reordered,
+         statusreport->udp_packets_duplicate,
+         1e3 * statusreport->delay_min,
+         1e3 * statusreport->delay_mean,
+         1e3 * statusreport->delay_max,
+         1e3 * statusreport->jitter,
+         8e-6 * statusreport->datarate_dl);
+    return 0;
+}
+
+int run_receiver(struct arguments* arguments) {
+    tc_udp_receiver_t* receiver = tc_udp_receiver_start(NULL,
+                                                        arguments->port,
+                                                        print_receiver_progress,
+                                                        NULL,
+                                                        arguments->interval_sec);
+    if(receiver == NULL) {
+        return -1;
+    }
+
+    while(running) {
+        pause();
+    }
+    tc_udp_receiver_stop(receiver);
+
+    if(arguments->record_file != NULL) {
+        FILE* f = fopen(arguments->record_file, "w");
+        if(f != NULL) {
+            tc_udp_receiver_write_records(receiver, f);
+            fclose(f);
+        }
+        else {
+            ERROR("Could not open file '%s'\n", arguments->record_file);
+        }
+    }
+
+    tc_udp_receiver_destroy(receiver);
+    return 0;
+}
+
+int run_sender(struct arguments* arguments) {
+    tc_udp_config_t config;
+    if(arguments->burst_packets > 0) {
+        tc_udp_init_config_burst(&config,
+                                 arguments->burst_packets,
+                                 arguments->burst_interval_sec,
+                                 arguments->packet_size,
+                                 arguments->duration_sec);
+    }
+    else {
+        tc_udp_init_config_cbr(&config,
+                               arguments->bitrate,
+                               arguments->packet_size,
+                               arguments->duration_sec);
+    }
+
+    int ret = tc_udp_send(arguments->host,
+                          arguments->port,
+                          &config,
+                          print_sender_progress,
+                          NULL,
+                          arguments->interval_sec);
+    return ret < 0 ? -1 : 0;
+}
+
+int main(int argc, char** argv) {
+    struct arguments arguments;
+    arguments.receive = 0;
+    arguments.host = NULL;
+    arguments.port = TC_UDP_DEFAULT_PORT;
+    arguments.bitrate = 1e6;
+    arguments.packet_size = 1000;
+    arguments.burst_packets = 0;
+    arguments.burst_interval_sec = 0.1;
+    arguments.duration_sec = 10;
+    arguments.interval_sec = 1.0;
+    arguments.record_file = NULL;
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+
+    signal(SIGINT, int_handler);
+    signal(SIGTERM, int_handler);
+
+    int ret;
+    if(arguments.receive) {
+        ret = run_receiver(&arguments);
+    }
+    else {
+        ret = run_sender(&arguments);
+    }
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}